@@ -0,0 +1,541 @@
+/*
+ *  Copyright (C) 2020-2025 Bernhard Schelling
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+// Headless benchmark which links the core statically and drives it through the libretro API with null video/audio.
+// It writes a set of synthetic DOS workloads into a work directory, then runs every workload on every CPU core type
+// in a separate child process (so each run starts from a fresh emulator) and prints the results as JSON.
+//
+// Usage: dosbox_pure_bench [-frames N] [-warmup N] [-cycles N] [-dir PATH] [-workloads a,b,..] [-cores a,b,..] [-out FILE] [-verbose]
+//
+// The interpreter cores execute one instruction per cycle so "mips" is directly comparable between builds. It only counts
+// cycles that were executed (see CPU_CyclesExecuted), the ones skipped while halted or waiting for I/O are "idle_cycles".
+// With non-fixed cycles (auto or max) only the host time per emulated millisecond is reported. To compare the
+// computed goto dispatch of the normal core against the plain switch, run it once on a default build and once after a clean
+// rebuild with MAKE_CPUFLAGS=-DC_CORE_NORMAL_GOTO=0 (the used dispatch is listed as "normal_dispatch" in the output).
+// On x86-64 the dynamic core is dynamic_x86 by default, MAKE_CPUFLAGS=-DDYNREC_X64 switches it to dynrec and adding
+// -DC_DYNREC_INLINE_TLB=0 disables the inline TLB memory accesses of dynrec (ARMv8 builds need =1 to enable them, the
+// used dynamic core is listed as "dynamic_core" in the output).
+
+#include "dosbox.h"
+#include "pic.h"
+#include "cpu.h"
+#include "../libretro-common/include/libretro.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#ifdef _WIN32
+#include <direct.h>
+#define popen _popen
+#define pclose _pclose
+#define DBPB_MKDIR(p) _mkdir(p)
+#else
+#include <sys/stat.h>
+#define DBPB_MKDIR(p) mkdir(p, 0755)
+#endif
+
+extern Bit32u DriveCalculateCRC32(const Bit8u *ptr, size_t len, Bit32u crc);
+
+struct DBPB_Workload { const char *name, *content, *desc; };
+static const DBPB_Workload dbpb_workloads[] =
+{
+	{ "integer", "INTEGER.COM",           "Tight 32-bit integer ALU loop with memory operands" },
+	{ "memory",  "MEMORY.COM",            "Byte/word/dword loads, stores and read-modify-writes over a 16 KB buffer" },
+	{ "mode13h", "MODE13H.COM",           "Mode 13h full screen REP MOVSD blits and per pixel writes" },
+	{ "timer",   "TIMER.COM",             "PIT at 10 kHz with an IRQ0 handler while polling PIT/PIC ports" },
+	{ "zipread", "FILES.ZIP#FILES.COM",   "Repeated sequential 32 KB reads of a deflated 512 KB file in a ZIP" },
+	{ "fatread", "FILES.IMG#A:FILES.COM", "Repeated sequential 32 KB reads of a 512 KB file on a FAT12 floppy image" },
+};
+static const char* dbpb_cores[] = { "normal", "simple", "dynamic" };
+
+// Machine code of the workload programs (all loop forever)
+static const Bit8u dbpb_com_integer[] =
+{
+	0x66,0x31,0xc0,                     //     xor eax,eax
+	0x66,0xbb,0x78,0x56,0x34,0x12,      //     mov ebx,0x12345678
+	0x66,0x31,0xc9,                     //     xor ecx,ecx
+	0xbe,0x00,0x10,                     //     mov si,0x1000
+	0x66,0x01,0xd8,                     // 1:  add eax,ebx
+	0x66,0x6b,0xd0,0x0d,                //     imul edx,eax,13
+	0x66,0x31,0xd3,                     //     xor ebx,edx
+	0x66,0xc1,0xc3,0x05,                //     rol ebx,5
+	0x66,0x89,0x04,                     //     mov [si],eax
+	0x83,0xc6,0x04,                     //     add si,4
+	0x81,0xe6,0xfc,0x1f,                //     and si,0x1ffc
+	0x66,0x2b,0x1c,                     //     sub ebx,[si]
+	0x66,0x41,                          //     inc ecx
+	0xf6,0xc1,0x07,                     //     test cl,7
+	0x75,0xde,                          //     jnz 1b
+	0x66,0xd1,0xe8,                     //     shr eax,1
+	0x66,0x11,0xcb,                     //     adc ebx,ecx
+	0xeb,0xd6,                          //     jmp 1b
+};
+static const Bit8u dbpb_com_memory[] =
+{
+	0x8c,0xc8,                          //     mov ax,cs
+	0x05,0x00,0x10,                     //     add ax,0x1000
+	0x8e,0xd8,                          //     mov ds,ax
+	0x31,0xf6,                          //     xor si,si
+	0x66,0x31,0xc0,                     //     xor eax,eax
+	0x66,0x8b,0x04,                     // 1:  mov eax,[si]
+	0x66,0x01,0x44,0x04,                //     add [si+4],eax
+	0x8a,0x5c,0x08,                     //     mov bl,[si+8]
+	0x88,0x5c,0x0c,                     //     mov [si+12],bl
+	0x8b,0x54,0x10,                     //     mov dx,[si+16]
+	0x01,0x54,0x14,                     //     add [si+20],dx
+	0x83,0xc6,0x04,                     //     add si,4
+	0x81,0xe6,0xfc,0x3f,                //     and si,0x3ffc
+	0xeb,0xe4,                          //     jmp 1b
+};
+static const Bit8u dbpb_com_mode13h[] =
+{
+	0xb8,0x13,0x00,                     //     mov ax,0x13
+	0xcd,0x10,                          //     int 0x10
+	0x8c,0xc8,                          //     mov ax,cs
+	0x05,0x00,0x10,                     //     add ax,0x1000
+	0x8e,0xd8,                          //     mov ds,ax
+	0x31,0xf6,                          //     xor si,si
+	0xb9,0x00,0x7d,                     //     mov cx,32000
+	0x89,0xf0,                          // 1:  mov ax,si
+	0x30,0xe0,                          //     xor al,ah
+	0x89,0x04,                          //     mov [si],ax
+	0x83,0xc6,0x02,                     //     add si,2
+	0xe2,0xf5,                          //     loop 1b
+	0xb8,0x00,0xa0,                     //     mov ax,0xa000
+	0x8e,0xc0,                          //     mov es,ax
+	0x31,0xdb,                          //     xor bx,bx
+	0x31,0xf6,                          // 2:  xor si,si
+	0x31,0xff,                          //     xor di,di
+	0xb9,0x80,0x3e,                     //     mov cx,16000
+	0xfc,                               //     cld
+	0x66,0xf3,0xa5,                     //     rep movsd
+	0x89,0xdf,                          //     mov di,bx
+	0xb9,0x40,0x01,                     //     mov cx,320
+	0x88,0xd8,                          //     mov al,bl
+	0x26,0x88,0x05,                     // 3:  mov es:[di],al
+	0x47,                               //     inc di
+	0xfe,0xc0,                          //     inc al
+	0xe2,0xf8,                          //     loop 3b
+	0x81,0xc3,0x40,0x01,                //     add bx,320
+	0x81,0xfb,0x00,0xfa,                //     cmp bx,64000
+	0x72,0xdc,                          //     jb 2b
+	0x31,0xdb,                          //     xor bx,bx
+	0xeb,0xd8,                          //     jmp 2b
+};
+static const Bit8u dbpb_com_timer[] =
+{
+	0xfa,                               //     cli
+	0x31,0xc0,                          //     xor ax,ax
+	0x8e,0xc0,                          //     mov es,ax
+	0x26,0xc7,0x06,0x20,0x00,0x33,0x01, //     mov word ptr es:[8*4],offset irq0
+	0x26,0x8c,0x0e,0x22,0x00,           //     mov es:[8*4+2],cs
+	0xb0,0x36,                          //     mov al,0x36
+	0xe6,0x43,                          //     out 0x43,al
+	0xb8,0x77,0x00,                     //     mov ax,119
+	0xe6,0x40,                          //     out 0x40,al
+	0x88,0xe0,                          //     mov al,ah
+	0xe6,0x40,                          //     out 0x40,al
+	0xfb,                               //     sti
+	0x30,0xc0,                          // 1:  xor al,al
+	0xe6,0x43,                          //     out 0x43,al
+	0xe4,0x40,                          //     in al,0x40
+	0x88,0xc4,                          //     mov ah,al
+	0xe4,0x40,                          //     in al,0x40
+	0xe4,0x21,                          //     in al,0x21
+	0xe4,0x61,                          //     in al,0x61
+	0xff,0x06,0x3f,0x01,                //     inc word ptr [count]
+	0xeb,0xec,                          //     jmp 1b
+	0x2e,0xff,0x06,0x41,0x01,           // irq0: inc word ptr cs:[ticks]
+	0x50,                               //     push ax
+	0xb0,0x20,                          //     mov al,0x20
+	0xe6,0x20,                          //     out 0x20,al
+	0x58,                               //     pop ax
+	0xcf,                               //     iret
+	0x00,0x00,0x00,0x00,                // count: dw 0, ticks: dw 0
+};
+static const Bit8u dbpb_com_files[] =
+{
+	0xb8,0x00,0x3d,                     // 1:  mov ax,0x3d00
+	0xba,0x22,0x01,                     //     mov dx,offset fname
+	0xcd,0x21,                          //     int 0x21
+	0x72,0xf6,                          //     jc 1b
+	0x89,0xc3,                          //     mov bx,ax
+	0xb4,0x3f,                          // 2:  mov ah,0x3f
+	0xb9,0x00,0x80,                     //     mov cx,0x8000
+	0xba,0x2e,0x01,                     //     mov dx,offset buf
+	0xcd,0x21,                          //     int 0x21
+	0x72,0x04,                          //     jc 3f
+	0x09,0xc0,                          //     or ax,ax
+	0x75,0xf0,                          //     jnz 2b
+	0xb4,0x3e,                          // 3:  mov ah,0x3e
+	0xcd,0x21,                          //     int 0x21
+	0xeb,0xde,                          //     jmp 1b
+	'C',':','\\','D','A','T','A','.','B','I','N',0, // fname (drive letter gets patched)
+};
+enum { DBPB_DATA_SIZE = 512 * 1024 };
+
+struct DBPB_Files
+{
+	static bool Write(const std::string& path, const std::vector<Bit8u>& data)
+	{
+		FILE* f = fopen(path.c_str(), "wb");
+		if (!f) { fprintf(stderr, "Could not write %s\n", path.c_str()); return false; }
+		bool res = (fwrite(&data[0], 1, data.size(), f) == data.size());
+		fclose(f);
+		return res;
+	}
+
+	static std::vector<Bit8u> Com(const Bit8u* code, size_t size)
+	{
+		return std::vector<Bit8u>(code, code + size);
+	}
+
+	static std::vector<Bit8u> FilesCom(char drive)
+	{
+		std::vector<Bit8u> res = Com(dbpb_com_files, sizeof(dbpb_com_files));
+		res[res.size() - 12] = (Bit8u)drive;
+		return res;
+	}
+
+	// Somewhat compressible data which resembles game assets (runs, repeated blocks and noise)
+	static std::vector<Bit8u> Data()
+	{
+		std::vector<Bit8u> res(DBPB_DATA_SIZE);
+		Bit32u seed = 1234;
+		for (size_t i = 0; i != res.size();)
+		{
+			seed = seed * 1103515245 + 12345;
+			size_t n = 1 + ((seed >> 8) & 63);
+			if (n > res.size() - i) n = res.size() - i;
+			switch ((seed >> 16) & 3)
+			{
+				case 0: memset(&res[i], (Bit8u)(seed >> 24), n); break;
+				case 1: if (i >= 1024) { memcpy(&res[i], &res[i - 1024 + (seed >> 24)], n); break; } // else fall through
+				default: for (size_t j = 0; j != n; j++) { seed = seed * 1103515245 + 12345; res[i + j] = (Bit8u)(seed >> 24); } break;
+			}
+			i += n;
+		}
+		return res;
+	}
+
+	// Minimal deflate encoder using the fixed Huffman table with greedy LZ77 matching
+	struct Deflate
+	{
+		std::vector<Bit8u> out;
+		Bit32u bitbuf, bitcount;
+
+		void Bits(Bit32u val, Bit32u num) { bitbuf |= val << bitcount; for (bitcount += num; bitcount >= 8; bitcount -= 8, bitbuf >>= 8) out.push_back((Bit8u)bitbuf); }
+		void Code(Bit32u code, Bit32u num) { Bit32u rev = 0; for (Bit32u i = 0; i != num; i++) rev |= ((code >> i) & 1) << (num - 1 - i); Bits(rev, num); }
+		void Sym(Bit32u sym)
+		{
+			if      (sym < 144) Code(0x30 + sym, 8);
+			else if (sym < 256) Code(0x190 + sym - 144, 9);
+			else if (sym < 280) Code(sym - 256, 7);
+			else                Code(0xC0 + sym - 280, 8);
+		}
+
+		Deflate(const std::vector<Bit8u>& in) : bitbuf(0), bitcount(0)
+		{
+			static const Bit16u lbase[29] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+			static const Bit8u  lbits[29] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+			static const Bit16u dbase[30] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+			static const Bit8u  dbits[30] = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+			std::vector<Bit32s> head(1 << 15, -1);
+			Bits(1, 1); Bits(1, 2); // final block with fixed Huffman codes
+			const size_t n = in.size();
+			for (size_t i = 0; i < n;)
+			{
+				size_t len = 0, dist = 0;
+				if (i + 3 <= n)
+				{
+					Bit32u h = ((in[i] << 10) ^ (in[i + 1] << 5) ^ in[i + 2]) & 0x7FFF;
+					Bit32s cand = head[h];
+					head[h] = (Bit32s)i;
+					if (cand >= 0 && i - cand <= 32768)
+						for (size_t max = (n - i < 258 ? n - i : 258); len != max && in[cand + len] == in[i + len];) len++;
+					dist = i - cand;
+				}
+				if (len < 3) { Sym(in[i++]); continue; }
+				int l = 28, d = 29;
+				while (lbase[l] > len) l--;
+				while (dbase[d] > dist) d--;
+				Sym(257 + l); Bits((Bit32u)(len - lbase[l]), lbits[l]);
+				Code((Bit32u)d, 5); Bits((Bit32u)(dist - dbase[d]), dbits[d]);
+				i += len;
+			}
+			Sym(256);
+			if (bitcount) out.push_back((Bit8u)bitbuf);
+		}
+	};
+
+	static void Put16(std::vector<Bit8u>& v, Bit32u x) { v.push_back((Bit8u)x); v.push_back((Bit8u)(x >> 8)); }
+	static void Put32(std::vector<Bit8u>& v, Bit32u x) { Put16(v, x & 0xFFFF); Put16(v, x >> 16); }
+
+	static std::vector<Bit8u> Zip(const std::vector<Bit8u>& com, const std::vector<Bit8u>& data)
+	{
+		struct Entry { const char* name; const std::vector<Bit8u>* raw; std::vector<Bit8u> packed; Bit16u method; Bit32u crc, ofs; } e[2] = { { "FILES.COM", &com }, { "DATA.BIN", &data } };
+		e[0].packed = com; e[0].method = 0;
+		e[1].packed = Deflate(data).out; e[1].method = 8;
+		std::vector<Bit8u> res, dir;
+		for (Entry& it : e)
+		{
+			Bit16u namelen = (Bit16u)strlen(it.name);
+			it.crc = DriveCalculateCRC32(&(*it.raw)[0], it.raw->size(), 0);
+			it.ofs = (Bit32u)res.size();
+			Put32(res, 0x04034b50); Put16(res, 20); Put16(res, 0); Put16(res, it.method); Put32(res, 0x21 << 16);
+			Put32(res, it.crc); Put32(res, (Bit32u)it.packed.size()); Put32(res, (Bit32u)it.raw->size()); Put16(res, namelen); Put16(res, 0);
+			res.insert(res.end(), it.name, it.name + namelen);
+			res.insert(res.end(), it.packed.begin(), it.packed.end());
+			Put32(dir, 0x02014b50); Put16(dir, 20); Put16(dir, 20); Put16(dir, 0); Put16(dir, it.method); Put32(dir, 0x21 << 16);
+			Put32(dir, it.crc); Put32(dir, (Bit32u)it.packed.size()); Put32(dir, (Bit32u)it.raw->size()); Put16(dir, namelen); Put16(dir, 0);
+			Put16(dir, 0); Put16(dir, 0); Put16(dir, 0); Put32(dir, 0); Put32(dir, it.ofs);
+			dir.insert(dir.end(), it.name, it.name + namelen);
+		}
+		Bit32u dirofs = (Bit32u)res.size();
+		res.insert(res.end(), dir.begin(), dir.end());
+		Put32(res, 0x06054b50); Put16(res, 0); Put16(res, 0); Put16(res, 2); Put16(res, 2);
+		Put32(res, (Bit32u)dir.size()); Put32(res, dirofs); Put16(res, 0);
+		return res;
+	}
+
+	// 1.44 MB FAT12 floppy image (1 sector per cluster, 224 root entries, 9 sectors per FAT)
+	static std::vector<Bit8u> FloppyImage(const std::vector<Bit8u>& com, const std::vector<Bit8u>& data)
+	{
+		enum { SECTORS = 2880, FAT_SECTORS = 9, ROOT_SECTOR = 1 + FAT_SECTORS * 2, DATA_SECTOR = ROOT_SECTOR + 14 };
+		std::vector<Bit8u> img(SECTORS * 512);
+		static const Bit8u bpb[] = { 0xEB,0x3C,0x90, 'M','S','D','O','S','5','.','0', 0x00,0x02, 1, 1,0, 2, 0xE0,0x00, 0x40,0x0B, 0xF0, FAT_SECTORS,0, 18,0, 2,0 };
+		memcpy(&img[0], bpb, sizeof(bpb));
+		img[510] = 0x55; img[511] = 0xAA;
+		const std::vector<Bit8u>* files[2] = { &com, &data };
+		const char* names[2] = { "FILES   COM", "DATA    BIN" };
+		Bit32u cluster = 2;
+		for (int f = 0; f != 2; f++)
+		{
+			Bit32u size = (Bit32u)files[f]->size(), count = (size + 511) / 512;
+			Bit8u* de = &img[ROOT_SECTOR * 512 + f * 32];
+			memcpy(de, names[f], 11);
+			de[11] = 0x20; de[24] = 0x21; de[26] = (Bit8u)cluster; de[27] = (Bit8u)(cluster >> 8);
+			de[28] = (Bit8u)size; de[29] = (Bit8u)(size >> 8); de[30] = (Bit8u)(size >> 16); de[31] = (Bit8u)(size >> 24);
+			memcpy(&img[(DATA_SECTOR + cluster - 2) * 512], &(*files[f])[0], size);
+			for (Bit32u i = 0; i != count; i++, cluster++)
+				SetFAT12(&img[512], cluster, (i == count - 1 ? 0xFFF : cluster + 1));
+		}
+		SetFAT12(&img[512], 0, 0xFF0); SetFAT12(&img[512], 1, 0xFFF);
+		memcpy(&img[(1 + FAT_SECTORS) * 512], &img[512], FAT_SECTORS * 512);
+		return img;
+	}
+
+	static void SetFAT12(Bit8u* fat, Bit32u cluster, Bit32u val)
+	{
+		Bit8u* p = fat + cluster * 3 / 2;
+		if (cluster & 1) { p[0] = (Bit8u)((p[0] & 0x0F) | (val << 4)); p[1] = (Bit8u)(val >> 4); }
+		else { p[0] = (Bit8u)val; p[1] = (Bit8u)((p[1] & 0xF0) | (val >> 8)); }
+	}
+
+	static bool WriteAll(const std::string& dir)
+	{
+		std::vector<Bit8u> data = Data();
+		return Write(dir + "INTEGER.COM", Com(dbpb_com_integer, sizeof(dbpb_com_integer)))
+			&& Write(dir + "MEMORY.COM", Com(dbpb_com_memory, sizeof(dbpb_com_memory)))
+			&& Write(dir + "MODE13H.COM", Com(dbpb_com_mode13h, sizeof(dbpb_com_mode13h)))
+			&& Write(dir + "TIMER.COM", Com(dbpb_com_timer, sizeof(dbpb_com_timer)))
+			&& Write(dir + "FILES.ZIP", Zip(FilesCom('C'), data))
+			&& Write(dir + "FILES.IMG", FloppyImage(FilesCom('A'), data));
+	}
+};
+
+struct DBPB_Frontend
+{
+	static std::string dir, core, cycles;
+	static bool verbose;
+
+	static void Log(enum retro_log_level level, const char *fmt, ...)
+	{
+		if (!verbose) return;
+		va_list ap; va_start(ap, fmt); vfprintf(stderr, fmt, ap); va_end(ap);
+	}
+
+	static bool Environment(unsigned cmd, void *data)
+	{
+		switch (cmd)
+		{
+			case RETRO_ENVIRONMENT_GET_LOG_INTERFACE: ((retro_log_callback*)data)->log = Log; return true;
+			case RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY: case RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY: *(const char**)data = dir.c_str(); return true;
+			case RETRO_ENVIRONMENT_SET_PIXEL_FORMAT: return true;
+			case RETRO_ENVIRONMENT_GET_VARIABLE:
+			{
+				retro_variable* var = (retro_variable*)data;
+				if      (!strcmp(var->key, "dosbox_pure_cpu_core"))   var->value = core.c_str();
+				else if (!strcmp(var->key, "dosbox_pure_cycles"))     var->value = cycles.c_str();
+				else if (!strcmp(var->key, "dosbox_pure_voodoo_perf")) var->value = "1";
+				else return false;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static void Video(const void *data, unsigned width, unsigned height, size_t pitch) { }
+	static size_t Audio(const int16_t *data, size_t frames) { return frames; }
+	static void Poll() { }
+	static int16_t Input(unsigned port, unsigned device, unsigned index, unsigned id) { return 0; }
+
+	// Runs a single workload on a single core and prints a JSON object, called in a child process
+	static int Run(const DBPB_Workload& w, Bit32u warmup, Bit32u frames)
+	{
+		retro_set_environment(Environment);
+		retro_set_video_refresh(Video);
+		retro_set_audio_sample_batch(Audio);
+		retro_set_input_poll(Poll);
+		retro_set_input_state(Input);
+		retro_init();
+		std::string path = dir + w.content;
+		retro_game_info info = {};
+		info.path = path.c_str();
+		if (!retro_load_game(&info)) { fprintf(stderr, "Loading %s failed\n", path.c_str()); return 1; }
+		retro_system_av_info av;
+		retro_get_system_av_info(&av);
+
+		for (Bit32u i = 0; i != warmup; i++) retro_run();
+		Bitu start_ticks = PIC_Ticks;
+		Bit32s start_cyclemax = CPU_CycleMax;
+		Bit64s start_executed = CPU_CyclesExecuted;
+		std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+		for (Bit32u i = 0; i != frames; i++) retro_run();
+		double host_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+		Bitu emu_ms = PIC_Ticks - start_ticks;
+
+		printf("{ \"workload\": \"%s\", \"core\": \"%s\", \"frames\": %u, \"emulated_ms\": %u, \"host_ms\": %.1f, \"host_ms_per_emulated_ms\": %.4f",
+			w.name, core.c_str(), (unsigned)frames, (unsigned)emu_ms, host_sec * 1000.0, (emu_ms ? host_sec * 1000.0 / emu_ms : 0.0));
+		if (CPU_CycleMax == start_cyclemax && !CPU_CycleAutoAdjust)
+		{
+			double executed = (double)(CPU_CyclesExecuted - start_executed), idle = (double)emu_ms * CPU_CycleMax - executed;
+			printf(", \"cycles_per_ms\": %d, \"executed_cycles\": %.0f, \"idle_cycles\": %.0f, \"executed_cycles_per_host_second\": %.0f, \"mips\": %.1f",
+				(int)CPU_CycleMax, executed, (idle > 0 ? idle : 0.0), (host_sec > 0 ? executed / host_sec : 0.0), (host_sec > 0 ? executed / host_sec / 1000000.0 : 0.0));
+		}
+		printf(", \"realtime_factor\": %.3f }", (host_sec > 0 ? emu_ms / 1000.0 / host_sec : 0.0));
+		fflush(stdout);
+
+		retro_unload_game();
+		retro_deinit();
+		return 0;
+	}
+};
+std::string DBPB_Frontend::dir, DBPB_Frontend::core, DBPB_Frontend::cycles;
+bool DBPB_Frontend::verbose;
+
+static bool DBPB_InList(const char* list, const char* name)
+{
+	if (!list) return true;
+	for (const char* p = list; (p = strstr(p, name)) != NULL; p++)
+		if ((p == list || p[-1] == ',') && (p[strlen(name)] == ',' || !p[strlen(name)]))
+			return true;
+	return false;
+}
+
+int main(int argc, char *argv[])
+{
+	Bit32u frames = 300, warmup = 60;
+	const char *workloads = NULL, *cores = NULL, *run = NULL, *outpath = NULL;
+	DBPB_Frontend::dir = "build/bench";
+	DBPB_Frontend::cycles = "200000";
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i], *val = (i + 1 < argc ? argv[i + 1] : NULL);
+		if      (!strcmp(arg, "-frames") && val)    { frames = (Bit32u)atoi(val); i++; }
+		else if (!strcmp(arg, "-warmup") && val)    { warmup = (Bit32u)atoi(val); i++; }
+		else if (!strcmp(arg, "-cycles") && val)    { DBPB_Frontend::cycles = val; i++; }
+		else if (!strcmp(arg, "-dir") && val)       { DBPB_Frontend::dir = val; i++; }
+		else if (!strcmp(arg, "-workloads") && val) { workloads = val; i++; }
+		else if (!strcmp(arg, "-cores") && val)     { cores = val; i++; }
+		else if (!strcmp(arg, "-run") && val)       { run = val; i++; }
+		else if (!strcmp(arg, "-out") && val)       { outpath = val; i++; }
+		else if (!strcmp(arg, "-verbose"))          { DBPB_Frontend::verbose = true; }
+		else
+		{
+			fprintf(stderr, "Usage: %s [-frames N] [-warmup N] [-cycles N] [-dir PATH] [-workloads a,b,..] [-cores a,b,..] [-out FILE] [-verbose]\n\nWorkloads:\n", argv[0]);
+			for (const DBPB_Workload& w : dbpb_workloads) fprintf(stderr, "  %-8s %s\n", w.name, w.desc);
+			fprintf(stderr, "\nCores:\n");
+			for (const char* c : dbpb_cores) fprintf(stderr, "  %s\n", c);
+			return 1;
+		}
+	}
+	if (DBPB_Frontend::dir.empty() || (DBPB_Frontend::dir.back() != '/' && DBPB_Frontend::dir.back() != '\\')) DBPB_Frontend::dir += '/';
+
+	if (run)
+	{
+		// Child process mode, run a single workload with the core given by -cores
+		DBPB_Frontend::core = (cores ? cores : "normal");
+		for (const DBPB_Workload& w : dbpb_workloads)
+			if (!strcmp(w.name, run))
+				return DBPB_Frontend::Run(w, warmup, frames);
+		fprintf(stderr, "Unknown workload %s\n", run);
+		return 1;
+	}
+
+	DBPB_MKDIR(DBPB_Frontend::dir.c_str());
+	if (!DBPB_Files::WriteAll(DBPB_Frontend::dir)) return 1;
+
+	FILE* out = (outpath ? fopen(outpath, "w") : stdout);
+	if (!out) { fprintf(stderr, "Could not write %s\n", outpath); return 1; }
+	#if C_CORE_NORMAL_GOTO
+	const char* normal_dispatch = "goto";
+	#else
+	const char* normal_dispatch = "switch";
+	#endif
+	#if C_DYNAMIC_X86
+	const char* dynamic_core = "dynamic_x86";
+	#elif C_DYNREC && C_DYNREC_INLINE_TLB && (defined(__x86_64__) || defined(__aarch64__) || _M_AMD64 || _M_ARM64)
+	const char* dynamic_core = "dynrec_inline_tlb";
+	#elif C_DYNREC
+	const char* dynamic_core = "dynrec";
+	#else
+	const char* dynamic_core = "none";
+	#endif
+	fprintf(out, "{\n  \"frames\": %u,\n  \"warmup\": %u,\n  \"cycles\": \"%s\",\n  \"normal_dispatch\": \"%s\",\n  \"dynamic_core\": \"%s\",\n  \"results\": [", (unsigned)frames, (unsigned)warmup, DBPB_Frontend::cycles.c_str(), normal_dispatch, dynamic_core);
+	fflush(out);
+	int failed = 0, count = 0;
+	for (const char* core : dbpb_cores)
+	{
+		if (!DBPB_InList(cores, core)) continue;
+		for (const DBPB_Workload& w : dbpb_workloads)
+		{
+			if (!DBPB_InList(workloads, w.name)) continue;
+			char cmd[1024];
+			snprintf(cmd, sizeof(cmd), "\"%s\" -run %s -cores %s -frames %u -warmup %u -cycles %s -dir \"%s\"%s",
+				argv[0], w.name, core, (unsigned)frames, (unsigned)warmup, DBPB_Frontend::cycles.c_str(), DBPB_Frontend::dir.c_str(), (DBPB_Frontend::verbose ? " -verbose" : ""));
+			std::string result;
+			if (FILE* p = popen(cmd, "r"))
+			{
+				char buf[512];
+				for (size_t n; (n = fread(buf, 1, sizeof(buf), p)) != 0;) result.append(buf, n);
+				if (pclose(p) != 0) result.clear();
+			}
+			if (result.empty()) { failed++; fprintf(stderr, "Running workload %s on core %s failed\n", w.name, core); continue; }
+			fprintf(out, "%s\n    %s", (count++ ? "," : ""), result.c_str());
+			fflush(out);
+			if (outpath) fprintf(stderr, "%s\n", result.c_str());
+		}
+	}
+	fprintf(out, "\n  ]\n}\n");
+	if (outpath) fclose(out);
+	return (failed ? 1 : 0);
+}
@@ -109,6 +109,7 @@ namespace DBP_Option
 		cpu_core,
 		bootos_ramdisk,
 		bootos_dfreespace,
+		bootos_compressdiff,
 		bootos_forcenormal,
 		// Audio
 		#ifndef DBP_STANDALONE
@@ -124,6 +125,7 @@ namespace DBP_Option
 		gus,
 		tandysound,
 		swapstereo,
+		cdaudio_resampler,
 		mixer_master,
 		mixer_disney,
 		mixer_spkr,
@@ -963,6 +965,15 @@ static retro_core_option_v2_definition option_defs[DBP_Option::_OPTIONS_TOTAL] =
 		{ { "1024", "1GB (default)" }, { "2048", "2GB" }, { "4096", "4GB" }, { "8192", "8GB" }, { "discard", "Discard Changes to D:" }, { "hide", "Disable D: Hard Disk (use only CD-ROM)" } },
 		"1024"
 	},
+	{
+		"dosbox_pure_bootos_compressdiff",
+		"Compress OS Disk Differences (restart required)", NULL,
+		"Compress new save files of D: drive changes and of 'Save Difference Per Content' with LZ4." "\n"
+		"This makes them smaller but slower to write. Existing save files keep the mode they were created with.", NULL,
+		DBP_OptionCat::System,
+		{ { "false", "Off (default)" }, { "true", "On" } },
+		"false"
+	},
 	{
 		"dosbox_pure_bootos_forcenormal",
 		"Force Normal Core in OS", NULL,
@@ -1113,6 +1124,16 @@ static retro_core_option_v2_definition option_defs[DBP_Option::_OPTIONS_TOTAL] =
 		{ { "false", "Off (default)" }, { "true", "On" } },
 		"false"
 	},
+	{
+		"dosbox_pure_cdaudio_resampler",
+		"CD Audio Resampling Quality", NULL,
+		"Quality of the conversion of CD audio tracks to the audio sample rate." "\n"
+		"Higher settings reduce aliasing but need more CPU time. Linear uses the cheap interpolation of the mixer." "\n"
+		"Changes apply the next time a CD audio track starts playing.", NULL,
+		DBP_OptionCat::Audio,
+		{ { "linear", "Linear" }, { "low", "Low" }, { "medium", "Medium (default)" }, { "high", "High" } },
+		"medium"
+	},
 	{
 		"dosbox_pure_mixer_master",
 		"Master Volume", NULL,
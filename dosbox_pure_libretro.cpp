@@ -76,7 +76,8 @@ static Bit16s dbp_content_year, dbp_forcefps;
 
 // DOSBOX AUDIO/VIDEO
 static Bit8u buffer_active, dbp_overscan;
-static bool dbp_doublescan, dbp_padding;
+static bool dbp_doublescan, dbp_padding, buffer_redraw;
+static Bit32u buffer_frames, buffer_submitted = (Bit32u)-1;
 static struct DBP_Buffer { Bit32u *video, width, height, cap, pad_x, pad_y, border_color; float ratio; } dbp_buffers[3];
 #ifndef DBP_STANDALONE
 static struct DBP_Audio { int16_t* audio; Bit32u length; } dbp_audio[2];
@@ -141,6 +142,7 @@ enum DBP_Event_Type : Bit8u
 	DBPET_TOGGLEOSD, DBPET_TOGGLEOSDUP,
 	DBPET_ACTIONWHEEL, DBPET_ACTIONWHEELUP,
 	DBPET_SHIFTPORT, DBPET_SHIFTPORTUP,
+	DBPET_REWIND, DBPET_REWINDUP,
 
 	DBPET_AXISMAPPAIR,
 	DBPET_CHANGEMOUNTS,
@@ -154,7 +156,7 @@ enum DBP_Event_Type : Bit8u
 
 	_DBPET_MAX
 };
-//static const char* DBP_Event_Type_Names[] = { "JOY1X", "JOY1Y", "JOY2X", "JOY2Y", "JOYMX", "JOYMY", "MOUSEMOVE", "MOUSEDOWN", "MOUSEUP", "MOUSESETSPEED", "MOUSERESETSPEED", "JOYHATSETBIT", "JOYHATUNSETBIT", "JOY1DOWN", "JOY1UP", "JOY2DOWN", "JOY2UP", "KEYDOWN", "KEYUP", "ONSCREENKEYBOARD", "ONSCREENKEYBOARDUP", "ACTIONWHEEL", "ACTIONWHEELUP", "SHIFTPORT", "SHIFTPORTUP", "AXIS_TO_KEY", "CHANGEMOUNTS", "REFRESHSYSTEM", "MAX" };
+//static const char* DBP_Event_Type_Names[] = { "JOY1X", "JOY1Y", "JOY2X", "JOY2Y", "JOYMX", "JOYMY", "MOUSEMOVE", "MOUSEDOWN", "MOUSEUP", "MOUSESETSPEED", "MOUSERESETSPEED", "JOYHATSETBIT", "JOYHATUNSETBIT", "JOY1DOWN", "JOY1UP", "JOY2DOWN", "JOY2UP", "KEYDOWN", "KEYUP", "ONSCREENKEYBOARD", "ONSCREENKEYBOARDUP", "ACTIONWHEEL", "ACTIONWHEELUP", "SHIFTPORT", "SHIFTPORTUP", "REWIND", "REWINDUP", "AXIS_TO_KEY", "CHANGEMOUNTS", "REFRESHSYSTEM", "MAX" };
 static const char *DBPDEV_Keyboard = "Keyboard", *DBPDEV_Mouse = "Mouse", *DBPDEV_Joystick = "Joystick";
 static const struct DBP_SpecialMapping { int16_t evt, meta; const char *dev, *name, *ymlid; } DBP_SpecialMappings[] =
 {
@@ -189,16 +191,17 @@ static const struct DBP_SpecialMapping { int16_t evt, meta; const char *dev, *na
 	{ DBPET_SHIFTPORT,      1, NULL, "Port #2 while holding" }, // 228
 	{ DBPET_SHIFTPORT,      2, NULL, "Port #3 while holding" }, // 229
 	{ DBPET_SHIFTPORT,      3, NULL, "Port #4 while holding" }, // 230
+	{ DBPET_REWIND,         0, NULL, "Rewind while holding", "rewind" }, // 231
 };
 #define DBP_SPECIALMAPPING(key) DBP_SpecialMappings[(key)-DBP_SPECIALMAPPINGS_KEY]
 enum { DBP_SPECIALMAPPINGS_KEY = 200, DBP_SPECIALMAPPINGS_MAX = 200+(sizeof(DBP_SpecialMappings)/sizeof(DBP_SpecialMappings[0])) };
-enum { DBP_SPECIALMAPPINGS_OSD = 225, DBP_SPECIALMAPPINGS_ACTIONWHEEL = 226 };
+enum { DBP_SPECIALMAPPINGS_OSD = 225, DBP_SPECIALMAPPINGS_ACTIONWHEEL = 226, DBP_SPECIALMAPPINGS_REWIND = 231 };
 enum { DBP_EVENT_QUEUE_SIZE = 256, DBP_DOWN_COUNT_MASK = 127, DBP_DOWN_BY_KEYBOARD = 128 };
 static struct DBP_Event { DBP_Event_Type type; Bit8u port; int val, val2; } dbp_event_queue[DBP_EVENT_QUEUE_SIZE];
 static int dbp_event_queue_write_cursor;
 static int dbp_event_queue_read_cursor;
 static int dbp_keys_down_count;
-static unsigned char dbp_keys_down[KBD_LAST + 21];
+static unsigned char dbp_keys_down[KBD_LAST + 22];
 static unsigned short dbp_keymap_dos2retro[KBD_LAST];
 static unsigned char dbp_keymap_retro2dos[RETROK_LAST];
 
@@ -358,6 +361,8 @@ static void DBP_QueueEvent(DBP_Event_Type type, Bit8u port, int val = 0, int val
 		case DBPET_ACTIONWHEELUP:  DBP_ASSERT(val >= 0 && val < 1); downs += KBD_LAST + 16; goto check_up;
 		case DBPET_SHIFTPORT:      DBP_ASSERT(val >= 0 && val < 4); downs += KBD_LAST + 17; goto check_down;
 		case DBPET_SHIFTPORTUP:    DBP_ASSERT(val >= 0 && val < 4); downs += KBD_LAST + 17; goto check_up;
+		case DBPET_REWIND:         DBP_ASSERT(val >= 0 && val < 1); downs += KBD_LAST + 21; goto check_down;
+		case DBPET_REWINDUP:       DBP_ASSERT(val >= 0 && val < 1); downs += KBD_LAST + 21; goto check_up;
 
 		check_down:
 			if (((++downs[val]) & DBP_DOWN_COUNT_MASK) > 1) return;
@@ -432,7 +437,7 @@ static void DBP_QueueEvent(DBP_Event_Type type, Bit8u port, int val = 0, int val
 
 static void DBP_ReleaseKeyEvents(bool onlyPhysicalKeys)
 {
-	for (Bit8u i = KBD_NONE + 1, iEnd = (onlyPhysicalKeys ? KBD_LAST : KBD_LAST + 21); i != iEnd; i++)
+	for (Bit8u i = KBD_NONE + 1, iEnd = (onlyPhysicalKeys ? KBD_LAST : KBD_LAST + 22); i != iEnd; i++)
 	{
 		if (!dbp_keys_down[i] || (onlyPhysicalKeys && (!(dbp_keys_down[i] & DBP_DOWN_BY_KEYBOARD) || input_state_cb(0, RETRO_DEVICE_KEYBOARD, 0, dbp_keymap_dos2retro[i])))) continue;
 		dbp_keys_down[i] = 1;
@@ -444,7 +449,8 @@ static void DBP_ReleaseKeyEvents(bool onlyPhysicalKeys)
 		else if (i < KBD_LAST + 15) { val -=  KBD_LAST +  7; type = DBPET_JOYHATUNSETBIT; }
 		else if (i < KBD_LAST + 16) { val -=  KBD_LAST + 15; type = DBPET_TOGGLEOSDUP; }
 		else if (i < KBD_LAST + 17) { val -=  KBD_LAST + 16; type = DBPET_ACTIONWHEELUP; }
-		else                        { val -=  KBD_LAST + 17; type = DBPET_SHIFTPORTUP; }
+		else if (i < KBD_LAST + 21) { val -=  KBD_LAST + 17; type = DBPET_SHIFTPORTUP; }
+		else                        { val -=  KBD_LAST + 21; type = DBPET_REWINDUP; }
 		DBP_QueueEvent(type, DBP_NO_PORT, val);
 	}
 }
@@ -1475,6 +1481,108 @@ Bitu GFX_SetSize(Bitu width, Bitu height, Bitu flags, double scalex, double scal
 	return GFX_GetBestMode(0);
 }
 
+//DBP: Pixel doubling and border filling for GFX_EndUpdate with SSE2 or NEON where available
+//#define DBP_GFX_SIMD_SELF_TEST
+#if !defined(__SSE2__) && (_M_IX86_FP == 2 || (defined(_M_AMD64) || defined(_M_X64)))
+#define __SSE2__ 1
+#endif
+#if defined(__SSE2__) && __SSE2__
+#include <emmintrin.h>
+#define DBP_GFX_SIMD
+typedef __m128i GfxVec;
+static INLINE GfxVec GfxVecLoad(const Bit32u* p) { return _mm_loadu_si128((const __m128i*)p); }
+static INLINE GfxVec GfxVecSet(Bit32u c) { return _mm_set1_epi32((int)c); }
+static INLINE void GfxVecStore(Bit32u* p, GfxVec v) { _mm_storeu_si128((__m128i*)p, v); }
+static INLINE void GfxVecStoreDoubled(Bit32u* p, GfxVec v) { GfxVecStore(p, _mm_unpacklo_epi32(v, v)); GfxVecStore(p + 4, _mm_unpackhi_epi32(v, v)); }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define DBP_GFX_SIMD
+typedef uint32x4_t GfxVec;
+static INLINE GfxVec GfxVecLoad(const Bit32u* p) { return vld1q_u32(p); }
+static INLINE GfxVec GfxVecSet(Bit32u c) { return vdupq_n_u32(c); }
+static INLINE void GfxVecStore(Bit32u* p, GfxVec v) { vst1q_u32(p, v); }
+static INLINE void GfxVecStoreDoubled(Bit32u* p, GfxVec v) { uint32x4x2_t d = { { v, v } }; vst2q_u32(p, d); }
+#endif
+
+static void DBP_FillPixels(Bit32u* p, Bit32u n, Bit32u col)
+{
+	#ifdef DBP_GFX_SIMD
+	for (const GfxVec v = GfxVecSet(col); n >= 4; n -= 4, p += 4) GfxVecStore(p, v);
+	#endif
+	for (; n; n--) *(p++) = col;
+}
+
+// Source lines are expanded in place, so lines need to be processed bottom to top and pixels right to left
+static void DBP_DoubleScanLine(Bit32u* trg, const Bit32u* src, Bit32u srcw, Bit32u pitch, Bit32u dblw, Bit32u dblh)
+{
+	if (!dblw)
+	{
+		if (trg != src) memcpy(trg, src, srcw * 4); // only the top line stays in place
+		memcpy(trg + pitch, src, srcw * 4);
+		return;
+	}
+	Bit32u x = srcw;
+	#ifdef DBP_GFX_SIMD
+	for (; x & 3; x--) { Bit32u p = src[x - 1], *t = trg + (x - 1) * 2; t[0] = t[1] = p; if (dblh) t[pitch] = t[pitch + 1] = p; }
+	if (dblh) for (; x; x -= 4) { GfxVec v = GfxVecLoad(src + x - 4); GfxVecStoreDoubled(trg + (x - 4) * 2, v); GfxVecStoreDoubled(trg + pitch + (x - 4) * 2, v); }
+	else      for (; x; x -= 4) { GfxVecStoreDoubled(trg + (x - 4) * 2, GfxVecLoad(src + x - 4)); }
+	#else
+	if (dblh) for (Bit32u *t = trg + x * 2; x--;) { t -= 2; t[0] = t[1] = t[pitch] = t[pitch+1] = src[x]; }
+	else      for (Bit32u *t = trg + x * 2; x--;) { t -= 2; t[0] = t[1] = src[x]; }
+	#endif
+}
+
+#ifdef DBP_GFX_SIMD_SELF_TEST
+static void DBP_GFX_SIMD_SelfTest()
+{
+	Bit32u *ref = (Bit32u*)malloc(1280 * 1000 * 4), *res = (Bit32u*)malloc(1280 * 1000 * 4), seed = 1234, errors = 0, usecs[4];
+	#define GFX_RAND() (seed = seed * 1103515245 + 12345, (seed >> 8))
+	for (int iter = 0; iter != 300; iter++)
+	{
+		// Compare against the scalar loops this replaced with random sizes, padding and double scan modes
+		const Bit32u srcw = 1 + GFX_RAND() % 640, srch = 1 + GFX_RAND() % 480, dblw = (iter & 1), dblh = !!(iter & 2) | !dblw, pad_x = GFX_RAND() % 8, pad_y = GFX_RAND() % 8;
+		const Bit32u pitch = (srcw << dblw) + pad_x * 2, trgpitch = pitch << dblh, height = (srch << dblh) + pad_y * 2, col = GFX_RAND();
+		for (Bit32u i = 0; i != pitch * height; i++) ref[i] = GFX_RAND();
+		memcpy(res, ref, pitch * height * 4);
+		for (Bit32u *pVid = ref + (pitch * pad_y + pad_x), *pLine = pVid + (pitch * (srch - 1)), *pTrgRight = pVid + (trgpitch * (srch - 1) + ((srcw - 1) << dblw)); pLine >= pVid; pLine -= pitch, pTrgRight -= trgpitch)
+		{
+			Bit32u *src = pLine + srcw, *srcEnd = pLine, *trg = pTrgRight;
+			if      (!dblw) for (; src != srcEnd; trg -= 1) trg[0] = trg[pitch] = *(--src);
+			else if (!dblh) for (; src != srcEnd; trg -= 2) trg[0] = trg[1] = *(--src);
+			else            for (; src != srcEnd; trg -= 2) trg[0] = trg[1] = trg[pitch] = trg[pitch+1] = *(--src);
+		}
+		Bit32u *v = ref, *topEnd = v + pitch * pad_y, *bottomStart = v + pitch * (height - pad_y), *vb, *vr, x;
+		for (vb = bottomStart; v != topEnd;) *(v++) = *(vb++) = col;
+		for (vr = v + (pitch - pad_x); v != bottomStart; v += (pitch - pad_x), vr += (pitch - pad_x)) { for (x = 0; x != pad_x; x++) *(v++) = *(vr++) = col; }
+
+		for (Bit32u *pVid = res + (pitch * pad_y + pad_x), y = srch; y--;)
+			DBP_DoubleScanLine(pVid + (trgpitch * y), pVid + (pitch * y), srcw, pitch, dblw, dblh);
+		DBP_FillPixels(res, pitch * pad_y, col);
+		DBP_FillPixels(res + pitch * (height - pad_y), pitch * pad_y, col);
+		if (pad_x) for (v = res + pitch * pad_y; v != res + pitch * (height - pad_y); v += pitch) { DBP_FillPixels(v, pad_x, col); DBP_FillPixels(v + pitch - pad_x, pad_x, col); }
+		if (memcmp(ref, res, pitch * height * 4)) errors++;
+	}
+	#undef GFX_RAND
+	for (int test = 0; test != 4; test++)
+	{
+		// 320x200 double scanned to 640x400 and a 640x480 frame with its borders filled (overscan of 4 on each side)
+		retro_time_t t = time_cb();
+		for (int iter = 0; iter != 1000; iter++)
+		{
+			if (test == 0) for (Bit32u *pVid = res, *pLine = pVid + (640 * 199), *pTrgRight = pVid + (1280 * 199 + 638); pLine >= pVid; pLine -= 640, pTrgRight -= 1280)
+				for (Bit32u *src = pLine + 320, *trg = pTrgRight; src != pLine; trg -= 2) trg[0] = trg[1] = trg[640] = trg[641] = *(--src);
+			if (test == 1) for (Bit32u y = 200; y--;) DBP_DoubleScanLine(res + 1280 * y, res + 640 * y, 320, 640, 1, 1);
+			if (test == 2) for (Bit32u *v = res, *vEnd = v + 656 * 496; v != vEnd;) *(v++) = iter;
+			if (test == 3) DBP_FillPixels(res, 656 * 496, iter);
+		}
+		usecs[test] = (Bit32u)(time_cb() - t);
+	}
+	free(ref);
+	free(res);
+	log_cb(RETRO_LOG_INFO, "[DOSBOX] GFX SIMD self test: %u errors, 1000x 320x200 to 640x400 scalar %u us vectorized %u us, 1000x 640x480 fill scalar %u us vectorized %u us\n", errors, usecs[0], usecs[1], usecs[2], usecs[3]);
+}
+#endif
+
 Bit8u* GFX_GetPixels(Bitu& pitch)
 {
 	DBP_Buffer& buf = dbp_buffers[(buffer_active + 1) % 3];
@@ -1524,7 +1632,7 @@ bool GFX_StartUpdate(Bit8u*& pixels, Bitu& pitch)
 void GFX_EndUpdate(const Bit16u *changedLines)
 {
 	if (!changedLines) return;
-	if (dbp_state == DBPSTATE_BOOT) return;
+	if (dbp_state == DBPSTATE_BOOT) { buffer_redraw = true; return; }
 
 	DBP_Buffer& buf = dbp_buffers[(buffer_active + 1) % 3];
 	//DBP_ASSERT((Bit8u*)buf.video == render.scale.outWrite - render.scale.outPitch * render.src.height); // this assert can fail after loading a save game
@@ -1532,37 +1640,38 @@ void GFX_EndUpdate(const Bit16u *changedLines)
 
 	const Bit32u dblw = (Bit32u)render.src.dblw, dblh = (Bit32u)render.src.dblh, srcw = (Bit32u)render.src.width, srch = (Bit32u)render.src.height;
 	if (render.aspect)
-	{
-		if (dbp_doublescan && (dblw | dblh))
-		{
-			const Bit32u pitch = buf.width, trgpitch = pitch<<dblh, padofs = (pitch * buf.pad_y + buf.pad_x);
-			for (Bit32u *pVid = buf.video + padofs, *pLine = pVid + (pitch * (srch - 1)), *pTrgRight = pVid + (trgpitch * (srch - 1) + ((srcw - 1) << dblw)); pLine >= pVid; pLine -= pitch, pTrgRight -= trgpitch)
-			{
-				Bit32u *src = pLine + srcw, *srcEnd = pLine, *trg = pTrgRight;
-				if      (!dblw) for (; src != srcEnd; trg -= 1) trg[0] = trg[pitch] = *(--src);
-				else if (!dblh) for (; src != srcEnd; trg -= 2) trg[0] = trg[1] = *(--src);
-				else            for (; src != srcEnd; trg -= 2) trg[0] = trg[1] = trg[pitch] = trg[pitch+1] = *(--src);
-			}
-		}
 		buf.ratio = (dbp_padding ? (4.0f / 3.0f) : ((srcw<<dblw) / ((srch<<dblh) * (float)render.src.ratio)));
-	}
 	else
 	{
 		// Use square pixels, if the correct aspect ratio is far off, we double or halve the aspect ratio
 		float sqr_ratio = ((float)buf.width / buf.height), sqr_to_corr = (((srcw<<dblw) / ((srch<<dblh) * (float)render.src.ratio)) / sqr_ratio);
 		buf.ratio = sqr_ratio * (sqr_to_corr > 1.66f ? 2.0f : (sqr_to_corr > 0.6f ? 1.0f : 0.5f));
 	}
+	const Bit32u border_color = ((buf.pad_x | buf.pad_y) ? (Bit32u)GFX_GetRGB(vga.dac.rgb[vga.attr.overscan_color].red<<2, vga.dac.rgb[vga.attr.overscan_color].green<<2, vga.dac.rgb[vga.attr.overscan_color].blue<<2) : 0);
+
+	// If the renderer tracked the changed lines and none did, the frame is the same as the one currently shown.
+	// Then there is no need to double scan or submit it, retro_run will pass a dupe frame to the frontend instead.
+	const DBP_Buffer& lbuf = dbp_buffers[buffer_active];
+	bool unchanged = (changedLines != (const Bit16u*)(size_t)1 && !buffer_redraw && lbuf.video && lbuf.width == buf.width && lbuf.height == buf.height && lbuf.pad_x == buf.pad_x && lbuf.pad_y == buf.pad_y
+		&& lbuf.ratio == buf.ratio && (!(buf.pad_x | buf.pad_y) || lbuf.border_color == border_color) && !(dbp_intercept_next && dbp_intercept_next->usegfx()) && !voodoo_ogl_is_showing());
+	for (Bit32u i = 0, y = 0; unchanged && y < srch && i <= srch; y += changedLines[i++])
+		if ((i & 1) && changedLines[i]) unchanged = false;
+	if (unchanged) goto skip_frame;
+
+	if (render.aspect && dbp_doublescan && (dblw | dblh))
+	{
+		const Bit32u pitch = buf.width, trgpitch = pitch<<dblh;
+		for (Bit32u *pVid = buf.video + (pitch * buf.pad_y + buf.pad_x), y = srch; y--;)
+			DBP_DoubleScanLine(pVid + (trgpitch * y), pVid + (pitch * y), srcw, pitch, dblw, dblh);
+	}
 
-	if (buf.pad_x | buf.pad_y)
+	if ((buf.pad_x | buf.pad_y) && border_color != buf.border_color)
 	{
-		Bit32u border_color = (Bit32u)GFX_GetRGB(vga.dac.rgb[vga.attr.overscan_color].red<<2, vga.dac.rgb[vga.attr.overscan_color].green<<2, vga.dac.rgb[vga.attr.overscan_color].blue<<2);
-		if (border_color != buf.border_color)
-		{
-			buf.border_color = border_color;
-			Bit32u px = buf.pad_x, py = buf.pad_y, w = buf.width, wb = (w - px), *v = buf.video, *topEnd = v + w * py, *bottomStart = v + w * (buf.height - py), *vb, *vr, x;
-			for (vb = bottomStart; v != topEnd;) *(v++) = *(vb++) = border_color;
-			for (vr = v + wb; v != bottomStart; v += wb, vr += wb) { for (x = 0; x != px; x++) *(v++) = *(vr++) = border_color; }
-		}
+		buf.border_color = border_color;
+		Bit32u px = buf.pad_x, py = buf.pad_y, w = buf.width, *v = buf.video, *bottomStart = v + w * (buf.height - py);
+		DBP_FillPixels(v, w * py, border_color);
+		DBP_FillPixels(bottomStart, w * py, border_color);
+		if (px) for (v += w * py; v != bottomStart; v += w) { DBP_FillPixels(v, px, border_color); DBP_FillPixels(v + w - px, px, border_color); }
 	}
 
 	if (dbp_intercept_next && dbp_intercept_next->usegfx())
@@ -1584,11 +1693,15 @@ void GFX_EndUpdate(const Bit16u *changedLines)
 	if (dbp_perf == DBP_PERF_DETAILED && !DBP_Run::autoinput.ptr)
 	#endif
 	{
-		const DBP_Buffer& lbuf = dbp_buffers[buffer_active];
-		bool diff = (!voodoo_ogl_is_showing() ? (!lbuf.video || lbuf.width != buf.width || lbuf.height != buf.height || memcmp(buf.video, lbuf.video, buf.width * buf.height * 4)) : voodoo_ogl_have_new_image());
+		// Frames with tracked lines that got here had changes, only untracked frames need to be compared
+		bool diff = (!voodoo_ogl_is_showing() ? (changedLines != (const Bit16u*)(size_t)1 || !lbuf.video || lbuf.width != buf.width || lbuf.height != buf.height || memcmp(buf.video, lbuf.video, buf.width * buf.height * 4)) : voodoo_ogl_have_new_image());
 		if (diff) { DBP_FPSCOUNT(dbp_fpscount_gfxend) dbp_perf_uniquedraw++; }
 	}
 	buffer_active = (buffer_active + 1) % 3;
+	buffer_frames++;
+	buffer_redraw = (dbp_intercept_next && dbp_intercept_next->usegfx());
+
+	skip_frame:
 
 	// frameskip is best to be modified in this function (otherwise it can be off by one)
 	dbp_framecount += 1 + render.frameskip.max;
@@ -1832,6 +1945,8 @@ void GFX_Events()
 			case DBPET_SHIFTPORT: DBP_WheelShiftOSD(e.port, true, (Bit8u)e.val); break;
 			case DBPET_SHIFTPORTUP: DBP_WheelShiftOSD(e.port, false, (Bit8u)e.val); break;
 
+			case DBPET_REWIND: case DBPET_REWINDUP: break; // handled on the main thread in DBP_RewindFrame
+
 			case DBPET_MOUSEMOVE:
 			{
 				#ifdef DBP_STANDALONE
@@ -1938,6 +2053,7 @@ void DBP_ShowSlowLoading()
 	Bit8u* pixels; Bitu pitch; GFX_StartUpdate(pixels, pitch);
 	buffer_active = (buffer_active + 1) % 3; // advance again
 	DBP_BufferDrawing& buf = (DBP_BufferDrawing&)dbp_buffers[buffer_active];
+	buffer_redraw = true;
 
 	// Show loading message
 	if (DBP_Run::autoinput.ptr) memset(buf.video, 0, buf.width * buf.height * 4); // keep black during auto input
@@ -2065,9 +2181,9 @@ static void DBP_PureXCopyProgram(Program** make)
 				dfDst->time = dfSrc->time;
 				dfDst->date = dfSrc->date;
 				dfDst->newtime = true;
-				Bit8u buf[4096];
-				for (Bit16u read, write; dfSrc->Read(buf, &(read = sizeof(buf))) && read;)
-					if (!dfDst->Write(buf, &(write = read)) || write != read)
+				std::vector<Bit8u> buf(256 * 1024);
+				for (Bit64u read, pos = 0; (read = dfSrc->ReadBulk(&buf[0], buf.size(), pos)) != 0; pos += read)
+					if (dfDst->WriteBulk(&buf[0], read, pos) != read)
 						{ dfDst->Close();delete dfDst; goto writeerr; } // disk full?
 				dfDst->Close();delete dfDst;
 			}
@@ -2337,6 +2453,10 @@ static bool check_variables()
 	DBP_Option::GetAndApply(sec_mixer, "swapstereo", DBP_Option::swapstereo);
 	extern bool dbp_swapstereo;
 	dbp_swapstereo = (bool)control->GetProp("mixer", "swapstereo")->GetValue(); // to also get dosbox.conf override
+	DBP_Option::GetAndApply(sec_mixer, "cdaudio_resampler", DBP_Option::cdaudio_resampler);
+	extern Bit8u dbp_cdaudio_resampler;
+	const char* cdaudio_resampler = (const char*)control->GetProp("mixer", "cdaudio_resampler")->GetValue();
+	dbp_cdaudio_resampler = (Bit8u)(cdaudio_resampler[0] == 'h' ? 3 : (cdaudio_resampler[0] == 'm' ? 2 : (cdaudio_resampler[0] == 'l' && cdaudio_resampler[1] == 'o' ? 1 : 0)));
 	DBP_MIXER_SetMasterVolume(dbp_mixer_option_to_gain(DBP_Option::mixer_master));
 	DBP_MIXER_SetChannelVolume("DISNEY", dbp_mixer_option_to_gain(DBP_Option::mixer_disney));
 	DBP_MIXER_SetChannelVolume("SPKR",   dbp_mixer_option_to_gain(DBP_Option::mixer_spkr));
@@ -3039,6 +3159,10 @@ void retro_init(void) //#3
 	struct retro_perf_callback perf;
 	if (environ_cb(RETRO_ENVIRONMENT_GET_PERF_INTERFACE, &perf) && perf.get_time_usec) time_cb = perf.get_time_usec;
 
+	#ifdef DBP_GFX_SIMD_SELF_TEST
+	DBP_GFX_SIMD_SelfTest();
+	#endif
+
 	// Set default port modes
 	dbp_port_mode[0] = dbp_port_mode[1] = dbp_port_mode[2] = dbp_port_mode[3] = DBP_PadMapping::MODE_MAPPER;
 
@@ -3397,6 +3521,49 @@ void retro_run_touchpad(bool has_press, Bit16s absx, Bit16s absy)
 		{ DBP_QueueEvent(DBPET_MOUSEUP, DBP_NO_PORT, down_btn); down_tick = 0; }
 }
 
+static Bit32u dbp_syncrender_runs; // calls to retro_run left until MIDI and OPL go back to rendering on a thread
+static void DBP_SetSynchronousRender(bool sync)
+{
+	extern void MIDI_SetSynchronousRender(bool sync);
+	extern void OPL_SetSynchronousRender(bool sync);
+	MIDI_SetSynchronousRender(sync);
+	OPL_SetSynchronousRender(sync);
+}
+
+static void DBP_HoldSynchronousRender()
+{
+	// Loading states out of order relies on the emulation being deterministic between them, don't render MIDI or OPL ahead on a thread
+	if (!dbp_syncrender_runs) DBP_SetSynchronousRender(true);
+	dbp_syncrender_runs = 120;
+}
+
+static void DBP_RewindFrame()
+{
+	// Core side rewind which stores a state every few frames while the rewind mapping is bound and steps back while it is held
+	enum { REWIND_FRAME_INTERVAL = 4 };
+	static Bit32u rewind_frames;
+	if (dbp_serializemode == DBPSERIALIZE_DISABLED || dbp_state != DBPSTATE_RUNNING || !dbp_game_running) return;
+	if (++rewind_frames < REWIND_FRAME_INTERVAL) return;
+	rewind_frames = 0;
+
+	bool bound = false;
+	for (const DBP_InputBind& b : dbp_input_binds)
+		if (b.evt == DBPET_REWIND || (b.evt == DBPET_AXISMAPPAIR && (DBP_MAPPAIR_GET(-1, b.meta) == DBP_SPECIALMAPPINGS_REWIND || DBP_MAPPAIR_GET(1, b.meta) == DBP_SPECIALMAPPINGS_REWIND)))
+			{ bound = true; break; }
+	for (const DBP_WheelItem& wi : dbp_wheelitems)
+		for (Bit8u i = 0; i != wi.key_count && !bound; i++)
+			bound = (wi.k[i] == DBP_SPECIALMAPPINGS_REWIND);
+	if (!bound) { DBPSerialize_RewindClear(); return; }
+
+	if (dbp_keys_down[KBD_LAST + 21])
+	{
+		DBP_HoldSynchronousRender();
+		DBPSerialize_RewindPop(true, true);
+	}
+	else
+		DBPSerialize_RewindPush(true, true);
+}
+
 void retro_run(void)
 {
 	#ifdef DBP_ENABLE_FPS_COUNTERS
@@ -3414,6 +3581,9 @@ void retro_run(void)
 
 	if (dbp_message_queue) run_emuthread_notify();
 
+	// Once the frontend stopped saving states for run-ahead or rollback netplay the context is back to normal
+	if (dbp_syncrender_runs && !--dbp_syncrender_runs) { DBP_SetSynchronousRender(false); MEM_SnapshotFree(MEM_SNAPSHOT_RUNAHEAD); }
+
 	if (!environ_cb(RETRO_ENVIRONMENT_GET_THROTTLE_STATE, &dbp_throttle))
 	{
 		bool fast_forward = false;
@@ -3516,6 +3686,7 @@ void retro_run(void)
 		if (dbp_state == DBPSTATE_EXITED || dbp_state == DBPSTATE_SHUTDOWN || dbp_state == DBPSTATE_REBOOT)
 		{
 			DBP_Buffer& buf = dbp_buffers[buffer_active];
+			buffer_redraw = true;
 			if (!dbp_crash_message.empty()) // unexpected shutdown
 				DBP_Shutdown();
 			else if (dbp_state == DBPSTATE_REBOOT || dbp_biosreboot)
@@ -3592,6 +3763,8 @@ void retro_run(void)
 
 	bool skip_emulate = (fpsboost > 1 && (((fpsboost_count++)%fpsboost)!=0)) || DBP_NeedFrameSkip(false);
 	DBP_ThreadControl(skip_emulate ? TCM_PAUSE_FRAME : TCM_FINISH_FRAME);
+	if (!skip_emulate) DBP_RewindFrame();
+	if (dbp_net_connected) { void DBP_Network_Flush(); DBP_Network_Flush(); } // send everything queued up while the emulation thread is paused
 
 	Bit32u tpfActual = 0, tpfTarget = 0, tpfDraws = 0;
 	#ifdef DBP_ENABLE_WAITSTATS
@@ -3631,7 +3804,8 @@ void retro_run(void)
 
 	// Read buffer_active before waking up emulation thread
 	const DBP_Buffer& buf = dbp_buffers[buffer_active];
-	Bit32u view_width = buf.width, view_height = buf.height;
+	Bit32u view_width = buf.width, view_height = buf.height, view_frame = buffer_frames;
+	bool view_redraw = buffer_redraw;
 
 	if (dbp_opengl_draw && voodoo_ogl_mainthread()) { view_width *= voodoo_ogl_scale; view_height *= voodoo_ogl_scale; }
 
@@ -3647,15 +3821,16 @@ void retro_run(void)
 	if (tpfActual)
 	{
 		extern const char* DBP_CPU_GetDecoderName();
+		extern Bit32u DBP_CPU_CacheKeptBlocks, DBP_CPU_CacheDroppedBlocks;
 		if (dbp_perf == DBP_PERF_DETAILED)
-			retro_notify(-1500, RETRO_LOG_INFO, "Speed: %4.1f%%, DOS: %dx%d@%4.2fhz, Actual: %4.2ffps, Drawn: %dfps, Cycles: %u (%s)"
+			retro_notify(-1500, RETRO_LOG_INFO, "Speed: %4.1f%%, DOS: %dx%d@%4.2fhz, Actual: %4.2ffps, Drawn: %dfps, Cycles: %u (%s), Cache on Load: %u kept/%u dropped"
 				#ifdef DBP_ENABLE_WAITSTATS
 				", Waits: p%u|f%u|z%u|c%u"
 				#endif
 				#ifdef DBP_ENABLE_FPS_COUNTERS
 				"\nRetro: %u, GfxStart: %u, GfxEnd: %u, Event: %u, SkipRun: %u, SkipRender: %u"
 				#endif
-				, ((float)tpfTarget / (float)tpfActual * 100), (int)render.src.width, (int)render.src.height, render.src.fps, (1000000.f / tpfActual), tpfDraws, CPU_CycleMax, DBP_CPU_GetDecoderName()
+				, ((float)tpfTarget / (float)tpfActual * 100), (int)render.src.width, (int)render.src.height, render.src.fps, (1000000.f / tpfActual), tpfDraws, CPU_CycleMax, DBP_CPU_GetDecoderName(), DBP_CPU_CacheKeptBlocks, DBP_CPU_CacheDroppedBlocks
 				#ifdef DBP_ENABLE_WAITSTATS
 				, waitPause, waitFinish, waitPaused, waitContinue
 				#endif
@@ -3666,6 +3841,7 @@ void retro_run(void)
 		else
 			retro_notify(-1500, RETRO_LOG_INFO, "Emulation Speed: %4.1f%%",
 				((float)tpfTarget / (float)tpfActual * 100));
+		DBP_CPU_CacheKeptBlocks = DBP_CPU_CacheDroppedBlocks = 0;
 		#ifdef DBP_ENABLE_FPS_COUNTERS
 		dbp_fpscount_retro = dbp_fpscount_gfxstart = dbp_fpscount_gfxend = dbp_fpscount_event = dbp_fpscount_skip_run = dbp_fpscount_skip_render = 0;
 		#endif
@@ -3697,15 +3873,20 @@ void retro_run(void)
 		}
 		environ_cb(((newfps || newmax) ? RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO : RETRO_ENVIRONMENT_SET_GEOMETRY), &av_info);
 		av_info.timing.fps = targetfps;
+		view_redraw = true;
 	}
 
-	// submit video
-	if (skip_emulate)
+	// submit video, if no new frame was finished since the last one submitted send a dupe instead
+	if (skip_emulate || (view_frame == buffer_submitted && !view_redraw && !dbp_opengl_draw))
 		video_cb(NULL, view_width, view_height, view_width * 4);
 	else if (dbp_opengl_draw)
 		dbp_opengl_draw(buf);
 	else
+	{
 		video_cb(buf.video, view_width, view_height, view_width * 4);
+		int av_enable = 3; // don't rely on frames the frontend didn't show (i.e. during run-ahead)
+		buffer_submitted = ((environ_cb(RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE, &av_enable) && !(av_enable & 1)) ? view_frame - 1 : view_frame);
+	}
 
 	#ifdef DBP_STANDALONE
 	if (dbp_intercept && dbp_osdbuf[&buf - dbp_buffers].video)
@@ -3719,6 +3900,16 @@ void retro_run(void)
 static bool retro_serialize_all(DBPArchive& ar, bool unlock_thread)
 {
 	if (dbp_serializemode == DBPSERIALIZE_DISABLED) return false;
+	int savestate_context;
+	if (environ_cb(RETRO_ENVIRONMENT_GET_SAVESTATE_CONTEXT, &savestate_context) && (savestate_context == RETRO_SAVESTATE_CONTEXT_RUNAHEAD_SAME_INSTANCE || savestate_context == RETRO_SAVESTATE_CONTEXT_ROLLBACK_NETPLAY))
+	{
+		DBP_HoldSynchronousRender();
+
+		// Run-ahead in the same instance only loads the state it saved last so memory can stay in a snapshot in the core.
+		// The size query stays a full state because the frontend can use the result for a regular save state as well.
+		if (savestate_context == RETRO_SAVESTATE_CONTEXT_RUNAHEAD_SAME_INSTANCE && (ar.mode == DBPArchive::MODE_SAVE || ar.mode == DBPArchive::MODE_LOAD))
+			ar.flags |= DBPArchive::FLAG_RUNAHEAD;
+	}
 	bool pauseThread = (dbp_state != DBPSTATE_BOOT && dbp_state != DBPSTATE_SHUTDOWN);
 	if (pauseThread) DBP_ThreadControl(TCM_PAUSE_FRAME);
 	DBPSerialize_All(ar, (dbp_state == DBPSTATE_RUNNING || dbp_state == DBPSTATE_FIRST_FRAME), dbp_game_running);
@@ -3791,7 +3982,7 @@ bool retro_serialize(void *data, size_t size)
 {
 	DBPArchiveWriter ar(data, size);
 	if (!retro_serialize_all(ar, true) && ((ar.had_error != DBPArchive::ERR_DOSNOTRUNNING && ar.had_error != DBPArchive::ERR_GAMENOTRUNNING) || dbp_serializemode != DBPSERIALIZE_REWIND)) return false;
-	memset(ar.ptr, 0, ar.end - ar.ptr);
+	if (!(ar.flags & DBPArchive::FLAG_RUNAHEAD)) memset(ar.ptr, 0, ar.end - ar.ptr); // run-ahead states never leave the core
 	return true;
 }
 
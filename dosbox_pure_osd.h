@@ -640,8 +640,7 @@ struct DBP_SettingsMenuState final : DBP_MenuState
 			return;
 		}
 		frontend->AddRef();
-		Bit8u *p = (Bit8u*)&json[0], *pEnd = p + json.length();
-		for (Bit16u len; p != pEnd; p += len) frontend->Write(p, &(len = (Bit16u)((pEnd - p) > 0xFFFF ? 0xFFFF : (pEnd - p))));
+		if (frontend->WriteBulk((const Bit8u*)json.c_str(), json.length(), 0) != json.length()) { DBP_ASSERT(0); }
 		frontend->Close();
 		delete frontend;
 	}
@@ -217,6 +217,10 @@ struct DBP_Run
 
 		if (!path.empty())
 		{
+			// Only applies to save files created from now on, existing ones are read in whatever mode they were written
+			extern bool dbp_diskdiff_compress;
+			dbp_diskdiff_compress = (DBP_Option::Get(DBP_Option::bootos_compressdiff)[0] == 't');
+
 			// When booting an external disk image as C:, use whatever is C: or D: in DOSBox DOS as the third IDE drive in the booted OS
 			const char newC = 'E'; // Third IDE drive (if it were D: the IDE CD-ROM drive wouldn't show up in Windows 9x)
 			if      (imageDiskList['C'-'A']) std::swap(imageDiskList['C'-'A'], imageDiskList[newC-'A']); // Loaded content is FAT12/FAT16 disk image
@@ -55,6 +55,8 @@ public:
 	Bit8u Write_Sector(Bit32u head,Bit32u cylinder,Bit32u sector,void * data);
 	Bit8u Read_AbsoluteSector(Bit32u sectnum, void * data);
 	Bit8u Write_AbsoluteSector(Bit32u sectnum, void * data);
+	//DBP: Added to read a range of sectors in one go
+	Bit8u Read_AbsoluteSectors(Bit32u start, Bit32u count, void * data);
 
 	void Set_Geometry(Bit32u setHeads, Bit32u setCyl, Bit32u setSect, Bit32u setSectSize);
 	void Get_Geometry(Bit32u * getHeads, Bit32u *getCyl, Bit32u *getSect, Bit32u *getSectSize);
@@ -94,6 +96,7 @@ private:
 	#endif
 	struct discardDisk* discard = NULL;
 	struct differencingDisk* differencing = NULL;
+	struct mappedDisk* mapped = NULL;
 	#else
 	Bit32u current_fpos;
 	#endif
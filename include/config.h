@@ -45,6 +45,16 @@
 #define C_FPU 1 /* Define to 1 to enable floating point emulation */
 #define C_MMX 0 /* Define to 1 to enable mmx emulation */
 #define C_CORE_INLINE 1 /* Define to 1 to use inlined memory functions in cpu core */
+#if !defined(C_CORE_NORMAL_GOTO) && defined(__GNUC__)
+#define C_CORE_NORMAL_GOTO 1 /* Define to 1 to dispatch opcodes in the normal core with computed goto (GCC/Clang only, 0 uses the switch) */
+#endif
+#ifndef C_DYNREC_INLINE_TLB
+#if defined(__aarch64__) || _M_ARM64
+#define C_DYNREC_INLINE_TLB 0 /* The ARMv8 inline TLB code has not run on hardware yet, build with -DC_DYNREC_INLINE_TLB=1 to try it */
+#else
+#define C_DYNREC_INLINE_TLB 1 /* Define to 1 to access plain ram pages inline through the TLB in dynrec generated code (x64 and ARMv8 backends) */
+#endif
+#endif
 /* #undef C_DIRECTSERIAL */ /* Define to 1 if you want serial passthrough support (Win32, Posix and OS/2). */
 /* #undef C_IPX */ /* Define to 1 to enable IPX over Internet networking, requires SDL_net */
 /* #undef C_MODEM */ /* Define to 1 to enable internal modem support, requires SDL_net */
@@ -117,6 +127,9 @@ void GFX_ShowMsg(char const* format,...);
 #elif defined(__arm__) || _M_ARM
 #define C_DYNREC 1
 #define C_TARGETCPU ARMV4LE
+#elif (defined(__x86_64__) || _M_AMD64) && defined(DYNREC_X64)
+#define C_DYNREC 1 /* Build with -DDYNREC_X64 to use the dynrec core with the x64 backend instead of dynamic_x86 */
+#define C_TARGETCPU X86_64
 #elif defined(__x86_64__) || _M_AMD64
 #define	C_DYNAMIC_X86 1
 #define C_TARGETCPU X86_64
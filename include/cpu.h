@@ -61,6 +61,7 @@ extern Bit32s CPU_OldCycleMax;
 extern Bit32s CPU_CyclePercUsed;
 extern Bit32s CPU_CycleLimit;
 extern Bit64s CPU_IODelayRemoved;
+extern Bit64s CPU_CyclesExecuted; //DBP: Running total of cycles not removed by halting or I/O delays (for benchmarking)
 extern bool CPU_CycleAutoAdjust;
 extern bool CPU_SkipCycleAutoAdjust;
 extern Bitu CPU_AutoDetermineMode;
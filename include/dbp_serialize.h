@@ -74,8 +74,12 @@ struct DBPArchive
 	{
 		FLAG_NONE            = 0,
 		FLAG_NORESETINPUT = 1<<0,
+		FLAG_REWIND       = 1<<1, // memory is kept in the snapshot of the core rewind buffer instead of the archive
+		FLAG_RUNAHEAD     = 1<<2, // memory is kept in the snapshot for frontend run-ahead, only the latest state can be loaded
 	};
 
+	enum { CURRENT_VERSION = 9 }; // version written by DBPSerialize_All
+
 	Bit8u mode, version, flags, had_error, warnings, error_info;
 
 	// If this is set to true, the serializer will attempt have the same
@@ -158,4 +162,9 @@ struct DBPArchiveZeroer : DBPArchive
 
 void DBPSerialize_All(DBPArchive& ar, bool dos_running = true, bool game_running = true);
 
+// Rewind buffer of states without memory, each with the pages needed to step the memory snapshot back to the previous state
+bool DBPSerialize_RewindPush(bool dos_running, bool game_running);
+bool DBPSerialize_RewindPop(bool dos_running, bool game_running);
+void DBPSerialize_RewindClear();
+
 #endif
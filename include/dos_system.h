@@ -91,6 +91,11 @@ public:
 	char* name;
 	//DBP: Added for large ZIP file support
 	inline virtual bool Seek64(Bit64u * pos,Bit32u type) { Bit32u i = (Bit32u)*pos; bool j = Seek(&i, type); *pos = i; return j; }
+	//DBP: Added positional bulk access without the 64kb limit of Read/Write which doesn't move the file position
+	virtual Bit64u ReadBulk(Bit8u * data,Bit64u len,Bit64u offset);
+	virtual Bit64u WriteBulk(const Bit8u * data,Bit64u len,Bit64u offset);
+	//DBP: Added to access the underlying file on the host file system directly (if there is one)
+	virtual FILE* GetHostFile() { return NULL; }
 /* Some Device Specific Stuff */
 private:
 	Bit8u hdrive;
@@ -122,21 +127,39 @@ private:
 	Bitu devnum;
 };
 
+//DBP: Positioned bulk access on a host FILE, sequential accesses of the same kind skip the seeks and the original position is restored lazily
+struct DOS_HostBulk {
+	DOS_HostBulk() : mode(NONE) {}
+	Bit64u Read(FILE* f, Bit8u* data, Bit64u len, Bit64u offset);
+	Bit64u Write(FILE* f, const Bit8u* data, Bit64u len, Bit64u offset);
+	bool End(FILE* f); // returns true if the position was restored
+private:
+	bool Begin(FILE* f, Bit64u offset, Bit8u kind);
+	enum { NONE, READ, WRITE };
+	Bit8u mode;
+	Bit64u ret_pos, next_ofs;
+};
+
 class localFile : public DOS_File {
 public:
 	localFile(const char* name, FILE * handle);
 	bool Read(Bit8u * data,Bit16u * size);
 	bool Write(Bit8u * data,Bit16u * size);
 	bool Seek(Bit32u * pos,Bit32u type);
+	Bit64u ReadBulk(Bit8u * data,Bit64u len,Bit64u offset);
+	Bit64u WriteBulk(const Bit8u * data,Bit64u len,Bit64u offset);
+	FILE* GetHostFile() { return fhandle; }
 	bool Close();
 	Bit16u GetInformation(void);
 	bool UpdateDateTimeFromHost(void);   
 	void FlagReadOnlyMedium(void);
 	void Flush(void);
+	void EndBulk(void) { if (bulk.End(fhandle)) last_action=NONE; }
 	FILE * fhandle; //todo handle this properly
 private:
 	bool read_only_medium;
 	enum { NONE,READ,WRITE } last_action;
+	DOS_HostBulk bulk;
 };
 
 //DBP: Moved label out of DOS_Drive_Cache into its own class
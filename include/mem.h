@@ -34,6 +34,13 @@ typedef Bit32s MemHandle;
 extern HostPt MemBase;
 HostPt GetMemBase(void);
 
+//DBP: Tracking of modified memory pages for incremental save states (one bit per 4 kb page)
+extern Bit32u* MemDirtyPages;
+static INLINE void MEM_MarkPageDirty(Bitu phys_page) { MemDirtyPages[phys_page>>5] |= (1u<<(phys_page&31)); }
+void MEM_MarkHostDirty(HostPt host);
+enum MEM_SnapshotId { MEM_SNAPSHOT_REWIND, MEM_SNAPSHOT_RUNAHEAD, MEM_SNAPSHOT_COUNT };
+void MEM_SnapshotFree(MEM_SnapshotId id);
+
 bool MEM_A20_Enabled(void);
 void MEM_A20_Enable(bool enable);
 
@@ -151,12 +158,17 @@ void mem_writed(PhysPt pt,Bit32u val);
 
 static INLINE void phys_writeb(PhysPt addr,Bit8u val) {
 	host_writeb(MemBase+addr,val);
+	MEM_MarkPageDirty(addr>>12);
 }
 static INLINE void phys_writew(PhysPt addr,Bit16u val){
 	host_writew(MemBase+addr,val);
+	MEM_MarkPageDirty(addr>>12);
+	if (GCC_UNLIKELY((addr&0xfff)==0xfff)) MEM_MarkHostDirty(MemBase+addr+1); // crosses a page, range checked against the end of RAM
 }
 static INLINE void phys_writed(PhysPt addr,Bit32u val){
 	host_writed(MemBase+addr,val);
+	MEM_MarkPageDirty(addr>>12);
+	if (GCC_UNLIKELY((addr&0xfff)>0xffc)) MEM_MarkHostDirty(MemBase+addr+3); // crosses a page, range checked against the end of RAM
 }
 
 static INLINE Bit8u phys_readb(PhysPt addr) {
@@ -504,8 +504,16 @@ void DBPSerialize_CPU_Core_Dyn_X86(DBPArchive& ar)
 	//We are currently not serializing the state of DynRegs.
 	//It's not that simple (as it contains multiple pointers) but hopefully it isn't required to be serialized.
 
-	if (ar.mode == DBPArchive::MODE_LOAD)
+	// When the cache stays enabled it is kept and validated against the restored memory by DBPSerialize_Memory
+	if (ar.mode == DBPArchive::MODE_LOAD && stored_initialized != cache_initialized)
 		CPU_Core_Dyn_X86_Cache_Init(stored_initialized);
 }
 
+void DBPSerialize_CPU_CodeCache(DBPArchive& ar, bool memory_restored)
+{
+	if (ar.mode != DBPArchive::MODE_LOAD) return;
+	if (!memory_restored) DBPSerialize_cache_hashpages();
+	else DBPSerialize_cache_validatepages();
+}
+
 #endif
@@ -379,8 +379,16 @@ void DBPSerialize_CPU_Core_Dynrec(DBPArchive& ar)
 		.Serialize(core_dynrec.readdata)
 		.SerializeArray(core_dynrec.protected_regs);
 
-	if (ar.mode == DBPArchive::MODE_LOAD)
+	// When the cache stays enabled it is kept and validated against the restored memory by DBPSerialize_Memory
+	if (ar.mode == DBPArchive::MODE_LOAD && stored_initialized != cache_initialized)
 		CPU_Core_Dynrec_Cache_Init(stored_initialized);
 }
 
+void DBPSerialize_CPU_CodeCache(DBPArchive& ar, bool memory_restored)
+{
+	if (ar.mode != DBPArchive::MODE_LOAD) return;
+	if (!memory_restored) DBPSerialize_cache_hashpages();
+	else DBPSerialize_cache_validatepages();
+}
+
 #endif
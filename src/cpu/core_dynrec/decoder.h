@@ -62,6 +62,8 @@ static CacheBlockDynRec * CreateCacheBlock(CodePageHandlerDynRec * codepage,Phys
 
 	decode.cycles=0;
 	while (max_opcodes--) {
+		//DBP: Link to the next block if the code of another instruction might overflow the cache block
+		if (GCC_UNLIKELY((Bitu)(cache.pos-decode.block->cache.start)+used_save_info_dynrec*DRC_SAVEINFO_MAXSIZE+DRC_OPCODE_MAXSIZE>CACHE_MAXSIZE)) break;
 		// Init prefixes
 		decode.big_addr=cpu.code.big;
 		decode.big_op=cpu.code.big;
@@ -634,6 +634,16 @@ static struct {
 
 Bitu used_save_info_dynrec=0;
 
+//DBP: Upper bounds for the code generated by one instruction (including the code that closes the block after it)
+// and by one save_info entry at the end of the block. The decoder ends a block early when the next instruction
+// might not fit into CACHE_MAXSIZE, inline tlb accesses make 32 instructions of memory operations too large.
+#ifndef DRC_OPCODE_MAXSIZE
+#define DRC_OPCODE_MAXSIZE 768
+#endif
+#ifndef DRC_SAVEINFO_MAXSIZE
+#define DRC_SAVEINFO_MAXSIZE 64
+#endif
+
 
 // return from current block, with returncode
 static void dyn_return(BlockReturn retcode,bool ret_exception=false) {
@@ -788,47 +798,77 @@ bool DRC_CALL_CONV mem_writed_checked_drc(PhysPt address,Bit32u val) {
 
 // functions that enable access to the memory
 
+#ifdef DRC_INLINE_TLB
+//DBP: Emit the tlb lookup inline so accesses to plain ram pages don't call the checked helper function.
+// Page crossing accesses and pages without a host pointer (handlers, unmapped, code pages on write)
+// branch to the helper call that follows, the returned position must be passed to dyn_tlb_fast_done.
+static const Bit8u* dyn_tlb_fast_path(HostReg reg_addr,HostReg reg,Bitu size,bool write) {
+	const Bit8u *miss_cross,*miss_page;
+	gen_tlb_lookup(reg_addr,size,write,miss_cross,miss_page);
+	if (write) gen_tlb_write(reg_addr,reg,size);
+	else gen_tlb_read(reg_addr,reg,size);
+	const Bit8u* done=gen_create_jump();
+	if (miss_cross) gen_fill_branch(miss_cross);
+	gen_fill_branch(miss_page);
+	return done;
+}
+#define dyn_tlb_fast_done(done) gen_fill_branch_long(done)
+#else
+#define dyn_tlb_fast_path(reg_addr,reg,size,write) NULL
+#define dyn_tlb_fast_done(done) (void)(done)
+#endif
+
 // read a byte from a given address and store it in reg_dst
 static void dyn_read_byte(HostReg reg_addr,HostReg reg_dst) {
+	const Bit8u* tlb_done=dyn_tlb_fast_path(reg_addr,reg_dst,1,false);
 	gen_mov_regs(FC_OP1,reg_addr);
 	gen_call_function_raw((void *)&mem_readb_checked_drc);
 	dyn_check_exception(FC_RETOP);
 	gen_mov_byte_to_reg_low(reg_dst,&core_dynrec.readdata);
+	dyn_tlb_fast_done(tlb_done);
 }
 static void dyn_read_byte_canuseword(HostReg reg_addr,HostReg reg_dst) {
+	const Bit8u* tlb_done=dyn_tlb_fast_path(reg_addr,reg_dst,1,false);
 	gen_mov_regs(FC_OP1,reg_addr);
 	gen_call_function_raw((void *)&mem_readb_checked_drc);
 	dyn_check_exception(FC_RETOP);
 	gen_mov_byte_to_reg_low_canuseword(reg_dst,&core_dynrec.readdata);
+	dyn_tlb_fast_done(tlb_done);
 }
 
 // write a byte from reg_val into the memory given by the address
 static void dyn_write_byte(HostReg reg_addr,HostReg reg_val) {
+	const Bit8u* tlb_done=dyn_tlb_fast_path(reg_addr,reg_val,1,true);
 	gen_mov_regs(FC_OP2,reg_val);
 	gen_mov_regs(FC_OP1,reg_addr);
 	gen_call_function_raw((void *)&mem_writeb_checked_drc);
 	dyn_check_exception(FC_RETOP);
+	dyn_tlb_fast_done(tlb_done);
 }
 
 // read a 32bit (dword=true) or 16bit (dword=false) value
 // from a given address and store it in reg_dst
 static void dyn_read_word(HostReg reg_addr,HostReg reg_dst,bool dword) {
+	const Bit8u* tlb_done=dyn_tlb_fast_path(reg_addr,reg_dst,(dword ? 4 : 2),false);
 	gen_mov_regs(FC_OP1,reg_addr);
 	if (dword) gen_call_function_raw((void *)&mem_readd_checked_drc);
 	else gen_call_function_raw((void *)&mem_readw_checked_drc);
 	dyn_check_exception(FC_RETOP);
 	gen_mov_word_to_reg(reg_dst,&core_dynrec.readdata,dword);
+	dyn_tlb_fast_done(tlb_done);
 }
 
 // write a 32bit (dword=true) or 16bit (dword=false) value
 // from reg_val into the memory given by the address
 static void dyn_write_word(HostReg reg_addr,HostReg reg_val,bool dword) {
 //	if (!dword) gen_extend_word(false,reg_val);
+	const Bit8u* tlb_done=dyn_tlb_fast_path(reg_addr,reg_val,(dword ? 4 : 2),true);
 	gen_mov_regs(FC_OP2,reg_val);
 	gen_mov_regs(FC_OP1,reg_addr);
 	if (dword) gen_call_function_raw((void *)&mem_writed_checked_drc);
 	else gen_call_function_raw((void *)&mem_writew_checked_drc);
 	dyn_check_exception(FC_RETOP);
+	dyn_tlb_fast_done(tlb_done);
 }
 
 
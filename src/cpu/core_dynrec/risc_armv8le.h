@@ -32,6 +32,11 @@
 // try to replace _simple functions by code
 #define DRC_FLAGS_INVALIDATION_DCODE
 
+// do guest memory accesses to plain ram pages inline through the tlb
+#if C_DYNREC_INLINE_TLB
+#define DRC_INLINE_TLB
+#endif
+
 // calling convention modifier
 #define DRC_CALL_CONV	/* nothing */
 #define DRC_FC			/* nothing */
@@ -264,6 +269,12 @@ typedef Bit8u HostReg;
 #define LDRB_IMM(reg, addr, imm) (0x39400000 + (reg) + ((addr) << 5) + ((imm) << 10) )
 // ldr reg, [addr1, addr2, lsl #imm]		@	imm = 0/2
 #define LDR64_REG_LSL_IMM(reg, addr1, addr2, imm) (0xf8606800 + (reg) + ((addr1) << 5) + ((addr2) << 16) + ((imm)?0x00001000:0) )
+// ldr reg, [addr1, addr2, uxtw]
+#define LDR_REG_UXTW(reg, addr1, addr2) (0xb8604800 + (reg) + ((addr1) << 5) + ((addr2) << 16) )
+// ldrh reg, [addr1, addr2, uxtw]
+#define LDRH_REG_UXTW(reg, addr1, addr2) (0x78604800 + (reg) + ((addr1) << 5) + ((addr2) << 16) )
+// ldrb reg, [addr1, addr2, uxtw]
+#define LDRB_REG_UXTW(reg, addr1, addr2) (0x38604800 + (reg) + ((addr1) << 5) + ((addr2) << 16) )
 // ldur reg, [addr, #imm]		@	-256 <= imm < 256
 #define LDUR64_IMM(reg, addr, imm) (0xf8400000 + (reg) + ((addr) << 5) + (((imm) << 12) & 0x001ff000) )
 // ldur reg, [addr, #imm]		@	-256 <= imm < 256
@@ -284,6 +295,12 @@ typedef Bit8u HostReg;
 #define STRH_IMM(reg, addr, imm) (0x79000000 + (reg) + ((addr) << 5) + ((imm) << 9) )
 // strb reg, [addr, #imm]		@	0 <= imm < 4096
 #define STRB_IMM(reg, addr, imm) (0x39000000 + (reg) + ((addr) << 5) + ((imm) << 10) )
+// str reg, [addr1, addr2, uxtw]
+#define STR_REG_UXTW(reg, addr1, addr2) (0xb8204800 + (reg) + ((addr1) << 5) + ((addr2) << 16) )
+// strh reg, [addr1, addr2, uxtw]
+#define STRH_REG_UXTW(reg, addr1, addr2) (0x78204800 + (reg) + ((addr1) << 5) + ((addr2) << 16) )
+// strb reg, [addr1, addr2, uxtw]
+#define STRB_REG_UXTW(reg, addr1, addr2) (0x38204800 + (reg) + ((addr1) << 5) + ((addr2) << 16) )
 // stur reg, [addr, #imm]		@	-256 <= imm < 256
 #define STUR64_IMM(reg, addr, imm) (0xf8000000 + (reg) + ((addr) << 5) + (((imm) << 12) & 0x001ff000) )
 // stur reg, [addr, #imm]		@	-256 <= imm < 256
@@ -296,6 +313,8 @@ typedef Bit8u HostReg;
 // branch
 // bgt pc+imm		@	0 <= imm < 1M	&	imm mod 4 = 0
 #define BGT_FWD(imm) (0x5400000c + ((imm) << 3) )
+// bhi pc+imm		@	0 <= imm < 1M	&	imm mod 4 = 0
+#define BHI_FWD(imm) (0x54000008 + ((imm) << 3) )
 // b pc+imm		@	0 <= imm < 128M	&	imm mod 4 = 0
 #define B_FWD(imm) (0x14000000 + ((imm) >> 2) )
 // br reg
@@ -306,6 +325,8 @@ typedef Bit8u HostReg;
 #define CBZ_FWD(reg, imm) (0x34000000 + (reg) + ((imm) << 3) )
 // cbnz reg, pc+imm		@	0 <= imm < 1M	&	imm mod 4 = 0
 #define CBNZ_FWD(reg, imm) (0x35000000 + (reg) + ((imm) << 3) )
+// cbz reg, pc+imm		@	0 <= imm < 1M	&	imm mod 4 = 0
+#define CBZ64_FWD(reg, imm) (0xb4000000 + (reg) + ((imm) << 3) )
 // ret reg
 #define RET_REG(reg) (0xd65f0000 + ((reg) << 5) )
 // ret
@@ -875,6 +896,52 @@ static void INLINE gen_fill_branch_long(const Bit8u* data) {
 	cache_addd(((data[3]<<24)&~0x03ffffff)|(offset&0x03ffffff),data);
 }
 
+#ifdef DRC_INLINE_TLB
+// unconditional jump, the destination is set by gen_fill_branch_long() later
+static const Bit8u* gen_create_jump(void) {
+	cache_addd( B_FWD(0) );         // b j
+	return (cache.pos-4);
+}
+
+// look up the host page of the guest address in reg_addr in the read or write tlb
+// temp1 receives the tlb entry, temp2 is clobbered
+// miss_cross is set to the branch taken if the access crosses a page (NULL for bytes),
+// miss_page to the branch taken if the page has no direct host pointer,
+// both get their destination by gen_fill_branch()
+static void gen_tlb_lookup(HostReg reg_addr,Bitu size,bool write,const Bit8u* &miss_cross,const Bit8u* &miss_page) {
+	miss_cross=NULL;
+	if (size>1) {
+		cache_addd( UBFM(temp1, reg_addr, 0, 11) );             // ubfx temp1, reg_addr, #0, #12
+		cache_addd( CMP_IMM(temp1, 0x1000-size, 0) );           // cmp temp1, #(0x1000-size)
+		cache_addd( BHI_FWD(0) );                               // bhi miss_cross
+		miss_cross=cache.pos-4;
+	}
+	cache_addd( UBFM(temp1, reg_addr, 12, 31) );                // lsr temp1, reg_addr, #12
+	gen_mov_qword_to_reg_imm(temp2, (Bit64u)(write ? paging.tlb.write : paging.tlb.read));
+	cache_addd( LDR64_REG_LSL_IMM(temp1, temp2, temp1, 3) );    // ldr temp1, [temp2, temp1, lsl #3]
+	cache_addd( CBZ64_FWD(temp1, 0) );                          // cbz temp1, miss_page
+	miss_page=cache.pos-4;
+}
+
+// load 1/2/4 bytes from the host page found by gen_tlb_lookup into reg_dst (zero extended)
+static void gen_tlb_read(HostReg reg_addr,HostReg reg_dst,Bitu size) {
+	switch (size) {
+		case 1: cache_addd( LDRB_REG_UXTW(reg_dst, temp1, reg_addr) ); break;  // ldrb reg_dst, [temp1, reg_addr, uxtw]
+		case 2: cache_addd( LDRH_REG_UXTW(reg_dst, temp1, reg_addr) ); break;  // ldrh reg_dst, [temp1, reg_addr, uxtw]
+		default: cache_addd( LDR_REG_UXTW(reg_dst, temp1, reg_addr) ); break;  // ldr reg_dst, [temp1, reg_addr, uxtw]
+	}
+}
+
+// store 1/2/4 bytes of reg_val to the host page found by gen_tlb_lookup
+static void gen_tlb_write(HostReg reg_addr,HostReg reg_val,Bitu size) {
+	switch (size) {
+		case 1: cache_addd( STRB_REG_UXTW(reg_val, temp1, reg_addr) ); break;  // strb reg_val, [temp1, reg_addr, uxtw]
+		case 2: cache_addd( STRH_REG_UXTW(reg_val, temp1, reg_addr) ); break;  // strh reg_val, [temp1, reg_addr, uxtw]
+		default: cache_addd( STR_REG_UXTW(reg_val, temp1, reg_addr) ); break;  // str reg_val, [temp1, reg_addr, uxtw]
+	}
+}
+#endif
+
 static void gen_run_code(void) {
 	const Bit8u *pos1, *pos2, *pos3;
 
@@ -29,6 +29,11 @@
 // try to replace _simple functions by code
 #define DRC_FLAGS_INVALIDATION_DCODE
 
+// do guest memory accesses to plain ram pages inline through the tlb
+#if C_DYNREC_INLINE_TLB
+#define DRC_INLINE_TLB
+#endif
+
 // calling convention modifier
 #define DRC_CALL_CONV	/* nothing */
 #define DRC_FC			/* nothing */
@@ -598,6 +603,61 @@ static void gen_fill_branch_long(const Bit8u* data) {
 	cache_addd((Bit32u)(cache.pos-data-4),data);
 }
 
+#ifdef DRC_INLINE_TLB
+// unconditional jump, the destination is set by gen_fill_branch_long() later
+static const Bit8u* gen_create_jump(void) {
+	cache_addb(0xe9);		// jmp
+	cache_addd(0);
+	return (cache.pos-4);
+}
+
+// look up the host page of the guest address in reg_addr in the read or write tlb
+// r10 receives the zero extended address and r11 the tlb entry, r9 is clobbered
+// miss_cross is set to the branch taken if the access crosses a page (NULL for bytes),
+// miss_page to the branch taken if the page has no direct host pointer,
+// both are short branches that get their destination by gen_fill_branch()
+static void gen_tlb_lookup(HostReg reg_addr,Bitu size,bool write,const Bit8u* &miss_cross,const Bit8u* &miss_page) {
+	cache_addw(0x8941);cache_addb(0xc2+(reg_addr<<3));	// mov r10d,reg_addr
+	miss_cross=NULL;
+	if (size>1) {
+		cache_addw(0x8945);cache_addb(0xd3);			// mov r11d,r10d
+		cache_addw(0x8141);cache_addb(0xe3);cache_addd(0xfff);	// and r11d,0xfff
+		cache_addw(0x8141);cache_addb(0xfb);cache_addd((Bit32u)(0x1000-size));	// cmp r11d,0x1000-size
+		cache_addw(0x0077);				// ja addr
+		miss_cross=cache.pos-1;
+	}
+	cache_addw(0x8945);cache_addb(0xd3);				// mov r11d,r10d
+	cache_addw(0xc141);cache_addw(0x0ceb);			// shr r11d,12
+	HostPt* tlb=(write ? paging.tlb.write : paging.tlb.read);
+	Bit64s diff=(Bit64s)tlb-((Bit64s)cache.pos+7);
+	if ((diff>>31)==(diff>>63)) {
+		cache_addb(0x4c);cache_addw(0x0d8d);cache_addd((Bit32u)diff);	// lea r9,[rip+tlb]
+	} else {
+		cache_addw(0xb949);cache_addq((Bit64u)tlb);	// mov r9,tlb
+	}
+	cache_addd(0xd91c8b4f);						// mov r11,[r9+r11*8]
+	cache_addw(0x854d);cache_addb(0xdb);				// test r11,r11
+	cache_addw(0x0074);						// jz addr
+	miss_page=cache.pos-1;
+}
+
+// load 1/2/4 bytes from the host page found by gen_tlb_lookup into reg_dst (zero extended)
+static void gen_tlb_read(HostReg /*reg_addr*/,HostReg reg_dst,Bitu size) {
+	if (size==4) cache_addw(0x8b43);			// mov reg_dst,[r11+r10]
+	else {
+		cache_addw(0x0f43);cache_addb(size==2 ? 0xb7 : 0xb6);	// movzx reg_dst,word/byte [r11+r10]
+	}
+	cache_addw(0x1304+(reg_dst<<3));
+}
+
+// store 1/2/4 bytes of reg_val to the host page found by gen_tlb_lookup
+static void gen_tlb_write(HostReg /*reg_addr*/,HostReg reg_val,Bitu size) {
+	if (size==2) cache_addb(0x66);
+	cache_addw(size==1 ? 0x8843 : 0x8943);		// mov [r11+r10],reg_val (REX makes regs 6/7 sil/dil)
+	cache_addw(0x1304+(reg_val<<3));
+}
+#endif
+
 static void gen_run_code(void) {
 	cache_addw(0x5355);     // push rbp,rbx
 	cache_addb(0x56);       // push rsi
@@ -146,10 +146,41 @@ static INLINE Bit32u Fetchd() {
 #include "core_normal/support.h"
 #include "core_normal/string.h"
 
+#if C_CORE_NORMAL_GOTO
+//DBP: Computed goto dispatch, every case of the prefix tables also gets a label which is entered directly through a
+//     table of label addresses, skipping the range check and jump table lookup of the switch. The switch stays as the
+//     enclosing statement so break/continue in the opcode handlers work unchanged and opcodes without a table entry
+//     still get dispatched by it. Compilers without the labels as values extension (MSVC) only use the switch.
+#undef CASE_W
+#undef CASE_D
+#undef CASE_0F_W
+#undef CASE_0F_D
+#define CASE_W(_WHICH)    case (OPCODE_NONE+_WHICH): op_w_##_WHICH:
+#define CASE_D(_WHICH)    case (OPCODE_SIZE+_WHICH): op_d_##_WHICH:
+#define CASE_0F_W(_WHICH) case ((OPCODE_0F|OPCODE_NONE)+_WHICH): op_0fw_##_WHICH:
+#define CASE_0F_D(_WHICH) case ((OPCODE_0F|OPCODE_SIZE)+_WHICH): op_0fd_##_WHICH:
+#define DISPATCH_W(_WHICH)    dispatch_table[OPCODE_NONE+_WHICH]=&&op_w_##_WHICH;
+#define DISPATCH_D(_WHICH)    dispatch_table[OPCODE_SIZE+_WHICH]=&&op_d_##_WHICH;
+#define DISPATCH_B(_WHICH)    DISPATCH_W(_WHICH) DISPATCH_D(_WHICH)
+#define DISPATCH_0F_W(_WHICH) dispatch_table[(OPCODE_0F|OPCODE_NONE)+_WHICH]=&&op_0fw_##_WHICH;
+#define DISPATCH_0F_D(_WHICH) dispatch_table[(OPCODE_0F|OPCODE_SIZE)+_WHICH]=&&op_0fd_##_WHICH;
+#define DISPATCH_0F_B(_WHICH) DISPATCH_0F_W(_WHICH) DISPATCH_0F_D(_WHICH)
+#define DISPATCH_0F_MMX(_WHICH) DISPATCH_0F_B(_WHICH)
+// Catch cases added to the prefix tables without an entry in table_dispatch.h
+#pragma GCC diagnostic warning "-Wunused-label"
+#endif
 
 #define EALookupTable (core.ea_table)
 
 Bits CPU_Core_Normal_Run(void) {
+	Bitu opcode;
+#if C_CORE_NORMAL_GOTO
+	static const void* dispatch_table[0x400];
+	if (!dispatch_table[0]) {
+		for (Bitu i = 0; i != 0x400; i++) dispatch_table[i] = &&dispatch_switch;
+		#include "core_normal/table_dispatch.h"
+	}
+#endif
 	while (CPU_Cycles-->0) {
 		LOADIP;
 		core.opcode_index=cpu.code.big*0x200;
@@ -168,7 +199,12 @@ Bits CPU_Core_Normal_Run(void) {
 		cycle_count++;
 #endif
 restart_opcode:
-		switch (core.opcode_index+Fetchb()) {
+		opcode=core.opcode_index+Fetchb();
+#if C_CORE_NORMAL_GOTO
+		goto *dispatch_table[opcode];
+dispatch_switch:
+#endif
+		switch (opcode) {
 		#include "core_normal/prefix_none.h"
 		#include "core_normal/prefix_0f.h"
 		#include "core_normal/prefix_66.h"
@@ -0,0 +1,108 @@
+/*
+ *  Copyright (C) 2002-2021  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+//DBP: Opcode list of the prefix_*.h tables, used by core_normal.cpp to fill the computed goto dispatch table.
+//     Each DISPATCH_* entry needs a matching CASE_* in the prefix tables (a missing case fails to compile). A case without
+//     an entry here still runs through the switch but core_normal.cpp warns about its unused dispatch label.
+
+/* prefix_none.h */
+	DISPATCH_B(0x00) DISPATCH_W(0x01) DISPATCH_B(0x02) DISPATCH_W(0x03) DISPATCH_B(0x04) DISPATCH_W(0x05) DISPATCH_W(0x06) DISPATCH_W(0x07)
+	DISPATCH_B(0x08) DISPATCH_W(0x09) DISPATCH_B(0x0a) DISPATCH_W(0x0b) DISPATCH_B(0x0c) DISPATCH_W(0x0d) DISPATCH_W(0x0e) DISPATCH_B(0x0f)
+	DISPATCH_B(0x10) DISPATCH_W(0x11) DISPATCH_B(0x12) DISPATCH_W(0x13) DISPATCH_B(0x14) DISPATCH_W(0x15) DISPATCH_W(0x16) DISPATCH_W(0x17)
+	DISPATCH_B(0x18) DISPATCH_W(0x19) DISPATCH_B(0x1a) DISPATCH_W(0x1b) DISPATCH_B(0x1c) DISPATCH_W(0x1d) DISPATCH_W(0x1e) DISPATCH_W(0x1f)
+	DISPATCH_B(0x20) DISPATCH_W(0x21) DISPATCH_B(0x22) DISPATCH_W(0x23) DISPATCH_B(0x24) DISPATCH_W(0x25) DISPATCH_B(0x26) DISPATCH_B(0x27)
+	DISPATCH_B(0x28) DISPATCH_W(0x29) DISPATCH_B(0x2a) DISPATCH_W(0x2b) DISPATCH_B(0x2c) DISPATCH_W(0x2d) DISPATCH_B(0x2e) DISPATCH_B(0x2f)
+	DISPATCH_B(0x30) DISPATCH_W(0x31) DISPATCH_B(0x32) DISPATCH_W(0x33) DISPATCH_B(0x34) DISPATCH_W(0x35) DISPATCH_B(0x36) DISPATCH_B(0x37)
+	DISPATCH_B(0x38) DISPATCH_W(0x39) DISPATCH_B(0x3a) DISPATCH_W(0x3b) DISPATCH_B(0x3c) DISPATCH_W(0x3d) DISPATCH_B(0x3e) DISPATCH_B(0x3f)
+	DISPATCH_W(0x40) DISPATCH_W(0x41) DISPATCH_W(0x42) DISPATCH_W(0x43) DISPATCH_W(0x44) DISPATCH_W(0x45) DISPATCH_W(0x46) DISPATCH_W(0x47)
+	DISPATCH_W(0x48) DISPATCH_W(0x49) DISPATCH_W(0x4a) DISPATCH_W(0x4b) DISPATCH_W(0x4c) DISPATCH_W(0x4d) DISPATCH_W(0x4e) DISPATCH_W(0x4f)
+	DISPATCH_W(0x50) DISPATCH_W(0x51) DISPATCH_W(0x52) DISPATCH_W(0x53) DISPATCH_W(0x54) DISPATCH_W(0x55) DISPATCH_W(0x56) DISPATCH_W(0x57)
+	DISPATCH_W(0x58) DISPATCH_W(0x59) DISPATCH_W(0x5a) DISPATCH_W(0x5b) DISPATCH_W(0x5c) DISPATCH_W(0x5d) DISPATCH_W(0x5e) DISPATCH_W(0x5f)
+	DISPATCH_W(0x60) DISPATCH_W(0x61) DISPATCH_W(0x62) DISPATCH_W(0x63) DISPATCH_B(0x64) DISPATCH_B(0x65) DISPATCH_B(0x66) DISPATCH_B(0x67)
+	DISPATCH_W(0x68) DISPATCH_W(0x69) DISPATCH_W(0x6a) DISPATCH_W(0x6b) DISPATCH_B(0x6c) DISPATCH_W(0x6d) DISPATCH_B(0x6e) DISPATCH_W(0x6f)
+	DISPATCH_W(0x70) DISPATCH_W(0x71) DISPATCH_W(0x72) DISPATCH_W(0x73) DISPATCH_W(0x74) DISPATCH_W(0x75) DISPATCH_W(0x76) DISPATCH_W(0x77)
+	DISPATCH_W(0x78) DISPATCH_W(0x79) DISPATCH_W(0x7a) DISPATCH_W(0x7b) DISPATCH_W(0x7c) DISPATCH_W(0x7d) DISPATCH_W(0x7e) DISPATCH_W(0x7f)
+	DISPATCH_B(0x80) DISPATCH_B(0x82) DISPATCH_W(0x81) DISPATCH_W(0x83) DISPATCH_B(0x84) DISPATCH_W(0x85) DISPATCH_B(0x86) DISPATCH_W(0x87)
+	DISPATCH_B(0x88) DISPATCH_W(0x89) DISPATCH_B(0x8a) DISPATCH_W(0x8b) DISPATCH_W(0x8c) DISPATCH_W(0x8d) DISPATCH_B(0x8e) DISPATCH_W(0x8f)
+	DISPATCH_B(0x90) DISPATCH_W(0x91) DISPATCH_W(0x92) DISPATCH_W(0x93) DISPATCH_W(0x94) DISPATCH_W(0x95) DISPATCH_W(0x96) DISPATCH_W(0x97)
+	DISPATCH_W(0x98) DISPATCH_W(0x99) DISPATCH_W(0x9a) DISPATCH_B(0x9b) DISPATCH_W(0x9c) DISPATCH_W(0x9d) DISPATCH_B(0x9e) DISPATCH_B(0x9f)
+	DISPATCH_B(0xa0) DISPATCH_W(0xa1) DISPATCH_B(0xa2) DISPATCH_W(0xa3) DISPATCH_B(0xa4) DISPATCH_W(0xa5) DISPATCH_B(0xa6) DISPATCH_W(0xa7)
+	DISPATCH_B(0xa8) DISPATCH_W(0xa9) DISPATCH_B(0xaa) DISPATCH_W(0xab) DISPATCH_B(0xac) DISPATCH_W(0xad) DISPATCH_B(0xae) DISPATCH_W(0xaf)
+	DISPATCH_B(0xb0) DISPATCH_B(0xb1) DISPATCH_B(0xb2) DISPATCH_B(0xb3) DISPATCH_B(0xb4) DISPATCH_B(0xb5) DISPATCH_B(0xb6) DISPATCH_B(0xb7)
+	DISPATCH_W(0xb8) DISPATCH_W(0xb9) DISPATCH_W(0xba) DISPATCH_W(0xbb) DISPATCH_W(0xbc) DISPATCH_W(0xbd) DISPATCH_W(0xbe) DISPATCH_W(0xbf)
+	DISPATCH_B(0xc0) DISPATCH_W(0xc1) DISPATCH_W(0xc2) DISPATCH_W(0xc3) DISPATCH_W(0xc4) DISPATCH_W(0xc5) DISPATCH_B(0xc6) DISPATCH_W(0xc7)
+	DISPATCH_W(0xc8) DISPATCH_W(0xc9) DISPATCH_W(0xca) DISPATCH_W(0xcb) DISPATCH_B(0xcc) DISPATCH_B(0xcd) DISPATCH_B(0xce) DISPATCH_W(0xcf)
+	DISPATCH_B(0xd0) DISPATCH_W(0xd1) DISPATCH_B(0xd2) DISPATCH_W(0xd3) DISPATCH_B(0xd4) DISPATCH_B(0xd5) DISPATCH_B(0xd6) DISPATCH_B(0xd7)
+	DISPATCH_B(0xd8) DISPATCH_B(0xd9) DISPATCH_B(0xda) DISPATCH_B(0xdb) DISPATCH_B(0xdc) DISPATCH_B(0xdd) DISPATCH_B(0xde) DISPATCH_B(0xdf)
+	DISPATCH_B(0xd8) DISPATCH_B(0xd9) DISPATCH_B(0xda) DISPATCH_B(0xdb) DISPATCH_B(0xdc) DISPATCH_B(0xdd) DISPATCH_B(0xde) DISPATCH_B(0xdf)
+	DISPATCH_W(0xe0) DISPATCH_W(0xe1) DISPATCH_W(0xe2) DISPATCH_W(0xe3) DISPATCH_B(0xe4) DISPATCH_W(0xe5) DISPATCH_B(0xe6) DISPATCH_W(0xe7)
+	DISPATCH_W(0xe8) DISPATCH_W(0xe9) DISPATCH_W(0xea) DISPATCH_W(0xeb) DISPATCH_B(0xec) DISPATCH_W(0xed) DISPATCH_B(0xee) DISPATCH_W(0xef)
+	DISPATCH_B(0xf0) DISPATCH_B(0xf1) DISPATCH_B(0xf2) DISPATCH_B(0xf3) DISPATCH_B(0xf4) DISPATCH_B(0xf5) DISPATCH_B(0xf6) DISPATCH_W(0xf7)
+	DISPATCH_B(0xf8) DISPATCH_B(0xf9) DISPATCH_B(0xfa) DISPATCH_B(0xfb) DISPATCH_B(0xfc) DISPATCH_B(0xfd) DISPATCH_B(0xfe) DISPATCH_W(0xff)
+/* prefix_0f.h */
+	DISPATCH_0F_W(0x00) DISPATCH_0F_W(0x01) DISPATCH_0F_W(0x02) DISPATCH_0F_W(0x03) DISPATCH_0F_B(0x06) DISPATCH_0F_B(0x08) DISPATCH_0F_B(0x09) DISPATCH_0F_B(0x20)
+	DISPATCH_0F_B(0x21) DISPATCH_0F_B(0x22) DISPATCH_0F_B(0x23) DISPATCH_0F_B(0x24) DISPATCH_0F_B(0x26) DISPATCH_0F_B(0x31) DISPATCH_0F_W(0x80) DISPATCH_0F_W(0x81)
+	DISPATCH_0F_W(0x82) DISPATCH_0F_W(0x83) DISPATCH_0F_W(0x84) DISPATCH_0F_W(0x85) DISPATCH_0F_W(0x86) DISPATCH_0F_W(0x87) DISPATCH_0F_W(0x88) DISPATCH_0F_W(0x89)
+	DISPATCH_0F_W(0x8a) DISPATCH_0F_W(0x8b) DISPATCH_0F_W(0x8c) DISPATCH_0F_W(0x8d) DISPATCH_0F_W(0x8e) DISPATCH_0F_W(0x8f) DISPATCH_0F_B(0x90) DISPATCH_0F_B(0x91)
+	DISPATCH_0F_B(0x92) DISPATCH_0F_B(0x93) DISPATCH_0F_B(0x94) DISPATCH_0F_B(0x95) DISPATCH_0F_B(0x96) DISPATCH_0F_B(0x97) DISPATCH_0F_B(0x98) DISPATCH_0F_B(0x99)
+	DISPATCH_0F_B(0x9a) DISPATCH_0F_B(0x9b) DISPATCH_0F_B(0x9c) DISPATCH_0F_B(0x9d) DISPATCH_0F_B(0x9e) DISPATCH_0F_B(0x9f) DISPATCH_0F_W(0xa0) DISPATCH_0F_W(0xa1)
+	DISPATCH_0F_B(0xa2) DISPATCH_0F_W(0xa3) DISPATCH_0F_W(0xa4) DISPATCH_0F_W(0xa5) DISPATCH_0F_W(0xa8) DISPATCH_0F_W(0xa9) DISPATCH_0F_W(0xab) DISPATCH_0F_W(0xac)
+	DISPATCH_0F_W(0xad) DISPATCH_0F_W(0xaf) DISPATCH_0F_B(0xb0) DISPATCH_0F_W(0xb1) DISPATCH_0F_W(0xb2) DISPATCH_0F_W(0xb3) DISPATCH_0F_W(0xb4) DISPATCH_0F_W(0xb5)
+	DISPATCH_0F_W(0xb6) DISPATCH_0F_W(0xb7) DISPATCH_0F_W(0xbf) DISPATCH_0F_W(0xba) DISPATCH_0F_W(0xbb) DISPATCH_0F_W(0xbc) DISPATCH_0F_W(0xbd) DISPATCH_0F_W(0xbe)
+	DISPATCH_0F_B(0xc0) DISPATCH_0F_W(0xc1) DISPATCH_0F_W(0xc8) DISPATCH_0F_W(0xc9) DISPATCH_0F_W(0xca) DISPATCH_0F_W(0xcb) DISPATCH_0F_W(0xcc) DISPATCH_0F_W(0xcd)
+	DISPATCH_0F_W(0xce) DISPATCH_0F_W(0xcf)
+/* prefix_66.h */
+	DISPATCH_D(0x01) DISPATCH_D(0x03) DISPATCH_D(0x05) DISPATCH_D(0x06) DISPATCH_D(0x07) DISPATCH_D(0x09) DISPATCH_D(0x0b) DISPATCH_D(0x0d)
+	DISPATCH_D(0x0e) DISPATCH_D(0x11) DISPATCH_D(0x13) DISPATCH_D(0x15) DISPATCH_D(0x16) DISPATCH_D(0x17) DISPATCH_D(0x19) DISPATCH_D(0x1b)
+	DISPATCH_D(0x1d) DISPATCH_D(0x1e) DISPATCH_D(0x1f) DISPATCH_D(0x21) DISPATCH_D(0x23) DISPATCH_D(0x25) DISPATCH_D(0x29) DISPATCH_D(0x2b)
+	DISPATCH_D(0x2d) DISPATCH_D(0x31) DISPATCH_D(0x33) DISPATCH_D(0x35) DISPATCH_D(0x39) DISPATCH_D(0x3b) DISPATCH_D(0x3d) DISPATCH_D(0x40)
+	DISPATCH_D(0x41) DISPATCH_D(0x42) DISPATCH_D(0x43) DISPATCH_D(0x44) DISPATCH_D(0x45) DISPATCH_D(0x46) DISPATCH_D(0x47) DISPATCH_D(0x48)
+	DISPATCH_D(0x49) DISPATCH_D(0x4a) DISPATCH_D(0x4b) DISPATCH_D(0x4c) DISPATCH_D(0x4d) DISPATCH_D(0x4e) DISPATCH_D(0x4f) DISPATCH_D(0x50)
+	DISPATCH_D(0x51) DISPATCH_D(0x52) DISPATCH_D(0x53) DISPATCH_D(0x54) DISPATCH_D(0x55) DISPATCH_D(0x56) DISPATCH_D(0x57) DISPATCH_D(0x58)
+	DISPATCH_D(0x59) DISPATCH_D(0x5a) DISPATCH_D(0x5b) DISPATCH_D(0x5c) DISPATCH_D(0x5d) DISPATCH_D(0x5e) DISPATCH_D(0x5f) DISPATCH_D(0x60)
+	DISPATCH_D(0x61) DISPATCH_D(0x62) DISPATCH_D(0x63) DISPATCH_D(0x68) DISPATCH_D(0x69) DISPATCH_D(0x6a) DISPATCH_D(0x6b) DISPATCH_D(0x6d)
+	DISPATCH_D(0x6f) DISPATCH_D(0x70) DISPATCH_D(0x71) DISPATCH_D(0x72) DISPATCH_D(0x73) DISPATCH_D(0x74) DISPATCH_D(0x75) DISPATCH_D(0x76)
+	DISPATCH_D(0x77) DISPATCH_D(0x78) DISPATCH_D(0x79) DISPATCH_D(0x7a) DISPATCH_D(0x7b) DISPATCH_D(0x7c) DISPATCH_D(0x7d) DISPATCH_D(0x7e)
+	DISPATCH_D(0x7f) DISPATCH_D(0x81) DISPATCH_D(0x83) DISPATCH_D(0x85) DISPATCH_D(0x87) DISPATCH_D(0x89) DISPATCH_D(0x8b) DISPATCH_D(0x8c)
+	DISPATCH_D(0x8d) DISPATCH_D(0x8f) DISPATCH_D(0x91) DISPATCH_D(0x92) DISPATCH_D(0x93) DISPATCH_D(0x94) DISPATCH_D(0x95) DISPATCH_D(0x96)
+	DISPATCH_D(0x97) DISPATCH_D(0x98) DISPATCH_D(0x99) DISPATCH_D(0x9a) DISPATCH_D(0x9c) DISPATCH_D(0x9d) DISPATCH_D(0xa1) DISPATCH_D(0xa3)
+	DISPATCH_D(0xa5) DISPATCH_D(0xa7) DISPATCH_D(0xa9) DISPATCH_D(0xab) DISPATCH_D(0xad) DISPATCH_D(0xaf) DISPATCH_D(0xb8) DISPATCH_D(0xb9)
+	DISPATCH_D(0xba) DISPATCH_D(0xbb) DISPATCH_D(0xbc) DISPATCH_D(0xbd) DISPATCH_D(0xbe) DISPATCH_D(0xbf) DISPATCH_D(0xc1) DISPATCH_D(0xc2)
+	DISPATCH_D(0xc3) DISPATCH_D(0xc4) DISPATCH_D(0xc5) DISPATCH_D(0xc7) DISPATCH_D(0xc8) DISPATCH_D(0xc9) DISPATCH_D(0xca) DISPATCH_D(0xcb)
+	DISPATCH_D(0xcf) DISPATCH_D(0xd1) DISPATCH_D(0xd3) DISPATCH_D(0xe0) DISPATCH_D(0xe1) DISPATCH_D(0xe2) DISPATCH_D(0xe3) DISPATCH_D(0xe5)
+	DISPATCH_D(0xe7) DISPATCH_D(0xe8) DISPATCH_D(0xe9) DISPATCH_D(0xea) DISPATCH_D(0xeb) DISPATCH_D(0xed) DISPATCH_D(0xef) DISPATCH_D(0xf7)
+	DISPATCH_D(0xff)
+/* prefix_66_0f.h */
+	DISPATCH_0F_D(0x00) DISPATCH_0F_D(0x01) DISPATCH_0F_D(0x02) DISPATCH_0F_D(0x03) DISPATCH_0F_D(0x80) DISPATCH_0F_D(0x81) DISPATCH_0F_D(0x82) DISPATCH_0F_D(0x83)
+	DISPATCH_0F_D(0x84) DISPATCH_0F_D(0x85) DISPATCH_0F_D(0x86) DISPATCH_0F_D(0x87) DISPATCH_0F_D(0x88) DISPATCH_0F_D(0x89) DISPATCH_0F_D(0x8a) DISPATCH_0F_D(0x8b)
+	DISPATCH_0F_D(0x8c) DISPATCH_0F_D(0x8d) DISPATCH_0F_D(0x8e) DISPATCH_0F_D(0x8f) DISPATCH_0F_D(0xa0) DISPATCH_0F_D(0xa1) DISPATCH_0F_D(0xa3) DISPATCH_0F_D(0xa4)
+	DISPATCH_0F_D(0xa5) DISPATCH_0F_D(0xa8) DISPATCH_0F_D(0xa9) DISPATCH_0F_D(0xab) DISPATCH_0F_D(0xac) DISPATCH_0F_D(0xad) DISPATCH_0F_D(0xaf) DISPATCH_0F_D(0xb1)
+	DISPATCH_0F_D(0xb2) DISPATCH_0F_D(0xb3) DISPATCH_0F_D(0xb4) DISPATCH_0F_D(0xb5) DISPATCH_0F_D(0xb6) DISPATCH_0F_D(0xb7) DISPATCH_0F_D(0xba) DISPATCH_0F_D(0xbb)
+	DISPATCH_0F_D(0xbc) DISPATCH_0F_D(0xbd) DISPATCH_0F_D(0xbe) DISPATCH_0F_D(0xbf) DISPATCH_0F_D(0xc1) DISPATCH_0F_D(0xc8) DISPATCH_0F_D(0xc9) DISPATCH_0F_D(0xca)
+	DISPATCH_0F_D(0xcb) DISPATCH_0F_D(0xcc) DISPATCH_0F_D(0xcd) DISPATCH_0F_D(0xce) DISPATCH_0F_D(0xcf)
+#if C_MMX
+/* prefix_0f_mmx.h */
+	DISPATCH_0F_MMX(0x77) DISPATCH_0F_MMX(0x6e) DISPATCH_0F_MMX(0x7e) DISPATCH_0F_MMX(0x6f) DISPATCH_0F_MMX(0x7f) DISPATCH_0F_MMX(0xef) DISPATCH_0F_MMX(0xeb) DISPATCH_0F_MMX(0xdb)
+	DISPATCH_0F_MMX(0xdf) DISPATCH_0F_MMX(0xf1) DISPATCH_0F_MMX(0xd1) DISPATCH_0F_MMX(0xe1) DISPATCH_0F_MMX(0x71) DISPATCH_0F_MMX(0xf2) DISPATCH_0F_MMX(0xd2) DISPATCH_0F_MMX(0xe2)
+	DISPATCH_0F_MMX(0x72) DISPATCH_0F_MMX(0xf3) DISPATCH_0F_MMX(0xd3) DISPATCH_0F_MMX(0x73) DISPATCH_0F_MMX(0xFC) DISPATCH_0F_MMX(0xFD) DISPATCH_0F_MMX(0xFE) DISPATCH_0F_MMX(0xEC)
+	DISPATCH_0F_MMX(0xED) DISPATCH_0F_MMX(0xDC) DISPATCH_0F_MMX(0xDD) DISPATCH_0F_MMX(0xF8) DISPATCH_0F_MMX(0xF9) DISPATCH_0F_MMX(0xFA) DISPATCH_0F_MMX(0xE8) DISPATCH_0F_MMX(0xE9)
+	DISPATCH_0F_MMX(0xD8) DISPATCH_0F_MMX(0xD9) DISPATCH_0F_MMX(0xE5) DISPATCH_0F_MMX(0xD5) DISPATCH_0F_MMX(0xF5) DISPATCH_0F_MMX(0x74) DISPATCH_0F_MMX(0x75) DISPATCH_0F_MMX(0x76)
+	DISPATCH_0F_MMX(0x64) DISPATCH_0F_MMX(0x65) DISPATCH_0F_MMX(0x66) DISPATCH_0F_MMX(0x63) DISPATCH_0F_MMX(0x6B) DISPATCH_0F_MMX(0x67) DISPATCH_0F_MMX(0x68) DISPATCH_0F_MMX(0x69)
+	DISPATCH_0F_MMX(0x6A) DISPATCH_0F_MMX(0x60) DISPATCH_0F_MMX(0x61) DISPATCH_0F_MMX(0x62)
+#endif
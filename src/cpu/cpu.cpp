@@ -61,6 +61,7 @@ Bit32s CPU_CycleUp = 0;
 Bit32s CPU_CycleDown = 0;
 #endif
 Bit64s CPU_IODelayRemoved = 0;
+Bit64s CPU_CyclesExecuted = 0;
 CPU_Decoder * cpudecoder;
 bool CPU_CycleAutoAdjust = false;
 bool CPU_SkipCycleAutoAdjust = false;
@@ -2929,6 +2930,9 @@ void DBPSerialize_CPU(DBPArchive& ar)
 	}
 }
 
+// Number of dynamic core cache blocks kept and dropped while loading save states (shown in detailed performance statistics)
+Bit32u DBP_CPU_CacheKeptBlocks, DBP_CPU_CacheDroppedBlocks;
+
 const char* DBP_CPU_GetDecoderName()
 {
 	if (cpudecoder == &CPU_Core_Full_Run         ) return "Full";
@@ -201,6 +201,7 @@ public:
 		addr&=4095;
 		if (host_readb(hostmem+addr)==(Bit8u)val) return;
 		host_writeb(hostmem+addr,val);
+		MEM_MarkHostDirty(hostmem);
 		// see if there's code where we are writing to
 		if (!write_map[addr]) {
 			if (active_blocks) return;		// still some blocks in this page
@@ -222,6 +223,7 @@ public:
 		addr&=4095;
 		if (host_readw(hostmem+addr)==(Bit16u)val) return;
 		host_writew(hostmem+addr,val);
+		MEM_MarkHostDirty(hostmem);
 		// see if there's code where we are writing to
 		if (!*(Bit16u*)&write_map[addr]) {
 			if (active_blocks) return;		// still some blocks in this page
@@ -248,6 +250,7 @@ public:
 		addr&=4095;
 		if (host_readd(hostmem+addr)==(Bit32u)val) return;
 		host_writed(hostmem+addr,val);
+		MEM_MarkHostDirty(hostmem);
 		// see if there's code where we are writing to
 		if (!*(Bit32u*)&write_map[addr]) {
 			if (active_blocks) return;		// still some blocks in this page
@@ -292,6 +295,7 @@ public:
 			}
 		}
 		host_writeb(hostmem+addr,val);
+		MEM_MarkHostDirty(hostmem);
 		return false;
 	}
 	bool writew_checked(PhysPt addr,Bitu val) {
@@ -325,6 +329,7 @@ public:
 			}
 		}
 		host_writew(hostmem+addr,val);
+		MEM_MarkHostDirty(hostmem);
 		return false;
 	}
 	bool writed_checked(PhysPt addr,Bitu val) {
@@ -358,6 +363,7 @@ public:
 			}
 		}
 		host_writed(hostmem+addr,val);
+		MEM_MarkHostDirty(hostmem);
 		return false;
 	}
 
@@ -457,11 +463,17 @@ public:
 	HostPt GetHostWritePt(Bitu phys_page) { 
 		return GetHostReadPt( phys_page );
 	}
+	//DBP: accessors used for validating pages on save state load
+	Bitu GetPhysPage(void) { return phys_page; }
+	Bitu GetActiveBlocks(void) { return active_blocks; }
+	PageHandler * GetOldPageHandler(void) { return old_pagehandler; }
 public:
 	// the write map, there are write_map[i] cache blocks that cover the byte at address i
 	Bit8u write_map[4096];
 	Bit8u * invalidation_map;
 	CodePageHandlerDynRec * next, * prev;	// page linking
+	//DBP: hash of the page contents to validate the cache blocks across save state loads
+	Bit64u content_hash;
 private:
 	PageHandler * old_pagehandler;
 
@@ -865,3 +877,44 @@ static void DBPSerialize_cache_reset(void) {
 		dyn_return(BR_Link2,false);
 	}
 }
+
+extern Bit32u DBP_CPU_CacheKeptBlocks, DBP_CPU_CacheDroppedBlocks;
+
+static Bit64u DBPSerialize_cache_hashpage(const Bit8u* p) {
+	Bit64u hash=0xcbf29ce484222325ULL;
+	for (const Bit64u *q=(const Bit64u*)p, *qend=q+(4096/sizeof(Bit64u)); q!=qend; q++)
+		hash=(hash^*q)*0x100000001b3ULL;
+	return hash;
+}
+
+// Instead of throwing away the entire cache on save state load, remember the contents of
+// all code pages before guest memory gets restored and afterwards only drop pages that differ
+static void DBPSerialize_cache_hashpages(void) {
+	if (!cache_initialized) return;
+	for (CodePageHandlerDynRec * cpage=cache.used_pages; cpage; cpage=cpage->next)
+		cpage->content_hash=DBPSerialize_cache_hashpage(cpage->GetHostReadPt(cpage->GetPhysPage()));
+}
+
+static void DBPSerialize_cache_validatepages(void) {
+	if (!cache_initialized) return;
+	const Bit8u *ram_begin=MemBase, *ram_end=MemBase+MEM_TotalPages()*MEM_PAGE_SIZE;
+	for (CodePageHandlerDynRec * cpage=cache.used_pages, * npage; cpage; cpage = npage) {
+		npage = cpage->next;
+		Bitu phys_page=cpage->GetPhysPage();
+		PageHandler * restored_handler=MEM_GetPageHandler(phys_page);
+		const Bit8u* hostmem=cpage->GetHostReadPt(phys_page);
+		// the page handler restored from the save state must be this page or the one it wraps, and
+		// pages outside of main memory (i.e. vga memory) are not yet restored here so always drop them
+		if ((restored_handler==cpage || restored_handler==cpage->GetOldPageHandler())
+			&& hostmem>=ram_begin && hostmem+4096<=ram_end
+			&& DBPSerialize_cache_hashpage(hostmem)==cpage->content_hash) {
+			if (restored_handler!=cpage) MEM_SetPageHandler(phys_page,1,cpage);
+			DBP_CPU_CacheKeptBlocks+=(Bit32u)cpage->GetActiveBlocks();
+		} else {
+			DBP_CPU_CacheDroppedBlocks+=(Bit32u)cpage->GetActiveBlocks();
+			cpage->ClearRelease(); // move it into free_pages
+			if (restored_handler!=cpage) MEM_SetPageHandler(phys_page,1,restored_handler);
+		}
+	}
+	PAGING_ClearTLB();
+}
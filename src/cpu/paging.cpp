@@ -950,69 +950,105 @@ public:
 		flags=PFLAG_INIT|PFLAG_NOCODE;
 	}
 	Bitu readb(PhysPt addr) {
+#ifdef C_DBP_PAGE_FAULT_QUEUE_WIPE //DBP: Block memory access while wiping the page fault queue
+		if (DOSBOX_IsWipingPageFaultQueue) return 0;
+#endif
 		Bitu needs_reset=InitPage(addr,false);
 		Bit8u val=mem_readb(addr);
 		InitPageUpdateLink(needs_reset,addr);
 		return val;
 	}
 	Bitu readw(PhysPt addr) {
+#ifdef C_DBP_PAGE_FAULT_QUEUE_WIPE //DBP: Block memory access while wiping the page fault queue
+		if (DOSBOX_IsWipingPageFaultQueue) return 0;
+#endif
 		Bitu needs_reset=InitPage(addr,false);
 		Bit16u val=mem_readw(addr);
 		InitPageUpdateLink(needs_reset,addr);
 		return val;
 	}
 	Bitu readd(PhysPt addr) {
+#ifdef C_DBP_PAGE_FAULT_QUEUE_WIPE //DBP: Block memory access while wiping the page fault queue
+		if (DOSBOX_IsWipingPageFaultQueue) return 0;
+#endif
 		Bitu needs_reset=InitPage(addr,false);
 		Bit32u val=mem_readd(addr);
 		InitPageUpdateLink(needs_reset,addr);
 		return val;
 	}
 	void writeb(PhysPt addr,Bitu val) {
+#ifdef C_DBP_PAGE_FAULT_QUEUE_WIPE //DBP: Block memory access while wiping the page fault queue
+		if (DOSBOX_IsWipingPageFaultQueue) return;
+#endif
 		Bitu needs_reset=InitPage(addr,true);
 		mem_writeb(addr,val);
 		InitPageUpdateLink(needs_reset,addr);
 	}
 	void writew(PhysPt addr,Bitu val) {
+#ifdef C_DBP_PAGE_FAULT_QUEUE_WIPE //DBP: Block memory access while wiping the page fault queue
+		if (DOSBOX_IsWipingPageFaultQueue) return;
+#endif
 		Bitu needs_reset=InitPage(addr,true);
 		mem_writew(addr,val);
 		InitPageUpdateLink(needs_reset,addr);
 	}
 	void writed(PhysPt addr,Bitu val) {
+#ifdef C_DBP_PAGE_FAULT_QUEUE_WIPE //DBP: Block memory access while wiping the page fault queue
+		if (DOSBOX_IsWipingPageFaultQueue) return;
+#endif
 		Bitu needs_reset=InitPage(addr,true);
 		mem_writed(addr,val);
 		InitPageUpdateLink(needs_reset,addr);
 	}
 	bool readb_checked(PhysPt addr, Bit8u * val) {
+#ifdef C_DBP_PAGE_FAULT_QUEUE_WIPE //DBP: Block memory access while wiping the page fault queue
+		if (DOSBOX_IsWipingPageFaultQueue) return true;
+#endif
 		if (InitPageCheckOnly(addr,false)) {
 			*val=mem_readb(addr);
 			return false;
 		} else return true;
 	}
 	bool readw_checked(PhysPt addr, Bit16u * val) {
+#ifdef C_DBP_PAGE_FAULT_QUEUE_WIPE //DBP: Block memory access while wiping the page fault queue
+		if (DOSBOX_IsWipingPageFaultQueue) return true;
+#endif
 		if (InitPageCheckOnly(addr,false)){
 			*val=mem_readw(addr);
 			return false;
 		} else return true;
 	}
 	bool readd_checked(PhysPt addr, Bit32u * val) {
+#ifdef C_DBP_PAGE_FAULT_QUEUE_WIPE //DBP: Block memory access while wiping the page fault queue
+		if (DOSBOX_IsWipingPageFaultQueue) return true;
+#endif
 		if (InitPageCheckOnly(addr,false)) {
 			*val=mem_readd(addr);
 			return false;
 		} else return true;
 	}
 	bool writeb_checked(PhysPt addr,Bitu val) {
+#ifdef C_DBP_PAGE_FAULT_QUEUE_WIPE //DBP: Block memory access while wiping the page fault queue
+		if (DOSBOX_IsWipingPageFaultQueue) return true;
+#endif
 		if (InitPageCheckOnly(addr,true)) {
 			mem_writeb(addr,val);
 			return false;
 		} else return true;
 	}
 	bool writew_checked(PhysPt addr,Bitu val) {
+#ifdef C_DBP_PAGE_FAULT_QUEUE_WIPE //DBP: Block memory access while wiping the page fault queue
+		if (DOSBOX_IsWipingPageFaultQueue) return true;
+#endif
 		if (InitPageCheckOnly(addr,true)) {
 			mem_writew(addr,val);
 			return false;
 		} else return true;
 	}
 	bool writed_checked(PhysPt addr,Bitu val) {
+#ifdef C_DBP_PAGE_FAULT_QUEUE_WIPE //DBP: Block memory access while wiping the page fault queue
+		if (DOSBOX_IsWipingPageFaultQueue) return true;
+#endif
 		if (InitPageCheckOnly(addr,true)) {
 			mem_writed(addr,val);
 			return false;
@@ -1339,7 +1375,7 @@ bool PAGING_MakePhysPage(Bitu & page) {
 #else
 		if (!dir_entry.block.p) {
 			// During page fault wipe this can fail but we still return true to avoid a crash caused by MakeCodePage failing with "DYNX86:Can't find physpage" due to this.
-			// This is fine because the page fault wipe will revert state back to what it was during the page fault anyway.
+			// This is fine because memory access is blocked while wiping and the CPU state gets restored from the wipe snapshot (see DOSBOX_SerializePageFaultWipe).
 			if (!DOSBOX_IsWipingPageFaultQueue)
 				return false;
 		}
@@ -1353,7 +1389,7 @@ bool PAGING_MakePhysPage(Bitu & page) {
 #else
 		if (!tbl_entry.block.p) {
 			// During page fault wipe this can fail but we still return true to avoid a crash caused by MakeCodePage failing with "DYNX86:Can't find physpage" due to this.
-			// This is fine because the page fault wipe will revert state back to what it was during the page fault anyway.
+			// This is fine because memory access is blocked while wiping and the CPU state gets restored from the wipe snapshot (see DOSBOX_SerializePageFaultWipe).
 			if (!DOSBOX_IsWipingPageFaultQueue)
 				return false;
 		}
@@ -1797,3 +1833,17 @@ void DBPSerialize_Paging(DBPArchive& ar)
 	if (ar.mode == DBPArchive::MODE_ZERO)
 		pf_queue.used = 0;
 }
+
+#ifdef C_DBP_PAGE_FAULT_QUEUE_WIPE
+void DBPSerialize_PagingWipe(DBPArchive& ar)
+{
+	// Subset of DBPSerialize_Paging used to wipe the page fault queue, the TLB gets rebuilt on demand
+	ar.Serialize(paging.cr3);
+	ar.Serialize(paging.cr2);
+	ar.Serialize(paging.base);
+	ar.Serialize(paging.enabled);
+	ar.Serialize(pf_queue.entries[pf_queue.used?pf_queue.used-1:0]);
+	if (ar.mode == DBPArchive::MODE_LOAD)
+		PAGING_ClearTLB();
+}
+#endif
@@ -34,16 +34,32 @@
 #include "cross.h"
 #include "dbp_network.h"
 #include "dbp_threads.h"
+#include "../libretro-common/include/libretro.h"
 #include <stdarg.h> /* va_list */
 #include <stdlib.h> /* realloc, free */ 
 
+//#define DBP_NET_LOOPBACK_TEST
+
 struct DBP_Net
 {
 	enum { FIRST_MAC_OCTET = 0xde }; // has locally administered address bit (0x02) set
-	enum { PKT_IPX, PKT_NE2K, PKT_MODEM };
+	enum { PKT_IPX, PKT_NE2K, PKT_MODEM, PKT_BATCH };
+	enum { BATCH_MAX_RELIABLE = 65535, BATCH_MAX_UNRELIABLE = 1400, MODEM_CHUNK = 1023 };
 	std::vector<Bit8u> IncomingIPX, IncomingNe2k, IncomingModem, OutgoingPackets, OutgoingModem;
 	Mutex IncomingMtx, OutgoingMtx;
 	struct Addr { Bit8u ipxnetworknum[4], mac[6]; };
+
+	// Packets queued during a frame are coalesced into one PKT_BATCH per target and reliability which holds
+	// the packets with the same [LE16 length][type][data] layout as OutgoingPackets
+	struct Batch { std::vector<Bit8u> data; Bit16u client_id, count; bool reliable; };
+	std::vector<Batch> Batches;
+	Bit32u SentPackets = 0, SentBatches = 0;
+
+	void Receive(const Bit8u* pkt, size_t pktlen);
+	void ReceiveOne(Bit8u type, const Bit8u* data, size_t datalen);
+	void SendOutgoing(retro_netpacket_send_t send_fn, bool flush);
+	void AddToBatch(retro_netpacket_send_t send_fn, Bit16u client_id, bool reliable, Bit8u type, const Bit8u* data, size_t datalen);
+	void SendBatch(retro_netpacket_send_t send_fn, Batch& b);
 };
 
 bool dbp_net_connected;
@@ -2776,8 +2792,134 @@ void IPX_Init(Section* sec) {
 
 #endif // C_DBP_ENABLE_LIBRETRO_IPX
 
-#include "../libretro-common/include/libretro.h"
 static retro_netpacket_send_t dbp_net_send_fn;
+static retro_netpacket_poll_receive_t dbp_net_poll_receive_fn;
+
+static INLINE Bit16u DBP_Net_ClientIdFromMac(const Bit8u* mac)
+{
+	// Consider unknown first octet to be a multicast of some sort
+	return (mac[0] == DBP_Net::FIRST_MAC_OCTET ? NET_READ_BE16(&mac[4]) : (Bit16u)RETRO_NETPACKET_BROADCAST);
+}
+
+void DBP_Net::ReceiveOne(Bit8u type, const Bit8u* data, size_t datalen)
+{
+	switch (type)
+	{
+		case PKT_IPX:
+		case PKT_NE2K:
+		{
+			std::vector<Bit8u>& incoming = (type == PKT_IPX ? IncomingIPX : IncomingNe2k);
+			size_t incomingsz = incoming.size();
+			incoming.resize(incomingsz + 2 + datalen);
+			Bit8u *pStore = &incoming[incomingsz];
+			NET_WRITE_LE16(pStore, (Bit16u)datalen);
+			memcpy(pStore + 2, data, datalen);
+			break;
+		}
+		case PKT_MODEM:
+		{
+			size_t incomingsz = IncomingModem.size();
+			IncomingModem.resize(incomingsz + datalen);
+			memcpy(&IncomingModem[incomingsz], data, datalen);
+			break;
+		}
+	}
+}
+
+void DBP_Net::Receive(const Bit8u* pkt, size_t pktlen)
+{
+	IncomingMtx.Lock();
+	if (pkt[0] != PKT_BATCH)
+		ReceiveOne(pkt[0], pkt + 1, pktlen - 1); // reduce by packet type
+	else for (const Bit8u *p = pkt + 1, *pEnd = pkt + pktlen; p + 3 <= pEnd;)
+	{
+		size_t len = NET_READ_LE16(p);
+		if (p + 3 + len > pEnd) { DBP_ASSERT(false); break; }
+		ReceiveOne(p[2], p + 3, len);
+		p += 3 + len;
+	}
+	IncomingMtx.Unlock();
+}
+
+void DBP_Net::SendBatch(retro_netpacket_send_t send_fn, Batch& b)
+{
+	// A batch with a single packet is sent without the batch header
+	if (b.count == 1) send_fn((b.reliable ? RETRO_NETPACKET_RELIABLE : RETRO_NETPACKET_UNRELIABLE), &b.data[3], b.data.size() - 3, b.client_id);
+	else send_fn((b.reliable ? RETRO_NETPACKET_RELIABLE : RETRO_NETPACKET_UNRELIABLE), &b.data[0], b.data.size(), b.client_id);
+	SentPackets += b.count;
+	SentBatches++;
+	b.data.clear();
+	b.count = 0;
+}
+
+void DBP_Net::AddToBatch(retro_netpacket_send_t send_fn, Bit16u client_id, bool reliable, Bit8u type, const Bit8u* data, size_t datalen)
+{
+	Batch* b = NULL;
+	for (Batch& it : Batches) if (it.client_id == client_id && it.reliable == reliable) { b = &it; break; }
+	if (!b) { Batches.resize(Batches.size() + 1); b = &Batches.back(); b->client_id = client_id; b->reliable = reliable; b->count = 0; }
+	if (b->count && b->data.size() + 3 + datalen > (size_t)(reliable ? BATCH_MAX_RELIABLE : BATCH_MAX_UNRELIABLE)) SendBatch(send_fn, *b);
+	if (!b->count) b->data.push_back(PKT_BATCH);
+	size_t ofs = b->data.size();
+	b->data.resize(ofs + 3 + datalen);
+	NET_WRITE_LE16(&b->data[ofs], (Bit16u)datalen);
+	b->data[ofs + 2] = type;
+	memcpy(&b->data[ofs + 3], data, datalen);
+	b->count++;
+}
+
+void DBP_Net::SendOutgoing(retro_netpacket_send_t send_fn, bool flush)
+{
+	if (!OutgoingPackets.size() && !OutgoingModem.size()) return;
+
+	//printf("[DOSBOXNET] Sending Packet(s) - Total Len: %d\n", (int)(OutgoingPackets.size() + OutgoingModem.size()));
+	OutgoingMtx.Lock();
+	if (OutgoingPackets.size())
+	{
+		size_t len;
+		for (Bit8u* p = &OutgoingPackets[0], *pEnd = p + OutgoingPackets.size(); p < pEnd; p += 3 + len)
+		{
+			len = NET_READ_LE16(p);
+			const Bit8u *data = p + 3, *src_mac, *dest_mac;
+			if (p[2] == PKT_IPX)
+			{
+				if (len < sizeof(IPXHeader)) { DBP_ASSERT(false); continue; }
+				src_mac = ((const IPXHeader*)data)->src.mac, dest_mac = ((const IPXHeader*)data)->dest.mac;
+			}
+			else // PKT_NE2K
+			{
+				if (len < sizeof(EthernetHeader)) { DBP_ASSERT(false); continue; }
+				src_mac = ((const EthernetHeader*)data)->src_mac, dest_mac = ((const EthernetHeader*)data)->dest_mac;
+			}
+			DBP_ASSERT(memcmp(dest_mac, dbp_net_addr.mac, 6)); // maybe? maybe not? probably...
+			//DBP_ASSERT(!memcmp(src_mac, dbp_net_addr.mac, 6)); // can fail during startup of Win9x, so allow it
+			//DBP_ASSERT(DBP_Net_ClientIdFromMac(src_mac) != DBP_Net_ClientIdFromMac(dest_mac)); // can fail during startup of Win9x, so allow it
+			// Currently we alwyas send everything NE2K wants to (IPX filters itself in DOSIPX::sendPacket)
+			// For example, TCP/IP might use multicasts (01-00-5e mac addresses) that we just broadcast to everyone and have the endpoint figure it out
+			// IPX on the other hand we cannot send to the wrong target as (some implementations?) think every packet is destined for them
+			//if (dest_mac[0] != DBP_Net::FIRST_MAC_OCTET && dest_mac[0] != 0xFF)
+			//{
+			//	printf("[DOSBOXNET] IGNORING Packet - Len: %d - Src: %02x:%02x:%02x:%02x:%02x:%02x (#%d) - Dest: %02x:%02x:%02x:%02x:%02x:%02x (#%d)\n", len, src_mac[0], src_mac[1], src_mac[2], src_mac[3], src_mac[4], src_mac[5], DBP_Net_ClientIdFromMac(src_mac), dest_mac[0], dest_mac[1], dest_mac[2], dest_mac[3], dest_mac[4], dest_mac[5], DBP_Net_ClientIdFromMac(dest_mac));
+			//	continue;
+			//}
+			//printf("[DOSBOXNET] Outgoing Packet - Len: %d - Src: %02x:%02x:%02x:%02x:%02x:%02x (#%d) - Dest: %02x:%02x:%02x:%02x:%02x:%02x (#%d)\n", len, src_mac[0], src_mac[1], src_mac[2], src_mac[3], src_mac[4], src_mac[5], DBP_Net_ClientIdFromMac(src_mac), dest_mac[0], dest_mac[1], dest_mac[2], dest_mac[3], dest_mac[4], dest_mac[5], DBP_Net_ClientIdFromMac(dest_mac));
+			// Broadcasts (mostly game state updates and discovery) are sent unreliable to avoid head-of-line blocking, directed packets stay reliable
+			Bit16u client_id = DBP_Net_ClientIdFromMac(dest_mac);
+			AddToBatch(send_fn, client_id, (client_id != (Bit16u)RETRO_NETPACKET_BROADCAST), p[2], data, len);
+		}
+		OutgoingPackets.clear();
+	}
+	if (OutgoingModem.size())
+	{
+		// The modem is a byte stream which needs to stay reliable (skip the space reserved for the packet id by CLibretroModem::transmitByte)
+		for (const Bit8u* p = &OutgoingModem[1], *pEnd = &OutgoingModem[0] + OutgoingModem.size(); p < pEnd; p += MODEM_CHUNK)
+			AddToBatch(send_fn, (Bit16u)RETRO_NETPACKET_BROADCAST, true, PKT_MODEM, p, (pEnd - p > MODEM_CHUNK ? (size_t)MODEM_CHUNK : (size_t)(pEnd - p)));
+		OutgoingModem.clear();
+	}
+	OutgoingMtx.Unlock();
+
+	for (Batch& b : Batches) if (b.count) SendBatch(send_fn, b);
+	if (flush) send_fn(RETRO_NETPACKET_FLUSH_HINT, NULL, 0, (Bit16u)RETRO_NETPACKET_BROADCAST);
+}
 
 struct NetCallBacks
 {
@@ -2789,16 +2931,11 @@ struct NetCallBacks
 		if (NE2K::self) NE2K::self->init_mac();
 		dbp_net_connected = true;
 		dbp_net_send_fn = send_fn;
+		dbp_net_poll_receive_fn = poll_receive_fn;
 		void DBP_EnableNetwork();
 		DBP_EnableNetwork();
 	}
 
-	static INLINE Bit16u client_id_from_mac(const Bit8u* mac)
-	{
-		// Consider unknown first octet to be a multicast of some sort
-		return (mac[0] == DBP_Net::FIRST_MAC_OCTET ? NET_READ_BE16(&mac[4]) : (Bit16u)RETRO_NETPACKET_BROADCAST);
-	}
-
 	static void RETRO_CALLCONV receive(const void* pkt, size_t pktlen, uint16_t client_id)
 	{
 		DBP_ASSERT(NET_READ_BE16(&dbp_net_addr.mac[4]) != client_id); // can't be from myself
@@ -2815,31 +2952,7 @@ struct NetCallBacks
 		#endif
 
 		//printf("[DOSBOXNET] Received Packet - From: %d, Type: %d, Len: %d\n", client_id, *(Bit8u*)pkt, pktlen);
-		switch (*(const Bit8u*)pkt)
-		{
-			case DBP_Net::PKT_IPX:
-			case DBP_Net::PKT_NE2K:
-			{
-				std::vector<Bit8u>& incoming = (*(const Bit8u*)pkt == DBP_Net::PKT_IPX ? dbp_net->IncomingIPX : dbp_net->IncomingNe2k);
-				dbp_net->IncomingMtx.Lock();
-				size_t incomingsz = incoming.size(), datalen = pktlen - 1; // reduce by packet type
-				incoming.resize(incomingsz + 2 + datalen);
-				Bit8u *pStore = &incoming[incomingsz];
-				NET_WRITE_LE16(pStore, (Bit16u)datalen);
-				memcpy(pStore + 2, (const Bit8u*)pkt + 1, datalen);
-				dbp_net->IncomingMtx.Unlock();
-				break;
-			}
-			case DBP_Net::PKT_MODEM:
-			{
-				dbp_net->IncomingMtx.Lock();
-				size_t incomingsz = dbp_net->IncomingModem.size(), datalen = pktlen - 1; // reduce by packet type
-				dbp_net->IncomingModem.resize(incomingsz + datalen);
-				memcpy(&dbp_net->IncomingModem[incomingsz], (const Bit8u*)pkt + 1, datalen);
-				dbp_net->IncomingMtx.Unlock();
-				break;
-			}
-		}
+		dbp_net->Receive((const Bit8u*)pkt, pktlen);
 	}
 
 	static void RETRO_CALLCONV stop(void)
@@ -2848,6 +2961,7 @@ struct NetCallBacks
 		if (dbp_net) cleanup();
 		dbp_net_connected = false;
 		dbp_net_send_fn = NULL;
+		dbp_net_poll_receive_fn = NULL;
 	}
 
 	static void RETRO_CALLCONV poll(void)
@@ -2863,60 +2977,13 @@ struct NetCallBacks
 		static size_t _sumlen, _sumnum; _sumlen += (dbp_net->OutgoingPackets.size() + dbp_net->OutgoingModem.size()); _sumnum++; extern Bit32u DBP_GetTicks(); static Bit32u lastreport; Bit32u tick = DBP_GetTicks();
 		if (tick - lastreport >= 1000)
 		{
-			printf("[DOSBOXNET] Sent %d bytes (%d polls) - [BUF] IPX: %d, NE2K: %d, MODEM: %d\n", (int)_sumlen, (int)_sumnum, (int)dbp_net->IncomingIPX.size(), (int)dbp_net->IncomingNe2k.size(), (int)dbp_net->IncomingModem.size());
+			printf("[DOSBOXNET] Sent %d bytes (%d polls, %d packets in %d batches) - [BUF] IPX: %d, NE2K: %d, MODEM: %d\n", (int)_sumlen, (int)_sumnum, (int)dbp_net->SentPackets, (int)dbp_net->SentBatches, (int)dbp_net->IncomingIPX.size(), (int)dbp_net->IncomingNe2k.size(), (int)dbp_net->IncomingModem.size());
 			_sumlen = _sumnum = 0;
 			lastreport = ((tick - lastreport < 2000) ? (lastreport + 1000) : tick);
 		}
 		#endif
 
-		if (!dbp_net->OutgoingPackets.size() && !dbp_net->OutgoingModem.size()) return;
-
-		//printf("[DOSBOXNET] Sending Packet(s) - Total Len: %d\n", (int)(dbp_net->OutgoingPackets.size() + dbp_net->OutgoingModem.size()));
-		dbp_net->OutgoingMtx.Lock();
-		if (dbp_net->OutgoingPackets.size())
-		{
-			size_t len;
-			for (Bit8u* p = &dbp_net->OutgoingPackets[0], *pEnd = p + dbp_net->OutgoingPackets.size(); p < pEnd; p += 2 + len)
-			{
-				len = NET_READ_LE16(p) + 1; // add packet type byte
-				const Bit8u *data = p + 3, *src_mac, *dest_mac;
-				if (p[2] == DBP_Net::PKT_IPX)
-				{
-					if (len < (sizeof(IPXHeader) + 1)) { DBP_ASSERT(false); return; }
-					src_mac = ((const IPXHeader*)data)->src.mac, dest_mac = ((const IPXHeader*)data)->dest.mac;
-				}
-				else // DBP_Net::PKT_NE2K
-				{
-					if (len < (sizeof(EthernetHeader) + 1)) { DBP_ASSERT(false); return; }
-					src_mac = ((const EthernetHeader*)data)->src_mac, dest_mac = ((const EthernetHeader*)data)->dest_mac;
-				}
-				DBP_ASSERT(memcmp(dest_mac, dbp_net_addr.mac, 6)); // maybe? maybe not? probably...
-				//DBP_ASSERT(!memcmp(src_mac, dbp_net_addr.mac, 6)); // can fail during startup of Win9x, so allow it
-				//DBP_ASSERT(client_id_from_mac(src_mac) != client_id_from_mac(dest_mac)); // can fail during startup of Win9x, so allow it
-				// Currently we alwyas send everything NE2K wants to (IPX filters itself in DOSIPX::sendPacket)
-				// For example, TCP/IP might use multicasts (01-00-5e mac addresses) that we just broadcast to everyone and have the endpoint figure it out
-				// IPX on the other hand we cannot send to the wrong target as (some implementations?) think every packet is destined for them
-				//if (dest_mac[0] != DBP_Net::FIRST_MAC_OCTET && dest_mac[0] != 0xFF)
-				//{
-				//	printf("[DOSBOXNET] IGNORING Packet - Len: %d - Src: %02x:%02x:%02x:%02x:%02x:%02x (#%d) - Dest: %02x:%02x:%02x:%02x:%02x:%02x (#%d)\n", len, src_mac[0], src_mac[1], src_mac[2], src_mac[3], src_mac[4], src_mac[5], client_id_from_mac(src_mac), dest_mac[0], dest_mac[1], dest_mac[2], dest_mac[3], dest_mac[4], dest_mac[5], client_id_from_mac(dest_mac));
-				//	continue;
-				//}
-				//printf("[DOSBOXNET] Outgoing Packet - Len: %d - Src: %02x:%02x:%02x:%02x:%02x:%02x (#%d) - Dest: %02x:%02x:%02x:%02x:%02x:%02x (#%d)\n", len, src_mac[0], src_mac[1], src_mac[2], src_mac[3], src_mac[4], src_mac[5], client_id_from_mac(src_mac), dest_mac[0], dest_mac[1], dest_mac[2], dest_mac[3], dest_mac[4], dest_mac[5], client_id_from_mac(dest_mac));
-				dbp_net_send_fn(RETRO_NETPACKET_RELIABLE, p + 2, len, client_id_from_mac(dest_mac));
-			}
-			dbp_net->OutgoingPackets.clear();
-		}
-		if (dbp_net->OutgoingModem.size())
-		{
-			for (Bit8u* p = &dbp_net->OutgoingModem[0], *pEnd = (p++) + dbp_net->OutgoingModem.size(); p < pEnd; p += 1023)
-			{
-				size_t len = (pEnd - p > 1023 ? (Bit32u)1023 : (Bit32u)(pEnd - p));
-				p[-1] = DBP_Net::PKT_MODEM; // prefix with packet type (space reserved by CLibretroModem::transmitByte)
-				dbp_net_send_fn(RETRO_NETPACKET_RELIABLE, p-1, len + 1, RETRO_NETPACKET_BROADCAST);
-			}
-			dbp_net->OutgoingModem.clear();
-		}
-		dbp_net->OutgoingMtx.Unlock();
+		dbp_net->SendOutgoing(dbp_net_send_fn, false);
 	}
 
 	//static void RETRO_CALLCONV connected(uint16_t client_id) { LOG_MSG("[DOSBOXNET] Client Connected: %d", client_id); }
@@ -2927,6 +2994,7 @@ struct NetCallBacks
 		dbp_net->OutgoingMtx.Lock();
 		dbp_net->OutgoingPackets.clear();
 		dbp_net->OutgoingModem.clear();
+		for (DBP_Net::Batch& b : dbp_net->Batches) { b.data.clear(); b.count = 0; }
 		dbp_net->OutgoingMtx.Unlock();
 		dbp_net->IncomingMtx.Lock();
 		dbp_net->IncomingIPX.clear();
@@ -2936,11 +3004,89 @@ struct NetCallBacks
 	}
 };
 
-#if 0 // disabled aggressive latency reduction
+// Called by retro_run when the emulation finished a frame, sends the packets of the whole frame and processes any incoming ones
 void DBP_Network_Flush()
 {
+	if (!dbp_net_connected || !dbp_net_send_fn) return;
+	dbp_net->SendOutgoing(dbp_net_send_fn, true);
 	if (dbp_net_poll_receive_fn) dbp_net_poll_receive_fn();
-	if (dbp_net_send_fn) NetCallBacks::SendOutgoing(RETRO_NETPACKET_RELIABLE|RETRO_NETPACKET_FLUSH_HINT);
+}
+
+#ifdef DBP_NET_LOOPBACK_TEST
+static void DBP_Net_LoopbackTest()
+{
+	// Two instances in one process connected by a transport that drops every third unreliable send
+	static DBP_Net *a, *b;
+	static Bit32u sends, drops;
+	struct Loopback
+	{
+		static void RETRO_CALLCONV send(int flags, const void* buf, size_t len, uint16_t client_id)
+		{
+			if (!buf || !len) return; // flush hint
+			if (!(flags & RETRO_NETPACKET_RELIABLE) && (++sends % 3) == 0) { drops++; return; }
+			b->Receive((const Bit8u*)buf, len);
+		}
+		static size_t HeaderSize(Bit8u type) { return (type == DBP_Net::PKT_IPX ? sizeof(IPXHeader) : sizeof(EthernetHeader)); }
+		static Bit8u* DestMac(Bit8u type, Bit8u* data) { return (type == DBP_Net::PKT_IPX ? ((IPXHeader*)data)->dest.mac : ((EthernetHeader*)data)->dest_mac); }
+		static void Queue(Bit8u type, bool broadcast, Bit16u seq, size_t payload)
+		{
+			size_t ofs = a->OutgoingPackets.size(), hdr = HeaderSize(type), len = hdr + 2 + payload;
+			a->OutgoingPackets.resize(ofs + 3 + len);
+			Bit8u *p = &a->OutgoingPackets[ofs], *data = p + 3, *dest_mac = DestMac(type, data);
+			NET_WRITE_LE16(p, (Bit16u)len);
+			p[2] = type;
+			memset(data, 0, hdr);
+			if (broadcast) memset(dest_mac, 0xff, 6);
+			else { dest_mac[0] = DBP_Net::FIRST_MAC_OCTET; dest_mac[1] = 0xb0; dest_mac[2] = 0xc9; dest_mac[3] = 0x00; NET_WRITE_BE16(&dest_mac[4], 1); }
+			NET_WRITE_LE16(data + hdr, seq);
+			for (size_t i = 0; i != payload; i++) data[hdr + 2 + i] = (Bit8u)(seq + i);
+		}
+		static Bit32u Check(Bit8u type, std::vector<Bit8u>& in, Bit32u& received, Bit32u& unicasts)
+		{
+			Bit32u errors = 0, last_seq[2] = { 0, 0 }; size_t len;
+			for (Bit8u* p = (in.size() ? &in[0] : NULL), *pEnd = p + in.size(); p < pEnd; p += 2 + len, received++)
+			{
+				len = NET_READ_LE16(p);
+				Bit8u *data = p + 2; size_t hdr = HeaderSize(type);
+				if (len < hdr + 2) { errors++; break; }
+				bool broadcast = (DestMac(type, data)[0] == 0xff);
+				Bit16u seq = NET_READ_LE16(data + hdr);
+				for (size_t i = hdr + 2; i != len; i++) if (data[i] != (Bit8u)(seq + i - hdr - 2)) { errors++; break; }
+				if (seq < last_seq[broadcast]) errors++; // out of order
+				if (!broadcast && seq != last_seq[0] + (unicasts ? 1 : 0)) errors++; // reliable packet lost
+				last_seq[broadcast] = seq;
+				if (!broadcast) unicasts++;
+			}
+			return errors;
+		}
+	};
+	a = new DBP_Net(); b = new DBP_Net();
+	enum { FRAMES = 60, MODEM_BYTES_PER_FRAME = 700 };
+	Bit32u errors = 0, queued = 0;
+	Bit16u seqs[2][2] = { { 0, 0 }, { 0, 0 } };
+	for (int frame = 0; frame != FRAMES; frame++)
+	{
+		for (int i = 0; i != 10; i++, queued++)
+		{
+			Bit8u type = (i < 8 ? DBP_Net::PKT_IPX : DBP_Net::PKT_NE2K);
+			bool broadcast = !(i & 1);
+			Loopback::Queue(type, broadcast, seqs[type][broadcast]++, (type == DBP_Net::PKT_IPX ? 10 + (frame * 10 + i) % 50 : 50 + (frame * 97) % 1400));
+		}
+		if (!a->OutgoingModem.size()) a->OutgoingModem.push_back(0); // reserved byte like CLibretroModem::transmitByte
+		for (int i = 0; i != MODEM_BYTES_PER_FRAME; i++) a->OutgoingModem.push_back((Bit8u)(frame * MODEM_BYTES_PER_FRAME + i));
+		a->SendOutgoing(Loopback::send, true);
+	}
+
+	// Directed packets and the modem stream must arrive complete and in order, broadcasts may be dropped but never reordered
+	Bit32u recv_ipx = 0, recv_ne2k = 0, unicast_ipx = 0, unicast_ne2k = 0;
+	errors += Loopback::Check(DBP_Net::PKT_IPX, b->IncomingIPX, recv_ipx, unicast_ipx);
+	errors += Loopback::Check(DBP_Net::PKT_NE2K, b->IncomingNe2k, recv_ne2k, unicast_ne2k);
+	if (unicast_ipx != seqs[DBP_Net::PKT_IPX][0] || unicast_ne2k != seqs[DBP_Net::PKT_NE2K][0]) errors++;
+	if (b->IncomingModem.size() != FRAMES * MODEM_BYTES_PER_FRAME) errors++;
+	for (size_t i = 0; i != b->IncomingModem.size(); i++) if (b->IncomingModem[i] != (Bit8u)i) { errors++; break; }
+	LOG_MSG("[DOSBOXNET] Loopback test: %u errors - Queued %u packets and %u modem bytes, sent %u packets in %u sends (%u unreliable dropped), received %u IPX and %u NE2K packets",
+		errors, queued, FRAMES * MODEM_BYTES_PER_FRAME, a->SentPackets, a->SentBatches, drops, recv_ipx, recv_ne2k);
+	delete a; delete b;
 }
 #endif
 
@@ -2954,6 +3100,10 @@ void DBP_Network_SetCallbacks(retro_environment_t envcb)
 	};
 	envcb(RETRO_ENVIRONMENT_SET_NETPACKET_INTERFACE, (void*)&packet_callback);
 
+	#ifdef DBP_NET_LOOPBACK_TEST
+	DBP_Net_LoopbackTest();
+	#endif
+
 #if 0 // This was disabled due to a bug in RetroArch 1.16 (fixed for 1.17 in https://github.com/libretro/RetroArch/pull/16019)
 	// We provide backwards compatibility with the deprecated environment call 76
 	#define RETRO_ENVIRONMENT_SET_NETPACKET76_INTERFACE 76
@@ -270,14 +270,14 @@ void DBPSerialize_All(DBPArchive& ar, bool dos_running, bool game_running)
 	Bit64s from = __rdtsc();
 	#endif
 
-	ar.version = 8;
+	ar.version = DBPArchive::CURRENT_VERSION;
 	if (ar.mode != DBPArchive::MODE_ZERO)
 	{
 		Bit32u magic = 0xD05B5747;
 		Bit8u invalid_state = (dos_running ? 0 : 1) | (game_running ? 0 : 2);
 		ar << magic << ar.version << invalid_state;
 		if (magic != 0xD05B5747) { ar.had_error = DBPArchive::ERR_LAYOUT; return; }
-		if (ar.version < 1 || ar.version > 8) { DBP_ASSERT(false); ar.had_error = DBPArchive::ERR_VERSION; return; }
+		if (ar.version < 1 || ar.version > DBPArchive::CURRENT_VERSION) { DBP_ASSERT(false); ar.had_error = DBPArchive::ERR_VERSION; return; }
 		if (ar.mode == DBPArchive::MODE_LOAD || ar.mode == DBPArchive::MODE_SAVE)
 		{
 			if (!dos_running  || (invalid_state & 1)) { ar.had_error = DBPArchive::ERR_DOSNOTRUNNING; return; }
@@ -372,3 +372,79 @@ void DBPSerialize_All(DBPArchive& ar, bool dos_running, bool game_running)
 	}
 	#endif
 }
+
+#include <mem.h>
+#include <deque>
+#include <vector>
+
+// Memory snapshot functions in memory.cpp
+bool MEM_SnapshotTake(MEM_SnapshotId id, std::vector<Bit8u>* undo);
+bool MEM_SnapshotUndo(MEM_SnapshotId id, const std::vector<Bit8u>& undo);
+
+static struct DBPRewindBuffer
+{
+	enum { MAX_TOTAL_SIZE = 128*1024*1024 };
+	struct Entry { std::vector<Bit8u> state, undo; }; // undo has the memory pages of the previous entry that differ
+	std::deque<Entry> entries;
+	size_t total_size;
+} dbp_rewind;
+
+bool DBPSerialize_RewindPush(bool dos_running, bool game_running)
+{
+	// States are stored without memory which is kept in a snapshot, only the pages that changed since the previous state are copied
+	DBPArchiveCounter arsize;
+	arsize.flags = DBPArchive::FLAG_REWIND;
+	DBPSerialize_All(arsize, dos_running, game_running);
+	if (arsize.had_error) return false;
+
+	DBPRewindBuffer::Entry e;
+	e.state.resize(arsize.count);
+	DBPArchiveWriter ar(&e.state[0], e.state.size());
+	ar.flags = DBPArchive::FLAG_REWIND;
+	DBPSerialize_All(ar, dos_running, game_running);
+	if (ar.had_error) return false;
+
+	// Without a snapshot to compare against (first state or memory was reset) the older states can't be restored anymore
+	if (!MEM_SnapshotTake(MEM_SNAPSHOT_REWIND, &e.undo)) { dbp_rewind.entries.clear(); dbp_rewind.total_size = 0; }
+	e.undo.shrink_to_fit();
+
+	dbp_rewind.total_size += e.state.size() + e.undo.size();
+	dbp_rewind.entries.push_back(std::move(e));
+
+	// Drop the oldest states while over the limit, the undo pages of the oldest remaining state are never needed
+	while (dbp_rewind.total_size > DBPRewindBuffer::MAX_TOTAL_SIZE && dbp_rewind.entries.size() > 1)
+	{
+		dbp_rewind.total_size -= dbp_rewind.entries.front().state.size() + dbp_rewind.entries.front().undo.size();
+		dbp_rewind.entries.pop_front();
+		dbp_rewind.total_size -= dbp_rewind.entries.front().undo.size();
+		std::vector<Bit8u>().swap(dbp_rewind.entries.front().undo);
+	}
+	return true;
+}
+
+bool DBPSerialize_RewindPop(bool dos_running, bool game_running)
+{
+	// Discard the newest state and restore the one before it which stays in the buffer as the base for the next pushed state
+	if (dbp_rewind.entries.empty()) return false;
+	if (dbp_rewind.entries.size() > 1)
+	{
+		const DBPRewindBuffer::Entry& e = dbp_rewind.entries.back();
+		if (!MEM_SnapshotUndo(MEM_SNAPSHOT_REWIND, e.undo)) { DBPSerialize_RewindClear(); return false; }
+		dbp_rewind.total_size -= e.state.size() + e.undo.size();
+		dbp_rewind.entries.pop_back();
+	}
+
+	const std::vector<Bit8u>& state = dbp_rewind.entries.back().state;
+	DBPArchiveReader ar(&state[0], state.size());
+	ar.flags = DBPArchive::FLAG_REWIND;
+	DBPSerialize_All(ar, dos_running, game_running);
+	if (ar.had_error) { DBPSerialize_RewindClear(); return false; }
+	return true;
+}
+
+void DBPSerialize_RewindClear()
+{
+	dbp_rewind.entries.clear();
+	dbp_rewind.total_size = 0;
+	MEM_SnapshotFree(MEM_SNAPSHOT_REWIND);
+}
@@ -203,6 +203,9 @@ private:
 		double audio_factor;
 		struct stb_vorbis *vorb;
 		std::vector<Bit8u> buffer_temp;
+		Bit32u src_rate, src_channels, resample_next, resample_src;
+		struct CDAudioResampler *resampler;
+		bool readResampled(Bit8u *buffer, int seek);
 		#elif defined(C_SDL_SOUND)
 		Sound_Sample *sample;
 		int lastCount;
@@ -0,0 +1,1000 @@
+// Decoders for compressed CHD version 5 files (map, zlib, lzma, huff, flac, cdzl, cdlz and cdfl hunk codecs)
+// Based on the CHD format as implemented in MAME (chd.cpp, chdcodec.cpp, huffman.cpp, bitstream.h, cdrom.cpp)
+// Copyright Aaron Giles, BSD-3-Clause
+// The LZMA decoder is based on LzmaSpec.cpp by Igor Pavlov (public domain)
+
+//#define DBP_CHD_SELF_TEST
+
+struct chdcodec
+{
+	enum
+	{
+		CODEC_ZLIB = 0x7a6c6962, CODEC_LZMA = 0x6c7a6d61, CODEC_HUFF = 0x68756666, CODEC_FLAC = 0x666c6163, // 'zlib', 'lzma', 'huff', 'flac'
+		CODEC_CDZL = 0x63647a6c, CODEC_CDLZ = 0x63646c7a, CODEC_CDFL = 0x6364666c,                          // 'cdzl', 'cdlz', 'cdfl'
+	};
+	enum
+	{
+		COMPRESSION_TYPE_0, COMPRESSION_TYPE_1, COMPRESSION_TYPE_2, COMPRESSION_TYPE_3, COMPRESSION_NONE, COMPRESSION_SELF, COMPRESSION_PARENT,
+		COMPRESSION_RLE_SMALL, COMPRESSION_RLE_LARGE, COMPRESSION_SELF_0, COMPRESSION_SELF_1, COMPRESSION_PARENT_SELF, COMPRESSION_PARENT_0, COMPRESSION_PARENT_1,
+	};
+	enum { MAP_HEADER_SIZE = 16, MAP_ENTRY_SIZE = 12 };
+	enum { CD_MAX_SECTOR_DATA = 2352, CD_MAX_SUBCODE_DATA = 96, CD_FRAME_SIZE = CD_MAX_SECTOR_DATA + CD_MAX_SUBCODE_DATA };
+
+	struct MapEntry { Bit64u offset; Bit32u length; Bit16u crc; Bit8u type; };
+
+	static Bit16u get_bigendian_uint16(const Bit8u *base) { return (Bit16u)((base[0] << 8) | base[1]); }
+	static Bit32u get_bigendian_uint24(const Bit8u *base) { return (base[0] << 16) | (base[1] << 8) | base[2]; }
+	static Bit32u get_bigendian_uint32(const Bit8u *base) { return ((Bit32u)base[0] << 24) | (base[1] << 16) | (base[2] << 8) | base[3]; }
+	static Bit64u get_bigendian_uint48(const Bit8u *base) { return ((Bit64u)get_bigendian_uint16(base) << 32) | get_bigendian_uint32(base + 2); }
+	static Bit64u get_bigendian_uint64(const Bit8u *base) { return ((Bit64u)get_bigendian_uint32(base) << 32) | get_bigendian_uint32(base + 4); }
+
+	static bool IsSupportedCodec(Bit32u codec)
+	{
+		return (codec == CODEC_ZLIB || codec == CODEC_LZMA || codec == CODEC_HUFF || codec == CODEC_FLAC || codec == CODEC_CDZL || codec == CODEC_CDLZ || codec == CODEC_CDFL);
+	}
+
+	static Bit16u CRC16(const Bit8u *p, Bit32u len)
+	{
+		// CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF)
+		static const struct Table { Bit16u t[256]; Table() { for (Bit32u i = 0, j, crc; i != 256; t[i++] = (Bit16u)crc) for (crc = (i << 8), j = 0; j != 8; j++) crc = (crc << 1) ^ ((crc & 0x8000) ? 0x1021 : 0); } } table;
+		Bit16u crc = 0xFFFF;
+		for (const Bit8u* pEnd = p + len; p != pEnd; p++) crc = (Bit16u)((crc << 8) ^ table.t[(crc >> 8) ^ *p]);
+		return crc;
+	}
+
+	// MSB first bit reader which reads zeros past the end of the input
+	struct BitStream
+	{
+		const Bit8u *read;
+		Bit32u buffer, doffset, dlength;
+		int bits;
+
+		BitStream(const Bit8u *src, Bit32u len) : read(src), buffer(0), doffset(0), dlength(len), bits(0) { }
+
+		Bit32u peek(int numbits)
+		{
+			if (!numbits) return 0;
+			if (numbits > bits)
+				for (; bits <= 24; bits += 8, doffset++)
+					if (doffset < dlength) buffer |= (Bit32u)read[doffset] << (24 - bits);
+			return buffer >> (32 - numbits);
+		}
+
+		void remove(int numbits) { buffer = (numbits < 32 ? buffer << numbits : 0); bits -= numbits; }
+		Bit32u read_bits(int numbits) { Bit32u res = peek(numbits); remove(numbits); return res; }
+		bool overflow() const { return ((doffset - bits / 8) > dlength); }
+	};
+
+	template <int NUMCODES, int MAXBITS> struct Huffman
+	{
+		Bit8u numbits[NUMCODES];
+		Bit32u codes[NUMCODES];
+		Bit16u lookup[1 << MAXBITS]; // code << 5 | number of bits
+
+		Bit32u decode_one(BitStream& bs)
+		{
+			Bit16u l = lookup[bs.peek(MAXBITS)];
+			bs.remove(l & 0x1f);
+			return (l >> 5);
+		}
+
+		bool build()
+		{
+			// Assign canonical codes for all nodes based on their code lengths
+			Bit32u bithisto[33] = { 0 };
+			for (int i = 0; i != NUMCODES; i++)
+			{
+				if (numbits[i] > MAXBITS) return false;
+				bithisto[numbits[i]]++;
+			}
+			for (Bit32u codelen = 32, curstart = 0; codelen > 0; codelen--)
+			{
+				Bit32u nextstart = (curstart + bithisto[codelen]) >> 1;
+				if (codelen != 1 && nextstart * 2 != (curstart + bithisto[codelen])) return false;
+				bithisto[codelen] = curstart;
+				curstart = nextstart;
+			}
+			memset(lookup, 0, sizeof(lookup));
+			for (int i = 0; i != NUMCODES; i++)
+			{
+				if (!numbits[i]) continue;
+				codes[i] = bithisto[numbits[i]]++;
+				int shift = MAXBITS - numbits[i];
+				if ((codes[i] << shift) >= (1 << MAXBITS)) return false;
+				for (Bit16u *dest = &lookup[codes[i] << shift], *destEnd = &lookup[((codes[i] + 1) << shift) - 1], value = (Bit16u)((i << 5) | numbits[i]); dest <= destEnd; dest++) *dest = value;
+			}
+			return true;
+		}
+
+		bool import_tree_rle(BitStream& bs)
+		{
+			int numbitsbits = (MAXBITS >= 16 ? 5 : (MAXBITS >= 8 ? 4 : 3)), curnode = 0;
+			while (curnode < NUMCODES)
+			{
+				int nodebits = (int)bs.read_bits(numbitsbits);
+				if (nodebits != 1) { numbits[curnode++] = (Bit8u)nodebits; continue; } // a non-one value is just raw
+				if ((nodebits = (int)bs.read_bits(numbitsbits)) == 1) { numbits[curnode++] = 1; continue; } // a double 1 is just a single 1
+				for (int repcount = (int)bs.read_bits(numbitsbits) + 3; repcount--;)
+				{
+					if (curnode == NUMCODES) return false;
+					numbits[curnode++] = (Bit8u)nodebits;
+				}
+			}
+			return (build() && !bs.overflow());
+		}
+
+		bool import_tree_huffman(BitStream& bs)
+		{
+			// Start by parsing the lengths for the small tree
+			Huffman<24, 6> smallhuff;
+			smallhuff.numbits[0] = (Bit8u)bs.read_bits(3);
+			int start = (int)bs.read_bits(3) + 1, count = 0;
+			for (int i = 1; i != 24; i++)
+			{
+				if (i < start || count == 7) smallhuff.numbits[i] = 0;
+				else { count = (int)bs.read_bits(3); smallhuff.numbits[i] = (Bit8u)(count == 7 ? 0 : count); }
+			}
+			if (!smallhuff.build()) return false;
+
+			// Determine the maximum length of an RLE count
+			int rlefullbits = 0;
+			for (Bit32u temp = NUMCODES - 9; temp; temp >>= 1) rlefullbits++;
+
+			// Now process the rest of the data
+			int curcode = 0;
+			for (Bit8u last = 0; curcode < NUMCODES;)
+			{
+				int value = (int)smallhuff.decode_one(bs);
+				if (value) { numbits[curcode++] = last = (Bit8u)(value - 1); continue; }
+				int rep = (int)bs.read_bits(3) + 2;
+				if (rep == 7 + 2) rep += (int)bs.read_bits(rlefullbits);
+				for (; rep && curcode < NUMCODES; rep--) numbits[curcode++] = last;
+			}
+			return (build() && !bs.overflow());
+		}
+	};
+
+	static bool DecodeMap(const Bit8u* maphdr, const Bit8u* src, Bit32u srclen, Bit32u hunkcount, Bit32u hunkbytes, Bit32u unitbytes, MapEntry* map)
+	{
+		// Map header: compressed length (4), offset of first hunk (6), map crc (2), lengthbits, selfbits, parentbits (1 each)
+		const Bit64u firstoffs = get_bigendian_uint48(maphdr + 4);
+		const Bit16u mapcrc = get_bigendian_uint16(maphdr + 10);
+		const int lengthbits = maphdr[12], selfbits = maphdr[13], parentbits = maphdr[14];
+		if (lengthbits > 32 || selfbits > 32 || parentbits > 32) return false;
+
+		// First decode the compression types
+		BitStream bs(src, srclen);
+		Huffman<16, 8> *decoder = new Huffman<16, 8>;
+		if (!decoder->import_tree_rle(bs)) { delete decoder; return false; }
+		Bit8u lastcomp = 0;
+		for (Bit32u hunk = 0, repcount = 0; hunk != hunkcount; hunk++)
+		{
+			if (repcount) { map[hunk].type = lastcomp; repcount--; continue; }
+			Bit8u val = (Bit8u)decoder->decode_one(bs);
+			if (val == COMPRESSION_RLE_SMALL)      { map[hunk].type = lastcomp; repcount = 2 + decoder->decode_one(bs); }
+			else if (val == COMPRESSION_RLE_LARGE) { map[hunk].type = lastcomp; repcount = 2 + 16 + (decoder->decode_one(bs) << 4); repcount += decoder->decode_one(bs); }
+			else map[hunk].type = lastcomp = val;
+		}
+		delete decoder;
+
+		// Then iterate through the hunks and extract the needed data while rebuilding the raw map for the CRC check
+		std::vector<Bit8u> rawmap(hunkcount * MAP_ENTRY_SIZE);
+		Bit64u curoffset = firstoffs, last_self = 0, last_parent = 0;
+		for (Bit32u hunk = 0; hunk != hunkcount; hunk++)
+		{
+			MapEntry& e = map[hunk];
+			e.offset = curoffset;
+			e.length = 0;
+			e.crc = 0;
+			switch (e.type)
+			{
+				case COMPRESSION_TYPE_0: case COMPRESSION_TYPE_1: case COMPRESSION_TYPE_2: case COMPRESSION_TYPE_3:
+					curoffset += (e.length = bs.read_bits(lengthbits));
+					e.crc = (Bit16u)bs.read_bits(16);
+					break;
+				case COMPRESSION_NONE:
+					curoffset += (e.length = hunkbytes);
+					e.crc = (Bit16u)bs.read_bits(16);
+					break;
+				case COMPRESSION_SELF:
+					last_self = e.offset = bs.read_bits(selfbits);
+					break;
+				case COMPRESSION_PARENT:
+					last_parent = e.offset = bs.read_bits(parentbits);
+					break;
+				case COMPRESSION_SELF_1:
+					last_self++;
+					/* fall through */
+				case COMPRESSION_SELF_0:
+					e.type = COMPRESSION_SELF;
+					e.offset = last_self;
+					break;
+				case COMPRESSION_PARENT_SELF:
+					e.type = COMPRESSION_PARENT;
+					last_parent = e.offset = ((Bit64u)hunk * hunkbytes) / unitbytes;
+					break;
+				case COMPRESSION_PARENT_1:
+					last_parent += hunkbytes / unitbytes;
+					/* fall through */
+				case COMPRESSION_PARENT_0:
+					e.type = COMPRESSION_PARENT;
+					e.offset = last_parent;
+					break;
+				default:
+					return false;
+			}
+			Bit8u* raw = &rawmap[hunk * MAP_ENTRY_SIZE];
+			raw[0] = e.type;
+			for (int i = 0; i != 3; i++) raw[1 + i] = (Bit8u)(e.length >> (16 - i * 8));
+			for (int i = 0; i != 6; i++) raw[4 + i] = (Bit8u)(e.offset >> (40 - i * 8));
+			raw[10] = (Bit8u)(e.crc >> 8);
+			raw[11] = (Bit8u)e.crc;
+		}
+		return (!bs.overflow() && CRC16(&rawmap[0], hunkcount * MAP_ENTRY_SIZE) == mapcrc);
+	}
+
+	struct LZMA
+	{
+		enum { LC = 3, LP = 0, PB = 2, NUM_STATES = 12, END_POS_MODEL_INDEX = 14, NUM_FULL_DISTANCES = 128, NUM_ALIGN_BITS = 4, NUM_LEN_TO_POS_STATES = 4 };
+		enum { NUM_BIT_MODEL_TOTAL_BITS = 11, BIT_MODEL_TOTAL = 1 << NUM_BIT_MODEL_TOTAL_BITS, NUM_MOVE_BITS = 5, TOP_VALUE = 1u << 24 };
+		typedef Bit16u Prob;
+		struct LenDecoder { Prob choice, choice2, low[1 << PB][8], mid[1 << PB][8], high[256]; };
+		struct Probs
+		{
+			Prob literal[0x300 << (LC + LP)], is_match[NUM_STATES << PB], is_rep[NUM_STATES], is_rep_g0[NUM_STATES], is_rep_g1[NUM_STATES], is_rep_g2[NUM_STATES], is_rep0_long[NUM_STATES << PB];
+			Prob pos_slot[NUM_LEN_TO_POS_STATES][64], pos_decoders[1 + NUM_FULL_DISTANCES - END_POS_MODEL_INDEX], align[1 << NUM_ALIGN_BITS];
+			LenDecoder len_decoder, rep_len_decoder;
+		} p;
+		const Bit8u *in, *in_end;
+		Bit32u range, code;
+
+		// The raw LZMA streams in CHD files are written without header and end marker using lc=3, lp=0, pb=2.
+		// The dictionary size (derived from the hunk size by the compressor) is irrelevant because we decode into one flat buffer.
+		bool Decode(const Bit8u* src, Bit32u srclen, Bit8u* out, Bit32u outlen)
+		{
+			for (Prob *pp = (Prob*)&p, *ppEnd = (Prob*)(&p + 1); pp != ppEnd; pp++) *pp = BIT_MODEL_TOTAL >> 1;
+			in = src;
+			in_end = src + srclen;
+			range = 0xFFFFFFFF;
+			code = 0;
+			if (NextByte() != 0) return false;
+			for (int i = 0; i != 4; i++) code = (code << 8) | NextByte();
+			if (code == range) return false;
+
+			Bit32u rep0 = 0, rep1 = 0, rep2 = 0, rep3 = 0, state = 0, pos = 0;
+			while (pos < outlen)
+			{
+				const Bit32u pos_state = (pos & ((1 << PB) - 1));
+				if (!Bit(p.is_match[(state << PB) + pos_state]))
+				{
+					const Bit32u prev_byte = (pos ? out[pos - 1] : 0);
+					Prob* probs = &p.literal[0x300 * (((pos & ((1 << LP) - 1)) << LC) + (prev_byte >> (8 - LC)))];
+					Bit32u symbol = 1;
+					if (state >= 7)
+					{
+						for (Bit32u match_byte = out[pos - rep0 - 1]; symbol < 0x100; match_byte <<= 1)
+						{
+							Bit32u match_bit = ((match_byte >> 7) & 1), bit = Bit(probs[((1 + match_bit) << 8) + symbol]);
+							symbol = (symbol << 1) | bit;
+							if (match_bit != bit) break;
+						}
+					}
+					while (symbol < 0x100) symbol = (symbol << 1) | Bit(probs[symbol]);
+					out[pos++] = (Bit8u)(symbol - 0x100);
+					state = (state < 4 ? 0 : (state < 10 ? state - 3 : state - 6));
+					continue;
+				}
+
+				Bit32u len;
+				if (Bit(p.is_rep[state]))
+				{
+					if (!pos) return false;
+					if (!Bit(p.is_rep_g0[state]))
+					{
+						if (!Bit(p.is_rep0_long[(state << PB) + pos_state]))
+						{
+							// short rep
+							state = (state < 7 ? 9 : 11);
+							out[pos] = out[pos - rep0 - 1];
+							pos++;
+							continue;
+						}
+					}
+					else
+					{
+						Bit32u dist;
+						if (!Bit(p.is_rep_g1[state])) dist = rep1;
+						else
+						{
+							if (!Bit(p.is_rep_g2[state])) dist = rep2;
+							else { dist = rep3; rep3 = rep2; }
+							rep2 = rep1;
+						}
+						rep1 = rep0;
+						rep0 = dist;
+					}
+					len = DecodeLen(p.rep_len_decoder, pos_state);
+					state = (state < 7 ? 8 : 11);
+				}
+				else
+				{
+					rep3 = rep2;
+					rep2 = rep1;
+					rep1 = rep0;
+					len = DecodeLen(p.len_decoder, pos_state);
+					state = (state < 7 ? 7 : 10);
+					rep0 = DecodeDistance(len);
+					if (rep0 == 0xFFFFFFFF) break; // end marker
+					if (rep0 >= pos) return false;
+				}
+				len += 2;
+				if (len > outlen - pos) return false;
+				for (Bit8u *o = out + pos, *oEnd = o + len; o != oEnd; o++) *o = o[-(int)rep0 - 1];
+				pos += len;
+			}
+			return (pos == outlen);
+		}
+
+		inline Bit8u NextByte() { return (in != in_end ? *in++ : 0); }
+
+		inline Bit32u Bit(Prob& prob)
+		{
+			Bit32u v = prob, bound = (range >> NUM_BIT_MODEL_TOTAL_BITS) * v, symbol;
+			if (code < bound) { v += ((BIT_MODEL_TOTAL - v) >> NUM_MOVE_BITS); range = bound; symbol = 0; }
+			else { v -= (v >> NUM_MOVE_BITS); code -= bound; range -= bound; symbol = 1; }
+			prob = (Prob)v;
+			if (range < TOP_VALUE) { range <<= 8; code = (code << 8) | NextByte(); }
+			return symbol;
+		}
+
+		Bit32u DirectBits(int num_bits)
+		{
+			Bit32u res = 0;
+			do
+			{
+				range >>= 1;
+				code -= range;
+				Bit32u t = 0 - (code >> 31);
+				code += (range & t);
+				if (range < TOP_VALUE) { range <<= 8; code = (code << 8) | NextByte(); }
+				res = (res << 1) + (t + 1);
+			} while (--num_bits);
+			return res;
+		}
+
+		Bit32u BitTree(Prob* probs, int num_bits)
+		{
+			Bit32u m = 1;
+			for (int i = 0; i != num_bits; i++) m = (m << 1) + Bit(probs[m]);
+			return m - (1u << num_bits);
+		}
+
+		Bit32u BitTreeReverse(Prob* probs, int num_bits)
+		{
+			Bit32u m = 1, symbol = 0;
+			for (int i = 0; i != num_bits; i++) { Bit32u bit = Bit(probs[m]); m = (m << 1) + bit; symbol |= (bit << i); }
+			return symbol;
+		}
+
+		Bit32u DecodeLen(LenDecoder& d, Bit32u pos_state)
+		{
+			if (!Bit(d.choice)) return BitTree(d.low[pos_state], 3);
+			if (!Bit(d.choice2)) return 8 + BitTree(d.mid[pos_state], 3);
+			return 16 + BitTree(d.high, 8);
+		}
+
+		Bit32u DecodeDistance(Bit32u len)
+		{
+			Bit32u pos_slot = BitTree(p.pos_slot[len < NUM_LEN_TO_POS_STATES ? len : NUM_LEN_TO_POS_STATES - 1], 6);
+			if (pos_slot < 4) return pos_slot;
+			int num_direct_bits = (int)((pos_slot >> 1) - 1);
+			Bit32u dist = ((2 | (pos_slot & 1)) << num_direct_bits);
+			if (pos_slot < END_POS_MODEL_INDEX) return dist + BitTreeReverse(p.pos_decoders + dist - pos_slot, num_direct_bits);
+			dist += DirectBits(num_direct_bits - NUM_ALIGN_BITS) << NUM_ALIGN_BITS;
+			return dist + BitTreeReverse(p.align, NUM_ALIGN_BITS);
+		}
+	};
+
+	// Decoder for the headerless 16-bit stereo FLAC frames stored in CHD files
+	struct FLAC
+	{
+		const Bit8u *src, *src_end, *p;
+		Bit64u cache;
+		int avail;
+		std::vector<Bit32s> samples;
+
+		inline void Refill() { for (; avail <= 56; avail += 8, p++) cache |= (Bit64u)(p < src_end ? *p : 0) << (56 - avail); }
+		inline Bit32u Read(int n) { if (!n) return 0; if (avail < n) Refill(); Bit32u res = (Bit32u)(cache >> (64 - n)); cache <<= n; avail -= n; return res; }
+		inline Bit32s ReadSigned(int n) { if (!n) return 0; return (Bit32s)(Read(n) << (32 - n)) >> (32 - n); }
+		inline Bit32u ReadUnary() { Bit32u n = 0; while (!Read(1)) { if (++n > 0x10000) return n; } return n; }
+		inline Bit32u BytePos() const { return (Bit32u)(p - src) - (Bit32u)(avail / 8); }
+		inline bool Overflow() const { return (BytePos() > (Bit32u)(src_end - src)); }
+		inline void AlignByte() { Read(avail & 7); }
+
+		bool DecodeResidual(Bit32s* out, Bit32u block_size, Bit32u order)
+		{
+			Bit32u method = Read(2);
+			if (method > 1) return false;
+			int param_bits = (method ? 5 : 4), escape = (method ? 31 : 15);
+			Bit32u partition_order = Read(4), partitions = (1 << partition_order);
+			if ((block_size >> partition_order) < order || (block_size & (partitions - 1))) return false;
+			for (Bit32u part = 0, i = order; part != partitions; part++)
+			{
+				Bit32u n = (block_size >> partition_order) - (part ? 0 : order);
+				int param = (int)Read(param_bits);
+				if (param == escape)
+				{
+					int bits = (int)Read(5);
+					for (Bit32u j = 0; j != n; j++) out[i++] = ReadSigned(bits);
+				}
+				else
+				{
+					for (Bit32u j = 0; j != n; j++)
+					{
+						Bit32u u = (ReadUnary() << param) | Read(param);
+						out[i++] = (Bit32s)(u >> 1) ^ -(Bit32s)(u & 1);
+					}
+				}
+				if (Overflow()) return false;
+			}
+			return true;
+		}
+
+		bool DecodeSubframe(Bit32s* out, Bit32u block_size, int bps)
+		{
+			if (Read(1)) return false;
+			Bit32u type = Read(6);
+			int wasted = 0;
+			if (Read(1)) wasted = (int)ReadUnary() + 1;
+			if (wasted >= bps) return false;
+			bps -= wasted;
+
+			if (type == 0) // constant
+			{
+				Bit32s v = ReadSigned(bps);
+				for (Bit32u i = 0; i != block_size; i++) out[i] = v;
+			}
+			else if (type == 1) // verbatim
+			{
+				for (Bit32u i = 0; i != block_size; i++) out[i] = ReadSigned(bps);
+			}
+			else if (type >= 8 && type <= 12) // fixed prediction
+			{
+				Bit32u order = type - 8;
+				if (order > block_size) return false;
+				for (Bit32u i = 0; i != order; i++) out[i] = ReadSigned(bps);
+				if (!DecodeResidual(out, block_size, order)) return false;
+				switch (order)
+				{
+					case 1: for (Bit32u i = 1; i < block_size; i++) out[i] += out[i-1]; break;
+					case 2: for (Bit32u i = 2; i < block_size; i++) out[i] += 2*out[i-1] - out[i-2]; break;
+					case 3: for (Bit32u i = 3; i < block_size; i++) out[i] += 3*out[i-1] - 3*out[i-2] + out[i-3]; break;
+					case 4: for (Bit32u i = 4; i < block_size; i++) out[i] += 4*out[i-1] - 6*out[i-2] + 4*out[i-3] - out[i-4]; break;
+				}
+			}
+			else if (type >= 32) // linear prediction
+			{
+				Bit32u order = (type & 31) + 1;
+				if (order > block_size) return false;
+				for (Bit32u i = 0; i != order; i++) out[i] = ReadSigned(bps);
+				int precision = (int)Read(4) + 1, shift = ReadSigned(5);
+				if (precision == 16 || shift < 0) return false;
+				Bit32s coefs[32];
+				for (Bit32u i = 0; i != order; i++) coefs[i] = ReadSigned(precision);
+				if (!DecodeResidual(out, block_size, order)) return false;
+				for (Bit32u i = order; i < block_size; i++)
+				{
+					Bit64s sum = 0;
+					for (Bit32u j = 0; j != order; j++) sum += (Bit64s)coefs[j] * out[i - 1 - j];
+					out[i] += (Bit32s)(sum >> shift);
+				}
+			}
+			else return false;
+
+			if (wasted)
+				for (Bit32u i = 0; i != block_size; i++) out[i] = (Bit32s)((Bit32u)out[i] << wasted);
+			return !Overflow();
+		}
+
+		bool DecodeFrame(Bit32u& block_size)
+		{
+			if (Read(15) != 0x7FFC) return false; // sync code
+			Read(1); // blocking strategy
+			Bit32u bs_code = Read(4), sr_code = Read(4), ch_assign = Read(4), ss_code = Read(3);
+			if (Read(1) || sr_code == 15 || ch_assign > 10 || (ss_code != 0 && ss_code != 4)) return false; // only 16-bit supported
+
+			// Frame or sample number coded like UTF-8
+			Bit32u first = Read(8);
+			for (Bit32u mask = 0x80; (first & mask) && mask != 1; mask >>= 1) if (mask != 0x80 && Read(8) >> 6 != 2) return false;
+
+			if (bs_code == 0) return false;
+			else if (bs_code == 1) block_size = 192;
+			else if (bs_code <= 5) block_size = 576 << (bs_code - 2);
+			else if (bs_code == 6) block_size = Read(8) + 1;
+			else if (bs_code == 7) block_size = Read(16) + 1;
+			else block_size = 256 << (bs_code - 8);
+
+			if (sr_code == 12) Read(8);
+			else if (sr_code == 13 || sr_code == 14) Read(16);
+			Read(8); // crc-8
+
+			Bit32u channels = (ch_assign < 8 ? ch_assign + 1 : 2);
+			if (channels != 2) return false;
+			if (samples.size() < block_size * 2) samples.resize(block_size * 2);
+			Bit32s *left = &samples[0], *right = left + block_size;
+			if (!DecodeSubframe(left, block_size, 16 + (ch_assign == 9 ? 1 : 0))) return false;
+			if (!DecodeSubframe(right, block_size, 16 + (ch_assign == 8 || ch_assign == 10 ? 1 : 0))) return false;
+			switch (ch_assign)
+			{
+				case 8: for (Bit32u i = 0; i != block_size; i++) right[i] = left[i] - right[i]; break; // left/side
+				case 9: for (Bit32u i = 0; i != block_size; i++) left[i] += right[i]; break; // side/right
+				case 10: // mid/side
+					for (Bit32u i = 0; i != block_size; i++)
+					{
+						Bit32s mid = (Bit32s)((Bit32u)left[i] << 1) | (right[i] & 1), side = right[i];
+						left[i] = (mid + side) >> 1;
+						right[i] = (mid - side) >> 1;
+					}
+					break;
+			}
+			AlignByte();
+			Read(16); // crc-16
+			return !Overflow();
+		}
+
+		// Decodes stereo sample frames into 16-bit interleaved output, returns the number of compressed bytes consumed (or 0 on error)
+		Bit32u Decode(const Bit8u* in, Bit32u inlen, Bit8u* out, Bit32u sample_frames, bool big_endian)
+		{
+			src = p = in;
+			src_end = in + inlen;
+			cache = 0;
+			avail = 0;
+			for (Bit32u done = 0, block_size, n; done != sample_frames; done += n)
+			{
+				if (!DecodeFrame(block_size)) return 0;
+				n = (block_size > sample_frames - done ? sample_frames - done : block_size);
+				for (const Bit32s *left = &samples[0], *right = left + block_size, *leftEnd = left + n; left != leftEnd; left++, right++, out += 4)
+				{
+					Bit16u l = (Bit16u)*left, r = (Bit16u)*right;
+					if (big_endian) { out[0] = (Bit8u)(l >> 8); out[1] = (Bit8u)l; out[2] = (Bit8u)(r >> 8); out[3] = (Bit8u)r; }
+					else { out[0] = (Bit8u)l; out[1] = (Bit8u)(l >> 8); out[2] = (Bit8u)r; out[3] = (Bit8u)(r >> 8); }
+				}
+			}
+			return BytePos();
+		}
+	};
+
+	static void ECCGenerate(Bit8u* sector)
+	{
+		// Regenerate the P and Q parity of a Mode 1 or Mode 2 Form 1 sector (ECMA-130 Annex A)
+		static const struct Tables { Bit8u f[256], b[256]; Tables() { for (Bit32u i = 0, j; i != 256; i++) { j = (i << 1) ^ ((i & 0x80) ? 0x11D : 0); f[i] = (Bit8u)j; b[i ^ (j & 0xFF)] = (Bit8u)i; } } } ecc;
+		const bool mode2 = (sector[15] == 2);
+		for (int pass = 0; pass != 2; pass++)
+		{
+			// P: 86 vectors of 24 bytes, Q: 52 vectors of 43 bytes, both starting after the 12 sync bytes
+			const Bit32u major_count = (pass ? 52 : 86), minor_count = (pass ? 43 : 24), major_mult = (pass ? 86 : 2), minor_inc = (pass ? 88 : 86), size = major_count * minor_count;
+			Bit8u* dest = sector + 12 + (pass ? 2236 : 2064);
+			for (Bit32u major = 0; major != major_count; major++)
+			{
+				Bit32u index = (major >> 1) * major_mult + (major & 1);
+				Bit8u ecc_a = 0, ecc_c = 0;
+				for (Bit32u minor = 0; minor != minor_count; minor++)
+				{
+					Bit8u temp = ((mode2 && index < 4) ? 0 : sector[12 + index]);
+					if ((index += minor_inc) >= size) index -= size;
+					ecc_a ^= temp;
+					ecc_c ^= temp;
+					ecc_a = ecc.f[ecc_a];
+				}
+				ecc_a = ecc.b[ecc.f[ecc_a] ^ ecc_c];
+				dest[major] = ecc_a;
+				dest[major + major_count] = (ecc_a ^ ecc_c);
+			}
+		}
+	}
+
+	// Per thread decompression state
+	struct Codecs
+	{
+		LZMA *lzma;
+		FLAC flac;
+		Huffman<256, 16> *huff;
+		std::vector<Bit8u> buf;
+		Codecs() : lzma(NULL), huff(NULL) { }
+		~Codecs() { delete lzma; delete huff; }
+
+		bool DecompressBase(Bit32u codec, const Bit8u* src, Bit32u srclen, Bit8u* dst, Bit32u dstlen)
+		{
+			if (codec == CODEC_ZLIB) return zipDrive::Uncompress(src, srclen, dst, dstlen);
+			if (codec == CODEC_LZMA) return (lzma ? lzma : (lzma = new LZMA))->Decode(src, srclen, dst, dstlen);
+			if (codec == CODEC_HUFF)
+			{
+				if (!huff) huff = new Huffman<256, 16>;
+				BitStream bs(src, srclen);
+				if (!huff->import_tree_huffman(bs)) return false;
+				for (Bit8u *d = dst, *dEnd = dst + dstlen; d != dEnd; d++) *d = (Bit8u)huff->decode_one(bs);
+				return !bs.overflow();
+			}
+			if (codec == CODEC_FLAC)
+			{
+				// First byte specifies the endianness of the samples
+				if (!srclen || (src[0] != 'L' && src[0] != 'B') || (dstlen & 3)) return false;
+				return (flac.Decode(src + 1, srclen - 1, dst, dstlen / 4, src[0] == 'B') != 0);
+			}
+			return false;
+		}
+
+		bool Decompress(Bit32u codec, const Bit8u* src, Bit32u srclen, Bit8u* dst, Bit32u hunkbytes)
+		{
+			if (codec != CODEC_CDZL && codec != CODEC_CDLZ && codec != CODEC_CDFL)
+				return DecompressBase(codec, src, srclen, dst, hunkbytes);
+
+			// CD codecs store sector data and subcode data of all frames in the hunk separately
+			const Bit32u frames = hunkbytes / CD_FRAME_SIZE, sector_bytes = frames * CD_MAX_SECTOR_DATA;
+			if (buf.size() < hunkbytes) buf.resize(hunkbytes);
+			Bit8u *sectors = &buf[0], *subcode = sectors + sector_bytes;
+			if (codec == CODEC_CDFL)
+			{
+				// FLAC audio data (big endian samples) followed by deflated subcode data
+				Bit32u ofs = flac.Decode(src, srclen, sectors, sector_bytes / 4, true);
+				if (!ofs || ofs > srclen || !zipDrive::Uncompress(src + ofs, srclen - ofs, subcode, frames * CD_MAX_SUBCODE_DATA)) return false;
+				for (Bit32u i = 0; i != frames; i++)
+				{
+					memcpy(dst + i * CD_FRAME_SIZE, sectors + i * CD_MAX_SECTOR_DATA, CD_MAX_SECTOR_DATA);
+					memcpy(dst + i * CD_FRAME_SIZE + CD_MAX_SECTOR_DATA, subcode + i * CD_MAX_SUBCODE_DATA, CD_MAX_SUBCODE_DATA);
+				}
+				return true;
+			}
+
+			// Header: bitmask of frames with stripped sync and ECC, then length of the compressed sector data
+			const Bit32u ecc_bytes = (frames + 7) / 8, complen_bytes = (hunkbytes < 65536 ? 2 : 3), header_bytes = ecc_bytes + complen_bytes;
+			if (srclen < header_bytes) return false;
+			Bit32u complen_base = (complen_bytes == 2 ? get_bigendian_uint16(src + ecc_bytes) : get_bigendian_uint24(src + ecc_bytes));
+			if (complen_base > srclen - header_bytes) return false;
+			if (!DecompressBase((codec == CODEC_CDLZ ? CODEC_LZMA : CODEC_ZLIB), src + header_bytes, complen_base, sectors, sector_bytes)) return false;
+			if (!zipDrive::Uncompress(src + header_bytes + complen_base, srclen - header_bytes - complen_base, subcode, frames * CD_MAX_SUBCODE_DATA)) return false;
+			static const Bit8u cd_sync_header[12] = { 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00 };
+			for (Bit32u i = 0; i != frames; i++)
+			{
+				Bit8u* sector = dst + i * CD_FRAME_SIZE;
+				memcpy(sector, sectors + i * CD_MAX_SECTOR_DATA, CD_MAX_SECTOR_DATA);
+				memcpy(sector + CD_MAX_SECTOR_DATA, subcode + i * CD_MAX_SUBCODE_DATA, CD_MAX_SUBCODE_DATA);
+				if (src[i / 8] & (1 << (i % 8))) { memcpy(sector, cd_sync_header, sizeof(cd_sync_header)); ECCGenerate(sector); }
+			}
+			return true;
+		}
+	};
+
+	#ifdef DBP_CHD_SELF_TEST
+	// Synthesizes hunks and a compressed map with minimal encoders for each codec and checks that they decode back to the source data
+	struct BitWriter
+	{
+		std::vector<Bit8u> out; Bit32u acc; int n;
+		BitWriter() : acc(0), n(0) { }
+		void Write(Bit32u v, int bits) { while (bits--) { acc = (acc << 1) | ((v >> bits) & 1); if (++n == 8) { out.push_back((Bit8u)acc); acc = 0; n = 0; } } }
+		void WriteUnary(Bit32u q) { while (q--) Write(0, 1); Write(1, 1); }
+		std::vector<Bit8u>& Flush() { while (n) Write(0, 1); return out; }
+	};
+
+	static void EncodeStoredDeflate(const Bit8u* src, Bit32u len, std::vector<Bit8u>& out)
+	{
+		for (Bit32u ofs = 0;;)
+		{
+			Bit32u n = (len - ofs > 0xFFFF ? 0xFFFF : len - ofs);
+			out.push_back((Bit8u)(ofs + n == len ? 1 : 0));
+			out.push_back((Bit8u)n); out.push_back((Bit8u)(n >> 8)); out.push_back((Bit8u)~n); out.push_back((Bit8u)(~n >> 8));
+			out.insert(out.end(), src + ofs, src + ofs + n);
+			if ((ofs += n) == len) break;
+		}
+	}
+
+	static void EncodeLiteralLZMA(const Bit8u* src, Bit32u len, std::vector<Bit8u>& out)
+	{
+		// Range encoder writing only literals, which is a valid LZMA stream
+		struct RC
+		{
+			std::vector<Bit8u>& out; Bit64u low; Bit32u range, cache_size; Bit8u cache;
+			RC(std::vector<Bit8u>& o) : out(o), low(0), range(0xFFFFFFFF), cache_size(1), cache(0) { }
+			void ShiftLow()
+			{
+				if ((Bit32u)low < 0xFF000000 || (int)(low >> 32))
+				{
+					Bit8u temp = cache;
+					do { out.push_back((Bit8u)(temp + (Bit8u)(low >> 32))); temp = 0xFF; } while (--cache_size);
+					cache = (Bit8u)((Bit32u)low >> 24);
+				}
+				cache_size++;
+				low = (Bit32u)low << 8;
+			}
+			void Bit(LZMA::Prob& p, Bit32u bit)
+			{
+				Bit32u bound = (range >> LZMA::NUM_BIT_MODEL_TOTAL_BITS) * p;
+				if (!bit) { range = bound; p += ((LZMA::BIT_MODEL_TOTAL - p) >> LZMA::NUM_MOVE_BITS); }
+				else { low += bound; range -= bound; p -= (p >> LZMA::NUM_MOVE_BITS); }
+				while (range < LZMA::TOP_VALUE) { range <<= 8; ShiftLow(); }
+			}
+		} rc(out);
+		LZMA* probs = new LZMA;
+		for (LZMA::Prob *pp = (LZMA::Prob*)&probs->p, *ppEnd = (LZMA::Prob*)(&probs->p + 1); pp != ppEnd; pp++) *pp = LZMA::BIT_MODEL_TOTAL >> 1;
+		for (Bit32u pos = 0, state = 0; pos != len; pos++)
+		{
+			rc.Bit(probs->p.is_match[(state << LZMA::PB) + (pos & ((1 << LZMA::PB) - 1))], 0);
+			LZMA::Prob* lit = &probs->p.literal[0x300 * ((pos ? src[pos - 1] : 0) >> (8 - LZMA::LC))];
+			for (Bit32u symbol = 1, i = 8; i--;) { Bit32u bit = (src[pos] >> i) & 1; rc.Bit(lit[symbol], bit); symbol = (symbol << 1) | bit; }
+			state = (state < 4 ? 0 : (state < 10 ? state - 3 : state - 6));
+		}
+		for (int i = 0; i != 5; i++) rc.ShiftLow();
+		delete probs;
+	}
+
+	static void EncodeFlatHuffman(const Bit8u* src, Bit32u len, std::vector<Bit8u>& out)
+	{
+		// Small tree with only code 9 (length 8 for all 256 codes of the main tree) followed by raw bytes
+		BitWriter bw;
+		bw.Write(0, 3); bw.Write(7, 3); bw.Write(0, 3); bw.Write(1, 3); bw.Write(7, 3); // code lengths start at 8, code 8 unused, code 9 with one bit, end
+		for (int i = 0; i != 256; i++) bw.Write(0, 1);
+		for (Bit32u i = 0; i != len; i++) bw.Write(src[i], 8);
+		out = bw.Flush();
+	}
+
+	static void EncodeFLAC(const Bit8u* src, Bit32u sample_frames, bool big_endian, std::vector<Bit8u>& out)
+	{
+		// Alternate between verbatim independent frames and fixed order 2 left/side frames
+		BitWriter bw;
+		std::vector<Bit32s> ch[2];
+		for (Bit32u done = 0, frame = 0; done != sample_frames; frame++)
+		{
+			Bit32u block_size = (sample_frames - done > 1000 ? 1000 : sample_frames - done), assign = (frame & 1 ? 8 : 1);
+			ch[0].resize(block_size); ch[1].resize(block_size);
+			for (Bit32u i = 0; i != block_size; i++)
+				for (int c = 0; c != 2; c++)
+				{
+					const Bit8u* s = src + (done + i) * 4 + c * 2;
+					ch[c][i] = (Bit16s)(big_endian ? ((s[0] << 8) | s[1]) : ((s[1] << 8) | s[0]));
+				}
+			if (assign == 8) for (Bit32u i = 0; i != block_size; i++) ch[1][i] = ch[0][i] - ch[1][i];
+			bw.Write(0x7FFC, 15); bw.Write(0, 1); bw.Write(7, 4); bw.Write(0, 4); bw.Write(assign, 4); bw.Write(4, 3); bw.Write(0, 1);
+			bw.Write(frame & 0x7F, 8); bw.Write(block_size - 1, 16); bw.Write(0, 8);
+			for (int c = 0; c != 2; c++)
+			{
+				int bps = 16 + (assign == 8 && c == 1 ? 1 : 0);
+				if (assign != 8) { bw.Write(1 << 1, 8); for (Bit32u i = 0; i != block_size; i++) bw.Write((Bit32u)ch[c][i], bps); continue; }
+				bw.Write((8 + 2) << 1, 8);
+				for (Bit32u i = 0; i != 2; i++) bw.Write((Bit32u)ch[c][i], bps);
+				bw.Write(0, 2); bw.Write(0, 4); bw.Write(12, 4); // rice method 0, partition order 0, parameter 12
+				for (Bit32u i = 2; i != block_size; i++)
+				{
+					Bit32s r = ch[c][i] - (2 * ch[c][i-1] - ch[c][i-2]);
+					Bit32u u = (r < 0 ? (((Bit32u)~r) << 1) | 1 : ((Bit32u)r << 1));
+					bw.WriteUnary(u >> 12); bw.Write(u & 0xFFF, 12);
+				}
+			}
+			bw.Flush();
+			bw.Write(0, 16);
+			done += block_size;
+		}
+		out = bw.Flush();
+	}
+
+	static void EncodeCD(Bit32u codec, const Bit8u* hunk, Bit32u hunkbytes, std::vector<Bit8u>& out)
+	{
+		const Bit32u frames = hunkbytes / CD_FRAME_SIZE, ecc_bytes = (frames + 7) / 8;
+		std::vector<Bit8u> sectors(frames * CD_MAX_SECTOR_DATA), subcode(frames * CD_MAX_SUBCODE_DATA), base, sub;
+		out.assign(ecc_bytes, 0);
+		for (Bit32u i = 0; i != frames; i++)
+		{
+			Bit8u* s = &sectors[i * CD_MAX_SECTOR_DATA];
+			memcpy(s, hunk + i * CD_FRAME_SIZE, CD_MAX_SECTOR_DATA);
+			memcpy(&subcode[i * CD_MAX_SUBCODE_DATA], hunk + i * CD_FRAME_SIZE + CD_MAX_SECTOR_DATA, CD_MAX_SUBCODE_DATA);
+			if (codec != CODEC_CDFL && s[0] == 0 && s[1] == 0xff && s[11] == 0)
+			{
+				out[i / 8] |= (Bit8u)(1 << (i % 8));
+				memset(s, 0, 12);
+				memset(s + 12 + 2064, 0, 172 + 104);
+			}
+		}
+		EncodeStoredDeflate(&subcode[0], (Bit32u)subcode.size(), sub);
+		if (codec == CODEC_CDFL) { EncodeFLAC(&sectors[0], (Bit32u)sectors.size() / 4, true, out); out.insert(out.end(), sub.begin(), sub.end()); return; }
+		if (codec == CODEC_CDLZ) EncodeLiteralLZMA(&sectors[0], (Bit32u)sectors.size(), base);
+		else EncodeStoredDeflate(&sectors[0], (Bit32u)sectors.size(), base);
+		out.push_back((Bit8u)(base.size() >> 8)); out.push_back((Bit8u)base.size());
+		out.insert(out.end(), base.begin(), base.end());
+		out.insert(out.end(), sub.begin(), sub.end());
+	}
+
+	static Bit32u SelfTestVectors(Codecs& codec_state)
+	{
+		// Fixed streams from real compressors to cover what the minimal encoders above never emit.
+		// The LZMA stream is from liblzma (lc=3, lp=0, pb=2, preset 9e) and uses matches, reps, short reps and long distances
+		// (unlike chdman it ends with an end marker, which is never reached because decoding stops at the hunk size).
+		// The huff stream follows huffman_encoder::export_tree_huffman of MAME and uses short and long RLE runs of code lengths.
+		// Both encode the text-like data generated below.
+		enum { LEN = 2048, CRC = 0x4c79 };
+		static const char* words[16] = { "TRACK", "INDEX", "MODE1/2352", "AUDIO", "PREGAP", "FILE", "BINARY", "CATALOG", " ", "\r\n", "00:02:00", "REM", "TITLE", "FLAGS DCP", "ISRC", "0" };
+		Bit8u src[LEN], dec[LEN];
+		for (Bit32u len = 0, seed = 4321; len < LEN;)
+		{
+			seed = seed * 1103515245 + 12345;
+			Bit32u r = ((seed >> 16) & 0x7FFF), k = (r & 7);
+			if (k < 5) for (const char* w = words[(r >> 3) & 15]; *w && len < LEN; w++) src[len++] = (Bit8u)*w;
+			else if (k == 5) for (Bit32u n = 3 + ((r >> 8) & 7); n-- && len < LEN;) src[len++] = (Bit8u)(0x40 + ((r >> 3) & 0x1F));
+			else if (k == 6) src[len++] = (Bit8u)(0x20 + ((r >> 3) & 0x3F));
+			else if (len > 300) for (Bit32u d = 150 + ((r >> 3) % (len - 150)), n = 8 + ((r >> 5) & 31); n-- && len < LEN; len++) src[len] = src[len - d];
+		}
+		if (CRC16(src, LEN) != CRC) { LOG_MSG("[CHD] Self test vector source: FAILED"); return 1; }
+
+		static const Bit8u lzma_stream[550] =
+		{
+				0x00,0x21,0x12,0x45,0xfd,0x59,0x1f,0xc1,0xff,0xc1,0xef,0xee,0x28,0xc6,0x56,0x8e,0x2a,0x6b,0x27,0x2b,0xbe,0x7d,0x81,0xbe,0x19,0x48,0x12,0x8c,0x44,0x49,0x89,0x4a,
+				0x19,0xdf,0x16,0xad,0x15,0x46,0x20,0x4e,0x3e,0x4c,0x95,0x77,0x99,0x34,0x34,0x18,0xd7,0xb9,0x06,0x55,0x2f,0x95,0x72,0x51,0x18,0xb5,0x18,0xbf,0xc8,0x9b,0x57,0x32,
+				0xf2,0x2a,0x2d,0x31,0x32,0x2c,0x30,0x97,0x5e,0xe3,0x83,0xa6,0xde,0x0e,0xc0,0x18,0x7e,0x5b,0x6a,0x2b,0x3c,0x32,0xb5,0xd1,0x98,0x1b,0xd5,0xf1,0x90,0xa7,0x52,0xe4,
+				0x95,0x17,0x9f,0x5b,0x32,0xbf,0x7e,0x9c,0xe2,0xca,0xf9,0x0b,0xb7,0xbd,0x4a,0x14,0x68,0x18,0x29,0x4a,0x46,0x05,0x29,0x1f,0x99,0x55,0x51,0x8b,0x9a,0xa1,0xd0,0x63,
+				0xa9,0x49,0xe8,0xa6,0xbb,0xb8,0x7d,0xee,0xb9,0x80,0x78,0xc5,0xe8,0x41,0x20,0x85,0x3e,0xa2,0x2f,0xfe,0xa1,0x9f,0x74,0xbd,0x35,0xdf,0x11,0xd9,0xd3,0x69,0x9b,0x58,
+				0x05,0x5d,0xdb,0x98,0x50,0xd5,0xe7,0x17,0x54,0x5b,0x8c,0xcf,0x3f,0x36,0xe1,0xd9,0x5f,0xc0,0x4f,0x98,0x90,0x01,0x8c,0x56,0x28,0xe5,0x3e,0xa6,0x2c,0x8f,0x2e,0x3f,
+				0xf4,0x51,0xe8,0x92,0x36,0x4e,0x72,0x67,0x16,0x58,0x82,0x27,0xfd,0xd6,0x20,0xfe,0x96,0xac,0x04,0x9d,0xcf,0x59,0x4d,0x05,0x05,0xd5,0xfd,0xb9,0x2d,0x6b,0xe5,0x5b,
+				0x1e,0xaf,0x72,0x2e,0x03,0x19,0xa6,0xe1,0x5d,0xf6,0x6e,0xbb,0x68,0x4f,0x09,0xdb,0xa4,0x2b,0x38,0x66,0x63,0x88,0x4f,0x74,0xb1,0xa7,0x4a,0x41,0x25,0x33,0x9a,0x9e,
+				0x61,0x35,0xda,0xc5,0xa2,0x90,0x2b,0xc4,0x45,0x57,0xf0,0x27,0x04,0xcd,0xe8,0xef,0xe6,0x9e,0x8f,0x4b,0x59,0xf0,0xd3,0xbe,0x23,0x41,0x6e,0x91,0x59,0xb7,0xfd,0x50,
+				0x06,0xd1,0x44,0xbf,0x7b,0xf8,0xad,0x5f,0xa7,0x02,0x9a,0x92,0xcf,0x9e,0x60,0x76,0x26,0x8f,0xc9,0x89,0x60,0x4f,0xf1,0x6c,0x17,0x98,0x5b,0xee,0x88,0x9e,0xf7,0x92,
+				0xbc,0x98,0x8b,0xcd,0xd9,0x40,0x1a,0xbf,0x77,0xc9,0xb0,0xc0,0xfb,0x1b,0xd0,0x72,0x41,0xba,0x1c,0x8e,0x4d,0x47,0x3f,0x39,0x52,0x34,0xd0,0x7e,0xc5,0x1c,0xdb,0x09,
+				0x6c,0xc1,0x91,0xaf,0x8a,0x5d,0x0e,0xc3,0xdf,0xf3,0xa6,0xe6,0x60,0x1d,0x1b,0xb3,0xc4,0x18,0xb6,0x81,0xad,0x6d,0x59,0x4b,0x7d,0x22,0x1d,0xad,0x17,0xd5,0xcf,0x9e,
+				0x3a,0xf9,0x92,0x5a,0x67,0x99,0x4d,0x4c,0xc8,0x75,0xdc,0x22,0x9f,0x79,0xdc,0xde,0xe7,0x7d,0xed,0xf4,0x80,0x76,0x60,0x2d,0x5d,0xd5,0x46,0xa8,0xcd,0x44,0x80,0x58,
+				0xea,0xa7,0xe1,0x1d,0xac,0xd6,0x47,0xcd,0xb4,0xba,0xa7,0x64,0x6b,0x37,0x76,0x33,0x92,0xab,0x16,0x60,0xc2,0x36,0x0a,0xf3,0x25,0x1e,0xa9,0xcc,0xc7,0x63,0x8a,0xde,
+				0x07,0x8f,0x6d,0x74,0xf0,0xd2,0x28,0xc9,0x17,0x80,0x23,0x07,0x9d,0x07,0xfe,0x18,0x11,0x82,0xcb,0xec,0xd9,0x25,0x65,0xc6,0xbc,0x41,0xe9,0xd3,0x32,0xd6,0xa9,0x08,
+				0xe0,0xae,0xaa,0x8a,0x9d,0xb3,0x13,0xe1,0xb6,0xcf,0xaa,0x9d,0x42,0xf1,0xa1,0x27,0x17,0x04,0x19,0x05,0xf3,0xfb,0x9e,0x46,0xf8,0x81,0x04,0xdc,0x4c,0x73,0xc1,0xde,
+				0xc7,0xca,0x9f,0x7a,0x69,0x09,0xa2,0x14,0x05,0x59,0x2a,0xd8,0xe3,0xad,0x4b,0x0f,0xe6,0x42,0xa3,0xc1,0x95,0x91,0xa7,0x97,0x52,0x16,0x74,0xed,0x90,0x32,0x4d,0x87,
+				0x4e,0x9b,0xfd,0x67,0x01,0x1e,
+		};
+		static const Bit8u huff_stream[1282] =
+		{
+				0x81,0x01,0x63,0x8e,0xc8,0xf8,0xf0,0x19,0xf3,0x1e,0x11,0x2e,0x97,0x13,0x6e,0xbf,0x0a,0x39,0xcf,0x45,0x34,0xef,0x72,0x6c,0x80,0xde,0x49,0x09,0x89,0x09,0x1b,0x3c,
+				0x32,0x1a,0x2e,0x73,0x1f,0x2c,0x7b,0x64,0xe8,0xc4,0xe4,0xa8,0x80,0xb4,0x87,0x44,0x0f,0x06,0x1e,0x22,0xd9,0x5c,0x58,0x04,0x44,0xbe,0x71,0xaa,0x5b,0x6b,0x87,0x0c,
+				0x61,0x02,0x4c,0xb6,0xd7,0x0e,0x18,0xc2,0x04,0x98,0xf6,0xc9,0xd1,0x8e,0xde,0xa9,0x71,0x24,0x92,0x4c,0xd9,0x1a,0x89,0x26,0xad,0xa4,0x10,0x41,0x04,0x3e,0xdf,0x9d,
+				0x37,0x9e,0x0b,0x2c,0xb2,0xcb,0x2f,0x33,0x33,0x33,0x01,0x51,0x2f,0x9c,0x6a,0x82,0x03,0xb2,0x35,0x00,0x4d,0xeb,0x76,0xf5,0x4b,0x8e,0x73,0x9d,0x37,0x9e,0xc8,0xd4,
+				0x3f,0x65,0x02,0xa1,0xf6,0xfc,0xee,0xde,0xa9,0x74,0x93,0x56,0xd0,0x80,0xca,0x28,0xa2,0x8a,0x28,0xa2,0x8a,0xde,0xb5,0xb6,0xb8,0x70,0xc6,0x10,0x24,0xcc,0x63,0x18,
+				0xc6,0x31,0x8c,0xb2,0x35,0x00,0x9e,0xc8,0xd4,0x3e,0xdf,0x9c,0xe7,0x39,0xce,0x73,0x9e,0x49,0xab,0x6b,0x9c,0xe9,0x26,0xad,0xb8,0x9b,0xce,0x9b,0xce,0xfb,0x7e,0x7f,
+				0xff,0xff,0xff,0xd1,0x2f,0x9c,0x6a,0xa2,0x07,0x83,0x0f,0x11,0x10,0x3c,0x18,0x78,0x87,0x6f,0x54,0xba,0xd9,0x5c,0x58,0x77,0xdb,0xf3,0xc4,0x0f,0x06,0x1e,0x22,0x20,
+				0x78,0x30,0xf1,0x01,0x4f,0x6c,0x9d,0x19,0x24,0xd5,0xb6,0x1f,0xb2,0x81,0x58,0xd5,0x04,0x07,0x64,0x6a,0x00,0x9b,0xd6,0xed,0xea,0x97,0x1c,0xe7,0x08,0x0d,0x39,0x2a,
+				0x20,0x2d,0x21,0xd6,0xca,0xe2,0xf7,0xad,0x6b,0x5a,0xd6,0xb5,0xad,0x70,0xfb,0x7e,0x77,0x6f,0x54,0xba,0x49,0xab,0x68,0x40,0x65,0x14,0x51,0x45,0x14,0x51,0x45,0x6a,
+				0xdb,0x5c,0x38,0x63,0x08,0x12,0x60,0x80,0xec,0x8d,0x42,0xdb,0x5c,0x38,0x63,0x08,0x12,0x67,0xdb,0xf3,0xf7,0x39,0xce,0x87,0x6f,0x54,0xb9,0x12,0xf9,0xc6,0xa9,0x37,
+				0x9d,0xdb,0xd5,0x2e,0x0b,0x98,0x0a,0x89,0x7c,0xe3,0x54,0x10,0x1d,0x91,0xa8,0x02,0x6f,0x5b,0xb7,0xaa,0x5c,0x73,0x9c,0xe9,0xb9,0x26,0xad,0xaf,0x7b,0xde,0x89,0x7c,
+				0xe3,0x55,0x6c,0xae,0x2f,0xaa,0x5c,0x73,0x9c,0xe9,0xbc,0xf6,0x46,0xa1,0xfb,0x28,0x15,0x0f,0x4e,0x4a,0x88,0x0b,0x48,0x72,0xdb,0x5c,0x38,0x63,0x08,0x12,0x6e,0x73,
+				0x9c,0xe7,0x39,0xcf,0x24,0xd5,0xb5,0xce,0x74,0x93,0x56,0xdc,0x4d,0xe7,0x1e,0x22,0x20,0x78,0x30,0xf1,0x01,0x4f,0x6c,0x9d,0x19,0x24,0xd5,0xb6,0x1f,0xa1,0x01,0xf8,
+				0x81,0xe0,0xc3,0xc4,0x44,0x0f,0x06,0x1e,0x20,0x29,0xed,0x93,0xa3,0x24,0x9a,0xb4,0xde,0x75,0xad,0xb5,0xc3,0x86,0x30,0x81,0x26,0x63,0x18,0xc6,0x31,0x8c,0x65,0xc9,
+				0x35,0x6d,0x44,0xbe,0x71,0xaa,0x4d,0xe7,0x84,0xde,0x75,0xb6,0xb8,0x70,0xc6,0x10,0x24,0xce,0xde,0xa9,0x73,0xed,0xf9,0xf7,0xae,0x49,0xab,0x6b,0xf3,0x9c,0xe7,0x39,
+				0xce,0x73,0xc9,0x35,0x6d,0x73,0x9d,0x24,0xd5,0xb7,0x13,0x79,0xd3,0x79,0xdf,0x6f,0xc2,0x08,0x21,0xf6,0xfc,0xe9,0xbc,0xf0,0x59,0x65,0x96,0x59,0x7d,0x12,0xf9,0xc6,
+				0xaa,0x20,0x78,0x30,0xf1,0x11,0x03,0xc1,0x87,0x88,0x76,0xf5,0x4b,0xad,0x94,0xfc,0xee,0xde,0xa9,0x74,0x93,0x56,0xd0,0x8f,0xd9,0x40,0xa9,0x26,0xad,0xa7,0xb6,0x4e,
+				0x8c,0xe1,0xc3,0x18,0x40,0x93,0x73,0x9c,0xe7,0x39,0xce,0x79,0x26,0xad,0xae,0x73,0x80,0x6f,0xd9,0x40,0xad,0xeb,0x4d,0xe7,0x00,0xc0,0x47,0x6f,0x54,0xba,0x13,0x92,
+				0xa2,0x02,0xd2,0x1d,0x33,0x33,0x33,0x2d,0x6b,0x5a,0xd6,0x81,0x80,0xc0,0x60,0x35,0x91,0xa8,0x73,0x9c,0xe5,0xb6,0xb8,0x70,0xc6,0x10,0x24,0xc7,0x39,0xce,0x79,0x26,
+				0xad,0xae,0x73,0xa4,0x9a,0xb6,0xe2,0x6f,0x3a,0x6f,0x3b,0xed,0xf9,0xff,0xff,0xc4,0x0f,0x06,0x1e,0x20,0x68,0xd1,0xa3,0x46,0x8d,0x1a,0x35,0xfb,0x28,0x15,0xbd,0x6f,
+				0xce,0xed,0xea,0x97,0x49,0x35,0x6d,0x08,0x0c,0xa2,0x8a,0x28,0xa2,0x8a,0x28,0xad,0xeb,0x5b,0x6b,0x87,0x0c,0x61,0x02,0x4c,0x05,0x88,0x1e,0x0c,0x3c,0x43,0xf6,0x50,
+				0x2b,0x7a,0xd6,0xda,0xe1,0xc3,0x18,0x40,0x93,0x3f,0x65,0x02,0x80,0xa9,0xc9,0x51,0x01,0x69,0x0e,0x5b,0x6b,0x87,0x0c,0x61,0x02,0x4d,0x24,0xd5,0xb5,0x40,0x57,0xdb,
+				0xf3,0xc9,0x35,0x6d,0x73,0x9c,0x03,0x7e,0xca,0x05,0x6f,0x5a,0x6f,0x38,0x06,0x02,0x3b,0x7a,0xa5,0xc8,0x97,0xce,0x35,0x5b,0xd6,0xfd,0x94,0x0a,0x92,0x6a,0xda,0x10,
+				0x19,0x45,0x14,0x51,0x45,0x14,0x51,0x47,0xb6,0x4e,0x8c,0x8c,0x4d,0xe7,0xb6,0x57,0x17,0x6c,0xae,0x2f,0x77,0x77,0x77,0x76,0xc8,0xd4,0x55,0x53,0xb7,0xaa,0x5d,0x64,
+				0x6a,0x00,0xe0,0x70,0x3b,0xb7,0xaa,0x5d,0xbd,0x6f,0xb7,0xe7,0x5b,0x6b,0x87,0x0c,0x61,0x02,0x4d,0x09,0xc9,0x51,0x01,0x69,0x0e,0x99,0x99,0x99,0x96,0xb5,0xad,0x6d,
+				0xb2,0xb8,0xb6,0xb9,0xce,0x92,0x6a,0xdb,0x89,0xbc,0xe9,0xbc,0xef,0xb7,0xe7,0xff,0xff,0x0e,0xde,0xa9,0x72,0xdb,0x5c,0x38,0x63,0x08,0x12,0x60,0xba,0xc6,0x31,0x8c,
+				0x63,0x2d,0x95,0xc5,0xa5,0x37,0x9e,0xc8,0xd4,0x55,0x55,0x55,0x55,0x55,0x25,0x29,0x4a,0x52,0x94,0xa5,0x25,0xd9,0x1a,0x82,0xcb,0x2c,0xb2,0xcb,0x80,0x80,0xc0,0x54,
+				0xe4,0xa8,0x80,0xb4,0x87,0x2b,0x02,0x03,0x88,0x1e,0x0c,0x3c,0x43,0xf3,0xc4,0x0f,0x06,0x1e,0x22,0x20,0x78,0x30,0xf1,0x01,0x4f,0x6c,0x9d,0x19,0x24,0xd5,0xb6,0x1f,
+				0xb2,0x81,0x58,0xdb,0xb0,0x1d,0x91,0xa8,0x7e,0x7f,0xff,0xff,0xf4,0x4b,0xe7,0x1a,0xa8,0x81,0xe0,0xc3,0xc4,0x2d,0xb5,0xc3,0x86,0x30,0x81,0x26,0x28,0xa2,0x8a,0x28,
+				0xa2,0x8a,0x28,0xa7,0x6f,0x54,0xb9,0x97,0x24,0xd5,0xb5,0x12,0xf9,0xc6,0xa9,0x37,0x9e,0x13,0x79,0xd6,0xda,0x4e,0x4a,0x88,0x0b,0x48,0x76,0xee,0xee,0xee,0xee,0xee,
+				0xf5,0xd0,0x05,0xde,0xb5,0xb6,0xb8,0x70,0xc6,0x10,0x24,0xcc,0x63,0x18,0xc6,0x3b,0x7a,0xa5,0xc0,0x0f,0xaa,0x5c,0x73,0x9c,0x20,0x34,0xe4,0xa8,0x80,0xb4,0x83,0xdb,
+				0x27,0x46,0x26,0xf3,0xad,0x6d,0xae,0x1c,0x31,0x84,0x09,0x33,0x18,0xc6,0x31,0x8c,0x60,0x53,0xdb,0x27,0x46,0x0c,0x18,0x30,0x65,0x2d,0x6b,0x5a,0xd6,0xb5,0xd9,0x1a,
+				0x84,0x4b,0xe7,0x1a,0xa5,0xad,0x6b,0x5a,0xd6,0x9b,0xcf,0x6c,0xae,0x2f,0x7a,0xa5,0xc7,0x39,0xce,0x9b,0xcf,0x64,0x6a,0x1f,0xb2,0x81,0x51,0x6c,0xae,0x2e,0xc8,0xd4,
+				0x3e,0xdf,0x9f,0x7a,0xd3,0x79,0xc2,0x03,0x87,0xec,0xa0,0x56,0x35,0x41,0x01,0xd9,0x1a,0x80,0x26,0xf5,0xbb,0x7a,0xa5,0xc7,0x39,0xc2,0x22,0x5f,0x38,0xd5,0x25,0x29,
+				0x4a,0x53,0x6c,0xae,0x2f,0x7a,0xc0,0x10,0x00,0x7d,0xbf,0x3c,0x93,0x56,0xd4,0xe4,0xa8,0x80,0xb4,0x87,0x2d,0xb5,0xc3,0x86,0x30,0x81,0x26,0xb6,0x57,0x17,0x16,0x46,
+				0xa0,0x00,0xad,0xb5,0xc3,0x86,0x30,0x81,0x26,0x2c,0xb2,0xcb,0x2c,0xb2,0xcb,0x2e,0x16,0xb5,0xad,0x6b,0x5a,0xd6,0xbf,0xff,0xff,0xff,0xbd,0x67,0xb6,0x4e,0x8c,0x99,
+				0x99,0x99,0x97,0x6f,0x54,0xbb,0x7a,0xe4,0x9a,0xb6,0x82,0x82,0x82,0x82,0x82,0x82,0x82,0x82,0x82,0x82,0x8c,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0xf1,0x03,0xc1,0x87,
+				0x88,0x1a,0x34,0x68,0xd1,0xa3,0x46,0x8d,0x7e,0xcc,0xad,0xb5,0xc3,0x86,0x30,0x81,0x26,0x92,0x6a,0xda,0xed,0xea,0x97,0x7f,0xff,0xff,0xa2,0x5f,0x38,0xd5,0x44,0x0f,
+				0x06,0x1e,0x21,0x6d,0xae,0x9c,0x95,0x10,0x16,0x90,0xe3,0x22,0x5f,0x38,0xd5,0x17,0xd1,0x2f,0x9c,0x6a,0x82,0x8f,0x10,0xed,0xea,0x97,0x5b,0x2b,0x8b,0x0e,0xfb,0x3d,
+				0xb2,0x74,0x60,0x59,0x26,0xad,0xa2,0xaf,0x3d,0x91,0xa8,0x7e,0xca,0x05,0x43,0xd3,0x92,0xa2,0x02,0xd2,0x1c,0xb6,0xd7,0x0e,0x18,0xc2,0x04,0xbf,0x65,0x02,0x9f,0x6f,
+				0xcf,0x0e,
+		};
+
+		Bit32u errors = 0;
+		if (!codec_state.Decompress(CODEC_LZMA, lzma_stream, (Bit32u)sizeof(lzma_stream), dec, LEN) || memcmp(dec, src, LEN)) { LOG_MSG("[CHD] Self test of lzma vector: FAILED"); errors++; }
+		if (!codec_state.Decompress(CODEC_HUFF, huff_stream, (Bit32u)sizeof(huff_stream), dec, LEN) || memcmp(dec, src, LEN)) { LOG_MSG("[CHD] Self test of huff vector: FAILED"); errors++; }
+		return errors;
+	}
+
+	static void SelfTest()
+	{
+		enum { FRAMES = 8, HUNKBYTES = FRAMES * CD_FRAME_SIZE, HUNKS = 13 };
+		static const Bit32u codecs[4] = { CODEC_CDLZ, CODEC_CDZL, CODEC_CDFL, CODEC_HUFF };
+		Bit8u *hunks = (Bit8u*)malloc(HUNKS * HUNKBYTES), *dec = (Bit8u*)malloc(HUNKBYTES);
+		Bit32u seed = 1234, errors = 0;
+		for (Bit32u h = 0; h != HUNKS; h++)
+			for (Bit32u f = 0; f != FRAMES; f++)
+			{
+				Bit8u* s = hunks + h * HUNKBYTES + f * CD_FRAME_SIZE;
+				if (h & 1)
+				{
+					// Mode 1 data sector with sync header and valid parity
+					for (Bit32u i = 0; i != CD_FRAME_SIZE; i++) { seed = seed * 1103515245 + 12345; s[i] = (Bit8u)((seed >> 16) & (h & 2 ? 0xFF : 0x0F)); }
+					memset(s, 0xFF, 12); s[0] = s[11] = 0; s[15] = 1;
+					memset(s + 2064, 0, 12);
+					ECCGenerate(s);
+				}
+				else
+				{
+					// Audio sector with two sine waves
+					for (Bit32u i = 0; i != CD_MAX_SECTOR_DATA / 4; i++)
+					{
+						double t = (f * (CD_MAX_SECTOR_DATA / 4) + i) / 44100.0;
+						Bit16s l = (Bit16s)(sin(t * 440 * 6.2831853) * 12000), r = (Bit16s)(sin(t * 1234 * 6.2831853) * 9000 + h * 100);
+						s[i*4+0] = (Bit8u)(l >> 8); s[i*4+1] = (Bit8u)l; s[i*4+2] = (Bit8u)(r >> 8); s[i*4+3] = (Bit8u)r;
+					}
+					for (Bit32u i = 0; i != CD_MAX_SUBCODE_DATA; i++) s[CD_MAX_SECTOR_DATA + i] = (Bit8u)(h + f + i);
+				}
+			}
+
+		// Hunk types: codec per hunk (audio hunks use cdfl or huff), one uncompressed, one self reference, then RLE repeated self references
+		Bit8u types[HUNKS]; Bit32u selfref[HUNKS];
+		std::vector<Bit8u> file, comp;
+		std::vector<MapEntry> expect(HUNKS);
+		Codecs codec_state;
+		for (Bit32u h = 0; h != HUNKS; h++)
+		{
+			MapEntry& e = expect[h];
+			Bit8u* src = hunks + h * HUNKBYTES;
+			if (h >= 8) { memcpy(src, hunks + 3 * HUNKBYTES, HUNKBYTES); types[h] = (h == 8 ? COMPRESSION_SELF : COMPRESSION_SELF_0); selfref[h] = 3; e.type = COMPRESSION_SELF; e.offset = 3; e.length = 0; e.crc = 0; continue; }
+			types[h] = (h == 6 ? (Bit8u)COMPRESSION_NONE : (Bit8u)(h & 1 ? (h & 2 ? 0 : 1) : (h == 4 ? 3 : 2)));
+			if (types[h] == COMPRESSION_NONE) comp.assign(src, src + HUNKBYTES);
+			else if (codecs[types[h]] == CODEC_HUFF) EncodeFlatHuffman(src, HUNKBYTES, comp);
+			else EncodeCD(codecs[types[h]], src, HUNKBYTES, comp);
+			e.type = types[h]; e.offset = 1000 + file.size(); e.length = (Bit32u)comp.size(); e.crc = CRC16(src, HUNKBYTES);
+			file.insert(file.end(), comp.begin(), comp.end());
+		}
+
+		BitWriter bw;
+		for (int i = 0; i != 16; i++) bw.Write(4, 4); // all 16 type codes with 4 bits
+		for (Bit32u h = 0; h != HUNKS; h++)
+		{
+			if (h == 10) { bw.Write(COMPRESSION_RLE_SMALL, 4); bw.Write(HUNKS - 10 - 2 - 1, 4); break; } // repeat the type of hunk 9 for the remaining 3 hunks
+			bw.Write(types[h], 4);
+		}
+		for (Bit32u h = 0; h != 9; h++)
+		{
+			if (types[h] <= COMPRESSION_TYPE_3) bw.Write(expect[h].length, 24);
+			if (types[h] <= COMPRESSION_NONE) bw.Write(expect[h].crc, 16);
+			if (types[h] == COMPRESSION_SELF) bw.Write(selfref[h], 8);
+		}
+		std::vector<Bit8u> rawmap(HUNKS * MAP_ENTRY_SIZE);
+		for (Bit32u h = 0; h != HUNKS; h++)
+		{
+			Bit8u* raw = &rawmap[h * MAP_ENTRY_SIZE];
+			raw[0] = expect[h].type;
+			for (int i = 0; i != 3; i++) raw[1 + i] = (Bit8u)(expect[h].length >> (16 - i * 8));
+			for (int i = 0; i != 6; i++) raw[4 + i] = (Bit8u)(expect[h].offset >> (40 - i * 8));
+			raw[10] = (Bit8u)(expect[h].crc >> 8); raw[11] = (Bit8u)expect[h].crc;
+		}
+		Bit16u mapcrc = CRC16(&rawmap[0], HUNKS * MAP_ENTRY_SIZE);
+		Bit8u maphdr[MAP_HEADER_SIZE] = { 0, 0, 0, 0, 0, 0, 0, 0, 0x03, 0xE8, (Bit8u)(mapcrc >> 8), (Bit8u)mapcrc, 24, 8, 0, 0 };
+		std::vector<Bit8u>& mapdata = bw.Flush();
+
+		MapEntry map[HUNKS];
+		if (!DecodeMap(maphdr, &mapdata[0], (Bit32u)mapdata.size(), HUNKS, HUNKBYTES, CD_FRAME_SIZE, map)) { LOG_MSG("[CHD] Self test of map decoding: FAILED"); errors++; }
+		else for (Bit32u h = 0; h != HUNKS; h++)
+		{
+			const MapEntry &e = map[h], &x = expect[h];
+			if (e.type != x.type || e.offset != x.offset || e.length != x.length || e.crc != x.crc) { LOG_MSG("[CHD] Self test of map entry %u: FAILED", h); errors++; continue; }
+			const MapEntry& d = (e.type == COMPRESSION_SELF ? map[e.offset] : e);
+			bool ok;
+			if (d.type == COMPRESSION_NONE) ok = !memcmp(&file[(size_t)(d.offset - 1000)], hunks + h * HUNKBYTES, HUNKBYTES);
+			else ok = (codec_state.Decompress(codecs[d.type], &file[(size_t)(d.offset - 1000)], d.length, dec, HUNKBYTES) && CRC16(dec, HUNKBYTES) == d.crc && !memcmp(dec, hunks + h * HUNKBYTES, HUNKBYTES));
+			if (!ok) { LOG_MSG("[CHD] Self test of hunk %u (type %d): FAILED", h, (int)d.type); errors++; }
+		}
+
+		// Plain FLAC with little endian samples
+		std::vector<Bit8u> flac(1, 'L');
+		for (Bit32u i = 0; i != HUNKBYTES; i += 2) { Bit8u t = hunks[i]; hunks[i] = hunks[i + 1]; hunks[i + 1] = t; }
+		EncodeFLAC(hunks, HUNKBYTES / 4, false, comp);
+		flac.insert(flac.end(), comp.begin(), comp.end());
+		if (!codec_state.Decompress(CODEC_FLAC, &flac[0], (Bit32u)flac.size(), dec, HUNKBYTES) || memcmp(dec, hunks, HUNKBYTES)) { LOG_MSG("[CHD] Self test of flac: FAILED"); errors++; }
+
+		errors += SelfTestVectors(codec_state);
+		LOG_MSG("[CHD] Self test: %s", (errors ? "FAILED" : "OK"));
+		DBP_ASSERT(!errors);
+		free(hunks);
+		free(dec);
+	}
+	#endif
+};
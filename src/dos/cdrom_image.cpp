@@ -43,6 +43,9 @@ using namespace std;
 #define MAX_LINE_LENGTH 512
 #define MAX_FILENAME_LENGTH 256
 
+#include "cdrom_resampler.inl"
+Bit8u dbp_cdaudio_resampler = CDAudioResampler::QUALITY_MEDIUM;
+
 #ifdef C_DBP_SUPPORT_CDROM_MOUNT_DOSFILE
 CDROM_Interface_Image::TrackFile::TrackFile(const char *filename, bool &error, const char *relative_to) : dos_file(NULL), dos_ofs(0), dos_end(0)
 {
@@ -66,19 +69,8 @@ bool CDROM_Interface_Image::TrackFile::read(Bit8u *buffer, int seek, int count)
 	int wanted_count = count;
 	if ((Bit32u)seek >= dos_end) count = 0;
 	else if (dos_end - (Bit32u)seek < (Bit32u)count) count = (int)(dos_end - (Bit32u)seek);
-	if ((Bit32u)seek != dos_ofs)
-	{
-		dos_ofs = (Bit32u)seek;
-		dos_file->Seek(&dos_ofs, DOS_SEEK_SET);
-	}
-	for (Bit32u remain = (Bit32u)count; remain;)
-	{
-		Bit16u sz = (remain > 0xFFFF ? 0xFFFF : (Bit16u)remain);
-		if (!dos_file->Read(buffer, &sz) || !sz) { count -= (int)remain; break; }
-		remain -= sz;
-		buffer += sz;
-	}
-	dos_ofs += (Bit32u)count;
+	if (count) count = (int)dos_file->ReadBulk(buffer, (Bit32u)count, (Bit32u)seek);
+	dos_ofs = (Bit32u)seek + (Bit32u)count;
 	return (wanted_count == count);
 }
 
@@ -119,7 +111,7 @@ int CDROM_Interface_Image::BinaryFile::getLength()
 
 #include "stb_vorbis.inl"
 
-CDROM_Interface_Image::AudioFile::AudioFile(const char *filename, bool &error, const char *relative_to) : TrackFile(filename, error, relative_to), last_seek(0), vorb(NULL)
+CDROM_Interface_Image::AudioFile::AudioFile(const char *filename, bool &error, const char *relative_to) : TrackFile(filename, error, relative_to), last_seek(0), vorb(NULL), src_rate(44100), src_channels(2), resample_next((Bit32u)-1), resample_src(0), resampler(NULL)
 {
 	if (error) return;
 
@@ -144,6 +136,8 @@ CDROM_Interface_Image::AudioFile::AudioFile(const char *filename, bool &error, c
 				|| chnk.nBlockAlign != chnk.nChannels * 2 //implementation error
 				) { LOG_MSG("ERROR: CD audio WAV file '%s' is not a valid PCM file", filename); error = true; return; }
 			haveFmt = true;
+			src_rate = chnk.nSamplesPerSec;
+			src_channels = chnk.nChannels;
 			audio_factor = (chnk.nSamplesPerSec * chnk.nChannels) / 88200.0f;
 			if (chnk.nChannels != 2 || chnk.nSamplesPerSec != 44100) { LOG_MSG("WARNING: CD audio WAV file '%s' has %d channels and a rate of %d hz (playback quality might suffer if it's not 2 channels and a rate of 44100 hz)", filename, (int)chnk.nChannels, (int)chnk.nSamplesPerSec); }
 		}
@@ -173,12 +167,14 @@ CDROM_Interface_Image::AudioFile::AudioFile(const char *filename, bool &error, c
 		if (!vorb) { LOG_MSG("ERROR: CD audio OGG file '%s' is invalid", filename); error = true; return; }
 		stb_vorbis_info p = stb_vorbis_get_info(vorb);
 		if (p.sample_rate != 44100) { LOG_MSG("WARNING: CD audio OGG file '%s' has a rate of %d hz (playback quality might suffer if it's not a rate of 44100 hz)", filename, (int)p.sample_rate); }
+		src_rate = p.sample_rate;
 		audio_factor = p.sample_rate / 44100.0f;
 		audio_length = stb_vorbis_stream_length_in_samples(vorb) * 4;
 	}
 	else { LOG_MSG("ERROR: CD audio file '%s' uses unsupported audio compression", filename); error = true; return; }
 
 	if (audio_factor != 1.0) buffer_temp.resize((size_t)(16 + RAW_SECTOR_SIZE * audio_factor)); // alloc temp buffer for resampling
+	if (src_rate != 44100) resampler = new CDAudioResampler();
 	audio_length = (Bit32u)(audio_length / audio_factor / (double)(RAW_SECTOR_SIZE) + .4999) * (Bit32u)(RAW_SECTOR_SIZE); // fix and round to RAW_SECTOR_SIZE
 	error = false;
 }
@@ -187,11 +183,64 @@ CDROM_Interface_Image::AudioFile::~AudioFile()
 {
 	if (vorb)
 		stb_vorbis_close(vorb);
+	delete resampler;
+}
+
+bool CDROM_Interface_Image::AudioFile::readResampled(Bit8u *buffer, int seek)
+{
+	enum { FRAMES = RAW_SECTOR_SIZE / 4, CHUNK = 1024 };
+	CDAudioResampler& rs = *resampler;
+	Bit32u out_frame = (Bit32u)seek / 4;
+	bool seek_failed = false;
+	last_seek = 0x7FFFFFFF; // make the non-resampling path seek if it gets used next
+	if (rs.quality != dbp_cdaudio_resampler || out_frame != resample_next)
+	{
+		if (rs.quality != dbp_cdaudio_resampler) rs.Setup(src_rate, 44100, dbp_cdaudio_resampler);
+		rs.Reset();
+
+		// Start reading early enough for the center of the filter to line up with the requested position
+		Bit32u src_pos = (Bit32u)((Bit64u)out_frame * src_rate / 44100), delay = (Bit32u)rs.Delay();
+		resample_src = (src_pos > delay ? src_pos - delay : 0);
+		rs.PushSilence(delay - (src_pos - resample_src));
+		seek_failed = (vorb && !stb_vorbis_seek(vorb, resample_src));
+	}
+	resample_next = (seek_failed ? (Bit32u)-1 : out_frame + FRAMES);
+
+	Bit16s chunk[CHUNK * 2];
+	for (Bitu need; (need = rs.Needed(FRAMES)) != 0;)
+	{
+		Bitu n = (need < CHUNK ? need : CHUNK), got = 0;
+		if (seek_failed) {}
+		else if (vorb) got = (Bitu)stb_vorbis_get_samples_short_interleaved(vorb, 2, chunk, (int)n * 2);
+		else
+		{
+			Bit32u frame_size = src_channels * 2, ofs = wave_start + resample_src * frame_size;
+			got = (ofs < dos_end ? (dos_end - ofs) / frame_size : 0);
+			if (got > n) got = n;
+			if (got) TrackFile::read((Bit8u*)chunk, (int)ofs, (int)(got * frame_size));
+		}
+		#if defined(WORDS_BIGENDIAN)
+		if (got) rs.Push(chunk, got, (vorb ? 2 : (int)src_channels), !vorb);
+		#else
+		if (got) rs.Push(chunk, got, (vorb ? 2 : (int)src_channels));
+		#endif
+		if (got < n) rs.PushSilence(n - got);
+		resample_src += (Bit32u)n;
+	}
+
+	Bit16s* out = (Bit16s*)buffer;
+	rs.Pull(out, FRAMES);
+	#if defined(WORDS_BIGENDIAN)
+	for (Bit16s* p = out, *pEnd = out + FRAMES * 2; p != pEnd; p++) *p = (Bit16s)host_readw((HostPt)p); // sector data is little endian
+	#endif
+	return true;
 }
 
 bool CDROM_Interface_Image::AudioFile::read(Bit8u *buffer, int seek, int count)
 {
 	DBP_ASSERT(count == RAW_SECTOR_SIZE);
+	if (resampler && dbp_cdaudio_resampler != CDAudioResampler::QUALITY_LINEAR) return readResampled(buffer, seek);
+	resample_next = (Bit32u)-1;
 	int count_org = count;
 	Bit8u* buffer_org = buffer;
 	seek = (int)(seek / sizeof(short) * audio_factor) * sizeof(short);
@@ -220,7 +269,7 @@ bool CDROM_Interface_Image::AudioFile::read(Bit8u *buffer, int seek, int count)
 
 	if (count != count_org)
 	{
-		// extremely low quality resampling (better than nothing, output warning in constructor if this gets used)
+		// extremely low quality resampling (only used when the CD audio resampler is set to linear or for mono files at 44100 hz)
 		short *pOut = (short*)buffer_org, *pIn = (short*)buffer;
 		for (int i = 0, iEnd = count_org/sizeof(short); i != iEnd; i++)
 			pOut[i] = pIn[(int)(i * audio_factor)];
@@ -299,6 +348,23 @@ CDROM_Interface_Image::imagePlayer CDROM_Interface_Image::player = {
 #endif
 	{0}, 0, 0, 0, false, false, false, { {0,0,0,0},{0,0,0,0} } };
 
+//DBP: Unless set to linear, CD audio gets converted to the mixer rate with CDAudioResampler instead of the mixer's interpolation
+static CDAudioResampler cdaudio_resampler;
+static bool cdaudio_restart;
+static Bit16s cdaudio_out[MIXER_BUFSIZE / 4 * 2];
+
+static void CDAudio_UpdateResampler(MixerChannel* channel)
+{
+	extern Bit32u DBP_MIXER_GetFrequency();
+	Bit32u mixer_freq = DBP_MIXER_GetFrequency();
+	Bit8u quality = (mixer_freq != 44100 ? dbp_cdaudio_resampler : (Bit8u)CDAudioResampler::QUALITY_LINEAR);
+	if (quality != CDAudioResampler::QUALITY_LINEAR && (quality != cdaudio_resampler.quality || mixer_freq != cdaudio_resampler.out_rate))
+		cdaudio_resampler.Setup(44100, mixer_freq, quality);
+	cdaudio_resampler.quality = quality;
+	channel->SetFreq(quality == CDAudioResampler::QUALITY_LINEAR ? 44100 : mixer_freq);
+	cdaudio_restart = true;
+}
+
 	
 CDROM_Interface_Image::CDROM_Interface_Image(Bit8u subUnit)
                       :subUnit(subUnit)
@@ -310,6 +376,7 @@ CDROM_Interface_Image::CDROM_Interface_Image(Bit8u subUnit)
 #endif
 		if (!player.channel) {
 			player.channel = MIXER_AddChannel(&CDAudioCallBack, 44100, "CDAUDIO");
+			CDAudio_UpdateResampler(player.channel);
 		}
 		player.channel->Enable(true);
 	}
@@ -408,6 +475,7 @@ bool CDROM_Interface_Image::PlayAudioSector(unsigned long start,unsigned long le
 	player.cd = this;
 	player.bufLen = 0;
 	player.currFrame = start;
+	CDAudio_UpdateResampler(player.channel);
 	player.targetFrame = start + len;
 	int track = GetTrack(start) - 1;
 	if(track >= 0 && tracks[track].attr == 0x40) {
@@ -654,6 +722,41 @@ void CDROM_Interface_Image::CDAudioCallBack(Bitu len)
 #ifdef C_DBP_USE_SDL
 	SDL_mutexP(player.mutex);
 #endif
+	if (cdaudio_resampler.quality != CDAudioResampler::QUALITY_LINEAR) {
+		Bitu frames = len / 4;
+		DBP_ASSERT(frames <= MIXER_BUFSIZE / 4);
+		if (cdaudio_restart) {
+			cdaudio_resampler.Reset();
+			cdaudio_resampler.PushSilence(cdaudio_resampler.Delay());
+			cdaudio_restart = false;
+		}
+		for (Bit16s sector[RAW_SECTOR_SIZE / 2]; cdaudio_resampler.Needed(frames);) {
+			if (player.targetFrame > player.currFrame && player.cd->ReadSector((Bit8u*)sector, true, player.currFrame))
+				player.currFrame++;
+			else {
+				memset(sector, 0, sizeof(sector));
+				player.isPlaying = false;
+			}
+#if defined(WORDS_BIGENDIAN)
+			cdaudio_resampler.Push(sector, RAW_SECTOR_SIZE / 4, 2, true);
+#else
+			cdaudio_resampler.Push(sector, RAW_SECTOR_SIZE / 4, 2);
+#endif
+		}
+		cdaudio_resampler.Pull(cdaudio_out, frames);
+		if (player.ctrlUsed) {
+			for (Bitu pos=0;pos<frames;pos++) {
+				Bit16s sample0=cdaudio_out[pos*2+player.ctrlData.out[0]], sample1=cdaudio_out[pos*2+player.ctrlData.out[1]];
+				cdaudio_out[pos*2+0]=(Bit16s)(sample0*player.ctrlData.vol[0]/255.0);
+				cdaudio_out[pos*2+1]=(Bit16s)(sample1*player.ctrlData.vol[1]/255.0);
+			}
+		}
+		player.channel->AddSamples_s16(frames,cdaudio_out);
+#ifdef C_DBP_USE_SDL
+		SDL_mutexV(player.mutex);
+#endif
+		return;
+	}
 	while (player.bufLen < (Bits)len) {
 		bool success;
 		if (player.targetFrame > player.currFrame)
@@ -1130,6 +1233,9 @@ void CDROM_Interface_Image::ClearTracks()
 }
 
 #ifdef C_DBP_SUPPORT_CDROM_CHD_IMAGE
+#include "cdrom_chd.inl"
+#include "dbp_threads.h"
+
 bool CDROM_Interface_Image::LoadChdFile(char* filename)
 {
 	//DBP: Call ClearTracks here which actually clears the tracks correctly (the call to LoadCueSheet can actually leave tracks that need clearing after an error)
@@ -1138,29 +1244,187 @@ bool CDROM_Interface_Image::LoadChdFile(char* filename)
 	enum { CHD_V5_HEADER_SIZE = 124, CHD_V5_UNCOMPMAPENTRYBYTES = 4, CD_MAX_SECTOR_DATA = 2352, CD_MAX_SUBCODE_DATA = 96, CD_FRAME_SIZE = CD_MAX_SECTOR_DATA + CD_MAX_SUBCODE_DATA };
 	enum { METADATA_HEADER_SIZE = 16, CDROM_TRACK_METADATA_TAG = 1128813650, CDROM_TRACK_METADATA2_TAG = 1128813618, CD_TRACK_PADDING = 4 };
 
+	// Compressed hunks are decompressed into a small LRU cache. While CD audio is playing, a worker thread decompresses the following hunks ahead of time.
+	// The worker never touches the file itself, the compressed data it needs is read in advance by the main thread.
 	struct ChdFile : public BinaryFile
 	{
-		ChdFile(const char *filename, bool &error) : BinaryFile(filename, error), hunkmap(NULL), cooked_sector_shift(0) { }
-		virtual ~ChdFile() { free(hunkmap); }
-		Bit32u *hunkmap;
-		int hunkbytes, cooked_sector_shift, audio_start;
+		enum { CACHE_HUNKS = 16, READ_AHEAD = 4 };
+		enum { SLOT_FREE, SLOT_PENDING, SLOT_READY };
+		struct Slot { Bit32u hunk, last_use; Bit8u state; Bit8u* data; };
 
-		static Bit32u get_bigendian_uint32(const Bit8u *base) { return (base[0] << 24) | (base[1] << 16) | (base[2] << 8) | base[3]; }
-		static Bit64u get_bigendian_uint64(const Bit8u *base) { return ((Bit64u)base[0] << 56) | ((Bit64u)base[1] << 48) | ((Bit64u)base[2] << 40) | ((Bit64u)base[3] << 32) | ((Bit64u)base[4] << 24) | ((Bit64u)base[5] << 16) | ((Bit64u)base[6] << 8) | (Bit64u)base[7]; }
+		ChdFile(const char *filename, bool &error) : BinaryFile(filename, error), hunkmap(NULL), use_counter(0), last_hunk((Bit32u)-1), cooked_sector_shift(0), job(false), waiting(false), read_ahead(0xFF), codecs_job(NULL) { memset(slots, 0, sizeof(slots)); }
+		virtual ~ChdFile()
+		{
+			mtx.Lock();
+			while (job) WaitJob();
+			mtx.Unlock();
+			for (Slot *s = slots, *sEnd = s + CACHE_HUNKS; s != sEnd; s++) free(s->data);
+			delete codecs_job;
+			free(hunkmap);
+		}
+		chdcodec::MapEntry *hunkmap;
+		Bit32u compressors[4], hunkcount, use_counter, last_hunk, job_count, job_hunks[READ_AHEAD], job_slots[READ_AHEAD], job_comp_ofs[READ_AHEAD];
+		int hunkbytes, cooked_sector_shift, audio_start;
+		bool job, waiting;
+		Bit8u read_ahead;
+		Slot slots[CACHE_HUNKS];
+		chdcodec::Codecs codecs_main, *codecs_job;
+		std::vector<Bit8u> comp, job_comp;
+		Mutex mtx;
+		Semaphore done;
 
 		virtual bool read(Bit8u *buffer, int seek, int count)
 		{
 			DBP_ASSERT((seek / CD_FRAME_SIZE) == ((seek + count) / CD_FRAME_SIZE)); // read only inside one sector
-			const int hunk = (seek / hunkbytes), hunk_ofs = (seek % hunkbytes), hunk_pos = (int)hunkmap[hunk];
-			if (!hunk_pos) { memset(buffer, 0, count); return true; }
-			if (!BinaryFile::read(buffer, hunk_pos + hunk_ofs + (count == COOKED_SECTOR_SIZE ? cooked_sector_shift : 0), count)) return false;
+			const Bit32u hunk = (Bit32u)(seek / hunkbytes);
+			const int hunk_ofs = (seek % hunkbytes) + (count == COOKED_SECTOR_SIZE ? cooked_sector_shift : 0);
+			if (hunk >= hunkcount) return false;
+			const chdcodec::MapEntry& e = hunkmap[hunk];
+			const Bit32u src = (e.type == chdcodec::COMPRESSION_SELF ? (Bit32u)e.offset : hunk); // self references point to non-self hunks after loading
+			if (hunkmap[src].type == chdcodec::COMPRESSION_NONE)
+			{
+				if (!hunkmap[src].offset) memset(buffer, 0, count);
+				else if (!BinaryFile::read(buffer, (int)hunkmap[src].offset + hunk_ofs, count)) return false;
+			}
+			else
+			{
+				const Bit8u* data = GetHunk(src);
+				if (!data) return false;
+				memcpy(buffer, data + hunk_ofs, count);
+			}
 			if (seek >= audio_start) // CHD audio endian swap
+			{
 				for (Bit8u *p = buffer + (seek & 1), *pEnd = buffer + count, tmp; p < pEnd; p += 2)
 					{ tmp = p[0]; p[0] = p[1]; p[1] = tmp; }
+				ReadAhead(hunk);
+			}
 			return true;
 		}
+
+		bool Decompress(chdcodec::Codecs& codecs, const Bit8u* src, Bit32u hunk, Bit8u* dst)
+		{
+			const chdcodec::MapEntry& e = hunkmap[hunk];
+			return (codecs.Decompress(compressors[e.type], src, e.length, dst, (Bit32u)hunkbytes) && chdcodec::CRC16(dst, (Bit32u)hunkbytes) == e.crc);
+		}
+
+		Slot* Find(Bit32u hunk)
+		{
+			for (Slot *s = slots, *sEnd = s + CACHE_HUNKS; s != sEnd; s++)
+				if (s->state != SLOT_FREE && s->hunk == hunk)
+					return s;
+			return NULL;
+		}
+
+		Slot* Alloc(Bit32u hunk)
+		{
+			Slot* res = NULL;
+			for (Slot *s = slots, *sEnd = s + CACHE_HUNKS; s != sEnd; s++)
+			{
+				if (s->state == SLOT_FREE) { res = s; break; }
+				if (s->state == SLOT_READY && (!res || (Bit32s)(s->last_use - res->last_use) < 0)) res = s;
+			}
+			DBP_ASSERT(res);
+			if (!res->data) res->data = (Bit8u*)malloc(hunkbytes);
+			res->hunk = hunk;
+			res->state = SLOT_PENDING;
+			res->last_use = use_counter;
+			return res;
+		}
+
+		const Bit8u* GetHunk(Bit32u hunk)
+		{
+			mtx.Lock();
+			Slot* s;
+			while ((s = Find(hunk)) != NULL && s->state == SLOT_PENDING) WaitJob(); // the read ahead thread is working on this hunk
+			if (s) { s->last_use = ++use_counter; mtx.Unlock(); return s->data; }
+			s = Alloc(hunk);
+			mtx.Unlock();
+
+			const chdcodec::MapEntry& e = hunkmap[hunk];
+			if (comp.size() < e.length) comp.resize(e.length);
+			bool ok = (BinaryFile::read(&comp[0], (int)e.offset, (int)e.length) && Decompress(codecs_main, &comp[0], hunk, s->data));
+			mtx.Lock();
+			s->state = (ok ? SLOT_READY : SLOT_FREE);
+			s->last_use = ++use_counter;
+			mtx.Unlock();
+			return (ok ? s->data : NULL);
+		}
+
+		void ReadAhead(Bit32u hunk)
+		{
+			// Start decompressing ahead when audio is read sequentially and one of the next two hunks isn't available yet
+			bool sequential = (hunk - last_hunk <= 1);
+			last_hunk = hunk;
+			if (read_ahead == 0xFF)
+			{
+				extern unsigned dbp_cpu_features_get_core_amount(void);
+				read_ahead = (dbp_cpu_features_get_core_amount() > 1);
+			}
+			if (!sequential || !read_ahead) return;
+
+			mtx.Lock();
+			if (job) { mtx.Unlock(); return; }
+			Bit32u comp_len = 0;
+			job_count = 0;
+			for (Bit32u h = hunk + 1; h <= hunk + READ_AHEAD && h < hunkcount; h++)
+			{
+				const Bit32u src = (hunkmap[h].type == chdcodec::COMPRESSION_SELF ? (Bit32u)hunkmap[h].offset : h);
+				if (hunkmap[src].type > chdcodec::COMPRESSION_TYPE_3 || Find(src)) continue;
+				if (!job_count && h > hunk + 2) break;
+				bool dup = false;
+				for (Bit32u i = 0; i != job_count; i++) dup |= (job_hunks[i] == src);
+				if (dup) continue;
+				job_hunks[job_count] = src;
+				job_slots[job_count] = (Bit32u)(Alloc(src) - slots);
+				job_comp_ofs[job_count++] = comp_len;
+				comp_len += hunkmap[src].length;
+			}
+			if (!job_count) { mtx.Unlock(); return; }
+			job = true;
+			mtx.Unlock();
+
+			job_comp.resize(comp_len);
+			for (Bit32u i = 0; i != job_count; i++)
+			{
+				if (BinaryFile::read(&job_comp[job_comp_ofs[i]], (int)hunkmap[job_hunks[i]].offset, (int)hunkmap[job_hunks[i]].length)) continue;
+				mtx.Lock();
+				for (i = 0; i != job_count; i++) slots[job_slots[i]].state = SLOT_FREE;
+				job = false;
+				mtx.Unlock();
+				return;
+			}
+			if (!codecs_job) codecs_job = new chdcodec::Codecs;
+			Thread::StartDetached(JobThread, this);
+		}
+
+		inline void WaitJob() { waiting = true; mtx.Unlock(); done.Wait(); mtx.Lock(); }
+
+		static Thread::RET_t THREAD_CC JobThread(void* p)
+		{
+			ChdFile& c = *(ChdFile*)p;
+			bool ok[READ_AHEAD];
+			for (Bit32u i = 0; i != c.job_count; i++)
+				ok[i] = c.Decompress(*c.codecs_job, &c.job_comp[c.job_comp_ofs[i]], c.job_hunks[i], c.slots[c.job_slots[i]].data);
+
+			c.mtx.Lock();
+			for (Bit32u i = 0; i != c.job_count; i++)
+			{
+				Slot& s = c.slots[c.job_slots[i]];
+				s.state = (ok[i] ? SLOT_READY : SLOT_FREE);
+				s.last_use = c.use_counter;
+			}
+			c.job = false;
+			if (c.waiting) { c.waiting = false; c.done.Post(); }
+			c.mtx.Unlock();
+			return 0;
+		}
 	};
 
+	#ifdef DBP_CHD_SELF_TEST
+	static bool self_tested;
+	if (!self_tested) { self_tested = true; chdcodec::SelfTest(); }
+	#endif
+
 	bool not_chd;
 	ChdFile* chd = new ChdFile(filename, not_chd);
 	if (not_chd)
@@ -1168,7 +1432,7 @@ bool CDROM_Interface_Image::LoadChdFile(char* filename)
 		err:
 		tracks.clear();
 		delete chd;
-		if (!not_chd) GFX_ShowMsg("Invalid or unsupported CHD file, must be an uncompressed version 5 CD image");
+		if (!not_chd) GFX_ShowMsg("Invalid or unsupported CHD file, must be a version 5 CD image");
 		return false;
 	}
 
@@ -1176,23 +1440,30 @@ bool CDROM_Interface_Image::LoadChdFile(char* filename)
 	Bit8u rawheader[CHD_V5_HEADER_SIZE];
 	if (!chd->BinaryFile::read(rawheader, 0, CHD_V5_HEADER_SIZE) || memcmp(rawheader, "MComprHD", 8)) { not_chd = true; goto err; }
 
-	// Check supported version, flags and compression
-	Bit32u hdr_length = ChdFile::get_bigendian_uint32(&rawheader[8]);
-	Bit32u hdr_version = ChdFile::get_bigendian_uint32(&rawheader[12]);
+	// Check supported version and compression
+	Bit32u hdr_length = chdcodec::get_bigendian_uint32(&rawheader[8]);
+	Bit32u hdr_version = chdcodec::get_bigendian_uint32(&rawheader[12]);
 	if (hdr_version != 5 || hdr_length != CHD_V5_HEADER_SIZE) goto err; // only ver 5 is supported
-	if (ChdFile::get_bigendian_uint32(&rawheader[16])) goto err; // compression is not supported
+	for (int i = 0; i != 4; i++)
+	{
+		chd->compressors[i] = chdcodec::get_bigendian_uint32(&rawheader[16 + i * 4]);
+		if (!chd->compressors[i] || chdcodec::IsSupportedCodec(chd->compressors[i])) continue;
+		LOG_MSG("[CHD] Unsupported compression '%.4s'", (const char*)&rawheader[16 + i * 4]);
+		goto err;
+	}
 
 	// Make sure it's a CD image
 	DBP_STATIC_ASSERT(CD_MAX_SECTOR_DATA == RAW_SECTOR_SIZE);
-	Bit32u unitsize = ChdFile::get_bigendian_uint32(&rawheader[60]);
-	chd->hunkbytes = (int)ChdFile::get_bigendian_uint32(&rawheader[56]);
-	if (unitsize != CD_FRAME_SIZE || (chd->hunkbytes % CD_FRAME_SIZE) || !chd->hunkbytes) goto err; // not CD sector size
+	DBP_STATIC_ASSERT((int)CD_FRAME_SIZE == (int)chdcodec::CD_FRAME_SIZE);
+	Bit32u unitsize = chdcodec::get_bigendian_uint32(&rawheader[60]);
+	chd->hunkbytes = (int)chdcodec::get_bigendian_uint32(&rawheader[56]);
+	if (unitsize != CD_FRAME_SIZE || (chd->hunkbytes % CD_FRAME_SIZE) || !chd->hunkbytes || chd->hunkbytes > 16 * 1024 * 1024) goto err; // not CD sector size
 
 	// Read file offsets for hunk mapping and track meta data
 	Bit64u filelen = (Bit64u)chd->BinaryFile::getLength();
-	Bit64u logicalbytes = ChdFile::get_bigendian_uint64(&rawheader[32]);
-	Bit64u mapoffset = ChdFile::get_bigendian_uint64(&rawheader[40]);
-	Bit64u metaoffset = ChdFile::get_bigendian_uint64(&rawheader[48]);
+	Bit64u logicalbytes = chdcodec::get_bigendian_uint64(&rawheader[32]);
+	Bit64u mapoffset = chdcodec::get_bigendian_uint64(&rawheader[40]);
+	Bit64u metaoffset = chdcodec::get_bigendian_uint64(&rawheader[48]);
 	if (mapoffset < CHD_V5_HEADER_SIZE || mapoffset >= filelen || metaoffset < CHD_V5_HEADER_SIZE || metaoffset >= filelen || !logicalbytes) goto err;
 
 	// Read track meta data
@@ -1202,9 +1473,9 @@ bool CDROM_Interface_Image::LoadChdFile(char* filename)
 		char meta[256], mt_type[32], mt_subtype[32];
 		Bit8u raw_meta_header[METADATA_HEADER_SIZE];
 		if (!chd->BinaryFile::read(raw_meta_header, (int)metaentry_offset, sizeof(raw_meta_header))) goto err;
-		Bit32u metaentry_metatag = ChdFile::get_bigendian_uint32(&raw_meta_header[0]);
-		Bit32u metaentry_length = (ChdFile::get_bigendian_uint32(&raw_meta_header[4]) & 0x00ffffff);
-		metaentry_next = ChdFile::get_bigendian_uint64(&raw_meta_header[8]);
+		Bit32u metaentry_metatag = chdcodec::get_bigendian_uint32(&raw_meta_header[0]);
+		Bit32u metaentry_length = (chdcodec::get_bigendian_uint32(&raw_meta_header[4]) & 0x00ffffff);
+		metaentry_next = chdcodec::get_bigendian_uint64(&raw_meta_header[8]);
 		if (metaentry_metatag != CDROM_TRACK_METADATA_TAG && metaentry_metatag != CDROM_TRACK_METADATA2_TAG) continue;
 		if (!chd->BinaryFile::read((Bit8u*)meta, (int)(metaentry_offset + METADATA_HEADER_SIZE), (int)(metaentry_length > sizeof(meta) ? sizeof(meta) : metaentry_length))) goto err;
 		//printf("%.*s\n", metaentry_length, meta);
@@ -1238,13 +1509,45 @@ bool CDROM_Interface_Image::LoadChdFile(char* filename)
 	empty_track.file = NULL;
 	tracks.push_back(empty_track);
 
-	DBP_STATIC_ASSERT(CHD_V5_UNCOMPMAPENTRYBYTES == sizeof(Bit32u));
-	Bit32u hunkcount = ((logicalbytes + chd->hunkbytes - 1) / chd->hunkbytes), sectorcount = (logicalbytes / CD_FRAME_SIZE);
-	chd->hunkmap = (Bit32u*)malloc(hunkcount * CHD_V5_UNCOMPMAPENTRYBYTES);
-
-	// Read hunk mapping and convert to file offsets
-	if (!chd->BinaryFile::read((Bit8u*)chd->hunkmap, (int)mapoffset, hunkcount * CHD_V5_UNCOMPMAPENTRYBYTES)) goto err;
-	for (Bit32u i = 0; i != hunkcount; i++) chd->hunkmap[i] = ChdFile::get_bigendian_uint32((Bit8u*)&chd->hunkmap[i]) * chd->hunkbytes;
+	Bit32u hunkcount = (Bit32u)((logicalbytes + chd->hunkbytes - 1) / chd->hunkbytes);
+	chd->hunkcount = hunkcount;
+	chd->hunkmap = (chdcodec::MapEntry*)malloc(hunkcount * sizeof(chdcodec::MapEntry));
+	if (!chd->compressors[0])
+	{
+		// Read uncompressed hunk mapping and convert to file offsets
+		std::vector<Bit8u> rawmap(hunkcount * CHD_V5_UNCOMPMAPENTRYBYTES);
+		if (!chd->BinaryFile::read(&rawmap[0], (int)mapoffset, hunkcount * CHD_V5_UNCOMPMAPENTRYBYTES)) goto err;
+		for (Bit32u i = 0; i != hunkcount; i++)
+		{
+			chdcodec::MapEntry& e = chd->hunkmap[i];
+			e.type = chdcodec::COMPRESSION_NONE;
+			e.offset = (Bit64u)chdcodec::get_bigendian_uint32(&rawmap[i * CHD_V5_UNCOMPMAPENTRYBYTES]) * chd->hunkbytes;
+		}
+	}
+	else
+	{
+		// Read and decode compressed hunk mapping
+		Bit8u maphdr[chdcodec::MAP_HEADER_SIZE];
+		if (!chd->BinaryFile::read(maphdr, (int)mapoffset, chdcodec::MAP_HEADER_SIZE)) goto err;
+		Bit32u mapbytes = chdcodec::get_bigendian_uint32(maphdr);
+		if (mapoffset + chdcodec::MAP_HEADER_SIZE + mapbytes > filelen) goto err;
+		std::vector<Bit8u> compmap(mapbytes + 1);
+		if (!chd->BinaryFile::read(&compmap[0], (int)mapoffset + chdcodec::MAP_HEADER_SIZE, (int)mapbytes)) goto err;
+		if (!chdcodec::DecodeMap(maphdr, &compmap[0], mapbytes, hunkcount, (Bit32u)chd->hunkbytes, unitsize, chd->hunkmap)) goto err;
+		for (Bit32u i = 0; i != hunkcount; i++)
+		{
+			chdcodec::MapEntry& e = chd->hunkmap[i];
+			if (e.type <= chdcodec::COMPRESSION_TYPE_3) { if (!chd->compressors[e.type] || !e.length || e.offset < CHD_V5_HEADER_SIZE || e.offset + e.length > filelen) goto err; }
+			else if (e.type == chdcodec::COMPRESSION_NONE) { if (e.offset < CHD_V5_HEADER_SIZE || e.offset + chd->hunkbytes > filelen) goto err; }
+			else if (e.type == chdcodec::COMPRESSION_SELF)
+			{
+				// Only references to earlier hunks are valid, resolve chained references so reading needs only one step
+				if (e.offset >= i) goto err;
+				if (chd->hunkmap[e.offset].type == chdcodec::COMPRESSION_SELF) e.offset = chd->hunkmap[e.offset].offset;
+			}
+			else { LOG_MSG("[CHD] File requires a parent CHD which is not supported"); goto err; }
+		}
+	}
 
 	// Now set physical start offsets for tracks and calculate CHD paddings. In CHD files tracks are padded to a to a 4-sector boundary.
 	// Thus we need to give ChdFile::read a means to figure out the padding that applies to the physical sector number it is reading.
@@ -1267,6 +1570,9 @@ void CDROM_Image_Destroy(Section*) {
 }
 
 void CDROM_Image_Init(Section* section) {
+#ifdef DBP_CDAUDIO_RESAMPLER_SELF_TEST
+	CDAudioResampler::SelfTest();
+#endif
 #if defined(C_SDL_SOUND)
 	Sound_Init();
 	section->AddDestroyFunction(CDROM_Image_Destroy, false);
@@ -1285,6 +1591,35 @@ void DBPSerialize_CDPlayer(DBPArchive& ar_outer)
 		<< CDROM_Interface_Image::player.ctrlUsed;
 	ar.Serialize(CDROM_Interface_Image::player.ctrlData);
 
+	// Keep the resampler history so loading a state (which run-ahead does every frame) continues the filter instead of restarting it with silence
+	CDAudioResampler& rs = cdaudio_resampler;
+	enum { MAX_HISTORY = 2048 };
+	Bit8u quality = rs.quality;
+	Bit32u out_rate = rs.out_rate, pos_frac = rs.pos_frac, history = (rs.in_len > rs.pos_int ? (Bit32u)(rs.in_len - rs.pos_int) : 0);
+	bool restart = (cdaudio_restart || quality == CDAudioResampler::QUALITY_LINEAR || history > MAX_HISTORY);
+	if (restart) history = 0;
+	if (ar.version >= 9)
+	{
+		ar << restart << quality << out_rate << pos_frac << history;
+		if (ar.mode == DBPArchive::MODE_MAXSIZE) history = MAX_HISTORY;
+		if (ar.mode == DBPArchive::MODE_LOAD)
+		{
+			if (history > MAX_HISTORY) { ar.had_error = DBPArchive::ERR_LAYOUT; return; }
+			if (rs.in[0].size() < history + CDAudioResampler::TAPS_ALIGN) { rs.in[0].resize(history + CDAudioResampler::TAPS_ALIGN + 1024); rs.in[1].resize(rs.in[0].size()); }
+			rs.in_len = history;
+			rs.pos_int = 0;
+		}
+		for (int ch = 0; ch != 2; ch++)
+			ar.SerializeBytes((ar.mode == DBPArchive::MODE_MAXSIZE || !history ? NULL : &rs.in[ch][rs.pos_int]), history * sizeof(Bit16s));
+		if (ar.mode == DBPArchive::MODE_LOAD)
+		{
+			// The filter can only continue with the same settings as when the state was saved
+			rs.pos_frac = pos_frac;
+			cdaudio_restart = (restart || quality != rs.quality || out_rate != rs.out_rate || pos_frac >= rs.den);
+		}
+	}
+	else if (ar.mode == DBPArchive::MODE_LOAD) cdaudio_restart = true;
+
 	if (ar.mode == DBPArchive::MODE_LOAD && CDROM_Interface_Image::player.isPlaying && !CDROM_Interface_Image::player.cd)
 	{
 		CDROM_Interface_Image* img = NULL;
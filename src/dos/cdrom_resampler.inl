@@ -0,0 +1,320 @@
+/*
+ *  Copyright (C) 2025 Bernhard Schelling
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+//DBP: Polyphase windowed-sinc resampler for 16-bit stereo CD audio
+//   Each output frame is the dot product of one of the precomputed Kaiser windowed sinc filter phases with the input frames
+//   around its position. If the rate ratio reduces to a fraction with a denominator up to MAX_PHASES, every phase is exact,
+//   otherwise the results of the two neighboring phases of MAX_PHASES get linearly interpolated. Input frames are stored in planar form so the inner loop is a
+//   plain 16-bit dot product for which SSE2 or NEON gets used when available (with identical results to the generic loop).
+//#define DBP_CDAUDIO_RESAMPLER_SELF_TEST
+
+#if !defined(__SSE2__) && (_M_IX86_FP == 2 || (defined(_M_AMD64) || defined(_M_X64)))
+#define __SSE2__ 1
+#endif
+#if defined(__SSE2__) && __SSE2__
+#include <emmintrin.h>
+#define DBP_CDAUDIO_RESAMPLER_SIMD
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define DBP_CDAUDIO_RESAMPLER_SIMD
+#endif
+#include <math.h>
+
+struct CDAudioResampler
+{
+	enum Quality : Bit8u { QUALITY_LINEAR, QUALITY_LOW, QUALITY_MEDIUM, QUALITY_HIGH };
+	enum : Bit32u { MAX_PHASES = 512, COEF_SHIFT = 15, TAPS_ALIGN = 8 };
+
+	Bit8u quality = QUALITY_LINEAR;
+	Bit32u in_rate = 0, out_rate = 0, taps = 0, phases = 0, den = 1, step_int = 0, step_frac = 0;
+	Bit32u pos_int = 0, pos_frac = 0; // position of the first tap of the next output frame in the input buffer
+	Bitu in_len = 0;
+	std::vector<Bit16s> coefs, in[2];
+	#ifdef DBP_CDAUDIO_RESAMPLER_SELF_TEST
+	bool simd_off = false;
+	#endif
+
+	static double BesselI0(double x)
+	{
+		double sum = 1.0, term = 1.0, q = x * x * .25;
+		for (int k = 1; term > sum * 1e-12; k++) { term *= q / ((double)k * k); sum += term; }
+		return sum;
+	}
+
+	void Setup(Bit32u from_rate, Bit32u to_rate, Bit8u new_quality)
+	{
+		DBP_ASSERT(from_rate && to_rate && new_quality != QUALITY_LINEAR);
+		static const struct { Bit32u taps; double beta, cutoff; } presets[] = { { 16, 5.0, .80 }, { 48, 8.5, .90 }, { 96, 10.0, .94 } };
+		const Bit32u q = (new_quality > QUALITY_HIGH ? QUALITY_HIGH : new_quality) - 1;
+		quality = new_quality;
+		in_rate = from_rate;
+		out_rate = to_rate;
+		taps = presets[q].taps;
+
+		Bit32u a = from_rate, b = to_rate;
+		while (b) { Bit32u t = a % b; a = b; b = t; }
+		den = to_rate / a;
+		step_int = (from_rate / a) / den;
+		step_frac = (from_rate / a) % den;
+		phases = (den <= MAX_PHASES ? den : MAX_PHASES);
+		const Bit32u sets = (den <= MAX_PHASES ? phases : phases + 1); // extra phase at the end to interpolate towards
+
+		// Cutoff relative to the input rate, below the output Nyquist frequency when reducing the rate
+		const double fc = (from_rate > to_rate ? (double)to_rate / from_rate : 1.0) * presets[q].cutoff, beta = presets[q].beta;
+		const double half = taps / 2, inv_i0_beta = 1.0 / BesselI0(beta), pi = 3.14159265358979323846;
+		std::vector<double> h(taps);
+		coefs.resize(sets * taps);
+		for (Bit32u p = 0; p != sets; p++)
+		{
+			double sum = 0;
+			for (Bit32u k = 0; k != taps; k++)
+			{
+				const double x = (double)k - (half - 1) - (double)p / phases, r = x / half;
+				const double sinc = (x == 0 ? 1.0 : sin(pi * fc * x) / (pi * fc * x));
+				const double window = (r <= -1.0 || r >= 1.0 ? 0.0 : BesselI0(beta * sqrt(1.0 - r * r)) * inv_i0_beta);
+				sum += (h[k] = sinc * window);
+			}
+
+			// Normalize to unity gain and make sure the quantized taps add up exactly to it
+			Bit16s* c = &coefs[p * taps];
+			Bit32s total = 0; Bit32u peak = 0;
+			for (Bit32u k = 0; k != taps; k++)
+			{
+				double v = floor(h[k] / sum * (1 << COEF_SHIFT) + .5);
+				c[k] = (Bit16s)(v > 32767 ? 32767 : (v < -32767 ? -32767 : v));
+				total += c[k];
+				if (c[k] > c[peak]) peak = k;
+			}
+			c[peak] = (Bit16s)(c[peak] + ((1 << COEF_SHIFT) - total));
+		}
+		Reset();
+	}
+
+	void Reset()
+	{
+		in_len = 0;
+		pos_int = pos_frac = 0;
+	}
+
+	// Number of input frames between the first tap and the center of the filter
+	INLINE Bitu Delay() const { return taps / 2 - 1; }
+
+	// Number of input frames still missing to be able to output the requested number of frames
+	Bitu Needed(Bitu out_frames) const
+	{
+		if (!out_frames) return 0;
+		Bit64u last = (Bit64u)pos_int * den + pos_frac + (Bit64u)(out_frames - 1) * ((Bit64u)step_int * den + step_frac);
+		Bitu need = (Bitu)(last / den) + taps;
+		return (need > in_len ? need - in_len : 0);
+	}
+
+	void Push(const Bit16s* src, Bitu frames, int channels, bool swap = false)
+	{
+		if (pos_int)
+		{
+			// Discard input frames that are no longer needed
+			Bitu drop = (pos_int < in_len ? pos_int : in_len);
+			for (int ch = 0; ch != 2; ch++)
+				if (in_len > drop) memmove(&in[ch][0], &in[ch][drop], (in_len - drop) * sizeof(Bit16s));
+			in_len -= drop;
+			pos_int -= (Bit32u)drop;
+		}
+		if (in[0].size() < in_len + frames + TAPS_ALIGN) { in[0].resize(in_len + frames + TAPS_ALIGN + 1024); in[1].resize(in[0].size()); }
+		Bit16s *l = &in[0][in_len], *r = &in[1][in_len];
+		in_len += frames;
+		if (!src) { memset(l, 0, frames * sizeof(Bit16s)); memset(r, 0, frames * sizeof(Bit16s)); return; }
+		for (const Bit16s* end = src + frames * channels; src != end; src += channels)
+		{
+			Bit16u sl = (Bit16u)src[0], sr = (Bit16u)src[channels - 1];
+			if (swap) { sl = (Bit16u)((sl >> 8) | (sl << 8)); sr = (Bit16u)((sr >> 8) | (sr << 8)); }
+			*(l++) = (Bit16s)sl;
+			*(r++) = (Bit16s)sr;
+		}
+	}
+
+	INLINE void PushSilence(Bitu frames) { Push(NULL, frames, 2); }
+
+	static INLINE void Dot(const Bit16s* c, const Bit16s* l, const Bit16s* r, Bitu n, Bit32s& out_l, Bit32s& out_r)
+	{
+		Bit32s sl = 0, sr = 0;
+		for (Bitu i = 0; i != n; i++) { sl += c[i] * l[i]; sr += c[i] * r[i]; }
+		out_l = sl; out_r = sr;
+	}
+
+	#ifdef DBP_CDAUDIO_RESAMPLER_SIMD
+	static INLINE void DotSIMD(const Bit16s* c, const Bit16s* l, const Bit16s* r, Bitu n, Bit32s& out_l, Bit32s& out_r)
+	{
+		#if defined(__SSE2__) && __SSE2__
+		__m128i al = _mm_setzero_si128(), ar = _mm_setzero_si128();
+		for (Bitu i = 0; i != n; i += 8)
+		{
+			__m128i vc = _mm_loadu_si128((const __m128i*)(c + i));
+			al = _mm_add_epi32(al, _mm_madd_epi16(vc, _mm_loadu_si128((const __m128i*)(l + i))));
+			ar = _mm_add_epi32(ar, _mm_madd_epi16(vc, _mm_loadu_si128((const __m128i*)(r + i))));
+		}
+		__m128i lr = _mm_add_epi32(_mm_unpacklo_epi32(al, ar), _mm_unpackhi_epi32(al, ar)); // [l0+l2, r0+r2, l1+l3, r1+r3]
+		lr = _mm_add_epi32(lr, _mm_srli_si128(lr, 8));
+		out_l = _mm_cvtsi128_si32(lr);
+		out_r = _mm_cvtsi128_si32(_mm_srli_si128(lr, 4));
+		#else
+		int32x4_t al = vdupq_n_s32(0), ar = vdupq_n_s32(0);
+		for (Bitu i = 0; i != n; i += 8)
+		{
+			int16x8_t vc = vld1q_s16(c + i), vl = vld1q_s16(l + i), vr = vld1q_s16(r + i);
+			al = vmlal_s16(vmlal_s16(al, vget_low_s16(vc), vget_low_s16(vl)), vget_high_s16(vc), vget_high_s16(vl));
+			ar = vmlal_s16(vmlal_s16(ar, vget_low_s16(vc), vget_low_s16(vr)), vget_high_s16(vc), vget_high_s16(vr));
+		}
+		int32x2_t lr = vpadd_s32(vadd_s32(vget_low_s32(al), vget_high_s32(al)), vadd_s32(vget_low_s32(ar), vget_high_s32(ar)));
+		out_l = vget_lane_s32(lr, 0);
+		out_r = vget_lane_s32(lr, 1);
+		#endif
+	}
+	#endif
+
+	INLINE void Filter(const Bit16s* c, Bitu i, Bit32s& l, Bit32s& r) const
+	{
+		#ifdef DBP_CDAUDIO_RESAMPLER_SIMD
+		#ifdef DBP_CDAUDIO_RESAMPLER_SELF_TEST
+		if (simd_off) { Dot(c, &in[0][i], &in[1][i], taps, l, r); return; }
+		#endif
+		DotSIMD(c, &in[0][i], &in[1][i], taps, l, r);
+		#else
+		Dot(c, &in[0][i], &in[1][i], taps, l, r);
+		#endif
+	}
+
+	// Writes up to out_frames interleaved stereo frames and returns how many could be generated with the available input
+	Bitu Pull(Bit16s* out, Bitu out_frames)
+	{
+		Bitu done = 0;
+		for (; done != out_frames; done++, out += 2)
+		{
+			const Bitu i = pos_int;
+			if (i + taps > in_len) break;
+
+			Bit32s l, r;
+			if (den <= MAX_PHASES)
+			{
+				Filter(&coefs[pos_frac * taps], i, l, r);
+				l = (l + (1 << (COEF_SHIFT - 1))) >> COEF_SHIFT;
+				r = (r + (1 << (COEF_SHIFT - 1))) >> COEF_SHIFT;
+			}
+			else
+			{
+				// Blend the results of the two phases around the exact position by a 16-bit fraction
+				const Bit64u fine = ((Bit64u)pos_frac * MAX_PHASES << 16) / den;
+				const Bit32u phase = (Bit32u)(fine >> 16);
+				const Bit64s f = (Bit64s)(fine & 0xFFFF);
+				Bit32s l0, r0, l1, r1;
+				Filter(&coefs[phase * taps], i, l0, r0);
+				Filter(&coefs[(phase + 1) * taps], i, l1, r1);
+				l = (Bit32s)((l0 * (Bit64s)0x10000 + (l1 - (Bit64s)l0) * f + ((Bit64s)1 << (COEF_SHIFT + 15))) >> (COEF_SHIFT + 16));
+				r = (Bit32s)((r0 * (Bit64s)0x10000 + (r1 - (Bit64s)r0) * f + ((Bit64s)1 << (COEF_SHIFT + 15))) >> (COEF_SHIFT + 16));
+			}
+			out[0] = (Bit16s)(l > 32767 ? 32767 : (l < -32768 ? -32768 : l));
+			out[1] = (Bit16s)(r > 32767 ? 32767 : (r < -32768 ? -32768 : r));
+
+			pos_int += step_int;
+			if ((pos_frac += step_frac) >= den) { pos_frac -= den; pos_int++; }
+		}
+		return done;
+	}
+
+	#ifdef DBP_CDAUDIO_RESAMPLER_SELF_TEST
+	// Measures THD+N of resampled sine waves by fitting the expected sine to the output and comparing the residual
+	static void SelfTest()
+	{
+		static const Bit32u rates[][2] = { { 44100, 48000 }, { 44100, 32000 }, { 44100, 22050 }, { 22050, 44100 }, { 11025, 44100 }, { 44100, 49716 } };
+		static const double tones[] = { 1000.0, 5000.0, 9000.0 };
+		enum { IN_FRAMES = 44100 };
+		extern Bit32u DBP_GetTicks();
+		std::vector<Bit16s> src(IN_FRAMES * 2), out, out_ref;
+		CDAudioResampler rs;
+		int failed = 0, mismatches = 0;
+		for (Bit8u q = QUALITY_LOW; q <= QUALITY_HIGH; q++)
+		{
+			static const double required_db[] = { 0, -50, -75, -75 };
+			double worst = -200;
+			for (const Bit32u* rate : rates)
+			{
+				rs.Setup(rate[0], rate[1], q);
+				out.resize((size_t)((Bit64u)IN_FRAMES * rate[1] / rate[0] + 16) * 2);
+				for (double tone : tones)
+				{
+					if (tone > (rate[0] < rate[1] ? rate[0] : rate[1]) * .4) continue;
+					for (Bitu i = 0; i != IN_FRAMES; i++)
+						src[i * 2] = src[i * 2 + 1] = (Bit16s)floor(sin(2 * 3.14159265358979323846 * tone * i / rate[0]) * 16384 + .5);
+
+					Bitu n = 0;
+					for (int simd = 0; simd != 2; simd++)
+					{
+						rs.Reset();
+						rs.simd_off = !simd;
+						rs.PushSilence(rs.Delay());
+						rs.Push(&src[0], IN_FRAMES, 2);
+						n = rs.Pull(&out[0], out.size() / 2);
+						if (!simd) out_ref = out;
+					}
+					rs.simd_off = false;
+					if (memcmp(&out[0], &out_ref[0], n * 4)) mismatches++;
+
+					// Fit a*sin + b*cos + dc to the left channel (skipping the start) and compare the residual to the signal
+					double w = 2 * 3.14159265358979323846 * tone / rate[1], ss = 0, sc = 0, cc = 0, ys = 0, yc = 0, y1 = 0, s1 = 0, c1 = 0, m = 0;
+					Bitu from = rs.taps * 2 + 64, to = n - rs.taps * 2;
+					for (Bitu i = from; i < to; i++)
+					{
+						double s = sin(w * i), c = cos(w * i), y = out[i * 2];
+						ss += s * s; sc += s * c; cc += c * c; ys += y * s; yc += y * c; y1 += y; s1 += s; c1 += c; m++;
+					}
+					// Solve the 3x3 least squares system with Cramer's rule
+					double A[3][3] = { { ss, sc, s1 }, { sc, cc, c1 }, { s1, c1, m } }, B[3] = { ys, yc, y1 }, x[3];
+					#define DET3(M) (M[0][0]*(M[1][1]*M[2][2]-M[1][2]*M[2][1]) - M[0][1]*(M[1][0]*M[2][2]-M[1][2]*M[2][0]) + M[0][2]*(M[1][0]*M[2][1]-M[1][1]*M[2][0]))
+					double det = DET3(A);
+					for (int j = 0; j != 3; j++)
+					{
+						double T[3][3]; memcpy(T, A, sizeof(T));
+						for (int k = 0; k != 3; k++) T[k][j] = B[k];
+						x[j] = DET3(T) / det;
+					}
+					#undef DET3
+					double sig = 0, noise = 0;
+					for (Bitu i = from; i < to; i++)
+					{
+						double fit = x[0] * sin(w * i) + x[1] * cos(w * i) + x[2], y = out[i * 2];
+						sig += fit * fit; noise += (y - fit) * (y - fit);
+					}
+					double db = 10 * log10((noise + 1e-9) / sig);
+					if (db > worst) worst = db;
+				}
+			}
+			if (worst > required_db[q]) failed++;
+
+			Bit32u ticks = DBP_GetTicks();
+			rs.Setup(44100, 48000, q);
+			for (int iter = 0; iter != 50; iter++)
+			{
+				rs.Reset();
+				rs.Push(&src[0], IN_FRAMES, 2);
+				rs.Pull(&out[0], out.size() / 2);
+			}
+			LOG_MSG("[CDAUDIO] Resampler quality %d: worst THD+N %.1f dB (limit %.0f dB), 50 seconds 44100 -> 48000 Hz in %u ms", (int)q, worst, required_db[q], DBP_GetTicks() - ticks);
+		}
+		LOG_MSG("[CDAUDIO] Resampler self test: %s (%d SIMD mismatches)", (failed || mismatches ? "FAILED" : "OK"), mismatches);
+	}
+	#endif
+};
@@ -124,6 +124,29 @@ DOS_File & DOS_File::operator= (const DOS_File & orig) {
 	return *this;
 }
 
+Bit64u DOS_File::ReadBulk(Bit8u * data,Bit64u len,Bit64u offset) {
+	// Generic fallback for file types without a native implementation, no positioning seek when already at offset
+	Bit64u org_pos = 0, pos = offset, done = 0;
+	if (!Seek64(&org_pos, DOS_SEEK_CUR) || (org_pos != offset && (!Seek64(&pos, DOS_SEEK_SET) || pos != offset))) return 0;
+	for (Bit16u sz; done != len; done += sz) {
+		sz = (Bit16u)(len - done > 0xFFFF ? 0xFFFF : len - done);
+		if (!Read(data + done, &sz) || !sz) break;
+	}
+	Seek64(&org_pos, DOS_SEEK_SET);
+	return done;
+}
+
+Bit64u DOS_File::WriteBulk(const Bit8u * data,Bit64u len,Bit64u offset) {
+	Bit64u org_pos = 0, pos = offset, done = 0;
+	if (!len || !Seek64(&org_pos, DOS_SEEK_CUR) || (org_pos != offset && (!Seek64(&pos, DOS_SEEK_SET) || pos != offset))) return 0;
+	for (Bit16u sz, want; done != len; done += sz) {
+		sz = want = (Bit16u)(len - done > 0xFFFF ? 0xFFFF : len - done);
+		if (!Write((Bit8u*)data + done, &sz) || sz != want) { done += sz; break; }
+	}
+	Seek64(&org_pos, DOS_SEEK_SET);
+	return done;
+}
+
 Bit8u DOS_FindDevice(char const * name) {
 	/* should only check for the names before the dot and spacepadded */
 	char fullname[DOS_PATHLENGTH];Bit8u drive;
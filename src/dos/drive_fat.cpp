@@ -37,6 +37,18 @@
 #define FAT16		   1
 #define FAT32		   2
 
+//#define DBP_FAT_PERF_TEST
+#ifdef DBP_FAT_PERF_TEST
+#ifdef _MSC_VER
+#include <intrin.h>
+#elif defined(__SSE2__) || defined(_M_AMD64) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP == 2)
+static Bit64s __rdtsc() { unsigned long lo, hi; asm( "rdtsc" : "=a" (lo), "=d" (hi) );  return( lo | (hi << 32) ); }
+#else
+#include <sys/time.h>
+static Bit64s __rdtsc() { struct timeval tv; gettimeofday(&tv, NULL); return ((Bit64u)tv.tv_sec * 1000000 + tv.tv_usec)<<8; }
+#endif
+#endif
+
 class fatFile : public DOS_File {
 public:
 	fatFile(const char* name, Bit32u startCluster, Bit32u fileLen, fatDrive *useDrive);
@@ -59,6 +71,12 @@ public:
 
 	bool loadedSector;
 	fatDrive *myDrive;
+	fatDrive::clusterExtents extents;
+	#ifdef DBP_FAT_PERF_TEST
+	Bit64s perfTicks;
+	Bit32u perfBytes;
+	struct PerfScope { fatFile* f; Bit16u* size; Bit64s from; PerfScope(fatFile* f, Bit16u* size) : f(f), size(size), from(__rdtsc()) {} ~PerfScope() { f->perfTicks += __rdtsc() - from; f->perfBytes += *size; } };
+	#endif
 private:
 	//DBP: Removed unused fields
 	//enum { NONE,READ,WRITE } last_action;
@@ -104,6 +122,10 @@ fatFile::fatFile(const char* name, Bit32u startCluster, Bit32u fileLen, fatDrive
 	curSectOff = 0;
 	seekpos = 0;
 	memset(&sectorBuffer[0], 0, sizeof(sectorBuffer));
+	#ifdef DBP_FAT_PERF_TEST
+	perfTicks = 0;
+	perfBytes = 0;
+	#endif
 	
 	if(filelength > 0) {
 		Seek(&seekto, DOS_SEEK_SET);
@@ -117,6 +139,9 @@ bool fatFile::Read(Bit8u * data, Bit16u *size) {
 		DOS_SetError(DOSERR_ACCESS_DENIED);
 		return false;
 	}
+	#ifdef DBP_FAT_PERF_TEST
+	PerfScope perf(this, size);
+	#endif
 	Bit16u sizedec, sizecount;
 	if(seekpos >= filelength) {
 		*size = 0;
@@ -124,7 +149,7 @@ bool fatFile::Read(Bit8u * data, Bit16u *size) {
 	}
 
 	if (!loadedSector) {
-		currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+		currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos, &extents);
 		if(currentSector == 0) {
 			/* EOC reached before EOF */
 			*size = 0;
@@ -146,7 +171,7 @@ bool fatFile::Read(Bit8u * data, Bit16u *size) {
 		data[sizecount++] = sectorBuffer[curSectOff++];
 		seekpos++;
 		if(curSectOff >= myDrive->getSectorSize()) {
-			currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+			currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos, &extents);
 			if(currentSector == 0) {
 				/* EOC reached before EOF */
 				//LOG_MSG("EOC reached before EOF, seekpos %d, filelen %d", seekpos, filelength);
@@ -209,17 +234,17 @@ bool fatFile::Write(Bit8u * data, Bit16u *size) {
 				firstCluster = myDrive->getFirstFreeClust();
 				if(firstCluster == 0) goto finalizeWrite; // out of space
 				myDrive->allocateCluster(firstCluster, 0);
-				currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+				currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos, &extents);
 				myDrive->readSector(currentSector, sectorBuffer);
 				loadedSector = true;
 			}
 			if (!loadedSector) {
-				currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+				currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos, &extents);
 				if(currentSector == 0) {
 					/* EOC reached before EOF - try to increase file allocation */
 					myDrive->appendCluster(firstCluster);
 					/* Try getting sector again */
-					currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+					currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos, &extents);
 					if(currentSector == 0) {
 						/* No can do. lets give up and go home.  We must be out of room */
 						goto finalizeWrite;
@@ -236,7 +261,7 @@ bool fatFile::Write(Bit8u * data, Bit16u *size) {
 		if(curSectOff >= myDrive->getSectorSize()) {
 			if(loadedSector) myDrive->writeSector(currentSector, sectorBuffer);
 
-			currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+			currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos, &extents);
 			if(currentSector == 0) loadedSector = false;
 			else {
 				curSectOff = 0;
@@ -279,7 +304,7 @@ bool fatFile::Seek(Bit32u *pos, Bit32u type) {
 
 	if(seekto<0) seekto = 0;
 	seekpos = (Bit32u)seekto;
-	currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+	currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos, &extents);
 	if (currentSector == 0) {
 		/* not within file size, thus no sector is available */
 		loadedSector = false;
@@ -302,6 +327,9 @@ bool fatFile::Close() {
 	//DBP: Added for date and time modification support
 	if (refCtr == 1)
 	{
+		#ifdef DBP_FAT_PERF_TEST
+		if (perfBytes) LOG_MSG("[FATPERF] Read %u bytes in %u kticks (%u cluster runs)", perfBytes, (Bit32u)(perfTicks >> 10), (Bit32u)extents.runs.size());
+		#endif
 		if (newtime && OPEN_IS_WRITING(flags))
 		{
 			direntry tmpentry;
@@ -328,6 +356,26 @@ Bit32u fatDrive::getClustFirstSect(Bit32u clustNum) {
 	return ((clustNum - 2) * bootbuffer.sectorspercluster) + firstDataSector;
 }
 
+Bit8u* fatDrive::getFatSectBuffer(Bit32u fatsectnum) {
+	Bitu oldest = 0;
+	fatCacheUse++;
+	for (Bitu i = 0; i != FAT_CACHE_ENTRIES; i++) {
+		if (fatCache[i].sect == fatsectnum) {
+			fatCache[i].lastUse = fatCacheUse;
+			return fatCache[i].data;
+		}
+		if (fatCache[i].lastUse < fatCache[oldest].lastUse) oldest = i;
+	}
+
+	/* Load two sectors at once for FAT12 */
+	readSector(fatsectnum, &fatCache[oldest].data[0]);
+	if (fattype==FAT12)
+		readSector(fatsectnum+1, &fatCache[oldest].data[512]);
+	fatCache[oldest].sect = fatsectnum;
+	fatCache[oldest].lastUse = fatCacheUse;
+	return fatCache[oldest].data;
+}
+
 Bit32u fatDrive::getClusterValue(Bit32u clustNum) {
 	Bit32u fatoffset=0;
 	Bit32u fatsectnum;
@@ -348,13 +396,7 @@ Bit32u fatDrive::getClusterValue(Bit32u clustNum) {
 	fatsectnum = bootbuffer.reservedsectors + (fatoffset / bootbuffer.bytespersector) + partSectOff;
 	fatentoff = fatoffset % bootbuffer.bytespersector;
 
-	if(curFatSect != fatsectnum) {
-		/* Load two sectors at once for FAT12 */
-		readSector(fatsectnum, &fatSectBuffer[0]);
-		if (fattype==FAT12)
-			readSector(fatsectnum+1, &fatSectBuffer[512]);
-		curFatSect = fatsectnum;
-	}
+	Bit8u* fatSectBuffer = getFatSectBuffer(fatsectnum);
 
 	switch(fattype) {
 		case FAT12:
@@ -395,13 +437,7 @@ void fatDrive::setClusterValue(Bit32u clustNum, Bit32u clustValue) {
 	fatsectnum = bootbuffer.reservedsectors + (fatoffset / bootbuffer.bytespersector) + partSectOff;
 	fatentoff = fatoffset % bootbuffer.bytespersector;
 
-	if(curFatSect != fatsectnum) {
-		/* Load two sectors at once for FAT12 */
-		readSector(fatsectnum, &fatSectBuffer[0]);
-		if (fattype==FAT12)
-			readSector(fatsectnum+1, &fatSectBuffer[512]);
-		curFatSect = fatsectnum;
-	}
+	Bit8u* fatSectBuffer = getFatSectBuffer(fatsectnum);
 
 	switch(fattype) {
 		case FAT12: {
@@ -434,6 +470,12 @@ void fatDrive::setClusterValue(Bit32u clustNum, Bit32u clustValue) {
 				writeSector(fatsectnum+1+(fc * bootbuffer.sectorsperfat), &fatSectBuffer[512]);
 		}
 	}
+	if (fattype==FAT12) {
+		/* Drop cached sector pairs that overlap the modified sectors */
+		for (Bitu i = 0; i != FAT_CACHE_ENTRIES; i++)
+			if (fatCache[i].sect == fatsectnum - 1 || fatCache[i].sect == fatsectnum + 1)
+				fatCache[i].sect = 0xffffffff;
+	}
 }
 
 bool fatDrive::getEntryName(char *fullname, char *entname) {
@@ -575,8 +617,76 @@ Bit32u fatDrive::getClusterSize(void) {
 	return bootbuffer.sectorspercluster * bootbuffer.bytespersector;
 }
 
-Bit32u fatDrive::getAbsoluteSectFromBytePos(Bit32u startClustNum, Bit32u bytePos) {
-	return  getAbsoluteSectFromChain(startClustNum, bytePos / bootbuffer.bytespersector);
+Bit32u fatDrive::getAbsoluteSectFromBytePos(Bit32u startClustNum, Bit32u bytePos, clusterExtents* extents) {
+	if (!extents || startClustNum == 0)
+		return getAbsoluteSectFromChain(startClustNum, bytePos / bootbuffer.bytespersector);
+
+	Bit32u logicalSector = bytePos / bootbuffer.bytespersector;
+	Bit32u logClust = logicalSector / bootbuffer.sectorspercluster;
+	Bit32u sectClust = logicalSector % bootbuffer.sectorspercluster;
+
+	if (extents->startClust != startClustNum || extents->deleteGen != chainDeleteGen) {
+		/* Chain was shortened (or belongs to a different file), start over */
+		extents->runs.clear();
+		extents->startClust = startClustNum;
+		extents->numClusts = 0;
+		extents->chainEnd = false;
+		extents->deleteGen = chainDeleteGen;
+		extents->allocGen = chainAllocGen;
+	} else if (extents->allocGen != chainAllocGen) {
+		/* Chain might have been extended, known runs are still valid */
+		extents->chainEnd = false;
+		extents->allocGen = chainAllocGen;
+	}
+
+	if (extents->numClusts == 0) {
+		clusterExtents::extent first = { 0, startClustNum, 1 };
+		extents->runs.push_back(first);
+		extents->numClusts = 1;
+	}
+
+	/* Walk the chain only as far as needed and only once */
+	while (logClust >= extents->numClusts) {
+		if (extents->chainEnd) return 0;
+		clusterExtents::extent& last = extents->runs.back();
+		Bit32u lastClust = last.clust + last.count - 1;
+		Bit32u testvalue = getClusterValue(lastClust);
+		bool isEOF = false;
+		switch(fattype) {
+			case FAT12:
+				if(testvalue >= 0xff8) isEOF = true;
+				break;
+			case FAT16:
+				if(testvalue >= 0xfff8) isEOF = true;
+				break;
+			case FAT32:
+				if(testvalue >= 0xfffffff8) isEOF = true;
+				break;
+		}
+		if (isEOF) {
+			extents->chainEnd = true;
+			return 0;
+		}
+		if (testvalue == lastClust + 1) {
+			last.count++;
+		} else {
+			clusterExtents::extent next = { extents->numClusts, testvalue, 1 };
+			extents->runs.push_back(next);
+		}
+		extents->numClusts++;
+	}
+
+	/* Binary search for the run containing the cluster, sequential access usually hits the last one */
+	const clusterExtents::extent *run = &extents->runs.back();
+	if (logClust < run->logClust) {
+		size_t lo = 0, hi = extents->runs.size() - 1;
+		while (hi - lo > 1) {
+			size_t mid = (lo + hi) / 2;
+			if (extents->runs[mid].logClust <= logClust) lo = mid; else hi = mid;
+		}
+		run = &extents->runs[lo];
+	}
+	return (getClustFirstSect(run->clust + (logClust - run->logClust)) + sectClust);
 }
 
 Bit32u fatDrive::getAbsoluteSectFromChain(Bit32u startClustNum, Bit32u logicalSector) {
@@ -616,6 +726,7 @@ Bit32u fatDrive::getAbsoluteSectFromChain(Bit32u startClustNum, Bit32u logicalSe
 }
 
 void fatDrive::deleteClustChain(Bit32u startCluster, Bit32u bytePos) {
+	chainDeleteGen++;
 	Bit32u clustSize = getClusterSize();
 	Bit32u endClust = (bytePos + clustSize - 1) / clustSize;
 	Bit32u countClust = 1;
@@ -700,6 +811,7 @@ bool fatDrive::allocateCluster(Bit32u useCluster, Bit32u prevCluster) {
 
 	/* Can't allocate cluster #0 */
 	if(useCluster == 0) return false;
+	chainAllocGen++;
 
 	if(prevCluster != 0) {
 		/* Refuse to allocate cluster if previous cluster value is zero (unallocated) */
@@ -931,8 +1043,10 @@ fatDrive::fatDrive(const char *sysFilename, Bit32u bytesector, Bit32u cylsector,
 	/* There is no cluster 0, this means we are in the root directory */
 	cwdDirCluster = 0;
 
-	memset(fatSectBuffer,0,1024);
-	curFatSect = 0xffffffff;
+	memset(fatCache,0,sizeof(fatCache));
+	for (Bitu i = 0; i != FAT_CACHE_ENTRIES; i++) fatCache[i].sect = 0xffffffff;
+	fatCacheUse = 0;
+	chainDeleteGen = chainAllocGen = 0;
 
 	#ifdef C_DBP_LIBRETRO // safety
 	snprintf(info, sizeof(info), "fatDrive %s", sysFilename);
@@ -36,6 +36,7 @@ public:
 	bool Read(Bit8u *data, Bit16u *size);
 	bool Write(Bit8u *data, Bit16u *size);
 	bool Seek(Bit32u *pos, Bit32u type);
+	Bit64u ReadBulk(Bit8u *data, Bit64u len, Bit64u offset);
 	bool Close();
 	Bit16u GetInformation(void);
 private:
@@ -100,6 +101,30 @@ bool isoFile::Read(Bit8u *data, Bit16u *size) {
 	return true;
 }
 
+Bit64u isoFile::ReadBulk(Bit8u *data, Bit64u len, Bit64u offset) {
+	//DBP: Read whole sectors straight into the output buffer, only partial sectors go through the sector cache
+	if (offset >= (Bit64u)(fileEnd - fileBegin)) return 0;
+	if (len > (Bit64u)(fileEnd - fileBegin) - offset) len = (Bit64u)(fileEnd - fileBegin) - offset;
+	Bit32u pos = fileBegin + (Bit32u)offset, end = pos + (Bit32u)len;
+	while (pos != end) {
+		int sector = (int)(pos / ISO_FRAMESIZE);
+		Bit32u sectorPos = pos % ISO_FRAMESIZE, step = ISO_FRAMESIZE - sectorPos;
+		if (step > end - pos) step = end - pos;
+		if (step == ISO_FRAMESIZE && sector != cachedSector) {
+			if (!drive->readSector(data, sector)) break;
+		} else {
+			if (sector != cachedSector) {
+				if (!drive->readSector(buffer, sector)) { cachedSector = -1; break; }
+				cachedSector = sector;
+			}
+			memcpy(data, &buffer[sectorPos], step);
+		}
+		data += step;
+		pos += step;
+	}
+	return (Bit64u)(pos - fileBegin) - offset;
+}
+
 bool isoFile::Write(Bit8u* /*data*/, Bit16u* /*size*/) {
 	return false;
 }
@@ -477,6 +477,7 @@ bool localFile::Read(Bit8u * data,Bit16u * size) {
 		DOS_SetError(DOSERR_ACCESS_DENIED);
 		return false;
 	}
+	EndBulk();
 	if (last_action==WRITE) fseek(fhandle,ftell(fhandle),SEEK_SET);
 	last_action=READ;
 	*size=(Bit16u)fread(data,1,*size,fhandle);
@@ -493,6 +494,7 @@ bool localFile::Write(Bit8u * data,Bit16u * size) {
 		DOS_SetError(DOSERR_ACCESS_DENIED);
 		return false;
 	}
+	EndBulk();
 	if (last_action==READ) fseek(fhandle,ftell(fhandle),SEEK_SET);
 	last_action=WRITE;
 	if(*size==0){  
@@ -515,6 +517,7 @@ bool localFile::Seek(Bit32u * pos,Bit32u type) {
 	//TODO Give some doserrorcode;
 		return false;//ERROR
 	}
+	EndBulk();
 	int ret=fseek(fhandle,*reinterpret_cast<Bit32s*>(pos),seektype);
 	if (ret!=0) {
 		// Out of file range, pretend everythings ok 
@@ -532,10 +535,57 @@ bool localFile::Seek(Bit32u * pos,Bit32u type) {
 	return true;
 }
 
+Bit64u localFile::ReadBulk(Bit8u * data,Bit64u len,Bit64u offset) {
+	if (!OPEN_IS_READING(flags)) {
+		DOS_SetError(DOSERR_ACCESS_DENIED);
+		return 0;
+	}
+	return bulk.Read(fhandle, data, len, offset);
+}
+
+Bit64u localFile::WriteBulk(const Bit8u * data,Bit64u len,Bit64u offset) {
+	if (!OPEN_IS_WRITING(flags)) {
+		DOS_SetError(DOSERR_ACCESS_DENIED);
+		return 0;
+	}
+	return bulk.Write(fhandle, data, len, offset);
+}
+
+bool DOS_HostBulk::Begin(FILE* f, Bit64u offset, Bit8u kind) {
+	// Continuing a sequential run of the same kind needs no seek, switching between reading and writing always does
+	if (mode == kind && next_ofs == offset) return true;
+	if (mode == NONE) ret_pos = (Bit64u)ftell_wrap(f);
+	mode = kind;
+	if (!fseek_wrap(f, offset, SEEK_SET)) return true;
+	End(f);
+	return false;
+}
+
+Bit64u DOS_HostBulk::Read(FILE* f, Bit8u* data, Bit64u len, Bit64u offset) {
+	if (!Begin(f, offset, READ)) return 0;
+	Bit64u res = (Bit64u)fread(data, 1, (size_t)len, f);
+	next_ofs = (res == len ? offset + res : (Bit64u)-1); // don't continue after hitting the end of file
+	return res;
+}
+
+Bit64u DOS_HostBulk::Write(FILE* f, const Bit8u* data, Bit64u len, Bit64u offset) {
+	if (!Begin(f, offset, WRITE)) return 0;
+	Bit64u res = (Bit64u)fwrite(data, 1, (size_t)len, f);
+	next_ofs = (res == len ? offset + res : (Bit64u)-1);
+	return res;
+}
+
+bool DOS_HostBulk::End(FILE* f) {
+	if (mode == NONE) return false;
+	fseek_wrap(f, ret_pos, SEEK_SET);
+	mode = NONE;
+	return true;
+}
+
 bool localFile::Close() {
 	// only close if one reference left
 	if (refCtr==1) {
-		if(fhandle) fclose(fhandle);
+		if(fhandle) { EndBulk(); fclose(fhandle); }
 		fhandle = 0;
 		open = false;
 	};
@@ -579,6 +629,7 @@ bool localFile::UpdateDateTimeFromHost(void) {
 }
 
 void localFile::Flush(void) {
+	EndBulk();
 	if (last_action==WRITE) {
 		fseek(fhandle,ftell(fhandle),SEEK_SET);
 		last_action=NONE;
@@ -119,6 +119,26 @@ struct Memory_Handle : public DOS_File
 		return true;
 	}
 
+	virtual Bit64u ReadBulk(Bit8u* data, Bit64u len, Bit64u offset)
+	{
+		if (!OPEN_IS_READING(flags)) { DOS_SetError(DOSERR_ACCESS_DENIED); return 0; }
+		if (offset >= (Bit64u)src->mem_data.size()) return 0;
+		Bit64u left = (Bit64u)src->mem_data.size() - offset;
+		if (left < len) len = left;
+		memcpy(data, &src->mem_data[(size_t)offset], (size_t)len);
+		return len;
+	}
+
+	virtual Bit64u WriteBulk(const Bit8u* data, Bit64u len, Bit64u offset)
+	{
+		if (!OPEN_IS_WRITING(flags)) { DOS_SetError(DOSERR_ACCESS_DENIED); return 0; }
+		if (!len) return 0;
+		wasmodified = true;
+		if (offset + len > (Bit64u)src->mem_data.size()) src->mem_data.resize((size_t)(offset + len));
+		memcpy(&src->mem_data[(size_t)offset], data, (size_t)len);
+		return len;
+	}
+
 	virtual bool Seek(Bit32u* pos, Bit32u type)
 	{
 		Bit32s seekto=0;
@@ -459,12 +479,7 @@ bool memoryDrive::CloneEntry(DOS_Drive* src_drv, const char* src_path)
 		{
 			df->AddRef();
 			e->AsFile()->mem_data.resize(stat.size);
-			Bit8u* buf = &e->AsFile()->mem_data[0];
-			for (Bit16u read; stat.size; stat.size -= read, buf += read)
-			{
-				read = (Bit16u)(stat.size > 0xFFFF ? 0xFFFF : stat.size);
-				if (!df->Read(buf, &read)) { DBP_ASSERT(0); }
-			}
+			if (df->ReadBulk(&e->AsFile()->mem_data[0], stat.size, 0) != stat.size) { DBP_ASSERT(0); }
 			df->Close();
 			delete df;
 		}
@@ -44,6 +44,9 @@ struct Mirror_Handle : public DOS_File
 	virtual bool Read(Bit8u* data, Bit16u* size) { return underfile->Read(data, size); }
 	virtual bool Write(Bit8u* data, Bit16u* size) { return underfile->Write(data, size); }
 	virtual bool Seek(Bit32u* pos, Bit32u type) { return underfile->Seek(pos, type); }
+	virtual Bit64u ReadBulk(Bit8u* data, Bit64u len, Bit64u offset) { return underfile->ReadBulk(data, len, offset); }
+	virtual Bit64u WriteBulk(const Bit8u* data, Bit64u len, Bit64u offset) { return underfile->WriteBulk(data, len, offset); }
+	virtual FILE* GetHostFile() { return underfile->GetHostFile(); }
 	virtual Bit16u GetInformation(void) { return underfile->GetInformation(); }
 	virtual bool UpdateDateTimeFromHost() { return underfile->UpdateDateTimeFromHost(); }
 
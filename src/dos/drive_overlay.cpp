@@ -223,6 +223,14 @@ public:
 		}
 		return localFile::Write(data,size);
 	}
+	Bit64u WriteBulk(const Bit8u * data,Bit64u len,Bit64u offset) {
+		Bit32u f = flags&0xf;
+		if (!overlay_active && (f == OPEN_READWRITE || f == OPEN_WRITE)) {
+			if (!create_copy()) return 0;
+			overlay_active = true;
+		}
+		return localFile::WriteBulk(data,len,offset);
+	}
 	bool create_copy();
 //private:
 	bool overlay_active;
@@ -262,6 +270,7 @@ bool OverlayFile::create_copy() {
 	//ensure file position
 	if (logoverlay) LOG_MSG("create_copy called %s",GetName());
 
+	EndBulk();
 	FILE* lhandle = this->fhandle;
 	fseek(lhandle,ftell(lhandle),SEEK_SET);
 	int location_in_old_file = ftell(lhandle);
@@ -294,6 +303,7 @@ bool OverlayFile::create_copy() {
 static OverlayFile* ccc(DOS_File* file) {
 	localFile* l = dynamic_cast<localFile*>(file);
 	if (!l) E_Exit("overlay input file is not a localFile");
+	l->EndBulk();
 	//Create an overlayFile
 	OverlayFile* ret = new OverlayFile(l->GetName(),l->fhandle);
 	ret->flags = l->flags;
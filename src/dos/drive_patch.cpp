@@ -109,7 +109,7 @@ struct Patch_File : Patch_Entry
 				if (!drv.FileStat(path, &stat) || !drv.FileOpen(&df, path, 0)) return false;
 				res.resize(stat.size);
 				df->AddRef();
-				if (!Read(df, (stat.size ? &res[0] : NULL), stat.size)) return false;
+				if (stat.size && df->ReadBulk(&res[0], stat.size, 0) != stat.size) return false;
 				df->Close();
 				delete df;
 				return true;
@@ -441,11 +441,27 @@ struct Patch_Handle : public DOS_File
 		return true;
 	}
 
+	virtual Bit64u ReadBulk(Bit8u* data, Bit64u len, Bit64u offset)
+	{
+		if (!OPEN_IS_READING(flags)) { DOS_SetError(DOSERR_ACCESS_DENIED); return 0; }
+		if (offset >= (Bit64u)src->mem_data.size()) return 0;
+		Bit64u left = (Bit64u)src->mem_data.size() - offset;
+		if (left < len) len = left;
+		memcpy(data, &src->mem_data[(size_t)offset], (size_t)len);
+		return len;
+	}
+
 	virtual bool Write(Bit8u* data, Bit16u* size)
 	{
 		return FALSE_SET_DOSERR(ACCESS_DENIED);
 	}
 
+	virtual Bit64u WriteBulk(const Bit8u* data, Bit64u len, Bit64u offset)
+	{
+		DOS_SetError(DOSERR_ACCESS_DENIED);
+		return 0;
+	}
+
 	virtual bool Seek(Bit32u* pos, Bit32u type)
 	{
 		Bit32s seekto=0;
@@ -284,12 +284,7 @@ struct unionDriveImpl
 					df->AddRef();
 					std::vector<char> mods;
 					mods.resize(size+sizeof('\0'));
-					Bit8u* buf = (Bit8u*)&mods[0];
-					for (Bit16u read; size; size -= read, buf += read)
-					{
-						read = (Bit16u)(size > 0xFFFF ? 0xFFFF : size);
-						if (!df->Read(buf, &read)) { DBP_ASSERT(0); }
-					}
+					if (df->ReadBulk((Bit8u*)&mods[0], size, 0) != size) { DBP_ASSERT(0); }
 					df->Close();
 					delete df;
 
@@ -603,6 +598,18 @@ struct Union_WriteHandle : public DOS_File
 		return real_file->Read(data, size);
 	}
 
+	virtual Bit64u ReadBulk(Bit8u* data, Bit64u len, Bit64u offset)
+	{
+		if (!OPEN_IS_READING(flags)) { DOS_SetError(DOSERR_ACCESS_DENIED); return 0; }
+		if (!real_file) { DOS_SetError(DOSERR_INVALID_HANDLE); return 0; }
+		return real_file->ReadBulk(data, len, offset);
+	}
+
+	virtual FILE* GetHostFile()
+	{
+		return (real_file ? real_file->GetHostFile() : NULL);
+	}
+
 	virtual bool Write(Bit8u* data, Bit16u* size)
 	{
 		if (!OPEN_IS_WRITING(flags)) return FALSE_SET_DOSERR(ACCESS_DENIED);
@@ -634,11 +641,10 @@ struct Union_WriteHandle : public DOS_File
 			}
 			clone_write->AddRef();
 
-			Bit8u buf[4096];
-			for (Bit16u read; real_file->Read(buf, &(read = sizeof(buf))) && read;)
+			Bit8u buf[16384];
+			for (Bit64u read, pos = 0; (read = real_file->ReadBulk(buf, sizeof(buf), pos)) != 0; pos += read)
 			{
-				Bit16u write = read;
-				if (!clone_write->Write(buf, &write) || write != read)
+				if (clone_write->WriteBulk(buf, read, pos) != read)
 				{
 					// Should not happen, maybe disk full
 					clone_write->Close();
@@ -21,6 +21,7 @@
 #include "drives.h"
 #include "inout.h"
 #include "pic.h"
+#include "dbp_threads.h"
 
 #include <vector>
 
@@ -1076,23 +1077,18 @@ struct Zip_Archive
 
 	Bit32u Read(Bit64u seek_ofs, void *pBuf, Bit32u n)
 	{
-		if (seek_ofs >= size) n = 0;
-		else if ((Bit64u)n > (size - seek_ofs)) n = (Bit32u)(size - seek_ofs);
+		if (seek_ofs >= size) return 0;
+		if ((Bit64u)n > (size - seek_ofs)) n = (Bit32u)(size - seek_ofs);
+		if (n > 0xFFFF) return (Bit32u)zip->ReadBulk((Bit8u*)pBuf, n, seek_ofs); // leaves the file position untouched
 		if (seek_ofs != ofs)
 		{
 			zip->Seek64(&seek_ofs, DOS_SEEK_SET);
 			ofs = seek_ofs;
 		}
-		Bit8u* pOut = (Bit8u*)pBuf;
-		for (Bit32u remain = n; remain;)
-		{
-			Bit16u sz = (remain > 0xFFFF ? 0xFFFF : (Bit16u)remain);
-			if (!zip->Read(pOut, &sz) || !sz) { n -= remain; break; }
-			remain -= sz;
-			pOut += sz;
-		}
-		ofs += n;
-		return n;
+		Bit16u sz = (Bit16u)n;
+		if (!zip->Read((Bit8u*)pBuf, &sz)) sz = 0;
+		ofs += sz;
+		return sz;
 	}
 };
 
@@ -1269,6 +1265,36 @@ struct Zip_DeflateMemoryUnpacker : Zip_MemoryUnpacker
 	}
 };
 
+// Decompressed blocks of larger deflated files are kept in a small LRU cache shared by all open files.
+// When a file is being read sequentially, a worker thread inflates the next blocks ahead of the read cursor.
+// The worker never touches the archive itself, the compressed data it needs is read in advance by the main thread.
+struct Zip_BlockCache
+{
+	enum { BLOCK_SIZE = 64*1024, BLOCK_COUNT = 32, READ_AHEAD = 2 };
+	struct Block { struct Zip_DeflateUnpacker* u; Bit32u idx, len, last_use; Bit8u* data; }; // len 0 means pending
+	Block blocks[BLOCK_COUNT];
+	Bit32u use_counter, job_from, job_to, job_blocks[READ_AHEAD];
+	Zip_DeflateUnpacker* job;
+	const Zip_File* job_file;
+	std::vector<Bit8u> job_comp;
+	bool waiting;
+	Bit8u read_ahead;
+	Mutex mtx;
+	Semaphore done;
+
+	Zip_BlockCache() : use_counter(0), job(NULL), waiting(false), read_ahead(0xFF) { memset(blocks, 0, sizeof(blocks)); }
+	Bit32u Read(Zip_DeflateUnpacker* u, const Zip_File& f, Bit32u seek_ofs, void *res_buf, Bit32u res_n);
+	void Sync(Zip_DeflateUnpacker* u, bool forget);
+
+private:
+	Block* Find(Zip_DeflateUnpacker* u, Bit32u idx);
+	Block* Alloc(Zip_DeflateUnpacker* u, Bit32u idx);
+	void ReadAhead(Zip_DeflateUnpacker* u, const Zip_File& f, Bit32u from);
+	inline void WaitJob() { waiting = true; mtx.Unlock(); done.Wait(); mtx.Lock(); }
+	static Thread::RET_t THREAD_CC JobThread(void*);
+};
+static Zip_BlockCache zip_block_cache;
+
 struct Zip_DeflateUnpacker : ZIP_Unpacker
 {
 	Zip_Archive& archive;
@@ -1298,13 +1324,18 @@ struct Zip_DeflateUnpacker : ZIP_Unpacker
 	Bit32u cursor_block;
 	SeekCursor* cursors;
 
+	Bit32u cache_last_idx; // last block accessed through Zip_BlockCache, used to detect sequential reading
+	const Bit8u* ahead_comp; // compressed data prepared for the read ahead thread (only set while it works on this file)
+	Bit64u ahead_comp_ofs;
+	Bit32u ahead_comp_len;
+
 	Bit8u read_buf[READ_BLOCK];
 	Bit8u write_buf[WRITE_BLOCK];
 
 	enum { SEEK_CURSOR_MAX_DEFL = 128 + (sizeof(SeekCursor) + 9) / 10 * 11, SEEK_CACHE_CURSOR_NEED = 50, SEEK_CACHE_CURSOR_STEPS = 20 };
 	struct SeekCache { zipDrive* drv; std::string path; Bit32u count; } * seek_cache;
 
-	Zip_DeflateUnpacker(Zip_Archive& _archive, const Zip_File& f, zipDrive* drv, const char* path) : archive(_archive), crc_run(0), crc_ofs((Bit32u)-1), crc_failed(0), seek_cache(NULL)
+	Zip_DeflateUnpacker(Zip_Archive& _archive, const Zip_File& f, zipDrive* drv, const char* path) : archive(_archive), crc_run(0), crc_ofs((Bit32u)-1), crc_failed(0), cache_last_idx(0), ahead_comp(NULL), seek_cache(NULL)
 	{
 		//printf("[%s] OPENED FILE!\n", f.name);
 		DBP_ASSERT(f.ofs_past_header);
@@ -1362,6 +1393,7 @@ struct Zip_DeflateUnpacker : ZIP_Unpacker
 
 	~Zip_DeflateUnpacker()
 	{
+		zip_block_cache.Sync(this, true);
 		if (seek_cache) delete seek_cache;
 		free(cursors);
 	}
@@ -1375,6 +1407,19 @@ struct Zip_DeflateUnpacker : ZIP_Unpacker
 	}
 
 	Bit32u Read(const Zip_File& f, Bit32u seek_ofs, void *res_buf, Bit32u res_n)
+	{
+		return zip_block_cache.Read(this, f, seek_ofs, res_buf, res_n);
+	}
+
+	Bit32u ReadCompressed(Bit64u pos, Bit8u* buf, Bit32u n)
+	{
+		if (!ahead_comp) return archive.Read(pos, buf, n);
+		if (pos < ahead_comp_ofs || pos + n > ahead_comp_ofs + ahead_comp_len) return 0;
+		memcpy(buf, ahead_comp + (pos - ahead_comp_ofs), n);
+		return n;
+	}
+
+	Bit32u Inflate(const Zip_File& f, Bit32u seek_ofs, void *res_buf, Bit32u res_n)
 	{
 		if (crc_failed) return 0;
 		Bit32u want_from = seek_ofs, want_to = seek_ofs + res_n, last_idx = (Bit32u)-1, slowload_num, slowload_tick;
@@ -1429,7 +1474,7 @@ struct Zip_DeflateUnpacker : ZIP_Unpacker
 			if (!read_buf_avail)
 			{
 				read_buf_avail = (comp_remaining < READ_BLOCK ? comp_remaining : READ_BLOCK);
-				if (archive.Read(ofs, read_buf, read_buf_avail) != read_buf_avail)
+				if (ReadCompressed(ofs, read_buf, read_buf_avail) != read_buf_avail)
 					break;
 				ofs_last_read = ofs;
 				ofs += read_buf_avail;
@@ -1477,8 +1522,9 @@ struct Zip_DeflateUnpacker : ZIP_Unpacker
 					cursors[idx].m_dist_from_out_buf_start = inflator.m_dist_from_out_buf_start;
 					memcpy(cursors[idx].write_buf, write_buf, sizeof(write_buf));
 
-					// Write a seek cache next to the compressed file for larger files
-					if (seek_cache && idx > SEEK_CACHE_CURSOR_NEED)
+					// Write a seek cache next to the compressed file for larger files and show the slow loading notice
+					// Both only happen on the main thread, never while the read ahead thread is inflating this file
+					if (!ahead_comp && seek_cache && idx > SEEK_CACHE_CURSOR_NEED)
 					{
 						Bit32u cursor_count = (Bit16u)((f.decomp_size + (cursor_block - 1)) / cursor_block), cursor_got = 0;
 						for (Bit32u ii = (SEEK_CACHE_CURSOR_STEPS / 2); ii < cursor_count; ii++)
@@ -1553,9 +1599,154 @@ struct Zip_DeflateUnpacker : ZIP_Unpacker
 	}
 };
 
+Zip_BlockCache::Block* Zip_BlockCache::Find(Zip_DeflateUnpacker* u, Bit32u idx)
+{
+	for (Block *b = blocks, *bEnd = b + BLOCK_COUNT; b != bEnd; b++)
+		if (b->u == u && b->idx == idx)
+			return b;
+	return NULL;
+}
+
+Zip_BlockCache::Block* Zip_BlockCache::Alloc(Zip_DeflateUnpacker* u, Bit32u idx)
+{
+	Block* res = NULL;
+	for (Block *b = blocks, *bEnd = b + BLOCK_COUNT; b != bEnd; b++)
+	{
+		if (!b->u) { res = b; break; }
+		if (b->len && (!res || (Bit32s)(b->last_use - res->last_use) < 0)) res = b;
+	}
+	DBP_ASSERT(res);
+	if (!res->data) res->data = (Bit8u*)malloc(BLOCK_SIZE);
+	res->u = u;
+	res->idx = idx;
+	res->len = 0;
+	res->last_use = use_counter;
+	return res;
+}
+
+Bit32u Zip_BlockCache::Read(Zip_DeflateUnpacker* u, const Zip_File& f, Bit32u seek_ofs, void *res_buf, Bit32u res_n)
+{
+	Bit8u* p_res = (Bit8u*)res_buf;
+	Bit32u pos = seek_ofs, pos_end = seek_ofs + res_n, first_idx = seek_ofs / BLOCK_SIZE, idx = first_idx;
+	mtx.Lock();
+	while (pos != pos_end)
+	{
+		idx = pos / BLOCK_SIZE;
+		Block* b = Find(u, idx);
+		if (b ? !b->len : (job == u)) { WaitJob(); continue; } // the read ahead thread is working on this file
+		if (!b)
+		{
+			// The lock is released while inflating because reading a nested archive can end up back in here
+			Bit32u len = (f.decomp_size - idx * BLOCK_SIZE < BLOCK_SIZE ? f.decomp_size - idx * BLOCK_SIZE : BLOCK_SIZE);
+			b = Alloc(u, idx);
+			mtx.Unlock();
+			Bit32u got = u->Inflate(f, idx * BLOCK_SIZE, b->data, len);
+			mtx.Lock();
+			if (got != len) { b->u = NULL; break; }
+			b->len = len;
+		}
+		b->last_use = ++use_counter;
+		Bit32u step = (b->len - (pos - idx * BLOCK_SIZE));
+		if (step > pos_end - pos) step = pos_end - pos;
+		memcpy(p_res, b->data + (pos - idx * BLOCK_SIZE), step);
+		p_res += step;
+		pos += step;
+	}
+
+	// Start reading ahead when the file is read sequentially and the next block isn't available yet
+	Bit32u prev_idx = u->cache_last_idx, next_idx;
+	u->cache_last_idx = idx;
+	if (read_ahead == 0xFF)
+	{
+		extern unsigned dbp_cpu_features_get_core_amount(void);
+		read_ahead = (dbp_cpu_features_get_core_amount() > 1);
+	}
+	if (pos == pos_end && read_ahead && !job && first_idx - prev_idx <= 1 && idx != prev_idx
+		&& !(u->out_buf_ofs & (BLOCK_SIZE-1)) && u->out_buf_ofs < f.decomp_size
+		&& (next_idx = u->out_buf_ofs / BLOCK_SIZE) > idx && next_idx <= idx + READ_AHEAD && !Find(u, next_idx))
+		ReadAhead(u, f, next_idx); // unlocks the mutex
+	else
+		mtx.Unlock();
+	return (Bit32u)(p_res - (Bit8u*)res_buf);
+}
+
+void Zip_BlockCache::ReadAhead(Zip_DeflateUnpacker* u, const Zip_File& f, Bit32u from)
+{
+	Bit32u block_count = (f.decomp_size + (BLOCK_SIZE - 1)) / BLOCK_SIZE;
+	job = u;
+	job_file = &f;
+	job_from = from;
+	job_to = (from + READ_AHEAD > block_count ? block_count : from + READ_AHEAD);
+	for (Bit32u i = job_from; i != job_to; i++)
+		job_blocks[i - job_from] = (Bit32u)(Alloc(u, i) - blocks);
+	mtx.Unlock();
+
+	// Deflate can expand data only by a few bytes per 64 kb, add what the inflater might read past the last needed byte
+	Bit32u comp_len = READ_AHEAD * BLOCK_SIZE + Zip_DeflateUnpacker::READ_BLOCK + 1024;
+	if (comp_len > u->comp_remaining) comp_len = u->comp_remaining;
+	job_comp.resize(comp_len ? comp_len : 1);
+	if (u->archive.Read(u->ofs, &job_comp[0], comp_len) != comp_len)
+	{
+		mtx.Lock();
+		for (Bit32u i = job_from; i != job_to; i++) blocks[job_blocks[i - job_from]].u = NULL;
+		job = NULL;
+		mtx.Unlock();
+		return;
+	}
+	u->ahead_comp = &job_comp[0];
+	u->ahead_comp_ofs = u->ofs;
+	u->ahead_comp_len = comp_len;
+	Thread::StartDetached(JobThread);
+}
+
+Thread::RET_t THREAD_CC Zip_BlockCache::JobThread(void*)
+{
+	Zip_BlockCache& c = zip_block_cache;
+	Zip_DeflateUnpacker* u = c.job;
+	const Zip_File& f = *c.job_file;
+	Bit32u i = c.job_from, lens[READ_AHEAD];
+	for (; i != c.job_to; i++)
+	{
+		Bit32u len = (f.decomp_size - i * BLOCK_SIZE < BLOCK_SIZE ? f.decomp_size - i * BLOCK_SIZE : BLOCK_SIZE);
+		if (u->Inflate(f, i * BLOCK_SIZE, c.blocks[c.job_blocks[i - c.job_from]].data, len) != len) { u->Reset(f); break; }
+		lens[i - c.job_from] = len;
+	}
+	u->ahead_comp = NULL;
+
+	c.mtx.Lock();
+	for (Bit32u j = c.job_from; j != c.job_to; j++)
+	{
+		Block& b = c.blocks[c.job_blocks[j - c.job_from]];
+		if (j < i) { b.len = lens[j - c.job_from]; b.last_use = c.use_counter; }
+		else b.u = NULL;
+	}
+	c.job = NULL;
+	if (c.waiting) { c.waiting = false; c.done.Post(); }
+	c.mtx.Unlock();
+	return 0;
+}
+
+void Zip_BlockCache::Sync(Zip_DeflateUnpacker* u, bool forget)
+{
+	mtx.Lock();
+	while (job == u) WaitJob();
+	if (forget)
+	{
+		bool any = false;
+		for (Block *b = blocks, *bEnd = b + BLOCK_COUNT; b != bEnd; b++)
+			if (b->u == u) b->u = NULL;
+			else if (b->u) any = true;
+		if (!any) // free all memory when the last file using the cache is closed
+			for (Block *b = blocks, *bEnd = b + BLOCK_COUNT; b != bEnd; b++)
+				{ free(b->data); b->data = NULL; }
+	}
+	mtx.Unlock();
+}
+
 void Zip_File::PICHandler(Bitu implPtr)
 {
 	Zip_File& f = *(Zip_File*)implPtr;
+	zip_block_cache.Sync((Zip_DeflateUnpacker*)f.unpacker, false);
 	((Zip_DeflateUnpacker*)f.unpacker)->WriteSeekCache(f);
 	f.have_pic = 0;
 }
@@ -1633,11 +1824,26 @@ struct Zip_Handle : public DOS_File
 		return true;
 	}
 
+	virtual Bit64u ReadBulk(Bit8u* data, Bit64u len, Bit64u offset)
+	{
+		if (!OPEN_IS_READING(flags)) { DOS_SetError(DOSERR_ACCESS_DENIED); return 0; }
+		if (!src->unpacker) { DOS_SetError(DOSERR_INVALID_HANDLE); return 0; }
+		if (offset >= (Bit64u)src->decomp_size) return 0;
+		Bit32u left = (Bit32u)(src->decomp_size - offset), want = (left < len ? left : (Bit32u)len);
+		return (want ? src->unpacker->Read(*src, (Bit32u)offset, data, want) : 0);
+	}
+
 	virtual bool Write(Bit8u* data, Bit16u* size)
 	{
 		return FALSE_SET_DOSERR(ACCESS_DENIED);
 	}
 
+	virtual Bit64u WriteBulk(const Bit8u* data, Bit64u len, Bit64u offset)
+	{
+		DOS_SetError(DOSERR_ACCESS_DENIED);
+		return 0;
+	}
+
 	virtual bool Seek(Bit32u* pos, Bit32u type)
 	{
 		//printf("[] [%s] SEEKING %d (type: %d)\n", name, *pos, type);
@@ -2202,19 +2408,20 @@ bool zipDrive::isRemote(void) { return false; }
 bool zipDrive::isRemovable(void) { return false; }
 Bits zipDrive::UnMount(void) { delete this; return 0;  }
 
-void zipDrive::Uncompress(const Bit8u* src, Bit32u src_len, Bit8u* trg, Bit32u trg_len)
+bool zipDrive::Uncompress(const Bit8u* src, Bit32u src_len, Bit8u* trg, Bit32u trg_len)
 {
 	miniz::tinfl_decompressor inflator;
 	miniz::tinfl_init(&inflator);
 	const Bit8u *src_end = src + src_len, *trg_start = trg, *trg_end = trg + trg_len;
-	for (miniz::tinfl_status status = miniz::TINFL_STATUS_HAS_MORE_OUTPUT; status == miniz::TINFL_STATUS_HAS_MORE_OUTPUT;)
+	for (miniz::tinfl_status status = miniz::TINFL_STATUS_HAS_MORE_OUTPUT; status == miniz::TINFL_STATUS_HAS_MORE_OUTPUT && trg != trg_end;)
 	{
 		Bit32u in_size = (Bit32u)(src_end - src), out_size = (Bit32u)(trg_end - trg);
 		status = miniz::tinfl_decompress(&inflator, src, &in_size, (Bit8u*)trg_start, trg, &out_size, miniz::TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
 		src += in_size;
 		trg += out_size;
-		DBP_ASSERT(status == miniz::TINFL_STATUS_HAS_MORE_OUTPUT || status == miniz::TINFL_STATUS_DONE);
+		if (status < miniz::TINFL_STATUS_DONE) return false;
 	}
+	return (trg == trg_end);
 }
 
 #include <dbp_serialize.h>
@@ -607,13 +607,7 @@ DOS_File *FindAndOpenDosFile(char const* filename, Bit32u *bsize, bool* writable
 
 static bool ReadAndClose(DOS_File *df, Bit32u filesize, Bit8u* buf)
 {
-	Bit32u seekzero = 0;
-	df->Seek(&seekzero, DOS_SEEK_SET);
-	for (Bit16u read; filesize; filesize -= read, buf += read)
-	{
-		read = (Bit16u)(filesize > 0xFFFF ? 0xFFFF : filesize);
-		if (!df->Read(buf, &read)) { DBP_ASSERT(0); }
-	}
+	if (filesize && df->ReadBulk(buf, filesize, 0) != filesize) { DBP_ASSERT(0); }
 	df->Close();
 	delete df;
 	return true;
@@ -659,23 +653,225 @@ bool DriveCreateFile(DOS_Drive* drv, const char* path, const Bit8u* buf, Bit32u
 	DOS_File *df;
 	if (!drv || !drv->FileCreate(&df, (char*)path, DOS_ATTR_ARCHIVE)) return false;
 	df->AddRef();
-	for (Bit16u wrote; numbytes; numbytes -= wrote, buf += wrote)
-	{
-		wrote = (Bit16u)(numbytes > 0xFFFF ? 0xFFFF : numbytes);
-		if (!df->Write((Bit8u*)buf, &wrote)) { DBP_ASSERT(0); }
-	}
+	if (numbytes && df->WriteBulk(buf, numbytes, 0) != numbytes) { DBP_ASSERT(0); }
 	df->Close();
 	delete df;
 	return true;
 }
 
+//DBP: CRC-32 with a portable slice-by-8 implementation and hardware accelerated paths selected at runtime
+//#define DBP_CRC32_SELF_TEST
+#if (defined(__x86_64__) || defined(_M_X64) || defined(_M_AMD64)) && (defined(__GNUC__) || defined(_MSC_VER))
+#define DBP_CRC32_PCLMUL
+#ifdef _MSC_VER
+#include <intrin.h>
+#define DBP_CRC32_TARGET
+#else
+#include <cpuid.h>
+#define DBP_CRC32_TARGET __attribute__((target("sse2,pclmul")))
+#endif
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#elif (defined(__aarch64__) || defined(_M_ARM64)) && (defined(__GNUC__) || defined(_MSC_VER))
+#define DBP_CRC32_ARMV8
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define DBP_CRC32_TARGET
+#else
+#include <arm_acle.h>
+#if defined(__ARM_FEATURE_CRC32)
+#define DBP_CRC32_TARGET
+#elif defined(__clang__)
+#define DBP_CRC32_TARGET __attribute__((target("crc")))
+#else
+#define DBP_CRC32_TARGET __attribute__((target("+crc")))
+#endif
+#endif
+#if defined(_WIN32) && !defined(__ARM_FEATURE_CRC32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__) && !defined(__ARM_FEATURE_CRC32)
+#include <sys/auxv.h>
+#endif
+#endif
+
+struct DriveCRC32
+{
+	// All functions take and return the inverted CRC state
+	typedef Bit32u (*Func)(const Bit8u *ptr, size_t len, Bit32u crc);
+	Func func;
+
+	static DriveCRC32& Get() { static DriveCRC32 s; return s; }
+
+	struct Table
+	{
+		Bit32u tbl[8][256];
+		static Table& Get() { static Table s; return s; }
+		Table()
+		{
+			for (Bit32u i = 0; i != 256; i++)
+			{
+				Bit32u c = i;
+				for (int k = 0; k != 8; k++) c = (c >> 1) ^ (0xEDB88320 & (0 - (c & 1)));
+				tbl[0][i] = c;
+			}
+			for (Bit32u i = 0; i != 256; i++)
+				for (int k = 1; k != 8; k++)
+					tbl[k][i] = (tbl[k-1][i] >> 8) ^ tbl[0][tbl[k-1][i] & 0xFF];
+		}
+	};
+
+	DriveCRC32()
+	{
+		func = Slice8;
+		#ifdef DBP_CRC32_PCLMUL
+		if (HavePCLMUL()) func = PCLMUL;
+		#elif defined(DBP_CRC32_ARMV8)
+		if (HaveARMv8CRC()) func = ARMv8;
+		#endif
+
+		#ifdef DBP_CRC32_SELF_TEST
+		SelfTest();
+		#endif
+	}
+
+	static Bit32u Slice8(const Bit8u *p, size_t len, Bit32u crc)
+	{
+		const Bit32u (*t)[256] = Table::Get().tbl;
+		for (; len && ((size_t)p & 3); len--) crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+		for (; len >= 8; len -= 8, p += 8)
+		{
+			Bit32u a = crc ^ (p[0] | (p[1] << 8) | (p[2] << 16) | ((Bit32u)p[3] << 24)), b = (p[4] | (p[5] << 8) | (p[6] << 16) | ((Bit32u)p[7] << 24));
+			crc = t[7][a & 0xFF] ^ t[6][(a >> 8) & 0xFF] ^ t[5][(a >> 16) & 0xFF] ^ t[4][a >> 24] ^ t[3][b & 0xFF] ^ t[2][(b >> 8) & 0xFF] ^ t[1][(b >> 16) & 0xFF] ^ t[0][b >> 24];
+		}
+		for (; len; len--) crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+		return crc;
+	}
+
+	#ifdef DBP_CRC32_PCLMUL
+	static bool HavePCLMUL()
+	{
+		#ifdef _MSC_VER
+		int regs[4]; __cpuid(regs, 1); return ((regs[2] & (1 << 1)) != 0);
+		#else
+		unsigned int a, b, c, d; return (__get_cpuid(1, &a, &b, &c, &d) && (c & bit_PCLMUL));
+		#endif
+	}
+
+	// Folding with carry-less multiplication as described in Intel's "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction"
+	static DBP_CRC32_TARGET Bit32u PCLMUL(const Bit8u *p, size_t len, Bit32u crc)
+	{
+		if (len < 64) return Slice8(p, len, crc);
+		static const Bit64u k1k2[2] = { 0x0154442bd4, 0x01c6e41596 }, k3k4[2] = { 0x01751997d0, 0x00ccaa009e }, k5k0[2] = { 0x0163cd6124, 0 }, poly[2] = { 0x01db710641, 0x01f7011641 };
+		__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+		x1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(p + 0x00)), _mm_cvtsi32_si128((int)crc));
+		x2 = _mm_loadu_si128((const __m128i*)(p + 0x10));
+		x3 = _mm_loadu_si128((const __m128i*)(p + 0x20));
+		x4 = _mm_loadu_si128((const __m128i*)(p + 0x30));
+		x0 = _mm_loadu_si128((const __m128i*)k1k2);
+		for (p += 64, len -= 64; len >= 64; p += 64, len -= 64)
+		{
+			x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+			x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+			x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+			x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+			x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, x0, 0x11), x5), _mm_loadu_si128((const __m128i*)(p + 0x00)));
+			x2 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x2, x0, 0x11), x6), _mm_loadu_si128((const __m128i*)(p + 0x10)));
+			x3 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x3, x0, 0x11), x7), _mm_loadu_si128((const __m128i*)(p + 0x20)));
+			x4 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x4, x0, 0x11), x8), _mm_loadu_si128((const __m128i*)(p + 0x30)));
+		}
+
+		// Fold the four lanes into one, then fold any remaining 16 byte blocks
+		x0 = _mm_loadu_si128((const __m128i*)k3k4);
+		x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, x0, 0x11), _mm_clmulepi64_si128(x1, x0, 0x00)), x2);
+		x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, x0, 0x11), _mm_clmulepi64_si128(x1, x0, 0x00)), x3);
+		x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, x0, 0x11), _mm_clmulepi64_si128(x1, x0, 0x00)), x4);
+		for (; len >= 16; p += 16, len -= 16)
+			x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, x0, 0x11), _mm_clmulepi64_si128(x1, x0, 0x00)), _mm_loadu_si128((const __m128i*)p));
+
+		// Fold 128 bits to 64 bits, then Barrett reduce to 32 bits
+		x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+		x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+		x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+		x0 = _mm_loadl_epi64((const __m128i*)k5k0);
+		x2 = _mm_srli_si128(x1, 4);
+		x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, x3), x0, 0x00), x2);
+		x0 = _mm_loadu_si128((const __m128i*)poly);
+		x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, x3), x0, 0x10);
+		x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, x3), x0, 0x00);
+		crc = (Bit32u)_mm_cvtsi128_si32(_mm_srli_si128(_mm_xor_si128(x1, x2), 4));
+		return (len ? Slice8(p, len, crc) : crc);
+	}
+	#endif
+
+	#ifdef DBP_CRC32_ARMV8
+	static bool HaveARMv8CRC()
+	{
+		#if defined(__ARM_FEATURE_CRC32) || defined(__APPLE__)
+		return true;
+		#elif defined(_WIN32)
+		return !!IsProcessorFeaturePresent(PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE);
+		#elif defined(__linux__)
+		return ((getauxval(AT_HWCAP) & (1 << 7)) != 0); // HWCAP_CRC32
+		#else
+		return false;
+		#endif
+	}
+
+	static DBP_CRC32_TARGET Bit32u ARMv8(const Bit8u *p, size_t len, Bit32u crc)
+	{
+		for (; len && ((size_t)p & 7); len--) crc = __crc32b(crc, *p++);
+		for (; len >= 8; len -= 8, p += 8) crc = __crc32d(crc, *(const Bit64u*)p);
+		for (; len; len--) crc = __crc32b(crc, *p++);
+		return crc;
+	}
+	#endif
+
+	#ifdef DBP_CRC32_SELF_TEST
+	static Bit32u Nibble(const Bit8u *ptr, size_t len, Bit32u crcu32)
+	{
+		// Karl Malbrain's compact CRC-32. See "A compact CCITT crc16 and crc32 C implementation that balances processor cache usage against speed": http://www.geocities.com/malbrain/
+		static const Bit32u s_crc32[16] = { 0, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c, 0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c };
+		while (len--) { Bit8u b = *ptr++; crcu32 = (crcu32 >> 4) ^ s_crc32[(crcu32 & 0xF) ^ (b & 0xF)]; crcu32 = (crcu32 >> 4) ^ s_crc32[(crcu32 & 0xF) ^ (b >> 4)]; }
+		return crcu32;
+	}
+
+	void SelfTest()
+	{
+		Func funcs[3] = { Slice8, NULL, NULL }; const char* names[3] = { "Slice8", NULL, NULL };
+		#ifdef DBP_CRC32_PCLMUL
+		if (HavePCLMUL()) { funcs[1] = PCLMUL; names[1] = "PCLMUL"; }
+		#elif defined(DBP_CRC32_ARMV8)
+		if (HaveARMv8CRC()) { funcs[1] = ARMv8; names[1] = "ARMv8"; }
+		#endif
+		extern Bit32u DBP_GetTicks();
+		enum { BUF_SIZE = 1024*1024 };
+		Bit8u* buf = (Bit8u*)malloc(BUF_SIZE);
+		Bit32u seed = 1234; volatile Bit32u sink = 0;
+		for (Bit32u i = 0; i != BUF_SIZE; i++) { seed = seed * 1103515245 + 12345; buf[i] = (Bit8u)(seed >> 16); }
+		for (int f = 0; funcs[f]; f++)
+		{
+			Bit32u errors = 0;
+			for (Bit32u ofs = 0; ofs != 16; ofs++)
+				for (Bit32u len = 0; len != 600; len++)
+					if (funcs[f](buf + ofs, len, ofs * 0x12345678) != Nibble(buf + ofs, len, ofs * 0x12345678)) errors++;
+			if (funcs[f](buf + 3, BUF_SIZE - 3, 0xFFFFFFFF) != Nibble(buf + 3, BUF_SIZE - 3, 0xFFFFFFFF)) errors++;
+			Bit32u t = DBP_GetTicks(), n;
+			for (n = 0; (Bit32s)(DBP_GetTicks() - t) < 200; n++) sink ^= funcs[f](buf, BUF_SIZE, n);
+			LOG_MSG("[CRC32] Self test of %s: %s (%u MB/s)", names[f], (errors ? "FAILED" : "OK"), n * 5);
+			DBP_ASSERT(!errors);
+		}
+		Bit32u t = DBP_GetTicks(), n;
+		for (n = 0; (Bit32s)(DBP_GetTicks() - t) < 200; n++) sink ^= Nibble(buf, BUF_SIZE, n);
+		LOG_MSG("[CRC32] Reference nibble table: %u MB/s", n * 5);
+		free(buf);
+	}
+	#endif
+};
+
 Bit32u DriveCalculateCRC32(const Bit8u *ptr, size_t len, Bit32u crc)
 {
-	// Karl Malbrain's compact CRC-32. See "A compact CCITT crc16 and crc32 C implementation that balances processor cache usage against speed": http://www.geocities.com/malbrain/
-	static const Bit32u s_crc32[16] = { 0, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c, 0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c };
-	Bit32u crcu32 = (Bit32u)~crc;
-	while (len--) { Bit8u b = *ptr++; crcu32 = (crcu32 >> 4) ^ s_crc32[(crcu32 & 0xF) ^ (b & 0xF)]; crcu32 = (crcu32 >> 4) ^ s_crc32[(crcu32 & 0xF) ^ (b >> 4)]; }
-	return ~crcu32;
+	return ~DriveCRC32::Get().func(ptr, len, ~crc);
 }
 
 //DBP: utility function to evaluate an entire drives filesystem
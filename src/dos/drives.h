@@ -184,7 +184,15 @@ public:
 public:
 	Bit8u readSector(Bit32u sectnum, void * data);
 	Bit8u writeSector(Bit32u sectnum, void * data);
-	Bit32u getAbsoluteSectFromBytePos(Bit32u startClustNum, Bit32u bytePos);
+	//DBP: Added cache of the cluster runs of a file to avoid walking the whole FAT chain for every sector
+	struct clusterExtents {
+		struct extent { Bit32u logClust, clust, count; };
+		std::vector<extent> runs;
+		Bit32u startClust, numClusts, deleteGen, allocGen;
+		bool chainEnd;
+		clusterExtents() : startClust(0), numClusts(0), deleteGen(0), allocGen(0), chainEnd(false) {}
+	};
+	Bit32u getAbsoluteSectFromBytePos(Bit32u startClustNum, Bit32u bytePos, clusterExtents* extents = NULL);
 	Bit32u getSectorCount(void);
 	Bit32u getSectorSize(void);
 	Bit32u getClusterSize(void);
@@ -231,8 +239,17 @@ private:
 	Bit32u cwdDirCluster;
 	Bit32u dirPosition; /* Position in directory search */
 
-	Bit8u fatSectBuffer[1024];
-	Bit32u curFatSect;
+	//DBP: Replaced single FAT sector buffer with a small LRU cache (two sectors per entry for FAT12)
+	enum { FAT_CACHE_ENTRIES = 8 };
+	struct {
+		Bit32u sect, lastUse;
+		Bit8u data[1024];
+	} fatCache[FAT_CACHE_ENTRIES];
+	Bit32u fatCacheUse;
+	Bit8u* getFatSectBuffer(Bit32u fatsectnum);
+
+	//DBP: Incremented when cluster chains get shortened or extended to invalidate clusterExtents
+	Bit32u chainDeleteGen, chainAllocGen;
 };
 
 
@@ -714,14 +731,18 @@ template <typename TVal> struct ValueEqualHashMap : public BaseHashMap<TVal>
 struct rawFile : public DOS_File
 {
 	FILE* f;
+	DOS_HostBulk bulk;
 	rawFile(FILE* _f, bool writable) : f(_f) { open = true; if (writable) flags |= OPEN_READWRITE; }
 	~rawFile() { if (f) fclose(f); }
 	virtual bool Close() { if (refCtr == 1) open = false; return true; }
-	virtual bool Read(Bit8u* data, Bit16u* size) { *size = (Bit16u)fread(data, 1, *size, f); return open; }
-	virtual bool Write(Bit8u* data, Bit16u* size) { if (!OPEN_IS_WRITING(flags)) return false; *size = (Bit16u)fwrite(data, 1, *size, f); return (*size && open); }
-	virtual bool Seek(Bit32u* pos, Bit32u type) { fseek(f, (long)*pos, type); *pos = (Bit32u)ftell_wrap(f); return open; }
-	virtual bool Seek64(Bit64u* pos, Bit32u type) { fseek_wrap(f, *pos, type); *pos = (Bit64u)ftell_wrap(f); return open; }
+	virtual bool Read(Bit8u* data, Bit16u* size) { bulk.End(f); *size = (Bit16u)fread(data, 1, *size, f); return open; }
+	virtual bool Write(Bit8u* data, Bit16u* size) { if (!OPEN_IS_WRITING(flags)) return false; bulk.End(f); *size = (Bit16u)fwrite(data, 1, *size, f); return (*size && open); }
+	virtual bool Seek(Bit32u* pos, Bit32u type) { bulk.End(f); fseek(f, (long)*pos, type); *pos = (Bit32u)ftell_wrap(f); return open; }
+	virtual bool Seek64(Bit64u* pos, Bit32u type) { bulk.End(f); fseek_wrap(f, *pos, type); *pos = (Bit64u)ftell_wrap(f); return open; }
+	virtual Bit64u ReadBulk(Bit8u* data, Bit64u len, Bit64u offset) { return bulk.Read(f, data, len, offset); }
+	virtual Bit64u WriteBulk(const Bit8u* data, Bit64u len, Bit64u offset) { if (!OPEN_IS_WRITING(flags)) return 0; return bulk.Write(f, data, len, offset); }
 	virtual Bit16u GetInformation(void) { return (OPEN_IS_WRITING(flags) ? 0x40 : 0); }
+	virtual FILE* GetHostFile() { return f; }
 	static rawFile* TryOpen(const char* path) { FILE* f = fopen_wrap(path, "rb"); return (f ? new rawFile(f, false) : NULL); }
 };
 
@@ -775,7 +796,7 @@ public:
 	virtual bool isRemote(void);
 	virtual bool isRemovable(void);
 	virtual Bits UnMount(void);
-	static void Uncompress(const Bit8u* src, Bit32u src_len, Bit8u* trg, Bit32u trg_len);
+	static bool Uncompress(const Bit8u* src, Bit32u src_len, Bit8u* trg, Bit32u trg_len);
 private:
 	struct zipDriveImpl* impl;
 	INLINE zipDrive() {}
@@ -162,7 +162,7 @@ struct DBP_ShutdownCPU
 static struct DBPArchiveWipe : DBPArchive
 {
 	DBPArchiveWipe() : DBPArchive(MODE_SAVE), start(NULL), end(NULL), ptr(NULL) { }
-	void Grow() { size_t oldp = ptr-start, newsz = (end ? (end-start)*2 : 1024*1024); start = (Bit8u*)realloc(start, newsz); end = start + newsz; ptr = start + oldp; }
+	void Grow() { size_t oldp = ptr-start, newsz = (end ? (end-start)*2 : 64*1024); start = (Bit8u*)realloc(start, newsz); end = start + newsz; ptr = start + oldp; }
 	virtual DBPArchive& SerializeByte(void* p) { if (ptr == end) Grow(); *(ptr++) = *(Bit8u*)p; return *this; }
 	virtual DBPArchive& SerializeBytes(void* p, size_t sz) { while (ptr + sz > end) Grow(); memcpy(ptr, p, sz); ptr += sz; return *this; }
 	virtual size_t GetOffset() { return (ptr - start); }
@@ -170,17 +170,102 @@ static struct DBPArchiveWipe : DBPArchive
 } wipear;
 bool DOSBOX_IsWipingPageFaultQueue;
 
-void DOSBOX_WipePageFaultQueue()
+static Bit32u looprecursion;
+
+//#define DBP_PAGE_FAULT_WIPE_VERIFY // also store a full machine state and compare it against the state after restoring, and run a nested page fault self test
+#ifdef DBP_PAGE_FAULT_WIPE_VERIFY
+static DBPArchiveWipe wipeverify;
+
+// Self test which provokes nested page faults in real mode by pointing the #PF vector at a callback that faults again until the
+// target depth is reached. Mode 0 fixes the fault at the deepest level and unwinds normally, mode 1 wipes the queue at the deepest
+// level and mode 2 nests deeper than the limit at which PageFaultCore wipes the queue on its own.
+static struct DBP_PageFaultWipeTest
 {
-	/* go back to the first recursion of DOSBOX_RunMachine and wipe the page fault queue */
-	if (!DOSBOX_IsWipingPageFaultQueue)
+	enum { FLAG_ADDR = 0x4F0, RUNS = 7 }; // the page present flag is kept in the BIOS inter-application communication area
+	Bitu cb, run, level, calls, passed, failed, old_mpl; Bit32u next_tick, old_flag, old_cr2; RealPt old_vec; bool pending;
+} pfwt = { 0, 0, 0, 0, 0, 0, 0, 3000 };
+static const struct { Bit8u depth, mode; } pfwt_runs[DBP_PageFaultWipeTest::RUNS] = { {1,0}, {4,0}, {16,0}, {1,1}, {4,1}, {16,1}, {52,2} };
+void PAGING_PageFault(PhysPt lin_addr,Bitu page_addr,Bitu faultcode);
+Bitu FillFlags(void);
+void DOSBOX_WipePageFaultQueue();
+
+static Bitu DBP_PageFaultWipeTest_Handler(void)
+{
+	if (!pfwt.level || DOSBOX_IsWipingPageFaultQueue) return CBRET_NONE; // not part of a test or already unwinding
+	pfwt.calls++;
+	if (pfwt.level < pfwt_runs[pfwt.run].depth)
 	{
-		DOSBOX_IsWipingPageFaultQueue = true;
-		wipear.ptr = wipear.start;
-		wipear.flags |= DBPArchive::FLAG_NORESETINPUT;
-		DBPSerialize_All(wipear, true, true);
+		pfwt.level++;
+		PAGING_PageFault(pfwt.level << 12, DBP_PageFaultWipeTest::FLAG_ADDR, 0);
 	}
-	DBP_ShutdownCPU::Shutdown();
+	else if (pfwt_runs[pfwt.run].mode == 0)
+		phys_writed(DBP_PageFaultWipeTest::FLAG_ADDR, 1); // mark present so every level returns
+	else if (pfwt_runs[pfwt.run].mode == 1)
+		DOSBOX_WipePageFaultQueue();
+	// mode 2 leaves the fault unfixed and PageFaultCore starts the wipe after the next instruction
+	return CBRET_NONE;
+}
+
+static void DBP_PageFaultWipeTest_Finish(bool ok)
+{
+	RealSetVec(0x0E, pfwt.old_vec);
+	phys_writed(DBP_PageFaultWipeTest::FLAG_ADDR, pfwt.old_flag);
+	paging.cr2 = pfwt.old_cr2;
+	cpu.mpl = pfwt.old_mpl;
+	(ok ? pfwt.passed : pfwt.failed)++;
+	LOG_MSG("[PFWIPE] Test %u (depth %u, mode %u, %u faults handled): %s", (unsigned)pfwt.run, (unsigned)pfwt_runs[pfwt.run].depth, (unsigned)pfwt_runs[pfwt.run].mode, (unsigned)pfwt.calls, (ok ? "PASS" : "FAIL"));
+	if (++pfwt.run == DBP_PageFaultWipeTest::RUNS)
+		LOG_MSG("[PFWIPE] Nested page fault self test finished: %u passed, %u failed", (unsigned)pfwt.passed, (unsigned)pfwt.failed);
+}
+
+static bool DBP_PageFaultWipeTest_Tick()
+{
+	// Starts a test every 100 ms from the outermost machine loop while in real mode, returns true if a wipe was started
+	if (pfwt.run == DBP_PageFaultWipeTest::RUNS || pfwt.pending || looprecursion != 1 || cpu.pmode || PIC_Ticks < pfwt.next_tick || reg_sp < 0x400) return false;
+	pfwt.next_tick = PIC_Ticks + 100;
+	if (!pfwt.cb)
+	{
+		pfwt.cb = CALLBACK_Allocate();
+		CALLBACK_Setup(pfwt.cb, DBP_PageFaultWipeTest_Handler, CB_IRET, "PF wipe test");
+	}
+	FillFlags();
+	Bit16u old_cs = SegValue(cs), old_ss = SegValue(ss);
+	Bit32u old_eip = reg_eip, old_esp = reg_esp, old_flags = reg_flags;
+	pfwt.old_vec = RealGetVec(0x0E);
+	pfwt.old_flag = phys_readd(DBP_PageFaultWipeTest::FLAG_ADDR);
+	pfwt.old_cr2 = paging.cr2;
+	pfwt.old_mpl = cpu.mpl;
+	RealSetVec(0x0E, CALLBACK_RealPointer(pfwt.cb));
+	phys_writed(DBP_PageFaultWipeTest::FLAG_ADDR, 0);
+	pfwt.calls = 0;
+	pfwt.level = 1;
+	PAGING_PageFault(pfwt.level << 12, DBP_PageFaultWipeTest::FLAG_ADDR, 0);
+	pfwt.level = 0;
+	if (DOSBOX_IsWipingPageFaultQueue)
+	{
+		// The result is checked by DOSBOX_RestorePageFaultWipe, afterwards the guest returns through the iret of each level
+		pfwt.pending = true;
+		return true;
+	}
+	DBP_PageFaultWipeTest_Finish(pfwt_runs[pfwt.run].mode == 0 && pfwt.calls == pfwt_runs[pfwt.run].depth && SegValue(cs) == old_cs && reg_eip == old_eip
+		&& SegValue(ss) == old_ss && reg_esp == old_esp && (reg_flags & FMASK_NORMAL) == (old_flags & FMASK_NORMAL));
+	return false;
+}
+#endif
+
+static void DOSBOX_SerializePageFaultWipe(DBPArchive& ar)
+{
+	// While wiping, memory writes and port access are blocked (see paging.cpp and iohandler.cpp) and Normal_Loop returns right away.
+	// What remains to be reverted is the CPU and FPU state modified by the instructions that finish while leaving the nested core runs.
+	void DBPSerialize_CPU(DBPArchive& ar);
+	void DBPSerialize_FPU(DBPArchive& ar);
+	void DBPSerialize_PagingWipe(DBPArchive& ar);
+	ar.version = DBPArchive::CURRENT_VERSION;
+	ar.flags |= DBPArchive::FLAG_NORESETINPUT;
+	DBPSerialize_CPU(ar);
+	DBPSerialize_FPU(ar);
+	DBPSerialize_PagingWipe(ar);
+	ar.Serialize(PIC_Ticks);
 }
 
 void DOSBOX_ResetCPUDecoder()
@@ -189,14 +274,50 @@ void DOSBOX_ResetCPUDecoder()
 	CPU_ResetCPUDecoder(static_cast<Section_prop *>(control->GetSection("cpu"))->Get_string("core"));
 }
 
+void DOSBOX_WipePageFaultQueue()
+{
+	/* go back to the first recursion of DOSBOX_RunMachine and wipe the page fault queue */
+	if (!DOSBOX_IsWipingPageFaultQueue)
+	{
+		wipear.ptr = wipear.start;
+		DOSBOX_SerializePageFaultWipe(wipear);
+		#ifdef DBP_PAGE_FAULT_WIPE_VERIFY
+		wipeverify.ptr = wipeverify.start;
+		// The restore switches back to the configured decoder (instead of the nested PageFaultCore), do the same for the comparison
+		CPU_Decoder* wipe_decoder = cpudecoder; Bitu wipe_automode = CPU_AutoDetermineMode;
+		DOSBOX_ResetCPUDecoder();
+		DBPSerialize_All(wipeverify, true, true);
+		cpudecoder = wipe_decoder; CPU_AutoDetermineMode = wipe_automode;
+		#endif
+		DOSBOX_IsWipingPageFaultQueue = true;
+		// Drop all direct memory pointers so every access while unwinding goes through the blocking page handlers
+		PAGING_ClearTLB();
+	}
+	DBP_ShutdownCPU::Shutdown();
+}
+
 static void DOSBOX_RestorePageFaultWipe()
 {
 	DBPArchiveReader arr(wipear.start, wipear.ptr - wipear.start);
-	arr.flags |= DBPArchive::FLAG_NORESETINPUT;
-	DBPSerialize_All(arr, true, true);
+	DOSBOX_SerializePageFaultWipe(arr);
+	DBP_ASSERT(!arr.had_error);
 	DOSBOX_IsWipingPageFaultQueue = false;
 	DOSBOX_ResetCPUDecoder();
 	DOSBOX_SetNormalLoop();
+	#ifdef DBP_PAGE_FAULT_WIPE_VERIFY
+	DBPArchiveWipe check;
+	DBPSerialize_All(check, true, true);
+	size_t diffs = 0, first = 0, len = (check.ptr - check.start);
+	if (len != (size_t)(wipeverify.ptr - wipeverify.start)) LOG_MSG("[PFWIPE] State size mismatch %u vs %u", (unsigned)len, (unsigned)(wipeverify.ptr - wipeverify.start));
+	else for (size_t i = 0; i != len; i++) if (check.start[i] != wipeverify.start[i] && !diffs++) first = i;
+	LOG_MSG("[PFWIPE] Restored with %u different bytes (first at %u) compared to a full state", (unsigned)diffs, (unsigned)first);
+	free(check.start);
+	if (pfwt.pending)
+	{
+		pfwt.pending = false;
+		DBP_PageFaultWipeTest_Finish(pfwt_runs[pfwt.run].mode != 0 && pfwt.calls == pfwt_runs[pfwt.run].depth && !diffs && len == (size_t)(wipeverify.ptr - wipeverify.start));
+	}
+	#endif
 }
 
 static void DBP_FreePageFaultWipe()
@@ -204,6 +325,10 @@ static void DBP_FreePageFaultWipe()
 	if (!wipear.start) return;
 	free(wipear.start);
 	wipear.start = wipear.end = wipear.ptr = NULL;
+	#ifdef DBP_PAGE_FAULT_WIPE_VERIFY
+	free(wipeverify.start);
+	wipeverify.start = wipeverify.end = wipeverify.ptr = NULL;
+	#endif
 }
 #endif
 
@@ -211,19 +336,31 @@ static Bitu Normal_Loop(void) {
 	Bits ret;
 	while (1) {
 		if (PIC_RunQueue()) {
+			//DBP: Cycles consumed by the decoder minus the ones skipped while halted or waiting for I/O, this also covers nested runs
+			Bit64s executed_mark = CPU_CyclesExecuted + CPU_Cycles + CPU_CycleLeft + CPU_IODelayRemoved;
 			ret = (*cpudecoder)();
+			CPU_CyclesExecuted = executed_mark - CPU_Cycles - CPU_CycleLeft - CPU_IODelayRemoved;
 			if (GCC_UNLIKELY(ret<0)) return 1;
+#ifdef C_DBP_PAGE_FAULT_QUEUE_WIPE
+			if (GCC_UNLIKELY(DOSBOX_IsWipingPageFaultQueue)) return 1; // leave without running callbacks or timer ticks
+#endif
 			if (ret>0) {
 				if (GCC_UNLIKELY(ret >= CB_MAX)) return 0;
 				paging_prevent_exception_jump = true;
 				Bitu blah = (*CallBack_Handlers[ret])();
 				paging_prevent_exception_jump = false;
 				if (GCC_UNLIKELY(blah)) return blah;
+#ifdef C_DBP_PAGE_FAULT_QUEUE_WIPE
+				if (GCC_UNLIKELY(DOSBOX_IsWipingPageFaultQueue)) return 1; // a page fault inside the callback started a wipe
+#endif
 			}
 #if C_DEBUG
 			if (DEBUG_ExitLoop()) return 0;
 #endif
 		} else {
+#ifdef DBP_PAGE_FAULT_WIPE_VERIFY
+			if (DBP_PageFaultWipeTest_Tick()) return 1;
+#endif
 #ifdef C_DBP_CUSTOMTIMING
 			static bool doTick;
 			if (doTick) {doTick=false;TIMER_AddTick();}
@@ -415,7 +552,6 @@ std::jmp_buf pagefault_jmp_buf;
 void DOSBOX_RunMachine(void){
 #ifdef C_DBP_PAGE_FAULT_QUEUE_WIPE
 	restartloop:
-	static Bit32u looprecursion;
 	looprecursion++;
 #endif
 
@@ -704,6 +840,7 @@ void DOSBOX_Init(void) {
 	secprop->Add_int("voodoo_perf",Property::Changeable::Always,1);
 	secprop->Add_int("voodoo_gamma",Property::Changeable::Always,1);
 	secprop->Add_int("voodoo_scale",Property::Changeable::Always,1);
+	secprop->Add_bool("voodoo_lograsterizers",Property::Changeable::Always,false);
 #endif
 #endif
 
@@ -728,6 +865,11 @@ void DOSBOX_Init(void) {
 
 #ifdef C_DBP_LIBRETRO
 	secprop->Add_bool("swapstereo",Property::Changeable::WhenIdle,false);
+
+	const char* cdaudio_resamplers[] = { "linear", "low", "medium", "high", 0 };
+	Pstring = secprop->Add_string("cdaudio_resampler",Property::Changeable::WhenIdle,"medium");
+	Pstring->Set_values(cdaudio_resamplers);
+	Pstring->Set_help("Quality of the conversion of CD audio to the mixer rate, linear leaves it to the mixer.");
 #endif
 
 	secprop=control->AddSection_prop("midi",&MIDI_Init,true);//done
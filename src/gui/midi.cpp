@@ -107,6 +107,185 @@ MidiHandler Midi_none;
 #endif
 #endif /* C_DBP_NATIVE_MIDI */
 
+//DBP: Software synthesizers render on a worker thread which receives MIDI messages and render requests in order through a lock-free queue.
+//     The resulting audio is identical to rendering synchronously in the mixer callback, just delayed by a fixed latency.
+//     Rendering falls back to being synchronous on single core systems or when requested (used for run-ahead and rollback netplay).
+//     When switching modes no audio is dropped or inserted, the worker output still queued gets played first after switching to
+//     synchronous rendering, and the latency gets filled by rendering ahead when switching to the worker thread.
+static volatile bool midi_synth_sync;
+
+void MIDI_SetSynchronousRender(bool sync)
+{
+	midi_synth_sync = sync;
+}
+
+#if defined(C_DBP_SUPPORT_MIDI_TSF) || defined(C_DBP_SUPPORT_MIDI_MT32)
+#include "dbp_threads.h"
+#include <atomic>
+
+struct MidiSynthThread
+{
+	typedef void (*MsgFunc)(void* synth, Bit8u* msg);
+	typedef void (*SysexFunc)(void* synth, Bit8u* sysex, Bitu len);
+	typedef void (*RenderFunc)(void* synth, Bit16s* out, Bitu frames);
+	enum { CMD_SIZE = 64*1024, OUT_FRAMES = 8*1024, LATENCY_MS = 20 };
+	enum ECmd : Bit8u { CMD_MSG, CMD_SYSEX, CMD_RENDER, CMD_STOP };
+
+	void* synth;
+	MsgFunc msg_func;
+	SysexFunc sysex_func;
+	RenderFunc render_func;
+	std::atomic<Bit32u> cmd_write, cmd_read, out_write;
+	std::atomic<bool> sleeping, running;
+	Bit32u out_read;
+	bool draining; // worker stopped, remaining output gets played by RenderSync
+	Semaphore sem;
+	Bit8u cmd[CMD_SIZE];
+	Bit16s out[OUT_FRAMES * 2];
+
+	// Switches between threaded and synchronous rendering as needed, returns true if threaded
+	static bool Update(MidiSynthThread*& thread, void* synth, MsgFunc msg_func, SysexFunc sysex_func, RenderFunc render_func, Bit32u rate)
+	{
+		static Bit32u cores;
+		if (!cores) { extern unsigned dbp_cpu_features_get_core_amount(void); cores = dbp_cpu_features_get_core_amount(); }
+		bool want = (!midi_synth_sync && cores > 1);
+		if (want && (!thread || thread->draining)) { MidiSynthThread* old = thread; thread = new MidiSynthThread(synth, msg_func, sysex_func, render_func, rate, old); delete old; }
+		else if (!want && thread && !thread->draining) thread->Stop();
+		return want;
+	}
+
+	// Renders synchronously, playing what is left over from the stopped worker first
+	static void RenderSync(MidiSynthThread*& thread, void* synth, RenderFunc render_func, Bit16s* res, Bitu frames)
+	{
+		Bit32u n = 0;
+		if (thread)
+		{
+			DBP_ASSERT(thread->draining);
+			n = thread->Drain(res, (Bit32u)frames);
+			if (thread->out_read == thread->out_write) { delete thread; thread = NULL; }
+		}
+		if (frames > n) render_func(synth, res + n * 2, frames - n);
+	}
+
+	MidiSynthThread(void* _synth, MsgFunc _msg_func, SysexFunc _sysex_func, RenderFunc _render_func, Bit32u rate, MidiSynthThread* drain)
+		: synth(_synth), msg_func(_msg_func), sysex_func(_sysex_func), render_func(_render_func), cmd_write(0), cmd_read(0), out_write(rate * LATENCY_MS / 1000), sleeping(false), running(true), out_read(0), draining(false)
+	{
+		// Fill the latency with the output of a previous worker and render the rest ahead so there is no gap in the audio
+		Bit32u latency = out_write, have = (drain ? drain->Drain(out, latency) : 0);
+		DBP_ASSERT(latency < OUT_FRAMES / 2);
+		if (latency > have) render_func(synth, out + have * 2, latency - have);
+		Thread::StartDetached(ThreadFunc, this);
+	}
+
+	~MidiSynthThread()
+	{
+		if (!draining) Stop();
+	}
+
+	void Stop()
+	{
+		Push(CMD_STOP, NULL, 0);
+		while (running) retro_sleep(0);
+		draining = true;
+	}
+
+	void PlayMsg(Bit8u* msg)
+	{
+		Bit8u m[4] = { msg[0], 0, 0, 0 }, len = MIDI_evt_len[msg[0]];
+		if (len > 1) memcpy(m + 1, msg + 1, len - 1);
+		Push(CMD_MSG, m, 4);
+	}
+	void PlaySysex(Bit8u* sysex, Bitu len) { Push(CMD_SYSEX, sysex, (Bit16u)len); }
+
+	void Render(Bit16s* res, Bitu frames)
+	{
+		Bit32u n = (Bit32u)frames;
+		Push(CMD_RENDER, (Bit8u*)&n, sizeof(n));
+		while (out_write.load(std::memory_order_acquire) - out_read < n) retro_sleep(0);
+		Drain(res, n);
+	}
+
+	// Copies up to n frames of available output, returns the number of frames copied
+	Bit32u Drain(Bit16s* res, Bit32u n)
+	{
+		Bit32u avail = out_write.load(std::memory_order_acquire) - out_read;
+		if (n > avail) n = avail;
+		for (Bit32u i = out_read % OUT_FRAMES, step, left = n; left; left -= step, res += step * 2, out_read += step, i = 0)
+		{
+			step = (left < OUT_FRAMES - i ? left : OUT_FRAMES - i);
+			memcpy(res, out + i * 2, step * 4);
+		}
+		return n;
+	}
+
+private:
+	void Push(ECmd type, const Bit8u* data, Bit16u len)
+	{
+		DBP_ASSERT(len <= SYSEX_SIZE);
+		Bit32u w = cmd_write.load(std::memory_order_relaxed), need = 3 + len;
+		while (CMD_SIZE - (w - cmd_read.load(std::memory_order_acquire)) < need) retro_sleep(0); // queue full, wait for worker
+		Bit8u hdr[3] = { (Bit8u)type, (Bit8u)len, (Bit8u)(len >> 8) };
+		CopyIn(w, hdr, 3);
+		CopyIn(w + 3, data, len);
+		cmd_write.store(w + need, std::memory_order_release);
+		if (sleeping.exchange(false)) sem.Post();
+	}
+
+	void CopyIn(Bit32u pos, const Bit8u* data, Bit32u len)
+	{
+		for (Bit32u i = pos % CMD_SIZE, step; len; len -= step, data += step, i = 0)
+			{ step = (len < CMD_SIZE - i ? len : CMD_SIZE - i); memcpy(cmd + i, data, step); }
+	}
+
+	void CopyOut(Bit32u pos, Bit8u* data, Bit32u len)
+	{
+		for (Bit32u i = pos % CMD_SIZE, step; len; len -= step, data += step, i = 0)
+			{ step = (len < CMD_SIZE - i ? len : CMD_SIZE - i); memcpy(data, cmd + i, step); }
+	}
+
+	static Thread::RET_t THREAD_CC ThreadFunc(void* p)
+	{
+		MidiSynthThread& t = *(MidiSynthThread*)p;
+		Bit8u buf[SYSEX_SIZE];
+		for (Bit32u r = t.cmd_read.load(std::memory_order_relaxed);;)
+		{
+			if (r == t.cmd_write.load(std::memory_order_acquire))
+			{
+				t.sleeping = true;
+				if (r == t.cmd_write.load(std::memory_order_acquire) || !t.sleeping.exchange(false)) t.sem.Wait();
+				continue;
+			}
+			Bit8u hdr[3];
+			t.CopyOut(r, hdr, 3);
+			Bit16u len = (Bit16u)(hdr[1] | (hdr[2] << 8));
+			t.CopyOut(r + 3, buf, len);
+			t.cmd_read.store((r += 3 + len), std::memory_order_release);
+			switch (hdr[0])
+			{
+				case CMD_MSG: t.msg_func(t.synth, buf); break;
+				case CMD_SYSEX: t.sysex_func(t.synth, buf, len); break;
+				case CMD_RENDER:
+				{
+					Bit32u n, w = t.out_write.load(std::memory_order_relaxed), step;
+					memcpy(&n, buf, sizeof(n));
+					for (; n; n -= step)
+					{
+						Bit32u i = w % OUT_FRAMES;
+						step = (n < OUT_FRAMES - i ? n : OUT_FRAMES - i);
+						t.render_func(t.synth, t.out + i * 2, step);
+						t.out_write.store((w += step), std::memory_order_release);
+					}
+					break;
+				}
+				case CMD_STOP:
+					t.running = false;
+					return 0;
+			}
+		}
+	}
+};
+#endif
+
 #ifdef C_DBP_SUPPORT_MIDI_TSF
 #include "midi_tsf.h"
 #endif
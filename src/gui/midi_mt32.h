@@ -29,13 +29,14 @@ static void MIDI_MT32_CallBack(Bitu len);
 
 struct MidiHandler_mt32 : public MidiHandler
 {
-	MidiHandler_mt32() : MidiHandler(), chan(NULL), mo(NULL), f_control(NULL), f_pcm(NULL), d_zip(NULL), syn(NULL) {}
-	MixerChannel*   chan;
-	MixerObject*    mo;
-	DOS_File*       f_control;
-	DOS_File*       f_pcm;
-	DOS_Drive*      d_zip;
-	MT32Emu::Synth* syn;
+	MidiHandler_mt32() : MidiHandler(), chan(NULL), mo(NULL), f_control(NULL), f_pcm(NULL), d_zip(NULL), syn(NULL), thread(NULL) {}
+	MixerChannel*    chan;
+	MixerObject*     mo;
+	DOS_File*        f_control;
+	DOS_File*        f_pcm;
+	DOS_Drive*       d_zip;
+	MT32Emu::Synth*  syn;
+	MidiSynthThread* thread;
 
 	const char * GetName(void) { return "mt32"; };
 
@@ -44,11 +45,9 @@ struct MidiHandler_mt32 : public MidiHandler
 		RomFile(DOS_File*& f) : data(NULL), size(0)
 		{
 			if (!f) return;
-			Bit32u begin = 0;
 			f->Seek(&size, SEEK_END);
-			f->Seek(&begin, SEEK_SET);
 			data = new Bit8u[size];
-			for (Bit32u sz = size, p = 0; sz;) { Bit16u read = (Bit16u)(sz > 0xFFFF ? 0xFFFF : sz); if (!f->Read(data+p, &read)) break; sz -= read; p += read; }
+			if (size) f->ReadBulk(data, size, 0);
 			f->Close();
 			delete f;
 			f = NULL;
@@ -208,6 +207,7 @@ struct MidiHandler_mt32 : public MidiHandler
 
 	void Close(void)
 	{
+		if (thread)    { delete thread;                        thread    = NULL; }
 		if (f_control) { f_control->Close(); delete f_control; f_control = NULL; }
 		if (f_pcm)     { f_pcm->Close(); delete f_pcm;         f_pcm     = NULL; }
 		if (d_zip)     { delete d_zip;                         d_zip     = NULL; }
@@ -245,14 +245,31 @@ struct MidiHandler_mt32 : public MidiHandler
 	void PlayMsg(Bit8u * msg)
 	{
 		if (!syn && (!f_control || !LoadSynth())) return;
-		Bit32u msg32 = ((Bit32u)(msg[0]) | ((Bit32u)(msg[1]) << 8U) | ((Bit32u)(msg[2]) << 16U) | ((Bit32u)(msg[3]) << 24U));
-		syn->playMsg(msg32);
+		if (thread && !thread->draining) thread->PlayMsg(msg);
+		else SynthMsg(this, msg);
 	};
 
 	void PlaySysex(Bit8u * sysex,Bitu len)
 	{
 		if (!syn && (!f_control || !LoadSynth())) return;
-		syn->playSysex(sysex, (Bit32u)len);
+		if (thread && !thread->draining) thread->PlaySysex(sysex, len);
+		else SynthSysex(this, sysex, len);
+	}
+
+	static void SynthMsg(void* self, Bit8u * msg)
+	{
+		Bit32u msg32 = ((Bit32u)(msg[0]) | ((Bit32u)(msg[1]) << 8U) | ((Bit32u)(msg[2]) << 16U) | ((Bit32u)(msg[3]) << 24U));
+		((MidiHandler_mt32*)self)->syn->playMsg(msg32);
+	}
+
+	static void SynthSysex(void* self, Bit8u * sysex, Bitu len)
+	{
+		((MidiHandler_mt32*)self)->syn->playSysex(sysex, (Bit32u)len);
+	}
+
+	static void SynthRender(void* self, Bit16s* out, Bitu frames)
+	{
+		((MidiHandler_mt32*)self)->syn->render(out, (Bit32u)frames);
 	}
 };
 
@@ -262,6 +279,9 @@ static void MIDI_MT32_CallBack(Bitu len)
 {
 	DBP_ASSERT(len <= (MIXER_BUFSIZE/4));
 	if (len > (MIXER_BUFSIZE/4)) len = (MIXER_BUFSIZE/4);
-	Midi_mt32.syn->render((Bit16s*)MixTemp, (Bit32u)len);
+	if (MidiSynthThread::Update(Midi_mt32.thread, &Midi_mt32, MidiHandler_mt32::SynthMsg, MidiHandler_mt32::SynthSysex, MidiHandler_mt32::SynthRender, MT32Emu::SAMPLE_RATE))
+		Midi_mt32.thread->Render((Bit16s*)MixTemp, len);
+	else
+		MidiSynthThread::RenderSync(Midi_mt32.thread, &Midi_mt32, MidiHandler_mt32::SynthRender, (Bit16s*)MixTemp, len);
 	Midi_mt32.chan->AddSamples_s16(len, (Bit16s*)MixTemp);
 }
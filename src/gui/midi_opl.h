@@ -1848,7 +1848,7 @@ struct MidiHandler_adlib : public MidiHandler
 			_shadowRegisters[reg] = value;
 			_opl->PortWrite(0x388, reg, 0);
 			//_opl->PortWrite(0x389, value, 0);
-			_opl->handler->WriteReg(reg, value);
+			_opl->ChipWrite(reg, value);
 		}
 	}
 };
@@ -31,12 +31,13 @@ static void MIDI_TSF_CallBack(Bitu len);
 
 struct MidiHandler_tsf : public MidiHandler
 {
-	MidiHandler_tsf() : MidiHandler(), chan(NULL), mo(NULL), f(NULL), sf(NULL) {}
-	MixerChannel* chan;
-	MixerObject*  mo;
-	DOS_File*     f;
-	DOS_Drive*    d_zip;
-	tsf*          sf;
+	MidiHandler_tsf() : MidiHandler(), chan(NULL), mo(NULL), f(NULL), sf(NULL), thread(NULL) {}
+	MixerChannel*    chan;
+	MixerObject*     mo;
+	DOS_File*        f;
+	DOS_Drive*       d_zip;
+	tsf*             sf;
+	MidiSynthThread* thread;
 
 	const char * GetName(void) { return "tsf"; };
 
@@ -80,6 +81,7 @@ struct MidiHandler_tsf : public MidiHandler
 
 	void Close(void)
 	{
+		if (thread) { delete thread;       thread = NULL; }
 		if (f)      { f->Close();delete f; f      = NULL; }
 		if (d_zip)  { delete d_zip;        d_zip  = NULL; }
 		if (sf)     { tsf_close(sf);       sf     = NULL; }
@@ -118,7 +120,13 @@ struct MidiHandler_tsf : public MidiHandler
 	void PlayMsg(Bit8u * msg)
 	{
 		if (!sf && (!f || !LoadFont())) return;
+		if (thread && !thread->draining) thread->PlayMsg(msg);
+		else SynthMsg(this, msg);
+	};
 
+	static void SynthMsg(void* self, Bit8u * msg)
+	{
+		tsf* sf = ((MidiHandler_tsf*)self)->sf;
 		Bit8u channel = (msg[0] & 0x0f);
 //		if (channel == 2 || channel == 3 || channel == 4)
 		switch (msg[0] & 0xf0)
@@ -142,7 +150,14 @@ struct MidiHandler_tsf : public MidiHandler
 				tsf_channel_midi_control(sf, channel, msg[1], msg[2]);
 				break;
 		}
-	};
+	}
+
+	static void SynthSysex(void* self, Bit8u * sysex, Bitu len) { }
+
+	static void SynthRender(void* self, Bit16s* out, Bitu frames)
+	{
+		tsf_render_short(((MidiHandler_tsf*)self)->sf, out, (int)frames, 0);
+	}
 
 	void PlaySysex(Bit8u * sysex,Bitu len)
 	{
@@ -164,7 +179,11 @@ static void MIDI_TSF_CallBack(Bitu len)
 {
 	DBP_ASSERT(len <= (MIXER_BUFSIZE/4));
 	if (len > (MIXER_BUFSIZE/4)) len = (MIXER_BUFSIZE/4);
-	tsf_render_short(Midi_tsf.sf, (Bit16s*)MixTemp, (int)len, 0);
+	extern Bit32u DBP_MIXER_GetFrequency();
+	if (MidiSynthThread::Update(Midi_tsf.thread, &Midi_tsf, MidiHandler_tsf::SynthMsg, MidiHandler_tsf::SynthSysex, MidiHandler_tsf::SynthRender, DBP_MIXER_GetFrequency()))
+		Midi_tsf.thread->Render((Bit16s*)MixTemp, len);
+	else
+		MidiSynthThread::RenderSync(Midi_tsf.thread, &Midi_tsf, MidiHandler_tsf::SynthRender, (Bit16s*)MixTemp, len);
 	Midi_tsf.chan->AddSamples_s16(len, (Bit16s*)MixTemp);
 }
 
@@ -149,6 +149,28 @@ static void RENDER_ClearCacheHandler(const void * src) {
 		cacheLine[x] = ~srcLine[x];
 	render.scale.lineHandler( src );
 }
+#else
+//DBP: Without the scaler cache every line still gets drawn, but the source lines are compared against a copy of the
+// last frame to pass the changed lines to GFX_EndUpdate (alternating unchanged/changed counts like the scaler cache)
+static struct { Bit8u* cache; Bitu cacheSize, pitch, line; bool valid, full; } render_track;
+
+static void RENDER_TrackLineHandler(const void * s) {
+	Bit8u *outWrite = render.scale.outWrite, *cache = render_track.cache + render_track.pitch * render_track.line;
+	Bitu changed = 1;
+	if (render_track.line++ >= render.src.height || !s)
+		render_track.valid = false;
+	else if (render_track.full || memcmp(cache, s, render_track.pitch))
+		memcpy(cache, s, render_track.pitch);
+	else
+		changed = 0;
+	render.scale.lineHandler( s );
+	Bitu count = (Bitu)(render.scale.outWrite - outWrite) / render.scale.outPitch;
+	if ((Scaler_ChangedLineIndex & 1) == changed) {
+		Scaler_ChangedLines[Scaler_ChangedLineIndex] += count;
+	} else if (Scaler_ChangedLineIndex < SCALER_MAXHEIGHT) {
+		Scaler_ChangedLines[++Scaler_ChangedLineIndex] = count;
+	}
+}
 #endif
 
 bool RENDER_StartUpdate(void) {
@@ -174,7 +196,12 @@ bool RENDER_StartUpdate(void) {
 #ifndef C_DBP_ENABLE_SCALERCACHE
 	if (GCC_UNLIKELY(!GFX_StartUpdate( render.scale.outWrite, render.scale.outPitch )))
 		return false;
-	RENDER_DrawLine = render.scale.lineHandler;
+	Scaler_ChangedLines[0] = 0;
+	Scaler_ChangedLineIndex = 0;
+	render_track.line = 0;
+	render_track.full = (!render_track.valid || render.pal.changed);
+	render_track.valid = true;
+	RENDER_DrawLine = RENDER_TrackLineHandler;
 #else
 	Scaler_ChangedLines[0] = 0;
 	Scaler_ChangedLineIndex = 0;
@@ -248,7 +275,9 @@ void RENDER_EndUpdate( bool abort ) {
 #endif
 	if ( render.scale.outWrite ) {
 #ifndef C_DBP_ENABLE_SCALERCACHE
-		GFX_EndUpdate( abort? NULL : (const Bit16u*)(size_t)1 );
+		// Lines not passed through RENDER_DrawLine (i.e. voodoo) or an aborted frame leave the line cache incomplete
+		if (abort || render_track.line != render.src.height) render_track.valid = false;
+		GFX_EndUpdate( abort? NULL : (render_track.line == render.src.height ? Scaler_ChangedLines : (const Bit16u*)(size_t)1) );
 #else
 		GFX_EndUpdate( abort? NULL : Scaler_ChangedLines );
 #endif
@@ -569,6 +598,11 @@ forcenormal:
 #ifdef C_DBP_ENABLE_SCALERCACHE
 	/* Signal the next frame to first reinit the cache */
 	render.scale.clearCache = true;
+#else
+	render_track.pitch = render.src.width * ((render.src.bpp + 7) / 8);
+	if (render_track.cacheSize < render_track.pitch * render.src.height)
+		render_track.cache = (Bit8u*)realloc(render_track.cache, (render_track.cacheSize = render_track.pitch * render.src.height));
+	render_track.valid = false;
 #endif
 	render.active=true;
 }
@@ -830,6 +864,11 @@ void DBPSerialize_Render(DBPArchive& ar)
 	if (ar.version < 5) { Bitu old; ar.Serialize(old); }
 	ar.Serialize(render_offset);
 	if (ar.version >= 2 && ar.version < 5) { Bit32u old; ar.Serialize(old); }
+	if (ar.mode == DBPArchive::MODE_LOAD)
+	{
+		render_track.valid = false;
+		render_track.full = true;
+	}
 #else
 	ar.Serialize(Scaler_ChangedLineIndex)
 	ar.Serialize(render_offset);
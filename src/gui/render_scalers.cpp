@@ -26,10 +26,8 @@
 #include <string.h>
 
 Bit8u Scaler_Aspect[SCALER_MAXHEIGHT];
-#ifdef C_DBP_ENABLE_SCALERCACHE
-Bit16u Scaler_ChangedLines[SCALER_MAXHEIGHT];
+Bit16u Scaler_ChangedLines[SCALER_MAXHEIGHT + 2]; //DBP: Also filled by RENDER_TrackLineHandler without the scaler cache
 Bitu Scaler_ChangedLineIndex;
-#endif
 
 #ifdef C_DBP_ENABLE_SCALERS
 static union {
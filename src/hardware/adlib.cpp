@@ -28,6 +28,9 @@
 #include "mem.h"
 #include "dbopl.h"
 #include "cpu.h"
+#include "dbp_threads.h"
+#include <atomic>
+#include <vector>
 
 #ifdef C_DBP_ENABLE_NUKEDOPL3
 #include "nukedopl3.h"
@@ -52,14 +55,11 @@ namespace OPL2 {
 			return val;
 		}
 
-		virtual void Generate( MixerChannel* chan, Bitu samples ) {
-			Bit16s buf[1024];
-			while( samples > 0 ) {
-				Bitu todo = samples > 1024 ? 1024 : samples;
-				samples -= todo;
-				adlib_getsample(buf, todo);
-				chan->AddSamples_m16( todo, buf );
-			}
+		virtual void Generate( Bit32s* out, Bitu samples ) {
+			Bit16s buf[MAX_SAMPLES];
+			adlib_getsample(buf, samples);
+			for (Bitu i = 0; i < samples; i++)
+				out[i*2] = out[i*2+1] = buf[i];
 		}
 		virtual void Init( Bitu rate ) {
 			adlib_init(rate);
@@ -81,14 +81,11 @@ namespace OPL3 {
 			adlib_write_index(port, val);
 			return opl_index;
 		}
-		virtual void Generate( MixerChannel* chan, Bitu samples ) {
-			Bit16s buf[1024*2];
-			while( samples > 0 ) {
-				Bitu todo = samples > 1024 ? 1024 : samples;
-				samples -= todo;
-				adlib_getsample(buf, todo);
-				chan->AddSamples_s16( todo, buf );
-			}
+		virtual void Generate( Bit32s* out, Bitu samples ) {
+			Bit16s buf[MAX_SAMPLES*2];
+			adlib_getsample(buf, samples);
+			for (Bitu i = 0; i < samples*2; i++)
+				out[i] = buf[i];
 		}
 		virtual void Init( Bitu rate ) {
 			adlib_init(rate);
@@ -110,14 +107,11 @@ struct Handler : public Adlib::Handler {
 	virtual Bit32u WriteAddr(Bit32u /*port*/, Bit8u val) {
 		return val;
 	}
-	virtual void Generate(MixerChannel* chan, Bitu samples) {
-		Bit16s buf[1024 * 2];
-		while (samples > 0) {
-			Bitu todo = samples > 1024 ? 1024 : samples;
-			samples -= todo;
-			ym3812_update_one(chip, buf, todo);
-			chan->AddSamples_m16(todo, buf);
-		}
+	virtual void Generate(Bit32s* out, Bitu samples) {
+		Bit16s buf[MAX_SAMPLES];
+		ym3812_update_one(chip, buf, samples);
+		for (Bitu i = 0; i < samples; i++)
+			out[i*2] = out[i*2+1] = buf[i];
 	}
 	virtual void Init(Bitu rate) {
 		chip = ym3812_init(0, OPL2_INTERNAL_FREQ, rate);
@@ -142,22 +136,15 @@ struct Handler : public Adlib::Handler {
 	virtual Bit32u WriteAddr(Bit32u /*port*/, Bit8u val) {
 		return val;
 	}
-	virtual void Generate(MixerChannel* chan, Bitu samples) {
+	virtual void Generate(Bit32s* out, Bitu samples) {
 		//We generate data for 4 channels, but only the first 2 are connected on a pc
-		Bit16s buf[4][1024];
-		Bit16s result[1024][2];
+		Bit16s buf[4][MAX_SAMPLES];
 		Bit16s* buffers[4] = { buf[0], buf[1], buf[2], buf[3] };
-
-		while (samples > 0) {
-			Bitu todo = samples > 1024 ? 1024 : samples;
-			samples -= todo;
-			ymf262_update_one(chip, buffers, todo);
-			//Interleave the samples before mixing
-			for (Bitu i = 0; i < todo; i++) {
-				result[i][0] = buf[0][i];
-				result[i][1] = buf[1][i];
-			}
-			chan->AddSamples_s16(todo, result[0]);
+		ymf262_update_one(chip, buffers, samples);
+		//Interleave the samples before mixing
+		for (Bitu i = 0; i < samples; i++) {
+			out[i*2+0] = buf[0][i];
+			out[i*2+1] = buf[1][i];
 		}
 	}
 	virtual void Init(Bitu rate) {
@@ -445,6 +432,191 @@ skipWrite:
 };
 #endif
 
+/*
+Renderer
+*/
+
+//DBP: Register writes are logged with their sample position inside the current mixer tick and replayed between blocks of
+//     rendered samples in the mixer callback, which makes them sample accurate. On systems with more than one core the chip
+//     renders on a worker thread which receives the same writes and blocks in order through a lock-free queue. Its output
+//     is identical to rendering synchronously, just delayed by a fixed latency of about one frame. Rendering is synchronous
+//     on single core systems or when requested (used for run-ahead and rollback netplay). Switching modes neither drops nor
+//     inserts samples, queued worker output is played first when going synchronous and the latency is rendered ahead otherwise.
+//#define DBP_OPL_RENDER_SELF_TEST
+static volatile bool opl_render_sync;
+
+struct RenderThread {
+	enum : Bit32u { CMD_SIZE = 16*1024, OUT_FRAMES = 8*1024, LATENCY_MS = 20, CMD_RENDER = 0x80000000, CMD_STOP = 0x40000000 };
+
+	Handler* handler;
+	std::atomic<Bit32u> cmd_write, cmd_read, out_write;
+	std::atomic<bool> sleeping, running;
+	Bit32u cmd_pushed, out_read;
+	bool draining; //worker stopped, the remaining output gets played by the synchronous renderer
+	Semaphore sem;
+	Bit32u cmd[CMD_SIZE];
+	Bit32s out[OUT_FRAMES * 2];
+
+	//Fills the latency with the output of a previous worker and renders the rest ahead so there is no gap in the audio
+	//Before anything was played the latency is filled with silence instead, which keeps the output identical to synchronous
+	RenderThread(Handler* _handler, Bit32u rate, RenderThread* drain, bool render_ahead)
+		: handler(_handler), cmd_write(0), cmd_read(0), out_write(rate * LATENCY_MS / 1000), sleeping(false), running(true), cmd_pushed(0), out_read(0), draining(false) {
+		DBP_ASSERT(out_write + MIXER_BUFSIZE / 4 < OUT_FRAMES);
+		Bit32u latency = out_write, have = (drain ? drain->Drain(out, latency) : 0);
+		if (!render_ahead) memset(out + have * 2, 0, (latency - have) * sizeof(Bit32s) * 2);
+		else for (Bit32u step; have != latency; have += step) {
+			step = (latency - have < Handler::MAX_SAMPLES ? latency - have : Handler::MAX_SAMPLES);
+			handler->Generate(out + have * 2, step);
+		}
+		Thread::StartDetached(ThreadFunc, this);
+	}
+
+	~RenderThread() {
+		if (!draining) Stop();
+	}
+
+	void Stop() {
+		Push(CMD_STOP);
+		Commit();
+		while (running) retro_sleep(0);
+		draining = true;
+	}
+
+	//Queue a register write (reg << 8 | val) or a render command, the worker only sees them after Commit
+	void Push(Bit32u c) {
+		if (cmd_pushed - cmd_read.load(std::memory_order_acquire) == CMD_SIZE) {
+			Commit();
+			while (cmd_pushed - cmd_read.load(std::memory_order_acquire) == CMD_SIZE) retro_sleep(0); // queue full, wait for worker
+		}
+		cmd[cmd_pushed++ % CMD_SIZE] = c;
+	}
+
+	void Commit() {
+		cmd_write.store(cmd_pushed, std::memory_order_release);
+		if (sleeping.exchange(false)) sem.Post();
+	}
+
+	//Fetch the next rendered samples, only waits for the worker if it fell behind by more than the latency
+	void Read(Bit32s* res, Bitu frames) {
+		Bit32u n = (Bit32u)frames;
+		while (out_write.load(std::memory_order_acquire) - out_read < n) retro_sleep(0);
+		Drain(res, n);
+	}
+
+	//Copy up to n frames of available output, returns the number of frames copied
+	Bit32u Drain(Bit32s* res, Bit32u n) {
+		Bit32u avail = out_write.load(std::memory_order_acquire) - out_read;
+		if (n > avail) n = avail;
+		for (Bit32u i = out_read % OUT_FRAMES, step, left = n; left; left -= step, res += step * 2, out_read += step, i = 0) {
+			step = (left < OUT_FRAMES - i ? left : OUT_FRAMES - i);
+			memcpy(res, out + i * 2, step * sizeof(Bit32s) * 2);
+		}
+		return n;
+	}
+
+private:
+	static Thread::RET_t THREAD_CC ThreadFunc(void* p) {
+		RenderThread& t = *(RenderThread*)p;
+		Bit32s buf[Handler::MAX_SAMPLES * 2];
+		for (Bit32u r = t.cmd_read.load(std::memory_order_relaxed);;) {
+			if (r == t.cmd_write.load(std::memory_order_acquire)) {
+				t.sleeping = true;
+				if (r == t.cmd_write.load(std::memory_order_acquire) || !t.sleeping.exchange(false)) t.sem.Wait();
+				continue;
+			}
+			const Bit32u c = t.cmd[r % CMD_SIZE];
+			t.cmd_read.store(++r, std::memory_order_release);
+			if (c & CMD_RENDER) {
+				//Render the block as a whole (same as synchronous rendering) and copy it into the output ring
+				Bit32u n = (c & ~CMD_RENDER), w = t.out_write.load(std::memory_order_relaxed);
+				t.handler->Generate(buf, n);
+				for (Bit32u i = w % OUT_FRAMES, step, j = 0; j != n; j += step, i = 0) {
+					step = (n - j < OUT_FRAMES - i ? n - j : OUT_FRAMES - i);
+					memcpy(t.out + i * 2, buf + j * 2, step * sizeof(Bit32s) * 2);
+				}
+				t.out_write.store(w + n, std::memory_order_release);
+			} else if (c & CMD_STOP) {
+				t.running = false;
+				return 0;
+			} else {
+				t.handler->WriteReg((c >> 8) & 0x1ff, (Bit8u)c);
+			}
+		}
+	}
+};
+
+struct Renderer {
+	struct RegWrite { Bit32u pos; Bit16u reg; Bit8u val; };
+
+	Handler* handler;
+	RenderThread* thread;
+	Bit32u rate;
+	bool played;
+	std::vector<RegWrite> writes;
+
+	Renderer(Handler* _handler, Bit32u _rate) : handler(_handler), thread(NULL), rate(_rate), played(false) {
+	}
+
+	~Renderer() {
+		delete thread;
+	}
+
+	//Switches between threaded and synchronous rendering, a stopped worker is kept until its remaining output got played
+	void Update(bool threaded) {
+		if (threaded && !Threaded()) { RenderThread* old = thread; thread = new RenderThread(handler, rate, old, played); delete old; }
+		else if (!threaded && Threaded()) thread->Stop();
+	}
+
+	inline bool Threaded() const {
+		return (thread && !thread->draining);
+	}
+
+	//Log a write to be replayed at a sample position of the next call to Render
+	void Log(Bit32u pos, Bit32u reg, Bit8u val) {
+		RegWrite w = { pos, (Bit16u)reg, val };
+		writes.push_back(w);
+	}
+
+	void WriteNow(Bit32u reg, Bit8u val) {
+		if (!Threaded()) { handler->WriteReg(reg, val); return; }
+		thread->Push((reg << 8) | val);
+		thread->Commit();
+	}
+
+	//Fill the buffer with stereo samples, writes logged with a position past the end get applied at the end
+	void Render(Bit32s* out, Bitu samples) {
+		Bitu done = 0;
+		if (thread && thread->draining) {
+			//Play what the stopped worker had rendered ahead, the writes logged during that time get applied right after
+			done = thread->Drain(out, (Bit32u)samples);
+			if (thread->out_read == thread->out_write) { delete thread; thread = NULL; }
+		}
+		const bool threaded = Threaded();
+		for (const RegWrite& w : writes) {
+			Bitu to = (w.pos < samples ? w.pos : samples);
+			if (to > done) { Generate(out + done * 2, to - done); done = to; }
+			if (threaded) thread->Push(((Bit32u)w.reg << 8) | w.val);
+			else handler->WriteReg(w.reg, w.val);
+		}
+		writes.clear();
+		if (samples > done) Generate(out + done * 2, samples - done);
+		played = true;
+		if (threaded) {
+			thread->Commit();
+			thread->Read(out, samples);
+		}
+	}
+
+private:
+	void Generate(Bit32s* out, Bitu n) {
+		for (Bitu step; n; n -= step, out += step * 2) {
+			step = (n < Handler::MAX_SAMPLES ? n : Handler::MAX_SAMPLES);
+			if (Threaded()) thread->Push(RenderThread::CMD_RENDER | (Bit32u)step);
+			else handler->Generate(out, step);
+		}
+	}
+};
+
 /*
 Chip
 */
@@ -536,10 +708,19 @@ void Module::DualWrite( Bit8u index, Bit8u reg, Bit8u val ) {
 		val |= index ? 0xA0 : 0x50;
 	}
 	Bit32u fullReg = reg + (index ? 0x100 : 0);
-	handler->WriteReg( fullReg, val );
+	ChipWrite( fullReg, val );
 	CacheWrite( fullReg, val );
 }
 
+void Module::ChipWrite( Bit32u reg, Bit8u val ) {
+	//DBP: Replay the write at its position in the current tick when the mixer renders it, apply it right away while not mixing
+	if ( mixerChan->enabled ) {
+		renderer->Log( (Bit32u)(PIC_TickIndex() * renderer->rate / 1000), reg, val );
+	} else {
+		renderer->WriteNow( reg, val );
+	}
+}
+
 void Module::CtrlWrite( Bit8u val ) {
 	switch ( ctrl.index ) {
 	case 0x09: /* Left FM Volume */
@@ -591,7 +772,7 @@ void Module::PortWrite( Bitu port, Bitu val, Bitu /*iolen*/ ) {
 		case MODE_OPL2:
 		case MODE_OPL3:
 			if ( !chip[0].Write( reg.normal, val ) ) {
-				handler->WriteReg( reg.normal, val );
+				ChipWrite( reg.normal, val );
 				CacheWrite( reg.normal, val );
 			}
 			break;
@@ -610,9 +791,10 @@ void Module::PortWrite( Bitu port, Bitu val, Bitu /*iolen*/ ) {
 	} else {
 		//Ask the handler to write the address
 		//Make sure to clip them in the right range
+		//DBP: Decode the address here based on the register cache because the handler might be busy on the render thread
 		switch ( mode ) {
 		case MODE_OPL2:
-			reg.normal = handler->WriteAddr( port, val ) & 0xff;
+			reg.normal = val & 0xff;
 			break;
 		case MODE_OPL3GOLD:
 			if ( port == 0x38a ) {
@@ -629,7 +811,8 @@ void Module::PortWrite( Bitu port, Bitu val, Bitu /*iolen*/ ) {
 			} //Fall-through if not handled by control chip
 			/* FALLTHROUGH */
 		case MODE_OPL3:
-			reg.normal = handler->WriteAddr( port, val ) & 0x1ff;
+			//The second register set is selected with port 2 when the opl3 mode is enabled (or to enable it)
+			reg.normal = ( ( ( port & 2 ) && ( ( cache[0x105] & 1 ) || val == 0x05 ) ) ? 0x100 : 0 ) | ( val & 0xff );
 			break;
 		case MODE_DUALOPL2:
 			//Not a 0x?88 port, when write to a specific side
@@ -699,7 +882,7 @@ void Module::Init( Mode m ) {
 		break;
 	case MODE_DUALOPL2:
 		//Setup opl3 mode in the hander
-		handler->WriteReg( 0x105, 1 );
+		ChipWrite( 0x105, 1 );
 		//Also set it up in the cache so the capturing will start opl3
 		CacheWrite( 0x105, 1 );
 		break;
@@ -710,10 +893,70 @@ void Module::Init( Mode m ) {
 
 
 
+#ifdef DBP_OPL_RENDER_SELF_TEST
+//DBP: Replay the same random register writes into a synchronous and a threaded renderer and compare the output
+static void OPL_RenderSelfTest(const char* name, Adlib::Handler* sync_handler, Adlib::Handler* thread_handler) {
+	enum { RATE = 49716, TICKS = 10000 };
+	extern Bit32u DBP_GetTicks();
+	static const Bit8u regs[] = { 0x20, 0x40, 0x60, 0x80, 0xe0, 0xa0, 0xb0, 0xc0, 0xbd, 0x08, 0x01 };
+	const Bitu latency = RATE * Adlib::RenderThread::LATENCY_MS / 1000;
+	std::vector<Bit32s> out[2];
+	Bit32u ticks[2];
+	for (int threaded = 0; threaded != 2; threaded++) {
+		Adlib::Handler* handler = (threaded ? thread_handler : sync_handler);
+		handler->Init(RATE);
+		Adlib::Renderer r(handler, RATE);
+		r.Update(!!threaded);
+		r.WriteNow(0x105, 1);
+		Bit32s buf[(RATE / 1000 + 1) * 2];
+		Bit32u seed = 1;
+		ticks[threaded] = DBP_GetTicks();
+		for (Bitu tick = 0; tick != TICKS; tick++) {
+			Bitu len = (tick + 1) * RATE / 1000 - tick * RATE / 1000, pos = 0;
+			#define RND() (seed = seed * 1103515245 + 12345, (seed >> 16) & 0x7fff)
+			for (Bitu n = RND() % 8; n--;) {
+				pos += RND() % (len / 4 + 1);
+				const Bit8u base = regs[RND() % sizeof(regs)];
+				Bit32u reg = (RND() & 1 ? 0x100 : 0) | base;
+				if (base < 0xa0) reg += (RND() % 3) * 8 + RND() % 6;
+				else if (base != 0xbd && base != 0x08 && base != 0x01) reg += RND() % 9;
+				Bit8u val = (Bit8u)RND();
+				if (base == 0x40) val &= 0x9f; // keep it audible
+				if (base == 0xc0) val |= 0x30;
+				r.Log((Bit32u)pos, reg, val);
+			}
+			#undef RND
+			r.Render(buf, len);
+			out[threaded].insert(out[threaded].end(), buf, buf + len * 2);
+		}
+		ticks[threaded] = DBP_GetTicks() - ticks[threaded];
+		r.Update(false);
+		delete handler;
+	}
+	Bitu audible = 0, silent_start = 0, match = 0, total = out[0].size() - latency * 2;
+	for (Bitu i = 0; i != total; i++) {
+		if (out[0][i]) audible++;
+		if (out[0][i] == out[1][i + latency * 2]) match++;
+	}
+	for (Bitu i = 0; i != latency * 2; i++)
+		if (!out[1][i]) silent_start++;
+	const bool ok = (audible > total / 4 && match == total && silent_start == latency * 2);
+	LOG_MSG("[OPL] Render self test %s: %s (%u of %u samples identical, %u audible) - Sync: %u ms, Threaded: %u ms",
+		name, (ok ? "OK" : "FAILED"), (unsigned)match, (unsigned)total, (unsigned)audible, ticks[0], ticks[1]);
+}
+#endif
+
 static Adlib::Module* module = 0;
 
 static void OPL_CallBack(Bitu len) {
-	module->handler->Generate( module->mixerChan, len );
+	//DBP: Render on a worker thread if possible and replay the register writes logged since the last callback
+	static Bit32u cores;
+	if (!cores) { extern unsigned dbp_cpu_features_get_core_amount(void); cores = dbp_cpu_features_get_core_amount(); }
+	module->renderer->Update(!Adlib::opl_render_sync && cores > 1);
+	static Bit32s buf[MIXER_BUFSIZE / 4 * 2];
+	DBP_ASSERT(len <= MIXER_BUFSIZE / 4);
+	module->renderer->Render( buf, len );
+	module->mixerChan->AddSamples_s32( len, buf );
 	//Disable the sound generation after 30 seconds of silence
 	if ((PIC_Ticks - module->lastUsed) > 30000) {
 		Bitu i;
@@ -803,6 +1046,7 @@ Module::Module( Section* configuration ) : Module_base(configuration) {
 	ctrl.lvol = 0xff;
 	ctrl.rvol = 0xff;
 	handler = 0;
+	renderer = 0;
 #ifdef C_DBP_ENABLE_CAPTURE
 	capture = 0;
 #endif
@@ -854,6 +1098,7 @@ Module::Module( Section* configuration ) : Module_base(configuration) {
 		handler = new DBOPL::Handler( opl3Mode );
 	}
 	handler->Init( rate );
+	renderer = new Renderer( handler, (Bit32u)rate );
 	bool single = false;
 	switch ( oplmode ) {
 	case OPL_opl2:
@@ -893,6 +1138,8 @@ Module::~Module() {
 		delete capture;
 	}
 #endif
+	//DBP: Stop the render thread before the handler gets deleted
+	delete renderer;
 	if ( handler ) {
 		delete handler;
 	}
@@ -912,7 +1159,22 @@ void OPL_Init(Section* sec,OPL_Mode oplmode) {
 	//DBP: Reset registers to their latest values
 	if (control->initialised)
 		for (Bit32u i = 0; i != 512; i++)
-			module->handler->WriteReg(i, Adlib::cache[i]);
+			module->ChipWrite(i, Adlib::cache[i]);
+
+	#ifdef DBP_OPL_RENDER_SELF_TEST
+	static bool tested;
+	if (!tested) {
+		tested = true;
+		OPL_RenderSelfTest("DBOPL", new DBOPL::Handler(true), new DBOPL::Handler(true));
+		#ifdef C_DBP_ENABLE_NUKEDOPL3
+		OPL_RenderSelfTest("Nuked", new NukedOPL::Handler(), new NukedOPL::Handler());
+		#endif
+	}
+	#endif
+}
+
+void OPL_SetSynchronousRender(bool sync) {
+	Adlib::opl_render_sync = sync;
 }
 
 void OPL_ShutDown(Section* /*sec*/){
@@ -943,8 +1205,9 @@ void DBPSerialize_OPL(DBPArchive& ar_outer)
 	if (ar.mode == DBPArchive::MODE_LOAD && module)
 	{
 		// Reset registers to their latest values
+		module->renderer->writes.clear();
 		for (Bit32u i = 0; i != 512; i++)
-			module->handler->WriteReg(i, Adlib::cache[i]);
+			module->ChipWrite(i, Adlib::cache[i]);
 	}
 	if (ar.IsReset() && module)
 	{
@@ -132,12 +132,13 @@ typedef enum {
 
 class Handler {
 public:
+	enum { MAX_SAMPLES = 512 }; //DBP: Maximum number of samples per call to Generate
 	//Write an address to a chip, returns the address the chip sets
 	virtual Bit32u WriteAddr( Bit32u port, Bit8u val ) = 0;
 	//Write to a specific register in the chip
 	virtual void WriteReg( Bit32u addr, Bit8u val ) = 0;
-	//Generate a certain amount of samples
-	virtual void Generate( MixerChannel* chan, Bitu samples ) = 0;
+	//Generate a certain amount of samples (DBP: changed to always output interleaved stereo into a buffer)
+	virtual void Generate( Bit32s* out, Bitu samples ) = 0;
 	//Initialize at a specific sample rate and mode
 	virtual void Init( Bitu rate ) = 0;
 	virtual ~Handler() {
@@ -152,6 +153,9 @@ typedef Bit8u RegisterCache[512];
 class Capture;
 #endif
 
+//DBP: Internal class used to replay logged register writes between rendered samples
+struct Renderer;
+
 class Module: public Module_base {
 	IO_ReadHandleObject ReadHandler[3];
 	IO_WriteHandleObject WriteHandler[3];
@@ -181,6 +185,7 @@ public:
 	Bit32u lastUsed;				//Ticks when adlib was last used to turn of mixing after a few second
 
 	Handler* handler;				//Handler that will generate the sound
+	Renderer* renderer;				//DBP: Owns the handler while it renders on a worker thread
 	//RegisterCache cache; //DBP: moved into static data
 #ifdef C_DBP_ENABLE_CAPTURE
 	Capture* capture;
@@ -189,6 +194,8 @@ public:
 
 	//Handle port writes
 	void PortWrite( Bitu port, Bitu val, Bitu iolen );
+	//DBP: Write to a chip register at the current sample position, never call handler->WriteReg directly
+	void ChipWrite( Bit32u reg, Bit8u val );
 	Bitu PortRead( Bitu port, Bitu iolen );
 	void Init( Mode m );
 
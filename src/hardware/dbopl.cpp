@@ -1517,16 +1517,16 @@ void Handler::WriteReg( Bit32u addr, Bit8u val ) {
 	chip.WriteReg( addr, val );
 }
 
-void Handler::Generate( MixerChannel* chan, Bitu samples ) {
-	Bit32s buffer[ 512 * 2 ];
-	if ( GCC_UNLIKELY(samples > 512) )
-		samples = 512;
+void Handler::Generate( Bit32s* out, Bitu samples ) {
+	if ( GCC_UNLIKELY(samples > MAX_SAMPLES) )
+		samples = MAX_SAMPLES;
 	if ( !chip.opl3Active ) {
-		chip.GenerateBlock2( samples, buffer );
-		chan->AddSamples_m32( samples, buffer );
+		chip.GenerateBlock2( samples, out );
+		//DBP: Expand the mono output in place back to front
+		for ( Bitu i = samples; i--; )
+			out[i * 2] = out[i * 2 + 1] = out[i];
 	} else {
-		chip.GenerateBlock3( samples, buffer );
-		chan->AddSamples_s32( samples, buffer );
+		chip.GenerateBlock3( samples, out );
 	}
 }
 
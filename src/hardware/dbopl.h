@@ -252,7 +252,7 @@ struct Handler : public Adlib::Handler {
 	DBOPL::Chip chip;
 	virtual Bit32u WriteAddr( Bit32u port, Bit8u val );
 	virtual void WriteReg( Bit32u addr, Bit8u val );
-	virtual void Generate( MixerChannel* chan, Bitu samples );
+	virtual void Generate( Bit32s* out, Bitu samples );
 	virtual void Init( Bitu rate );
 
 	Handler(bool opl3Mode) : chip(opl3Mode) {
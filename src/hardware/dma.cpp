@@ -41,6 +41,23 @@ static void UpdateEMSMapping(void) {
 	}
 }
 
+//DBP: Transfers are done in runs up to the next page or wrap boundary which are copied directly from/to host memory
+static INLINE Bitu DMA_TranslatePage(Bitu page) {
+	/* care for EMS pageframe etc. */
+	if (page < EMM_PAGEFRAME4K) return paging.firstmb[page];
+	else if (page < EMM_PAGEFRAME4K+0x10) return ems_board_mapping[page];
+	else if (page < LINK_START) return paging.firstmb[page];
+	return page;
+}
+
+static INLINE Bitu DMA_RunLength(PhysPt offset, Bit32u dma_wrap, Bitu size) {
+	Bitu run = 4096 - (offset & 4095);
+	const Bit64u to_wrap = (Bit64u)dma_wrap - offset + 1;
+	if (to_wrap < run) run = (Bitu)to_wrap;
+	if (dma_wrap & (dma_wrap + 1)) run = 1; // wrap mask with holes, step through it byte by byte
+	return (run < size ? run : size);
+}
+
 /* read a block from physical memory */
 static void DMA_BlockRead(PhysPt spage,PhysPt offset,void * data,Bitu size,Bit8u dma16) {
 	Bit8u * write=(Bit8u *) data;
@@ -48,17 +65,14 @@ static void DMA_BlockRead(PhysPt spage,PhysPt offset,void * data,Bitu size,Bit8u
 	size <<= dma16;
 	offset <<= dma16;
 	Bit32u dma_wrap = ((0xffff<<dma16)+dma16) | dma_wrapping;
-	for ( ; size ; size--, offset++) {
+	for (Bitu run; size; size -= run, offset += (PhysPt)run, write += run) {
 		if (offset>(dma_wrapping<<dma16)) {
 			LOG_MSG("DMA segbound wrapping (read): %x:%x size %" sBitfs(x) " [%x] wrap %x",spage,offset,size,dma16,dma_wrapping);
 		}
 		offset &= dma_wrap;
-		Bitu page = highpart_addr_page+(offset >> 12);
-		/* care for EMS pageframe etc. */
-		if (page < EMM_PAGEFRAME4K) page = paging.firstmb[page];
-		else if (page < EMM_PAGEFRAME4K+0x10) page = ems_board_mapping[page];
-		else if (page < LINK_START) page = paging.firstmb[page];
-		*write++=phys_readb(page*4096 + (offset & 4095));
+		run = DMA_RunLength(offset, dma_wrap, size);
+		Bitu page = DMA_TranslatePage(highpart_addr_page+(offset >> 12));
+		memcpy(write, MemBase + page*4096 + (offset & 4095), run);
 	}
 }
 
@@ -69,19 +83,83 @@ static void DMA_BlockWrite(PhysPt spage,PhysPt offset,void * data,Bitu size,Bit8
 	size <<= dma16;
 	offset <<= dma16;
 	Bit32u dma_wrap = ((0xffff<<dma16)+dma16) | dma_wrapping;
-	for ( ; size ; size--, offset++) {
+	for (Bitu run; size; size -= run, offset += (PhysPt)run, read += run) {
 		if (offset>(dma_wrapping<<dma16)) {
 			LOG_MSG("DMA segbound wrapping (write): %x:%x size %" sBitfs(x) " [%x] wrap %x",spage,offset,size,dma16,dma_wrapping);
 		}
+		offset &= dma_wrap;
+		run = DMA_RunLength(offset, dma_wrap, size);
+		Bitu page = DMA_TranslatePage(highpart_addr_page+(offset >> 12));
+		memcpy(MemBase + page*4096 + (offset & 4095), read, run);
+		MEM_MarkPageDirty(page);
+	}
+}
+
+//#define DBP_DMA_SELF_TEST
+#ifdef DBP_DMA_SELF_TEST
+#include <vector>
+//DBP: Compare the block transfers against the previous byte by byte implementation with wrapping, EMS frame and 16-bit channels
+static void DMA_BlockRef(bool do_write,PhysPt spage,PhysPt offset,Bit8u * data,Bitu size,Bit8u dma16) {
+	Bitu highpart_addr_page = spage>>12;
+	size <<= dma16;
+	offset <<= dma16;
+	Bit32u dma_wrap = ((0xffff<<dma16)+dma16) | dma_wrapping;
+	for ( ; size ; size--, offset++) {
 		offset &= dma_wrap;
 		Bitu page = highpart_addr_page+(offset >> 12);
-		/* care for EMS pageframe etc. */
 		if (page < EMM_PAGEFRAME4K) page = paging.firstmb[page];
 		else if (page < EMM_PAGEFRAME4K+0x10) page = ems_board_mapping[page];
 		else if (page < LINK_START) page = paging.firstmb[page];
-		phys_writeb(page*4096 + (offset & 4095), *read++);
+		if (do_write) phys_writeb(page*4096 + (offset & 4095), *data++);
+		else *data++=phys_readb(page*4096 + (offset & 4095));
+	}
+}
+
+static void DMA_BlockSelfTest(void) {
+	enum { MEM_SIZE = 4*1024*1024, BUF_SIZE = 0x30000 };
+	if (MEM_TotalPages() * 4096 < MEM_SIZE) return;
+	static const PhysPt spages[] = { 0x10000, 0x20000, 0xE0000, 0xC0000, 0x200000 };
+	static const Bit32u wrappings[] = { 0xffff, 0xffffffff };
+	std::vector<Bit8u> mem_save(MemBase, MemBase + MEM_SIZE), mem_ref(MEM_SIZE), buf(BUF_SIZE), buf_ref(BUF_SIZE);
+	Bit32u ems_save[0x10], wrapping_save = dma_wrapping, seed = 1, errors = 0, tests = 0;
+	memcpy(ems_save, ems_board_mapping + EMM_PAGEFRAME4K, sizeof(ems_save));
+	for (Bitu i = 0; i != 0x10; i++) ems_board_mapping[EMM_PAGEFRAME4K + i] = 0x180 + (Bit32u)((i * 7) % 0x10) * 3; // scattered EMS pages
+	#define RND() (seed = seed * 1103515245 + 12345, (seed >> 8))
+	for (Bit32u wrapping : wrappings) {
+		dma_wrapping = wrapping;
+		for (int iter = 0; iter != 2000; iter++, tests++) {
+			const bool do_write = !!(RND() & 1);
+			const Bit8u dma16 = (Bit8u)(RND() & 1);
+			const PhysPt spage = spages[RND() % (sizeof(spages)/sizeof(*spages))] & (dma16 ? 0xFE0000 : 0xFF0000);
+			const PhysPt offset = (RND() & 1 ? 0xFF00 + RND() % 0x100 : RND() % 0x10000);
+			const Bitu size = (RND() & 1 ? RND() % 0x300 : RND() % 0x10000) >> dma16;
+			for (Bitu i = 0; i != BUF_SIZE; i++) buf[i] = buf_ref[i] = (Bit8u)RND();
+			DMA_BlockRef(do_write, spage, offset, &buf_ref[0], size, dma16);
+			memcpy(&mem_ref[0], MemBase, MEM_SIZE);
+			memcpy(MemBase, &mem_save[0], MEM_SIZE);
+			if (do_write) DMA_BlockWrite(spage, offset, &buf[0], size, dma16);
+			else DMA_BlockRead(spage, offset, &buf[0], size, dma16);
+			if (buf != buf_ref || memcmp(&mem_ref[0], MemBase, MEM_SIZE)) errors++;
+			memcpy(MemBase, &mem_save[0], MEM_SIZE);
+		}
+	}
+	#undef RND
+	memcpy(ems_board_mapping + EMM_PAGEFRAME4K, ems_save, sizeof(ems_save));
+	dma_wrapping = wrapping_save;
+
+	extern Bit32u DBP_GetTicks();
+	Bit32u ticks[2];
+	for (int ref = 0; ref != 2; ref++) {
+		ticks[ref] = DBP_GetTicks();
+		for (int i = 0; i != 2000; i++) {
+			if (ref) DMA_BlockRef(false, 0x20000, 0, &buf[0], 0x8000, 1);
+			else DMA_BlockRead(0x20000, 0, &buf[0], 0x8000, 1);
+		}
+		ticks[ref] = DBP_GetTicks() - ticks[ref];
 	}
+	LOG_MSG("[DMA] Block transfer self test: %s (%u of %u mismatches) - Reading 128 MB in %u ms (byte by byte: %u ms)", (errors ? "FAILED" : "OK"), errors, tests, ticks[0], ticks[1]);
 }
+#endif
 
 DmaChannel * GetDMAChannel(Bit8u chan) {
 	if (chan<4) {
@@ -411,6 +489,9 @@ void DMA_Init(Section* sec) {
 	for (i=0;i<LINK_START;i++) {
 		ems_board_mapping[i]=i;
 	}
+	#ifdef DBP_DMA_SELF_TEST
+	DMA_BlockSelfTest();
+	#endif
 }
 
 #include <dbp_serialize.h>
@@ -25,6 +25,7 @@
 #include "regs.h"
 
 #include <string.h>
+#include <vector>
 
 #define PAGES_IN_BLOCK	((1024*1024)/MEM_PAGE_SIZE)
 #ifndef C_DBP_LIBRETRO
@@ -63,6 +64,7 @@ static struct MemoryBlock {
 } memory;
 
 HostPt MemBase;
+Bit32u* MemDirtyPages;
 
 class IllegalPageHandler : public PageHandler {
 public:
@@ -115,6 +117,7 @@ public:
 		return MemBase+phys_page*MEM_PAGESIZE;
 	}
 	HostPt GetHostWritePt(Bitu phys_page) {
+		MEM_MarkPageDirty(phys_page);
 		return MemBase+phys_page*MEM_PAGESIZE;
 	}
 };
@@ -198,21 +201,58 @@ void mem_strcpy(PhysPt dest,PhysPt src) {
 	mem_writeb_inline(dest,0);
 }
 
+//DBP: Bulk transfers are split at page boundaries and copy whole pages directly when the TLB has a host pointer for them.
+//     Pages without one (MMIO, VGA, code pages of the dynamic core, pages not linked yet) go through the page handler one
+//     byte at a time, which also links pages that can be mapped directly so the rest of them can be copied in one go.
+static INLINE Bitu MEM_PageLeft(PhysPt pt, Bitu size) {
+	Bitu left = MEM_PAGESIZE - (pt & (MEM_PAGESIZE - 1));
+	return (left < size ? left : size);
+}
+
 void mem_memcpy(PhysPt dest,PhysPt src,Bitu size) {
-	while (size--) mem_writeb_inline(dest++,mem_readb_inline(src++));
+	for (Bitu chunk; size; size -= chunk, dest += (PhysPt)chunk, src += (PhysPt)chunk) {
+		HostPt tlb_src = get_tlb_read(src), tlb_dest = get_tlb_write(dest);
+		if (!tlb_src || !tlb_dest) {
+			mem_writeb_inline(dest,mem_readb_inline(src));
+			chunk = 1;
+			continue;
+		}
+		chunk = MEM_PageLeft(src, MEM_PageLeft(dest, size));
+		HostPt s = tlb_src + src, d = tlb_dest + dest;
+		if (d > s && d < s + chunk) {
+			//Keep the byte by byte forward copy behavior when the destination overlaps the end of the source
+			for (HostPt end = s + chunk; s != end;) *(d++) = *(s++);
+		} else {
+			memmove(d, s, chunk);
+		}
+	}
 }
 
 void MEM_BlockRead(PhysPt pt,void * data,Bitu size) {
 	Bit8u * write=reinterpret_cast<Bit8u *>(data);
-	while (size--) {
-		*write++=mem_readb_inline(pt++);
+	for (Bitu chunk; size; size -= chunk, pt += (PhysPt)chunk, write += chunk) {
+		HostPt tlb_addr = get_tlb_read(pt);
+		if (!tlb_addr) {
+			*write = mem_readb_inline(pt);
+			chunk = 1;
+			continue;
+		}
+		chunk = MEM_PageLeft(pt, size);
+		memcpy(write, tlb_addr + pt, chunk);
 	}
 }
 
 void MEM_BlockWrite(PhysPt pt,void const * const data,Bitu size) {
 	Bit8u const * read = reinterpret_cast<Bit8u const * const>(data);
-	while (size--) {
-		mem_writeb_inline(pt++,*read++);
+	for (Bitu chunk; size; size -= chunk, pt += (PhysPt)chunk, read += chunk) {
+		HostPt tlb_addr = get_tlb_write(pt);
+		if (!tlb_addr) {
+			mem_writeb_inline(pt, *read);
+			chunk = 1;
+			continue;
+		}
+		chunk = MEM_PageLeft(pt, size);
+		memcpy(tlb_addr + pt, read, chunk);
 	}
 }
 
@@ -562,6 +602,103 @@ void PreparePCJRCartRom(void) {
 
 HostPt GetMemBase(void) { return MemBase; }
 
+void MEM_MarkHostDirty(HostPt host) {
+	// Used by page handlers that map other physical pages into MemBase (i.e. Tandy video memory)
+	if (host >= MemBase && host < MemBase + memory.pages * MEM_PAGESIZE)
+		MEM_MarkPageDirty((Bitu)(host - MemBase) / MEM_PAGESIZE);
+}
+
+//DBP: Copies of memory as of the last state stored by the core rewind buffer or for frontend run-ahead.
+// They are kept current through the dirty page tracking so storing or restoring a state only touches modified pages.
+static struct MemSnapshot { Bit8u* mem; Bit32u* dirty; Bit32u serial; } mem_snapshots[MEM_SNAPSHOT_COUNT];
+
+static void MEM_SnapshotCollectDirty(void) {
+	// Move the pages modified since the last call into every snapshot and restart the tracking
+	Bitu words = (memory.pages + 31) / 32;
+	if (memory.pages & 31) MemDirtyPages[words - 1] &= (1u << (memory.pages & 31)) - 1; // bits past the end get set by marking everything
+	for (MemSnapshot& s : mem_snapshots)
+		if (s.mem)
+			for (Bitu i = 0; i != words; i++)
+				s.dirty[i] |= MemDirtyPages[i];
+	memset(MemDirtyPages, 0, words * sizeof(Bit32u));
+	// Direct host pointers in the TLB bypass the tracking so re-link all pages to mark them again on the next write
+	PAGING_ClearTLB();
+}
+
+void MEM_SnapshotFree(MEM_SnapshotId id) {
+	MemSnapshot& s = mem_snapshots[id];
+	delete [] s.mem;
+	delete [] s.dirty;
+	s.mem = NULL;
+	s.dirty = NULL;
+}
+
+bool MEM_SnapshotTake(MEM_SnapshotId id, std::vector<Bit8u>* undo) {
+	// Bring the snapshot up to date, optionally storing the previous content of changed pages as [page number][page data] records
+	// Returns false if the snapshot had to be created (so there is no previous content)
+	MemSnapshot& s = mem_snapshots[id];
+	Bitu words = (memory.pages + 31) / 32;
+	MEM_SnapshotCollectDirty();
+	if (!s.mem) {
+		s.mem = new Bit8u[memory.pages * MEM_PAGESIZE];
+		s.dirty = new Bit32u[words];
+		memcpy(s.mem, MemBase, memory.pages * MEM_PAGESIZE);
+		memset(s.dirty, 0, words * sizeof(Bit32u));
+		return false;
+	}
+	for (Bitu i = 0; i != words; i++) {
+		Bit32u page = (Bit32u)(i * 32);
+		for (Bit32u bits = s.dirty[i]; bits; bits >>= 1, page++) {
+			if (!(bits & 1)) continue;
+			Bit8u *cur = MemBase + page * MEM_PAGESIZE, *snap = s.mem + page * MEM_PAGESIZE;
+			if (undo) {
+				if (!memcmp(cur, snap, MEM_PAGESIZE)) continue;
+				size_t ofs = undo->size();
+				undo->resize(ofs + sizeof(page) + MEM_PAGESIZE);
+				memcpy(&(*undo)[ofs], &page, sizeof(page));
+				memcpy(&(*undo)[ofs + sizeof(page)], snap, MEM_PAGESIZE);
+			}
+			memcpy(snap, cur, MEM_PAGESIZE);
+		}
+		s.dirty[i] = 0;
+	}
+	return true;
+}
+
+bool MEM_SnapshotUndo(MEM_SnapshotId id, const std::vector<Bit8u>& undo) {
+	// Roll the snapshot back with the records of MEM_SnapshotTake, the pages get copied into memory by the next MEM_SnapshotRestore
+	MemSnapshot& s = mem_snapshots[id];
+	const size_t rec = sizeof(Bit32u) + MEM_PAGESIZE;
+	if (!s.mem || (undo.size() % rec)) return false;
+	for (size_t ofs = 0; ofs != undo.size(); ofs += rec) {
+		Bit32u page;
+		memcpy(&page, &undo[ofs], sizeof(page));
+		if (page >= memory.pages) return false;
+		memcpy(s.mem + page * MEM_PAGESIZE, &undo[ofs + sizeof(page)], MEM_PAGESIZE);
+		s.dirty[page>>5] |= (1u<<(page&31));
+	}
+	return true;
+}
+
+static bool MEM_SnapshotRestore(MEM_SnapshotId id) {
+	// Copy back the pages modified since the snapshot was taken, which other snapshots then see as modified
+	MemSnapshot& s = mem_snapshots[id];
+	if (!s.mem) return false;
+	MEM_SnapshotCollectDirty();
+	for (Bitu i = 0, words = (memory.pages + 31) / 32; i != words; i++) {
+		if (!s.dirty[i]) continue;
+		Bit32u page = (Bit32u)(i * 32);
+		for (Bit32u bits = s.dirty[i]; bits; bits >>= 1, page++)
+			if (bits & 1)
+				memcpy(MemBase + page * MEM_PAGESIZE, s.mem + page * MEM_PAGESIZE, MEM_PAGESIZE);
+		for (MemSnapshot& o : mem_snapshots)
+			if (&o != &s && o.mem)
+				o.dirty[i] |= s.dirty[i];
+		s.dirty[i] = 0;
+	}
+	return true;
+}
+
 class MEMORY:public Module_base{
 private:
 	IO_ReadHandleObject ReadHandler;
@@ -592,6 +729,8 @@ public:
 		 * (Visual C debug mode). We want zeroed memory though. */
 		memset((void*)MemBase,0,memsize*1024*1024);
 		memory.pages = (memsize*1024*1024)/4096;
+		MemDirtyPages = new Bit32u[(memory.pages + 31) / 32];
+		memset(MemDirtyPages,0xFF,((memory.pages + 31) / 32) * sizeof(Bit32u));
 		/* Allocate the data for the different page information blocks */
 		memory.phandlers=new  PageHandler * [memory.pages];
 		memory.mhandles=new MemHandle [memory.pages];
@@ -623,6 +762,9 @@ public:
 	}
 	~MEMORY(){
 		delete [] MemBase;
+		delete [] MemDirtyPages;
+		MEM_SnapshotFree(MEM_SNAPSHOT_REWIND);
+		MEM_SnapshotFree(MEM_SNAPSHOT_RUNAHEAD);
 		delete [] memory.phandlers;
 		delete [] memory.mhandles;
 	}
@@ -635,10 +777,79 @@ static void MEM_ShutDown(Section * sec) {
 	delete test;
 }
 
+//#define DBP_MEM_BLOCK_SELF_TEST
+#ifdef DBP_MEM_BLOCK_SELF_TEST
+//DBP: Compare the bulk transfer functions against byte by byte reference loops over a mix of RAM, ROM and MMIO pages
+static void MEM_BlockSelfTest(void) {
+	enum { FIRST_PAGE = 0x180, PAGES = 16, SIZE = PAGES * MEM_PAGESIZE };
+	struct MMIOPageHandler : public PageHandler {
+		Bit8u mem[SIZE];
+		MMIOPageHandler() { flags = PFLAG_NOCODE; }
+		Bitu readb(PhysPt addr) { return mem[addr - FIRST_PAGE * MEM_PAGESIZE]; }
+		void writeb(PhysPt addr, Bitu val) { mem[addr - FIRST_PAGE * MEM_PAGESIZE] = (Bit8u)val; }
+	};
+	if (memory.pages < FIRST_PAGE + PAGES) return;
+	extern Bit32u DBP_GetTicks();
+	static MMIOPageHandler mmio;
+	static Bit8u ram_save[SIZE], ram_res[SIZE], mmio_res[SIZE], buf[SIZE], buf_res[SIZE];
+	static const char layout[] = "RRMRORMMRRRMRROR"; // RAM, ROM, MMIO
+	const PhysPt base = FIRST_PAGE * MEM_PAGESIZE;
+	HostPt ram = MemBase + base;
+	memcpy(ram_save, ram, SIZE);
+	for (Bitu i = 0; i != PAGES; i++)
+		MEM_SetPageHandler(FIRST_PAGE + i, 1, (layout[i] == 'R' ? (PageHandler*)&ram_page_handler : layout[i] == 'O' ? (PageHandler*)&rom_page_handler : (PageHandler*)&mmio));
+
+	Bit32u seed = 1, errors = 0;
+	#define RND() (seed = seed * 1103515245 + 12345, (seed >> 8))
+	for (int iter = 0; iter != 4000; iter++) {
+		const int op = (int)(RND() % 3);
+		const Bitu size = (RND() & 1 ? RND() % 64 : RND() % (MEM_PAGESIZE * 3));
+		const PhysPt src = base + (PhysPt)(RND() % (SIZE - size + 1));
+		const PhysPt dest = (RND() & 3 ? base + (PhysPt)(RND() % (SIZE - size + 1)) : (PhysPt)(src + RND() % 32 < base + SIZE - size ? src + RND() % 32 : src));
+		const bool clear_tlb = !(RND() & 3);
+		for (int pass = 0; pass != 2; pass++) {
+			Bit32u fill = (Bit32u)iter * 2654435761u;
+			for (Bitu i = 0; i != SIZE; i++) { fill = fill * 1664525 + 1013904223; ram[i] = (Bit8u)(fill >> 24); mmio.mem[i] = (Bit8u)(fill >> 16); buf[i] = (Bit8u)(fill >> 8); }
+			if (clear_tlb) PAGING_ClearTLB();
+			if (pass == 0) {
+				if (op == 0) for (Bitu i = 0; i != size; i++) buf[i] = mem_readb(src + (PhysPt)i);
+				if (op == 1) for (Bitu i = 0; i != size; i++) mem_writeb(dest + (PhysPt)i, buf[i]);
+				if (op == 2) for (Bitu i = 0; i != size; i++) mem_writeb(dest + (PhysPt)i, mem_readb(src + (PhysPt)i));
+				memcpy(ram_res, ram, SIZE); memcpy(mmio_res, mmio.mem, SIZE); memcpy(buf_res, buf, SIZE);
+			} else {
+				if (op == 0) MEM_BlockRead(src, buf, size);
+				if (op == 1) MEM_BlockWrite(dest, buf, size);
+				if (op == 2) mem_memcpy(dest, src, size);
+				if (memcmp(ram_res, ram, SIZE) || memcmp(mmio_res, mmio.mem, SIZE) || memcmp(buf_res, buf, SIZE)) errors++;
+			}
+		}
+	}
+	#undef RND
+
+	MEM_ResetPageHandler(FIRST_PAGE, PAGES);
+	PAGING_ClearTLB();
+
+	// Measure moving 64 MB through RAM pages
+	Bit32u ticks = DBP_GetTicks();
+	for (int i = 0; i != 64 * 1024 * 1024 / (SIZE / 2); i++) {
+		MEM_BlockRead(base, buf, SIZE / 2);
+		MEM_BlockWrite(base + SIZE / 2, buf, SIZE / 2);
+	}
+	ticks = DBP_GetTicks() - ticks;
+
+	memcpy(ram, ram_save, SIZE);
+	PAGING_ClearTLB();
+	LOG_MSG("[MEM] Block transfer self test: %s (%u of 4000 mismatches) - Read/write 64 MB in %u ms", (errors ? "FAILED" : "OK"), errors, ticks);
+}
+#endif
+
 void MEM_Init(Section * sec) {
 	/* shutdown function */
 	test = new MEMORY(sec);
 	sec->AddDestroyFunction(&MEM_ShutDown);
+	#ifdef DBP_MEM_BLOCK_SELF_TEST
+	MEM_BlockSelfTest();
+	#endif
 }
 
 #include <dbp_serialize.h>
@@ -660,7 +871,36 @@ void DBPSerialize_Memory(DBPArchive& ar)
 	ar.Serialize(memory.lfb.end_page);
 	ar.Serialize(memory.lfb.pages);
 	ar.Serialize(memory.a20);
-	ar.SerializeSparse(MemBase, (pages * MEM_PAGE_SIZE));
+
+	#if (C_DYNAMIC_X86) || (C_DYNREC)
+	// Hash the code pages of the dynamic core cache before loading to keep the unmodified ones afterwards
+	void DBPSerialize_CPU_CodeCache(DBPArchive& ar, bool memory_restored);
+	DBPSerialize_CPU_CodeCache(ar, false);
+	#endif
+
+	if (ar.flags & DBPArchive::FLAG_RUNAHEAD)
+	{
+		// Memory stays in the snapshot which only matches the run-ahead state saved most recently
+		MemSnapshot& s = mem_snapshots[MEM_SNAPSHOT_RUNAHEAD];
+		Bit32u serial = (ar.mode == DBPArchive::MODE_SAVE ? ++s.serial : s.serial);
+		ar << serial;
+		if (ar.mode == DBPArchive::MODE_SAVE)
+			MEM_SnapshotTake(MEM_SNAPSHOT_RUNAHEAD, NULL);
+		else if (ar.mode == DBPArchive::MODE_LOAD && (serial != s.serial || !MEM_SnapshotRestore(MEM_SNAPSHOT_RUNAHEAD)))
+			ar.had_error = DBPArchive::ERR_LAYOUT;
+	}
+	else if (ar.flags & DBPArchive::FLAG_REWIND)
+	{
+		// Memory stays in the snapshot which the rewind buffer updates after saving and rolls back before loading
+		if (ar.mode == DBPArchive::MODE_LOAD && !MEM_SnapshotRestore(MEM_SNAPSHOT_REWIND))
+			ar.had_error = DBPArchive::ERR_LAYOUT;
+	}
+	else
+	{
+		ar.SerializeSparse(MemBase, (pages * MEM_PAGE_SIZE));
+		if (ar.mode == DBPArchive::MODE_LOAD) // all of memory was replaced without being tracked
+			memset(MemDirtyPages, 0xFF, ((memory.pages + 31) / 32) * sizeof(Bit32u));
+	}
 	ar.SerializeBytes(memory.mhandles, (pages * sizeof(MemHandle)));
 
 	//if (ar.mode == DBPArchive::MODE_LOAD) memcpy(MemBase + CALLBACK_PhysPointer(0), cbBuf, sizeof(cbBuf));
@@ -671,4 +911,8 @@ void DBPSerialize_Memory(DBPArchive& ar)
 	ar.SerializePointers((void**)memory.phandlers, pages, true, 2,
 		DBP_SERIALIZE_GET_POINTER_LIST(PageHandlerPtr, Memory),
 		DBP_SERIALIZE_GET_POINTER_LIST(PageHandlerPtr, VGA));
+
+	#if (C_DYNAMIC_X86) || (C_DYNREC)
+	DBPSerialize_CPU_CodeCache(ar, true);
+	#endif
 }
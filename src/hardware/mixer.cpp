@@ -311,9 +311,188 @@ void MixerChannel::AddSilence(void) {
 #define MIXER_UPRAMP_STEPS 0
 #define MIXER_UPRAMP_SAVE 512
 
+//DBP: Vectorized path for native 16-bit signed data (m16/s16, used by most devices) which produces bit identical output
+// to the generic loop below. Output sample j reads source frames up to (freq_counter + j * freq_add) >> FREQ_SHIFT and the
+// generic loop stops at the first output that would need a frame beyond len, so the number of outputs is known upfront.
+//#define DBP_MIXER_SIMD_SELF_TEST
+#if MIXER_UPRAMP_STEPS == 0
+#if !defined(__SSE2__) && (_M_IX86_FP == 2 || (defined(_M_AMD64) || defined(_M_X64)))
+#define __SSE2__ 1
+#endif
+static INLINE Bit32u MixLoadPair(const Bit16s* p) { Bit32u v; memcpy(&v, p, 4); return v; }
+#if defined(__SSE2__) && __SSE2__
+#include <emmintrin.h>
+#define DBP_MIXER_SIMD
+typedef __m128i MixVec;
+static INLINE MixVec MixVecLoad16(const Bit16s* p) { __m128i x = _mm_loadl_epi64((const __m128i*)p); return _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16); }
+static INLINE MixVec MixVecSet4(Bit32s a, Bit32s b, Bit32s c, Bit32s d) { return _mm_set_epi32(d, c, b, a); }
+static INLINE MixVec MixVecDupLo(MixVec a) { return _mm_unpacklo_epi32(a, a); }
+static INLINE MixVec MixVecDupHi(MixVec a) { return _mm_unpackhi_epi32(a, a); }
+static INLINE MixVec MixVecLerpMono(const Bit16s* p0, const Bit16s* p1, const Bit16s* p2, const Bit16s* p3, MixVec weights)
+{
+	__m128i pn = _mm_set_epi32(MixLoadPair(p3), MixLoadPair(p2), MixLoadPair(p1), MixLoadPair(p0));
+	return _mm_srai_epi32(_mm_madd_epi16(pn, weights), FREQ_SHIFT);
+}
+static INLINE MixVec MixVecLerpStereo(const Bit16s* p0, const Bit16s* p1, MixVec weights)
+{
+	__m128i pn = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)p0), _mm_loadl_epi64((const __m128i*)p1)); // [pL,pR,nL,nR] => [pL,nL,pR,nR]
+	pn = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pn, _MM_SHUFFLE(3, 1, 2, 0)), _MM_SHUFFLE(3, 1, 2, 0));
+	return _mm_srai_epi32(_mm_madd_epi16(pn, weights), FREQ_SHIFT);
+}
+static INLINE MixVec MixVecMul(MixVec a, MixVec b) // SSE2 has no pmulld, the low 32 bits of the unsigned products are the same as signed
+{
+	__m128i even = _mm_mul_epu32(a, b), odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+static INLINE void MixVecAccum(Bit32s* p, MixVec a) { _mm_storeu_si128((__m128i*)p, _mm_add_epi32(_mm_loadu_si128((const __m128i*)p), a)); }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define DBP_MIXER_SIMD
+typedef int32x4_t MixVec;
+static INLINE MixVec MixVecLoad16(const Bit16s* p) { return vmovl_s16(vld1_s16(p)); }
+static INLINE MixVec MixVecSet4(Bit32s a, Bit32s b, Bit32s c, Bit32s d) { const Bit32s v[4] = { a, b, c, d }; return vld1q_s32(v); }
+static INLINE MixVec MixVecDupLo(MixVec a) { return vzipq_s32(a, a).val[0]; }
+static INLINE MixVec MixVecDupHi(MixVec a) { return vzipq_s32(a, a).val[1]; }
+static INLINE MixVec MixVecLerp(int16x4_t p, int16x4_t n, MixVec weights)
+{
+	int16x4x2_t w = vuzp_s16(vget_low_s16(vreinterpretq_s16_s32(weights)), vget_high_s16(vreinterpretq_s16_s32(weights)));
+	return vshrq_n_s32(vmlal_s16(vmull_s16(p, w.val[0]), n, w.val[1]), FREQ_SHIFT);
+}
+static INLINE MixVec MixVecLerpMono(const Bit16s* p0, const Bit16s* p1, const Bit16s* p2, const Bit16s* p3, MixVec weights)
+{
+	int16x4x2_t pn = vuzp_s16(vcreate_s16(MixLoadPair(p0) | ((Bit64u)MixLoadPair(p1) << 32)), vcreate_s16(MixLoadPair(p2) | ((Bit64u)MixLoadPair(p3) << 32)));
+	return MixVecLerp(pn.val[0], pn.val[1], weights);
+}
+static INLINE MixVec MixVecLerpStereo(const Bit16s* p0, const Bit16s* p1, MixVec weights)
+{
+	int32x2x2_t pn = vzip_s32(vreinterpret_s32_s16(vld1_s16(p0)), vreinterpret_s32_s16(vld1_s16(p1))); // [pL,pR,nL,nR] => [pL,pR,pL,pR] and [nL,nR,nL,nR]
+	return MixVecLerp(vreinterpret_s16_s32(pn.val[0]), vreinterpret_s16_s32(pn.val[1]), weights);
+}
+static INLINE MixVec MixVecMul(MixVec a, MixVec b) { return vmulq_s32(a, b); }
+static INLINE void MixVecAccum(Bit32s* p, MixVec a) { vst1q_s32(p, vaddq_s32(vld1q_s32(p), a)); }
+#endif
+#endif
+
+#ifdef DBP_MIXER_SIMD
+#ifdef DBP_MIXER_SIMD_SELF_TEST
+static bool mixer_simd_off;
+#endif
+
+template<bool stereo> static void MIXER_AddSamples16(MixerChannel& c, Bitu len, const Bit16s* data)
+{
+	enum { CH = (stereo ? 2 : 1) };
+	const Bitu add = c.freq_add, start = c.freq_counter, limit = ((len + 1) << FREQ_SHIFT);
+	const Bitu total = (start >= limit ? 0 : (limit - start + add - 1) / add);
+	const Bits volL = c.volmul[0], volR = c.volmul[1];
+	const MixVec vol = MixVecSet4(c.volmul[0], c.volmul[1], c.volmul[0], c.volmul[1]);
+	Bitu counter = start, mixpos = mixer.pos + c.done;
+	for (Bitu j = 0, run; j != total; j += run, mixpos += run)
+	{
+		// Split where the output wraps around the end of mixer.work
+		mixpos &= MIXER_BUFMASK;
+		run = (MIXER_BUFSIZE - mixpos < total - j ? MIXER_BUFSIZE - mixpos : total - j);
+		Bit32s* w = mixer.work[mixpos], *wend = w + run * 2;
+
+		// The first outputs can still read prevSample and nextSample, after that everything comes from data
+		for (; w != wend && (counter >> FREQ_SHIFT) < 2; w += 2, counter += add)
+		{
+			Bitu k = (counter >> FREQ_SHIFT);
+			Bits l = (k == 0 ? c.prevSample[0] : c.nextSample[0]), r = (!stereo ? l : k == 0 ? c.prevSample[1] : c.nextSample[1]);
+			if (c.interpolate)
+			{
+				Bits diff_mul = (counter & FREQ_MASK);
+				l += (((k == 0 ? c.nextSample[0] : data[0]) - l) * diff_mul) >> FREQ_SHIFT;
+				r = (!stereo ? l : r + ((((k == 0 ? c.nextSample[1] : data[1]) - r) * diff_mul) >> FREQ_SHIFT));
+			}
+			w[0] += (Bit32s)(l * volL);
+			w[1] += (Bit32s)(r * volR);
+		}
+
+		if (!c.interpolate && add == FREQ_NEXT)
+		{
+			// Same rate as the mixer, source frames are read in sequence
+			const Bit16s* src = data + ((counter >> FREQ_SHIFT) - 2) * CH;
+			Bitu blocks = (Bitu)(wend - w) / 8;
+			for (Bitu b = 0; b != blocks; b++, w += 8, src += 4 * CH)
+			{
+				if (stereo)
+				{
+					MixVecAccum(w + 0, MixVecMul(MixVecLoad16(src + 0), vol));
+					MixVecAccum(w + 4, MixVecMul(MixVecLoad16(src + 4), vol));
+				}
+				else
+				{
+					MixVec s = MixVecLoad16(src);
+					MixVecAccum(w + 0, MixVecMul(MixVecDupLo(s), vol));
+					MixVecAccum(w + 4, MixVecMul(MixVecDupHi(s), vol));
+				}
+			}
+			counter += blocks * 4 * FREQ_NEXT;
+		}
+		else
+		{
+			// Each output frame reads a prev/next pair which is blended with p + (((n - p) * f) >> 14) == ((p * (16384 - f) + n * f) >> 14)
+			#define MIXER_WEIGHTS(cnt) (interp ? ((Bit32s)((cnt) & FREQ_MASK) << 16) | (Bit32s)(FREQ_NEXT - ((cnt) & FREQ_MASK)) : (Bit32s)FREQ_NEXT)
+			#define MIXER_PAIR(cnt) (data + (((cnt) >> FREQ_SHIFT) - 2) * CH)
+			const bool interp = c.interpolate;
+			for (; wend - w >= 8; w += 8, counter += add * 4)
+			{
+				const Bitu c0 = counter, c1 = counter + add, c2 = counter + add * 2, c3 = counter + add * 3;
+				if (stereo)
+				{
+					MixVecAccum(w + 0, MixVecMul(MixVecLerpStereo(MIXER_PAIR(c0), MIXER_PAIR(c1), MixVecSet4(MIXER_WEIGHTS(c0), MIXER_WEIGHTS(c0), MIXER_WEIGHTS(c1), MIXER_WEIGHTS(c1))), vol));
+					MixVecAccum(w + 4, MixVecMul(MixVecLerpStereo(MIXER_PAIR(c2), MIXER_PAIR(c3), MixVecSet4(MIXER_WEIGHTS(c2), MIXER_WEIGHTS(c2), MIXER_WEIGHTS(c3), MIXER_WEIGHTS(c3))), vol));
+				}
+				else
+				{
+					MixVec s = MixVecLerpMono(MIXER_PAIR(c0), MIXER_PAIR(c1), MIXER_PAIR(c2), MIXER_PAIR(c3), MixVecSet4(MIXER_WEIGHTS(c0), MIXER_WEIGHTS(c1), MIXER_WEIGHTS(c2), MIXER_WEIGHTS(c3)));
+					MixVecAccum(w + 0, MixVecMul(MixVecDupLo(s), vol));
+					MixVecAccum(w + 4, MixVecMul(MixVecDupHi(s), vol));
+				}
+			}
+			#undef MIXER_WEIGHTS
+			#undef MIXER_PAIR
+		}
+
+		for (; w != wend; w += 2, counter += add)
+		{
+			const Bit16s* src = data + ((counter >> FREQ_SHIFT) - 2) * CH;
+			Bits l = src[0], r = src[CH - 1];
+			if (c.interpolate)
+			{
+				Bits diff_mul = (counter & FREQ_MASK);
+				l += ((src[CH] - l) * diff_mul) >> FREQ_SHIFT;
+				r = (!stereo ? l : r + (((src[CH * 2 - 1] - r) * diff_mul) >> FREQ_SHIFT));
+			}
+			w[0] += (Bit32s)(l * volL);
+			w[1] += (Bit32s)(r * volR);
+		}
+	}
+
+	// Like the generic loop, all source frames are consumed before returning
+	c.done += total;
+	c.freq_counter = start + total * add - (len << FREQ_SHIFT);
+	for (int ch = 0; ch != CH; ch++)
+	{
+		if (len >= 2) { c.prevSample[ch] = data[(len - 2) * CH + ch]; c.nextSample[ch] = data[(len - 1) * CH + ch]; }
+		else if (len == 1) { c.prevSample[ch] = c.nextSample[ch]; c.nextSample[ch] = data[ch]; }
+	}
+	c.last_samples_were_silence = false;
+}
+#endif
+
 template<class Type,bool stereo,bool signeddata,bool nativeorder>
 inline void MixerChannel::AddSamples(Bitu len, const Type* data) {
 	last_samples_were_stereo = stereo;
+#ifdef DBP_MIXER_SIMD
+#ifdef DBP_MIXER_SIMD_SELF_TEST
+	if (!mixer_simd_off)
+#endif
+	if (sizeof(Type) == 2 && signeddata && nativeorder && freq_add) {
+		MIXER_AddSamples16<stereo>(*this, len, (const Bit16s*)data);
+		return;
+	}
+#endif
 
 	//Position where to write the data
 	Bitu mixpos = mixer.pos + done;
@@ -533,6 +712,62 @@ void MixerChannel::AddSamples_s32_nonnative(Bitu len,const Bit32s * data) {
 	AddSamples<Bit32s,true,true,false>(len,data);
 }
 
+#ifdef DBP_MIXER_SIMD_SELF_TEST
+static void MIXER_SIMD_SelfTest()
+{
+	static Bit32s ref[MIXER_BUFSIZE][2];
+	static Bit16s src[4096 * 3];
+	extern Bit32u DBP_GetTicks();
+	Bit32u seed = 1234, errors = 0, ticks[4];
+	#define MIXER_RAND() (seed = seed * 1103515245 + 12345, (seed >> 8))
+	for (Bitu i = 0; i != 4096 * 3; i++) src[i] = (Bit16s)MIXER_RAND();
+	MixerChannel c, org, res;
+	memset(&c, 0, sizeof(c));
+	for (int iter = 0; iter != 4000; iter++)
+	{
+		bool stereo = !!(iter & 1);
+		c.freq_add = ((iter & 2) ? FREQ_NEXT : (FREQ_NEXT / 8 + MIXER_RAND() % (FREQ_NEXT * 4)));
+		c.interpolate = (c.freq_add != FREQ_NEXT || (iter & 4));
+		c.freq_counter = MIXER_RAND() % (FREQ_NEXT * 2);
+		c.volmul[0] = (Bit32s)(MIXER_RAND() % 40000); c.volmul[1] = (Bit32s)(MIXER_RAND() % 40000);
+		c.prevSample[0] = (Bit16s)MIXER_RAND(); c.prevSample[1] = (Bit16s)MIXER_RAND();
+		c.nextSample[0] = (Bit16s)MIXER_RAND(); c.nextSample[1] = (Bit16s)MIXER_RAND();
+		c.done = MIXER_RAND() % 1000;
+		mixer.pos = MIXER_RAND() & MIXER_BUFMASK;
+		Bitu len = ((iter & 8) ? (iter >> 4) % 5 : MIXER_RAND() % 4096);
+		const Bit16s* data = src + (MIXER_RAND() % 4096);
+		org = c;
+		for (int simd = 0; simd != 2; simd++)
+		{
+			mixer_simd_off = !simd;
+			memset(mixer.work, 0, sizeof(mixer.work));
+			if (stereo) c.AddSamples_s16(len, data); else c.AddSamples_m16(len, data);
+			if (!simd) { memcpy(ref, mixer.work, sizeof(ref)); res = c; c = org; }
+		}
+		if (memcmp(ref, mixer.work, sizeof(ref)) || c.done != res.done || c.freq_counter != res.freq_counter || memcmp(c.prevSample, res.prevSample, sizeof(c.prevSample)) || memcmp(c.nextSample, res.nextSample, sizeof(c.nextSample)))
+			errors++;
+	}
+	for (int test = 0; test != 4; test++)
+	{
+		mixer_simd_off = !(test & 1);
+		ticks[test] = DBP_GetTicks();
+		c.freq_add = ((test & 2) ? FREQ_NEXT : (FREQ_NEXT * 22050 / 48000));
+		c.interpolate = (c.freq_add != FREQ_NEXT);
+		for (int iter = 0; iter != 20000; iter++)
+		{
+			c.done = 0; mixer.pos = 0;
+			if (iter & 1) c.AddSamples_s16(1024, src); else c.AddSamples_m16(1024, src);
+		}
+		ticks[test] = DBP_GetTicks() - ticks[test];
+	}
+	#undef MIXER_RAND
+	mixer_simd_off = false;
+	mixer.pos = 0;
+	memset(mixer.work, 0, sizeof(mixer.work));
+	LOG_MSG("[MIXER] SIMD self test: %u errors, resampling generic %u ms vectorized %u ms, same rate generic %u ms vectorized %u ms", errors, ticks[0], ticks[1], ticks[2], ticks[3]);
+}
+#endif
+
 void MixerChannel::FillUp(void) {
 	if (!enabled) return;
 
@@ -858,6 +1093,9 @@ void MIXER_Init(Section* sec) {
 	mixer.pos=0;
 	mixer.done=0;
 	memset(mixer.work,0,sizeof(mixer.work));
+#ifdef DBP_MIXER_SIMD_SELF_TEST
+	MIXER_SIMD_SelfTest();
+#endif
 #ifdef C_DBP_LIBRETRO
 	mixer.mastervol[0]=dbp_master_volume;
 	mixer.mastervol[1]=dbp_master_volume;
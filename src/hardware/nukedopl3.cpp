@@ -1350,7 +1350,7 @@ static Bit64s __rdtsc() { struct timeval tv; gettimeofday(&tv, NULL); return ((B
 #endif
 #endif
 
-void NukedOPL::Handler::Generate(MixerChannel* chan, Bitu samples)
+void NukedOPL::Handler::Generate(Bit32s* res, Bitu samples)
 {
     Bit16s buf[1024 * 2];
     for (Bitu block; samples; samples -= block)
@@ -1412,7 +1412,8 @@ void NukedOPL::Handler::Generate(MixerChannel* chan, Bitu samples)
         }
         #endif
 
-        chan->AddSamples_s16(block, buf);
+        for (const Bit16s *in = buf, *in_end = buf + block * 2; in != in_end;)
+            *(res++) = *(in++);
 
         #ifndef DBP_NUKED_BIT_ACCURATE
         active_check += (Bit16u)block;
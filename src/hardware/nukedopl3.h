@@ -142,7 +142,7 @@ namespace NukedOPL
         Bit8u newm;
         virtual void WriteReg(Bit32u reg, Bit8u val);
         virtual Bit32u WriteAddr(Bit32u port, Bit8u val);
-        virtual void Generate(MixerChannel* chan, Bitu samples);
+        virtual void Generate(Bit32s* out, Bitu samples);
         virtual void Init(Bitu rate);
     };
 }
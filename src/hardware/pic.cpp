@@ -168,15 +168,53 @@ struct PICEntry {
 	float index;
 	Bitu value;
 	PIC_EventHandler pic_event;
-	PICEntry * next;
+	Bit32u order; // insertion order, keeps events with the same index in the order they were added
 };
 
+//DBP: The event queue is a binary min-heap ordered by index (and insertion order for equal indices)
+// instead of a sorted linked list which made adding events O(n)
 static struct {
 	PICEntry entries[PIC_QUEUESIZE];
-	PICEntry * free_entry;
-	PICEntry * next_entry;
+	Bitu count;
+	Bit32u order;
 } pic_queue;
 
+static INLINE bool PIC_EntryBefore(const PICEntry& a, const PICEntry& b) {
+	return (a.index < b.index || (a.index == b.index && (Bit32s)(a.order - b.order) < 0));
+}
+
+static void PIC_HeapSiftUp(Bitu i) {
+	PICEntry entry = pic_queue.entries[i];
+	while (i) {
+		Bitu parent = (i - 1) >> 1;
+		if (!PIC_EntryBefore(entry, pic_queue.entries[parent])) break;
+		pic_queue.entries[i] = pic_queue.entries[parent];
+		i = parent;
+	}
+	pic_queue.entries[i] = entry;
+}
+
+static void PIC_HeapSiftDown(Bitu i) {
+	PICEntry entry = pic_queue.entries[i];
+	for (Bitu child; (child = i * 2 + 1) < pic_queue.count; i = child) {
+		if (child + 1 < pic_queue.count && PIC_EntryBefore(pic_queue.entries[child + 1], pic_queue.entries[child])) child++;
+		if (!PIC_EntryBefore(pic_queue.entries[child], entry)) break;
+		pic_queue.entries[i] = pic_queue.entries[child];
+	}
+	pic_queue.entries[i] = entry;
+}
+
+static void PIC_HeapPop(void) {
+	if (--pic_queue.count) {
+		pic_queue.entries[0] = pic_queue.entries[pic_queue.count];
+		PIC_HeapSiftDown(0);
+	}
+}
+
+static void PIC_HeapRebuild(void) {
+	for (Bitu i = pic_queue.count / 2; i--;) PIC_HeapSiftDown(i);
+}
+
 static void write_command(Bitu port,Bitu val,Bitu /*iolen*/) {
 	PIC_Controller * pic = &pics[port==0x20 ? 0 : 1];
 
@@ -371,30 +409,8 @@ void PIC_SetIRQMask(Bitu irq, bool masked) {
 }
 
 static void AddEntry(PICEntry * entry) {
-	PICEntry * find_entry=pic_queue.next_entry;
-	if (GCC_UNLIKELY(find_entry ==0)) {
-		entry->next=0;
-		pic_queue.next_entry=entry;
-	} else if (find_entry->index>entry->index) {
-		pic_queue.next_entry=entry;
-		entry->next=find_entry;
-	} else while (find_entry) {
-		if (find_entry->next) {
-			/* See if the next index comes later than this one */
-			if (find_entry->next->index > entry->index) {
-				entry->next=find_entry->next;
-				find_entry->next=entry;
-				break;
-			} else {
-				find_entry=find_entry->next;
-			}
-		} else {
-			entry->next=find_entry->next;
-			find_entry->next=entry;
-			break;
-		}
-	}
-	Bits cycles=PIC_MakeCycles(pic_queue.next_entry->index-PIC_TickIndex());
+	PIC_HeapSiftUp(entry - pic_queue.entries);
+	Bits cycles=PIC_MakeCycles(pic_queue.entries[0].index-PIC_TickIndex());
 	if (cycles<CPU_Cycles) {
 		CPU_CycleLeft+=CPU_Cycles;
 		CPU_Cycles=0;
@@ -404,68 +420,45 @@ static bool InEventService = false;
 static float srv_lag = 0;
 
 void PIC_AddEvent(PIC_EventHandler handler,float delay,Bitu val) {
-	if (GCC_UNLIKELY(!pic_queue.free_entry)) {
+	if (GCC_UNLIKELY(pic_queue.count == PIC_QUEUESIZE)) {
 		DBP_ASSERT(false);
 		LOG(LOG_PIC,LOG_ERROR)("Event queue full");
 		return;
 	}
-	PICEntry * entry=pic_queue.free_entry;
+	PICEntry * entry=&pic_queue.entries[pic_queue.count++];
 	if(InEventService) entry->index = delay + srv_lag;
 	else entry->index = delay + PIC_TickIndex();
 
 	entry->pic_event=handler;
 	entry->value=val;
-	pic_queue.free_entry=pic_queue.free_entry->next;
+	entry->order=pic_queue.order++;
 	AddEntry(entry);
 }
 
 void PIC_RemoveSpecificEvents(PIC_EventHandler handler, Bitu val) {
-	PICEntry * entry=pic_queue.next_entry;
-	PICEntry * prev_entry;
-	prev_entry = 0;
-	while (entry) {
-		if (GCC_UNLIKELY((entry->pic_event == handler)) && (entry->value == val)) {
-			if (prev_entry) {
-				prev_entry->next=entry->next;
-				entry->next=pic_queue.free_entry;
-				pic_queue.free_entry=entry;
-				entry=prev_entry->next;
-				continue;
-			} else {
-				pic_queue.next_entry=entry->next;
-				entry->next=pic_queue.free_entry;
-				pic_queue.free_entry=entry;
-				entry=pic_queue.next_entry;
-				continue;
-			}
-		}
-		prev_entry=entry;
-		entry=entry->next;
+	// The heap array is compact so filtering it and rebuilding the heap if anything was removed is cheap
+	Bitu n = 0;
+	for (Bitu i = 0; i != pic_queue.count; i++) {
+		if (GCC_UNLIKELY((pic_queue.entries[i].pic_event == handler)) && (pic_queue.entries[i].value == val)) continue;
+		if (n != i) pic_queue.entries[n] = pic_queue.entries[i];
+		n++;
+	}
+	if (n != pic_queue.count) {
+		pic_queue.count = n;
+		PIC_HeapRebuild();
 	}
 }
 
 void PIC_RemoveEvents(PIC_EventHandler handler) {
-	PICEntry * entry=pic_queue.next_entry;
-	PICEntry * prev_entry;
-	prev_entry=0;
-	while (entry) {
-		if (GCC_UNLIKELY(entry->pic_event==handler)) {
-			if (prev_entry) {
-				prev_entry->next=entry->next;
-				entry->next=pic_queue.free_entry;
-				pic_queue.free_entry=entry;
-				entry=prev_entry->next;
-				continue;
-			} else {
-				pic_queue.next_entry=entry->next;
-				entry->next=pic_queue.free_entry;
-				pic_queue.free_entry=entry;
-				entry=pic_queue.next_entry;
-				continue;
-			}
-		}
-		prev_entry=entry;
-		entry=entry->next;
+	Bitu n = 0;
+	for (Bitu i = 0; i != pic_queue.count; i++) {
+		if (GCC_UNLIKELY(pic_queue.entries[i].pic_event==handler)) continue;
+		if (n != i) pic_queue.entries[n] = pic_queue.entries[i];
+		n++;
+	}
+	if (n != pic_queue.count) {
+		pic_queue.count = n;
+		PIC_HeapRebuild();
 	}
 }
 
@@ -480,22 +473,19 @@ bool PIC_RunQueue(void) {
 	/* Check the queue for an entry */
 	Bits index_nd=PIC_TickIndexND();
 	InEventService = true;
-	while (pic_queue.next_entry && (pic_queue.next_entry->index*CPU_CycleMax<=index_nd)) {
-		PICEntry * entry=pic_queue.next_entry;
-		pic_queue.next_entry=entry->next;
-
-		srv_lag = entry->index;
-		(entry->pic_event)(entry->value); // call the event handler
+	while (pic_queue.count && (pic_queue.entries[0].index*CPU_CycleMax<=index_nd)) {
+		/* Take the entry out of the queue before calling the handler which can add or remove events */
+		PICEntry entry=pic_queue.entries[0];
+		PIC_HeapPop();
 
-		/* Put the entry in the free list */
-		entry->next=pic_queue.free_entry;
-		pic_queue.free_entry=entry;
+		srv_lag = entry.index;
+		(entry.pic_event)(entry.value); // call the event handler
 	}
 	InEventService = false;
 
 	/* Check when to set the new cycle end */
-	if (pic_queue.next_entry) {
-		Bits cycles=(Bits)(pic_queue.next_entry->index*CPU_CycleMax-index_nd);
+	if (pic_queue.count) {
+		Bits cycles=(Bits)(pic_queue.entries[0].index*CPU_CycleMax-index_nd);
 		if (GCC_UNLIKELY(!cycles)) cycles=1;
 		if (cycles<CPU_CycleLeft) {
 			CPU_Cycles=cycles;
@@ -544,11 +534,13 @@ void TIMER_AddTick(void) {
 	CPU_Cycles=0;
 	PIC_Ticks++;
 	/* Go through the list of scheduled events and lower their index with 1000 */
-	PICEntry * entry=pic_queue.next_entry;
-	while (entry) {
-		entry->index -= 1.0;
-		entry=entry->next;
+	bool reorder = false;
+	for (Bitu i = 0; i != pic_queue.count; i++) {
+		pic_queue.entries[i].index -= 1.0;
+		// Float rounding can make two indices equal which might break the insertion order of the heap
+		if (i && PIC_EntryBefore(pic_queue.entries[i], pic_queue.entries[(i - 1) >> 1])) reorder = true;
 	}
+	if (GCC_UNLIKELY(reorder)) PIC_HeapRebuild();
 	/* Call our list of ticker handlers */
 	TickerBlock * ticker=firstticker;
 	while (ticker) {
@@ -602,12 +594,8 @@ public:
 		WriteHandler[2].Install(0xa0,write_command,IO_MB);
 		WriteHandler[3].Install(0xa1,write_data,IO_MB);
 		/* Initialize the pic queue */
-		for (i=0;i<PIC_QUEUESIZE-1;i++) {
-			pic_queue.entries[i].next=&pic_queue.entries[i+1];
-		}
-		pic_queue.entries[PIC_QUEUESIZE-1].next=0;
-		pic_queue.free_entry=&pic_queue.entries[0];
-		pic_queue.next_entry=0;
+		pic_queue.count=0;
+		pic_queue.order=0;
 	}
 
 	~PIC_8259A(){
@@ -628,7 +616,8 @@ void PIC_Init(Section* sec) {
 }
 
 #include <dbp_serialize.h>
-#include <string.h> /* memset */
+#include <string.h> /* memset, memcpy */
+#include <algorithm> /* std::sort */
 
 void DBPSerialize_PIC(DBPArchive& ar)
 {
@@ -660,7 +649,11 @@ void DBPSerialize_PIC(DBPArchive& ar)
 	}
 	else if (ar.mode != DBPArchive::MODE_LOAD)
 	{
-		for (PICEntry* it = pic_queue.next_entry; it; it = it->next)
+		// Store the events sorted by the order they will be processed to keep compatibility with the linked list queue of older versions
+		PICEntry sorted[PIC_QUEUESIZE];
+		memcpy(sorted, pic_queue.entries, pic_queue.count * sizeof(PICEntry));
+		std::sort(sorted, sorted + pic_queue.count, PIC_EntryBefore);
+		for (PICEntry* it = sorted, *itEnd = sorted + pic_queue.count; it != itEnd; it++)
 		{
 			// skip storing state irrelevant union and zip drive events which keep a pointer in the value
 			if (it->pic_event == DBPSerializePIC_EventHandlerunionDrivePtrs[0]) continue;
@@ -703,7 +696,7 @@ void DBPSerialize_PIC(DBPArchive& ar)
 
 	if (ar.mode == DBPArchive::MODE_LOAD)
 	{
-		for (Bit16u i = 0; i != PIC_QUEUESIZE-1; i++) pic_queue.entries[i].next = &pic_queue.entries[i+1];
+		// The stored events are sorted which already is a valid heap
 		for (Bit16u i = 0, iMax = pic_count, fix = 0; i != iMax; i++)
 		{
 			// skip loading state irrelevant union drive event from old saves which has a pointer in its value
@@ -711,20 +704,15 @@ void DBPSerialize_PIC(DBPArchive& ar)
 			pic_queue.entries[i-fix].index     = pic_indices[i];
 			pic_queue.entries[i-fix].value     = pic_values[i];
 			pic_queue.entries[i-fix].pic_event = pic_events[i];
+			pic_queue.entries[i-fix].order     = (Bit32u)(i-fix);
 		}
-		pic_queue.entries[PIC_QUEUESIZE-1].next = NULL;
-		pic_queue.free_entry = (pic_count != PIC_QUEUESIZE ? &pic_queue.entries[pic_count] : NULL);
-		pic_queue.next_entry = (pic_count ? &pic_queue.entries[0] : NULL);
-		if (pic_count) pic_queue.entries[pic_count-1].next = NULL;
+		pic_queue.count = pic_count;
+		pic_queue.order = pic_count;
 	}
 }
 
 //void PIC_VALIDATE()
 //{
-//	int i, total = 0;
-//	PICEntry *last_entry = NULL, *last_free = NULL, *it;
-//	for (i = 0, it = pic_queue.next_entry; it; it = it->next, total++) { last_entry = it; DBP_ASSERT(i++ <= PIC_QUEUESIZE); }
-//	for (i = 0, it = pic_queue.free_entry; it; it = it->next, total++) { last_free = it; DBP_ASSERT(i++ <= PIC_QUEUESIZE); }
-//	DBP_ASSERT(total == PIC_QUEUESIZE || InEventService);
-//	DBP_ASSERT(!last_entry || !last_free || last_entry != last_free);
+//	DBP_ASSERT(pic_queue.count <= PIC_QUEUESIZE);
+//	for (Bitu i = 1; i < pic_queue.count; i++) DBP_ASSERT(!PIC_EntryBefore(pic_queue.entries[i], pic_queue.entries[(i - 1) >> 1]));
 //}
@@ -707,7 +707,9 @@ public:
 		return vga.tandy.mem_base + (phys_page * 4096);
 	}
 	HostPt GetHostWritePt(Bitu phys_page) {
-		return GetHostReadPt( phys_page );
+		HostPt host = GetHostReadPt( phys_page );
+		MEM_MarkHostDirty(host); //DBP: video memory is part of MemBase
+		return host;
 	}
 };
 
@@ -725,7 +727,9 @@ public:
 		return vga.tandy.mem_base + (phys_page * 4096);
 	}
 	HostPt GetHostWritePt(Bitu phys_page) {
-		return GetHostReadPt( phys_page );
+		HostPt host = GetHostReadPt( phys_page );
+		MEM_MarkHostDirty(host); //DBP: video memory is part of MemBase
+		return host;
 	}
 };
 
@@ -284,6 +284,9 @@ enum
 
 enum { MAX_TRIANGLE_THREADS = 7, MAX_TRIANGLE_WORKERS = MAX_TRIANGLE_THREADS + 1 };
 
+/* triangles are queued in batches and binned into bands of scanlines, each band is owned by one worker */
+enum { TRIANGLE_BATCH_SIZE = 256, TRIANGLE_BAND_SHIFT = 3, TRIANGLE_BANDS = 1024 >> TRIANGLE_BAND_SHIFT };
+
 /* maximum number of TMUs */
 #define MAX_TMU					2
 
@@ -486,9 +489,12 @@ static const UINT8 dither_matrix_2x2[16] =
 #define FBZCP_CCA_ADD_ACLOCAL(val)			(((val) >> 23) & 3)
 #define FBZCP_CCA_INVERT_OUTPUT_BIT			(1 << 25)
 #define FBZCP_CCA_INVERT_OUTPUT(val)		(((val) >> 25) & 1)
+#define FBZCP_CCA_SUBPIXEL_ADJUST_BIT		(1 << 26)
 #define FBZCP_CCA_SUBPIXEL_ADJUST(val)		(((val) >> 26) & 1)
+#define FBZCP_TEXTURE_ENABLE_BIT			(1 << 27)
 #define FBZCP_TEXTURE_ENABLE(val)			(((val) >> 27) & 1)
 #define FBZCP_RGBZW_CLAMP(val)				(((val) >> 28) & 1)		/* voodoo 2 only */
+#define FBZCP_ANTI_ALIAS_BIT				(1 << 29)		/* voodoo 2 only */
 #define FBZCP_ANTI_ALIAS(val)				(((val) >> 29) & 1)		/* voodoo 2 only */
 
 #define ALPHAMODE_ALPHATEST_BIT				(1 << 0)
@@ -541,7 +547,7 @@ static const UINT8 dither_matrix_2x2[16] =
 #define FBZMODE_STIPPLE_PATTERN(val)		(((val) >> 12) & 1)
 #define FBZMODE_ENABLE_ALPHA_MASK_BIT		(1 << 13)
 #define FBZMODE_ENABLE_ALPHA_MASK(val)		(((val) >> 13) & 1)
-#define FBZMODE_DRAW_BUFFER_BITS			(1 << 14)
+#define FBZMODE_DRAW_BUFFER_BITS			(3 << 14)
 #define FBZMODE_DRAW_BUFFER(val)			(((val) >> 14) & 3)
 #define FBZMODE_ENABLE_DEPTH_BIAS(val)		(((val) >> 16) & 1)
 #define FBZMODE_Y_ORIGIN_BIT				(1 << 17)
@@ -698,6 +704,7 @@ static const UINT8 dither_matrix_2x2[16] =
 #define TEXMODE_MAGNIFICATION_FILTER(val)	(((val) >> 2) & 1)
 #define TEXMODE_CLAMP_NEG_W(val)			(((val) >> 3) & 1)
 #define TEXMODE_ENABLE_LOD_DITHER(val)		(((val) >> 4) & 1)
+#define TEXMODE_NCC_TABLE_SELECT_BIT		(1 << 5)
 #define TEXMODE_NCC_TABLE_SELECT(val)		(((val) >> 5) & 1)
 #define TEXMODE_CLAMP_S_BIT					(1 << 6)
 #define TEXMODE_CLAMP_S(val)				(((val) >> 6) & 1)
@@ -730,6 +737,7 @@ static const UINT8 dither_matrix_2x2[16] =
 #define TEXMODE_TCA_INVERT_OUTPUT(val)		(((val) >> 29) & 1)
 #define TEXMODE_TRILINEAR_BIT				(1 << 30)
 #define TEXMODE_TRILINEAR(val)				(((val) >> 30) & 1)
+#define TEXMODE_SEQ_8_DOWNLD_BIT			((UINT32)1 << 31)
 #define TEXMODE_SEQ_8_DOWNLD(val)			(((val) >> 31) & 1)
 
 #define TEXLOD_LODMIN(val)					(((val) >> 0) & 0x3f)
@@ -951,15 +959,85 @@ struct draw_state
 	bool screen_update_pending;
 };
 
+struct voodoo_state;
+struct triangle_params;
+typedef void (*raster_func)(const voodoo_state *v, const triangle_params& tp, void *destbase, INT32 y, const poly_extent *extent, stats_block& stats);
+
+/* register state that selects a rasterizer */
+struct raster_key
+{
+	UINT32				tmus;					/* number of TMUs involved */
+	UINT32				fbzcp;					/* fbzColorPath */
+	UINT32				alphamode;				/* alphaMode */
+	UINT32				fogmode;				/* fogMode */
+	UINT32				fbzmode;				/* fbzMode */
+	UINT32				texmode0, texmode1;		/* textureMode of the TMUs */
+};
+
+/* rasterizer table entry */
+struct raster_info
+{
+	raster_key			key;					/* normalized register state */
+	raster_func			func;					/* specialized rasterizer */
+};
+
+/* register state that had no specialized rasterizer */
+struct raster_miss
+{
+	raster_key			key;					/* normalized register state */
+	UINT32				count;					/* number of triangles drawn */
+};
+
+/* per-triangle state captured when a triangle gets queued */
+struct triangle_params
+{
+	raster_func			raster;					/* rasterizer for the register state */
+	UINT16 *			drawbuf;				/* target buffer */
+	poly_vertex			v1, v2, v3;				/* vertices sorted by Y */
+	float				dxdy_v1v2, dxdy_v1v3, dxdy_v2v3; /* edge slopes */
+	INT32				v1y, v3y;				/* first and last (exclusive) scanline */
+	UINT32				tmus;					/* number of TMUs involved */
+	UINT32				texmode0, texmode1;		/* texture modes of the TMUs */
+
+	INT16				ax, ay;					/* vertex A x,y (12.4) */
+	INT32				startr, startg, startb, starta; /* starting R,G,B,A (12.12) */
+	INT32				startz;					/* starting Z (20.12) */
+	INT64				startw;					/* starting W (16.32) */
+	INT32				drdx, dgdx, dbdx, dadx;	/* delta R,G,B,A per X */
+	INT32				dzdx;					/* delta Z per X */
+	INT64				dwdx;					/* delta W per X */
+	INT32				drdy, dgdy, dbdy, dady;	/* delta R,G,B,A per Y */
+	INT32				dzdy;					/* delta Z per Y */
+	INT64				dwdy;					/* delta W per Y */
+
+	struct tmu_params
+	{
+		INT64			starts, startt;			/* starting S,T (14.18) */
+		INT64			startw;					/* starting W (2.30) */
+		INT64			dsdx, dtdx;				/* delta S,T per X */
+		INT64			dwdx;					/* delta W per X */
+		INT64			dsdy, dtdy;				/* delta S,T per Y */
+		INT64			dwdy;					/* delta W per Y */
+		INT32			lodbasetemp;			/* lodbase calculated by prepare_tmu */
+	} tmu[MAX_TMU];
+};
+
 struct triangle_worker
 {
 	bool threads_active;
 	UINT8 triangle_threads;
-	UINT16 *drawbuf;
-	poly_vertex v1, v2, v3;
-	INT32 v1y, v3y, totalpix;
+	INT32 numtris, batchpix;
 	Semaphore* sembegin;
 	volatile bool done[MAX_TRIANGLE_THREADS];
+	UINT16 bandnum[TRIANGLE_BANDS];
+	UINT16 bandtris[TRIANGLE_BANDS][TRIANGLE_BATCH_SIZE];
+	triangle_params tris[TRIANGLE_BATCH_SIZE];
+
+	raster_key rasterkey;
+	raster_func rasterfunc;
+	raster_miss* rastermiss;
+	UINT32 rasterhits, rastermisses, rastermissnum;
+	raster_miss rastermisslist[32];
 };
 
 struct voodoo_state
@@ -2921,6 +2999,7 @@ enum VoodoPerf : UINT8
 	#endif
 };
 static UINT8 v_perf;
+static bool v_lograsterizers; // log rasterizer table hits and the most common misses on shutdown
 
 #ifdef C_DBP_ENABLE_VOODOO_OPENGL
 static bool vogl_palette_changed;
@@ -5003,7 +5082,6 @@ static UINT8 dither2_lookup[256*16*2];
 #define LOG_REGISTERS		(0)
 #define LOG_LFB				(0)
 #define LOG_TEXTURE_RAM		(0)
-#define LOG_RASTERIZERS		(0)
 
 /*************************************
  *
@@ -5021,7 +5099,7 @@ static double Voodoo_GetHRetracePosition();
     RASTERIZER MANAGEMENT
 ***************************************************************************/
 
-static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEXMODE0, UINT32 TEXMODE1, void *destbase, INT32 y, const poly_extent *extent, stats_block& stats)
+static INLINE void raster_generic(const voodoo_state *v, const triangle_params& tp, UINT32 TMUS, UINT32 FBZCOLORPATH, UINT32 FBZMODE, UINT32 ALPHAMODE, UINT32 FOGMODE, UINT32 TEXMODE0, UINT32 TEXMODE1, void *destbase, INT32 y, const poly_extent *extent, stats_block& stats)
 {
 	DECLARE_DITHER_POINTERS;
 
@@ -5029,25 +5107,21 @@ static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEX
 	INT32 startx = extent->startx;
 	INT32 stopx = extent->stopx;
 
-	const fbi_state& fbi = v->fbi;
-	const tmu_state& tmu0 = v->tmu[0];
-	const tmu_state& tmu1 = v->tmu[1];
-	UINT32 r_fbzColorPath = v->reg[fbzColorPath].u;
-	UINT32 r_fbzMode = v->reg[fbzMode].u;
-	UINT32 r_alphaMode = v->reg[alphaMode].u;
-	UINT32 r_fogMode = v->reg[fogMode].u;
+	const triangle_params& fbi = tp;
+	const triangle_params::tmu_params& tmu0 = tp.tmu[0];
+	const triangle_params::tmu_params& tmu1 = tp.tmu[1];
 	UINT32 r_zaColor = v->reg[zaColor].u;
 	UINT32 r_stipple = v->reg[stipple].u;
 
 	/* determine the screen Y */
-	if (FBZMODE_Y_ORIGIN(r_fbzMode))
+	if (FBZMODE_Y_ORIGIN(FBZMODE))
 		scry = (v->fbi.yorigin - y) & 0x3ff;
 
 	/* compute the dithering pointers */
-	if (FBZMODE_ENABLE_DITHERING(r_fbzMode))
+	if (FBZMODE_ENABLE_DITHERING(FBZMODE))
 	{
 		dither4 = &dither_matrix_4x4[(y & 3) * 4];
-		if (FBZMODE_DITHER_TYPE(r_fbzMode) == 0)
+		if (FBZMODE_DITHER_TYPE(FBZMODE) == 0)
 		{
 			dither = dither4;
 			dither_lookup = &dither4_lookup[(y & 3) << 11];
@@ -5060,7 +5134,7 @@ static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEX
 	}
 
 	/* apply clipping */
-	if (FBZMODE_ENABLE_CLIPPING(r_fbzMode))
+	if (FBZMODE_ENABLE_CLIPPING(FBZMODE))
 	{
 		/* Y clipping buys us the whole scanline */
 		if (scry < (INT32)((v->reg[clipLowYHighY].u >> 16) & 0x3ff) ||
@@ -5120,7 +5194,7 @@ static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEX
 		rgb_union texel = { 0 };
 
 		/* pixel pipeline part 1 handles depth testing and stippling */
-		PIXEL_PIPELINE_BEGIN(v, stats, x, y, r_fbzColorPath, r_fbzMode, iterz, iterw, r_zaColor, r_stipple);
+		PIXEL_PIPELINE_BEGIN(v, stats, x, y, FBZCOLORPATH, FBZMODE, iterz, iterw, r_zaColor, r_stipple);
 
 		/* run the texture pipeline on TMU1 to produce a value in texel */
 		/* note that they set LOD min to 8 to "disable" a TMU */
@@ -5129,7 +5203,7 @@ static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEX
 			const tmu_state* const tmus = &v->tmu[1];
 			const rgb_t* const lookup = tmus->lookup;
 			TEXTURE_PIPELINE(tmus, x, dither4, TEXMODE1, texel,
-								lookup, tmus->lodbasetemp,
+								lookup, tmu1.lodbasetemp,
 								iters1, itert1, iterw1, texel);
 		}
 
@@ -5141,7 +5215,7 @@ static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEX
 				const tmu_state* const tmus = &v->tmu[0];
 				const rgb_t* const lookup = tmus->lookup;
 				TEXTURE_PIPELINE(tmus, x, dither4, TEXMODE0, texel,
-								lookup, tmus->lodbasetemp,
+								lookup, tmu0.lodbasetemp,
 								iters0, itert0, iterw0, texel);
 			} else {	/* send config data to the frame buffer */
 				texel.u=v->tmu_config;
@@ -5149,7 +5223,7 @@ static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEX
 		}
 
 		/* colorpath pipeline selects source colors and does blending */
-		CLAMPED_ARGB(iterr, iterg, iterb, itera, r_fbzColorPath, iterargb);
+		CLAMPED_ARGB(iterr, iterg, iterb, itera, FBZCOLORPATH, iterargb);
 
 
 		INT32 blendr, blendg, blendb, blenda;
@@ -5157,7 +5231,7 @@ static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEX
 		rgb_union c_local;
 
 		/* compute c_other */
-		switch (FBZCP_CC_RGBSELECT(r_fbzColorPath))
+		switch (FBZCP_CC_RGBSELECT(FBZCOLORPATH))
 		{
 			case 0:		/* iterated RGB */
 				c_other.u = iterargb.u;
@@ -5174,10 +5248,10 @@ static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEX
 		}
 
 		/* handle chroma key */
-		APPLY_CHROMAKEY(v, stats, r_fbzMode, c_other);
+		APPLY_CHROMAKEY(v, stats, FBZMODE, c_other);
 
 		/* compute a_other */
-		switch (FBZCP_CC_ASELECT(r_fbzColorPath))
+		switch (FBZCP_CC_ASELECT(FBZCOLORPATH))
 		{
 			case 0:		/* iterated alpha */
 				c_other.rgb.a = iterargb.rgb.a;
@@ -5194,15 +5268,15 @@ static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEX
 		}
 
 		/* handle alpha mask */
-		APPLY_ALPHAMASK(v, stats, r_fbzMode, c_other.rgb.a);
+		APPLY_ALPHAMASK(v, stats, FBZMODE, c_other.rgb.a);
 
 		/* handle alpha test */
-		APPLY_ALPHATEST(v, stats, r_alphaMode, c_other.rgb.a);
+		APPLY_ALPHATEST(v, stats, ALPHAMODE, c_other.rgb.a);
 
 		/* compute c_local */
-		if (FBZCP_CC_LOCALSELECT_OVERRIDE(r_fbzColorPath) == 0)
+		if (FBZCP_CC_LOCALSELECT_OVERRIDE(FBZCOLORPATH) == 0)
 		{
-			if (FBZCP_CC_LOCALSELECT(r_fbzColorPath) == 0)	/* iterated RGB */
+			if (FBZCP_CC_LOCALSELECT(FBZCOLORPATH) == 0)	/* iterated RGB */
 				c_local.u = iterargb.u;
 			else											/* color0 RGB */
 				c_local.u = v->reg[color0].u;
@@ -5216,7 +5290,7 @@ static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEX
 		}
 
 		/* compute a_local */
-		switch (FBZCP_CCA_LOCALSELECT(r_fbzColorPath))
+		switch (FBZCP_CCA_LOCALSELECT(FBZCOLORPATH))
 		{
 			case 0:		/* iterated alpha */
 				c_local.rgb.a = iterargb.rgb.a;
@@ -5227,21 +5301,21 @@ static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEX
 			case 2:		/* clamped iterated Z[27:20] */
 			{
 				int temp;
-				CLAMPED_Z(iterz, r_fbzColorPath, temp);
+				CLAMPED_Z(iterz, FBZCOLORPATH, temp);
 				c_local.rgb.a = (UINT8)temp;
 				break;
 			}
 			case 3:		/* clamped iterated W[39:32] */
 			{
 				int temp;
-				CLAMPED_W(iterw, r_fbzColorPath, temp);			/* Voodoo 2 only */
+				CLAMPED_W(iterw, FBZCOLORPATH, temp);			/* Voodoo 2 only */
 				c_local.rgb.a = (UINT8)temp;
 				break;
 			}
 		}
 
 		/* select zero or c_other */
-		if (FBZCP_CC_ZERO_OTHER(r_fbzColorPath) == 0)
+		if (FBZCP_CC_ZERO_OTHER(FBZCOLORPATH) == 0)
 		{
 			r = c_other.rgb.r;
 			g = c_other.rgb.g;
@@ -5251,13 +5325,13 @@ static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEX
 			r = g = b = 0;
 
 		/* select zero or a_other */
-		if (FBZCP_CCA_ZERO_OTHER(r_fbzColorPath) == 0)
+		if (FBZCP_CCA_ZERO_OTHER(FBZCOLORPATH) == 0)
 			a = c_other.rgb.a;
 		else
 			a = 0;
 
 		/* subtract c_local */
-		if (FBZCP_CC_SUB_CLOCAL(r_fbzColorPath))
+		if (FBZCP_CC_SUB_CLOCAL(FBZCOLORPATH))
 		{
 			r -= c_local.rgb.r;
 			g -= c_local.rgb.g;
@@ -5265,11 +5339,11 @@ static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEX
 		}
 
 		/* subtract a_local */
-		if (FBZCP_CCA_SUB_CLOCAL(r_fbzColorPath))
+		if (FBZCP_CCA_SUB_CLOCAL(FBZCOLORPATH))
 			a -= c_local.rgb.a;
 
 		/* blend RGB */
-		switch (FBZCP_CC_MSELECT(r_fbzColorPath))
+		switch (FBZCP_CC_MSELECT(FBZCOLORPATH))
 		{
 			default:	/* reserved */
 			case 0:		/* 0 */
@@ -5297,7 +5371,7 @@ static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEX
 		}
 
 		/* blend alpha */
-		switch (FBZCP_CCA_MSELECT(r_fbzColorPath))
+		switch (FBZCP_CCA_MSELECT(FBZCOLORPATH))
 		{
 			default:	/* reserved */
 			case 0:		/* 0 */
@@ -5318,7 +5392,7 @@ static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEX
 		}
 
 		/* reverse the RGB blend */
-		if (!FBZCP_CC_REVERSE_BLEND(r_fbzColorPath))
+		if (!FBZCP_CC_REVERSE_BLEND(FBZCOLORPATH))
 		{
 			blendr ^= 0xff;
 			blendg ^= 0xff;
@@ -5326,7 +5400,7 @@ static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEX
 		}
 
 		/* reverse the alpha blend */
-		if (!FBZCP_CCA_REVERSE_BLEND(r_fbzColorPath))
+		if (!FBZCP_CCA_REVERSE_BLEND(FBZCOLORPATH))
 			blenda ^= 0xff;
 
 		/* do the blend */
@@ -5336,7 +5410,7 @@ static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEX
 		a = (a * (blenda + 1)) >> 8;
 
 		/* add clocal or alocal to RGB */
-		switch (FBZCP_CC_ADD_ACLOCAL(r_fbzColorPath))
+		switch (FBZCP_CC_ADD_ACLOCAL(FBZCOLORPATH))
 		{
 			case 3:		/* reserved */
 			case 0:		/* nothing */
@@ -5354,7 +5428,7 @@ static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEX
 		}
 
 		/* add clocal or alocal to alpha */
-		if (FBZCP_CCA_ADD_ACLOCAL(r_fbzColorPath))
+		if (FBZCP_CCA_ADD_ACLOCAL(FBZCOLORPATH))
 			a += c_local.rgb.a;
 
 		/* clamp */
@@ -5364,21 +5438,21 @@ static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEX
 		CLAMP(a, 0x00, 0xff);
 
 		/* invert */
-		if (FBZCP_CC_INVERT_OUTPUT(r_fbzColorPath))
+		if (FBZCP_CC_INVERT_OUTPUT(FBZCOLORPATH))
 		{
 			r ^= 0xff;
 			g ^= 0xff;
 			b ^= 0xff;
 		}
-		if (FBZCP_CCA_INVERT_OUTPUT(r_fbzColorPath))
+		if (FBZCP_CCA_INVERT_OUTPUT(FBZCOLORPATH))
 			a ^= 0xff;
 
 
 		/* pixel pipeline part 2 handles fog, alpha, and final output */
 		PIXEL_PIPELINE_MODIFY(v, dither, dither4, x,
-							r_fbzMode, r_fbzColorPath, r_alphaMode, r_fogMode,
+							FBZMODE, FBZCOLORPATH, ALPHAMODE, FOGMODE,
 							iterz, iterw, iterargb);
-		PIXEL_PIPELINE_FINISH(v, dither_lookup, x, dest, depth, r_fbzMode);
+		PIXEL_PIPELINE_FINISH(v, dither_lookup, x, dest, depth, FBZMODE);
 		PIXEL_PIPELINE_END(stats);
 
 		/* update the iterated parameters */
@@ -5403,6 +5477,149 @@ static INLINE void raster_generic(const voodoo_state *v, UINT32 TMUS, UINT32 TEX
 	}
 }
 
+/*-------------------------------------------------
+    raster_specialized - raster_generic with the
+    register state compiled in as constants
+-------------------------------------------------*/
+template <UINT32 TMUS, UINT32 FBZCOLORPATH, UINT32 ALPHAMODE, UINT32 FOGMODE, UINT32 FBZMODE, UINT32 TEXMODE0, UINT32 TEXMODE1>
+static void raster_specialized(const voodoo_state *v, const triangle_params& tp, void *destbase, INT32 y, const poly_extent *extent, stats_block& stats)
+{
+	raster_generic(v, tp, TMUS, FBZCOLORPATH, FBZMODE, ALPHAMODE, FOGMODE, TEXMODE0, TEXMODE1, destbase, y, extent, stats);
+}
+
+/*-------------------------------------------------
+    raster_fallback - raster_generic reading the
+    register state at runtime
+-------------------------------------------------*/
+static void raster_fallback(const voodoo_state *v, const triangle_params& tp, void *destbase, INT32 y, const poly_extent *extent, stats_block& stats)
+{
+	raster_generic(v, tp, tp.tmus, v->reg[fbzColorPath].u, v->reg[fbzMode].u, v->reg[alphaMode].u, v->reg[fogMode].u, tp.texmode0, tp.texmode1, destbase, y, extent, stats);
+}
+
+/* keys are normalized (see raster_normalize_key), entries can be taken from the voodoo_lograsterizers output */
+#define RASTERIZER_ENTRY(tmus, fbzcp, alphamode, fogmode, fbzmode, texmode0, texmode1) \
+	{ { tmus, fbzcp, alphamode, fogmode, fbzmode, texmode0, texmode1 }, raster_specialized<tmus, fbzcp, alphamode, fogmode, fbzmode, texmode0, texmode1> }
+
+static const raster_info raster_table[] =
+{
+	/* seeded from the most common single TMU states in MAME's rasterizer table (blitz, mace, carnevil, gauntleg, calspeed) */
+	RASTERIZER_ENTRY( 1, 0x00002C35, 0x00515110, 0x00000000, 0x000B07F9, 0x0C261A0F, 0x00000000 ),
+	RASTERIZER_ENTRY( 1, 0x00000035, 0x00000000, 0x00000000, 0x000B073B, 0x0C261A0F, 0x00000000 ),
+	RASTERIZER_ENTRY( 1, 0x00000035, 0x00000000, 0x00000000, 0x000B07F9, 0x0C261A0F, 0x00000000 ),
+	RASTERIZER_ENTRY( 1, 0x00002C35, 0x00000000, 0x00000000, 0x000B07F9, 0x0C261A0F, 0x00000000 ),
+	RASTERIZER_ENTRY( 1, 0x00002C35, 0x00515110, 0x00000000, 0x000B073B, 0x0C261A0F, 0x00000000 ),
+	RASTERIZER_ENTRY( 1, 0x00002C35, 0x00000000, 0x00000000, 0x000B073B, 0x0C261A0F, 0x00000000 ),
+	RASTERIZER_ENTRY( 1, 0x00000035, 0x00000000, 0x00000000, 0x000B07F9, 0x0C261A09, 0x00000000 ),
+	RASTERIZER_ENTRY( 1, 0x00002C35, 0x00515110, 0x00000000, 0x000B07F9, 0x0C261A09, 0x00000000 ),
+	RASTERIZER_ENTRY( 1, 0x00000035, 0x00000000, 0x00000000, 0x000B0739, 0x0C261A0F, 0x00000000 ),
+	RASTERIZER_ENTRY( 1, 0x00000035, 0x00000009, 0x00000000, 0x000B0739, 0x0C261A0F, 0x00000000 ),
+	RASTERIZER_ENTRY( 1, 0x00002425, 0x00045119, 0x00000000, 0x00010F79, 0x0C261A0F, 0x00000000 ),
+	RASTERIZER_ENTRY( 1, 0x00002425, 0x00045119, 0x00000000, 0x00010F79, 0x0C261ACF, 0x00000000 ),
+	RASTERIZER_ENTRY( 1, 0x00002425, 0x00045119, 0x00000000, 0x00010F79, 0x0C261A09, 0x00000000 ),
+	RASTERIZER_ENTRY( 1, 0x00002425, 0x00000000, 0x00000000, 0x00010F79, 0x0C261A0F, 0x00000000 ),
+	RASTERIZER_ENTRY( 1, 0x00002425, 0x00045119, 0x00000000, 0x000002F9, 0x0C261A0F, 0x00000000 ),
+	RASTERIZER_ENTRY( 1, 0x00002C35, 0x00000000, 0x00000000, 0x00000B39, 0x0C261A09, 0x00000000 ),
+	RASTERIZER_ENTRY( 1, 0x00002425, 0x00045119, 0x00000000, 0x00000B31, 0x0C261A0F, 0x00000000 ),
+
+	/* untextured fills and gouraud shading */
+	RASTERIZER_ENTRY( 0, 0x00000002, 0x00000000, 0x00000000, 0x00000300, 0x00000000, 0x00000000 ),
+	RASTERIZER_ENTRY( 0, 0x00000035, 0x00000000, 0x00000000, 0x00000300, 0x00000000, 0x00000000 ),
+	RASTERIZER_ENTRY( 0, 0x0142610A, 0x00045110, 0x00000000, 0x00000331, 0x00000000, 0x00000000 ),
+
+	{ { 0 }, NULL } /* end of table */
+};
+
+#undef RASTERIZER_ENTRY
+
+/*-------------------------------------------------
+    raster_normalize_key - clear register bits
+    the rasterizer ignores or reads at runtime
+-------------------------------------------------*/
+static INLINE void raster_normalize_key(raster_key& key)
+{
+	key.fbzcp &= ~(FBZCP_CCA_SUBPIXEL_ADJUST_BIT | FBZCP_TEXTURE_ENABLE_BIT | FBZCP_ANTI_ALIAS_BIT);
+	key.fbzmode &= ~FBZMODE_DRAW_BUFFER_BITS;
+	if (!FBZMODE_ENABLE_DEPTHBUF(key.fbzmode))
+		key.fbzmode &= ~(FBZMODE_DEPTH_FUNCTION_BITS | FBZMODE_DEPTH_SOURCE_COMPARE_BIT);
+	key.alphamode &= ~(ALPHAMODE_ANTIALIAS_BIT | ALPHAMODE_ALPHAREF_BITS);
+	if (!ALPHAMODE_ALPHATEST(key.alphamode))
+		key.alphamode &= ~ALPHAMODE_ALPHAFUNCTION_BITS;
+	if (!ALPHAMODE_ALPHABLEND(key.alphamode))
+		key.alphamode &= ~(ALPHAMODE_SRCRGBBLEND_BITS | ALPHAMODE_DSTRGBBLEND_BITS | ALPHAMODE_SRCALPHABLEND_BITS | ALPHAMODE_DSTALPHABLEND_BITS);
+	if (!FOGMODE_ENABLE_FOG(key.fogmode))
+		key.fogmode = 0;
+	key.texmode0 &= ~(TEXMODE_NCC_TABLE_SELECT_BIT | TEXMODE_TRILINEAR_BIT | TEXMODE_SEQ_8_DOWNLD_BIT);
+	key.texmode1 &= ~(TEXMODE_NCC_TABLE_SELECT_BIT | TEXMODE_TRILINEAR_BIT | TEXMODE_SEQ_8_DOWNLD_BIT);
+}
+
+/*-------------------------------------------------
+    raster_select - find the rasterizer for the
+    current register state
+-------------------------------------------------*/
+static raster_func raster_select(triangle_worker& tworker, UINT32 tmus, UINT32 texmode0, UINT32 texmode1)
+{
+	raster_key key = { tmus, v->reg[fbzColorPath].u, v->reg[alphaMode].u, v->reg[fogMode].u, v->reg[fbzMode].u, texmode0, texmode1 };
+	raster_normalize_key(key);
+
+	/* most consecutive triangles share the same state */
+	if (!tworker.rasterfunc || memcmp(&key, &tworker.rasterkey, sizeof(key)))
+	{
+		tworker.rasterkey = key;
+		tworker.rasterfunc = raster_fallback;
+		tworker.rastermiss = NULL;
+		for (const raster_info* ri = raster_table; ri->func; ri++)
+		{
+			if (memcmp(&key, &ri->key, sizeof(key))) continue;
+			tworker.rasterfunc = ri->func;
+			break;
+		}
+		if (tworker.rasterfunc == raster_fallback)
+		{
+			for (UINT32 i = 0; i != tworker.rastermissnum; i++)
+			{
+				if (memcmp(&key, &tworker.rastermisslist[i].key, sizeof(key))) continue;
+				tworker.rastermiss = &tworker.rastermisslist[i];
+				break;
+			}
+			if (!tworker.rastermiss && tworker.rastermissnum != ARRAY_LENGTH(tworker.rastermisslist))
+			{
+				tworker.rastermiss = &tworker.rastermisslist[tworker.rastermissnum++];
+				tworker.rastermiss->key = key;
+				tworker.rastermiss->count = 0;
+			}
+		}
+	}
+
+	if (tworker.rasterfunc != raster_fallback)
+		tworker.rasterhits++;
+	else
+	{
+		tworker.rastermisses++;
+		if (tworker.rastermiss) tworker.rastermiss->count++;
+	}
+	return tworker.rasterfunc;
+}
+
+/*-------------------------------------------------
+    raster_log_misses - print the register states
+    that most often missed the rasterizer table
+-------------------------------------------------*/
+static void raster_log_misses(triangle_worker& tworker)
+{
+	if (!tworker.rasterhits && !tworker.rastermisses)
+		return;
+	LOG_MSG("VOODOO: %u triangles drawn by specialized rasterizers, %u by the generic rasterizer", tworker.rasterhits, tworker.rastermisses);
+	for (UINT32 i = 1; i < tworker.rastermissnum; i++)
+		for (UINT32 j = i; j && tworker.rastermisslist[j - 1].count < tworker.rastermisslist[j].count; j--)
+			std::swap(tworker.rastermisslist[j - 1], tworker.rastermisslist[j]);
+	for (UINT32 i = 0; i != tworker.rastermissnum; i++)
+	{
+		const raster_key& k = tworker.rastermisslist[i].key;
+		LOG_MSG("\tRASTERIZER_ENTRY( %u, 0x%08X, 0x%08X, 0x%08X, 0x%08X, 0x%08X, 0x%08X ), /* %u triangles */",
+			k.tmus, k.fbzcp, k.alphamode, k.fogmode, k.fbzmode, k.texmode0, k.texmode1, tworker.rastermisslist[i].count);
+	}
+}
+
 /***************************************************************************
     GENERIC RASTERIZERS
 ***************************************************************************/
@@ -6015,7 +6232,7 @@ static void accumulate_statistics(voodoo_state *v, const stats_block *stats)
 static void update_statistics(voodoo_state *v, bool accumulate)
 {
 	/* accumulate/reset statistics from all units */
-	for (size_t i = 0; i != v->tworker.triangle_threads; i++)
+	for (size_t i = 0; i != (size_t)v->tworker.triangle_threads + 1; i++)
 	{
 		if (accumulate)
 			accumulate_statistics(v, &v->thread_stats[i]);
@@ -6033,67 +6250,52 @@ static void update_statistics(voodoo_state *v, bool accumulate)
     COMMAND HANDLERS
 ***************************************************************************/
 
-static void triangle_worker_work(triangle_worker& tworker, INT32 worktstart, INT32 worktend)
+static void triangle_worker_work(triangle_worker& tworker, INT32 worker, INT32 workers)
 {
-	/* determine the number of TMUs involved */
-	UINT32 tmus = 0, texmode0 = 0, texmode1 = 0;
-	if (!FBIINIT3_DISABLE_TMUS(v->reg[fbiInit3].u) && FBZCP_TEXTURE_ENABLE(v->reg[fbzColorPath].u))
-	{
-		tmus = 1;
-		texmode0 = v->tmu[0].reg[textureMode].u;
-		if (v->chipmask & 0x04)
-		{
-			tmus = 2;
-			texmode1 = v->tmu[1].reg[textureMode].u;
-		}
-		if (v_perf & V_PERFFLAG_LOWQUALITY) //force disable bilinear filter
-		{
-			texmode0 &= ~6;
-			texmode1 &= ~6;
-		}
-	}
-
-	/* compute the slopes for each portion of the triangle */
-	poly_vertex v1 = tworker.v1, v2 = tworker.v2, v3 = tworker.v3;
-	float dxdy_v1v2 = (v2.y == v1.y) ? 0.0f : (v2.x - v1.x) / (v2.y - v1.y);
-	float dxdy_v1v3 = (v3.y == v1.y) ? 0.0f : (v3.x - v1.x) / (v3.y - v1.y);
-	float dxdy_v2v3 = (v3.y == v2.y) ? 0.0f : (v3.x - v2.x) / (v3.y - v2.y);
-
 	stats_block my_stats = {0};
-	INT32 from = tworker.totalpix * worktstart / (tworker.triangle_threads + 1);
-	INT32 to   = tworker.totalpix * worktend   / (tworker.triangle_threads + 1);
-	for (INT32 curscan = tworker.v1y, scanend = tworker.v3y, sumpix = 0, lastsum = 0; curscan != scanend && lastsum < to; lastsum = sumpix, curscan++)
+	for (INT32 band = worker; band < TRIANGLE_BANDS; band += workers)
 	{
-		float fully = (float)(curscan) + 0.5f;
-		float startx = v1.x + (fully - v1.y) * dxdy_v1v3;
+		/* triangles binned into a band are drawn in the order they were queued */
+		for (const UINT16 *it = tworker.bandtris[band], *itEnd = it + tworker.bandnum[band]; it != itEnd; it++)
+		{
+			const triangle_params& tp = tworker.tris[*it];
+			const poly_vertex &v1 = tp.v1, &v2 = tp.v2;
 
-		/* compute the ending X based on which part of the triangle we're in */
-		float stopx = (fully < v2.y ? (v1.x + (fully - v1.y) * dxdy_v1v2) : (v2.x + (fully - v2.y) * dxdy_v2v3));
+			/* bands repeat every 1024 scanlines, find the first repetition that overlaps the triangle */
+			INT32 bandy = (tp.v1y & ~((TRIANGLE_BANDS << TRIANGLE_BAND_SHIFT) - 1)) + (band << TRIANGLE_BAND_SHIFT);
+			if (bandy + (1 << TRIANGLE_BAND_SHIFT) <= tp.v1y)
+				bandy += (TRIANGLE_BANDS << TRIANGLE_BAND_SHIFT);
 
-		/* clamp to full pixels */
-		poly_extent extent;
-		extent.startx = round_coordinate(startx);
-		extent.stopx = round_coordinate(stopx);
+			for (; bandy < tp.v3y; bandy += (TRIANGLE_BANDS << TRIANGLE_BAND_SHIFT))
+			{
+				INT32 curscan = (bandy < tp.v1y ? tp.v1y : bandy);
+				INT32 scanend = (bandy + (1 << TRIANGLE_BAND_SHIFT) < tp.v3y ? bandy + (1 << TRIANGLE_BAND_SHIFT) : tp.v3y);
+				for (; curscan != scanend; curscan++)
+				{
+					float fully = (float)(curscan) + 0.5f;
+					float startx = v1.x + (fully - v1.y) * tp.dxdy_v1v3;
 
-		/* force start < stop */
-		if (extent.startx >= extent.stopx)
-		{
-			if (extent.startx == extent.stopx) continue;
-			std::swap(extent.startx, extent.stopx);
-		}
+					/* compute the ending X based on which part of the triangle we're in */
+					float stopx = (fully < v2.y ? (v1.x + (fully - v1.y) * tp.dxdy_v1v2) : (v2.x + (fully - v2.y) * tp.dxdy_v2v3));
 
-		sumpix += (extent.stopx - extent.startx);
+					/* clamp to full pixels */
+					poly_extent extent;
+					extent.startx = round_coordinate(startx);
+					extent.stopx = round_coordinate(stopx);
 
-		if (sumpix <= from)
-			continue;
-		if (lastsum < from)
-			extent.startx += (from - lastsum);
-		if (sumpix > to)
-			extent.stopx -= (sumpix - to);
+					/* force start < stop */
+					if (extent.startx >= extent.stopx)
+					{
+						if (extent.startx == extent.stopx) continue;
+						std::swap(extent.startx, extent.stopx);
+					}
 
-		raster_generic(v, tmus, texmode0, texmode1, tworker.drawbuf, curscan, &extent, my_stats);
+					tp.raster(v, tp, tp.drawbuf, curscan, &extent, my_stats);
+				}
+			}
+		}
 	}
-	sum_statistics(&v->thread_stats[worktstart], &my_stats);
+	sum_statistics(&v->thread_stats[worker], &my_stats);
 }
 
 static Thread::RET_t THREAD_CC triangle_worker_thread_func(void* p)
@@ -6103,7 +6305,7 @@ static Thread::RET_t THREAD_CC triangle_worker_thread_func(void* p)
 	{
 		tworker.sembegin[tnum].Wait();
 		if (tworker.threads_active)
-			triangle_worker_work(tworker, tnum, tnum + 1);
+			triangle_worker_work(tworker, tnum, tworker.triangle_threads + 1);
 		tworker.done[tnum] = true;
 	}
 	return 0;
@@ -6111,6 +6313,8 @@ static Thread::RET_t THREAD_CC triangle_worker_thread_func(void* p)
 
 static void triangle_worker_shutdown(triangle_worker& tworker)
 {
+	tworker.numtris = tworker.batchpix = 0;
+	memset(tworker.bandnum, 0, sizeof(tworker.bandnum));
 	if (!tworker.threads_active) return;
 	tworker.threads_active = false;
 	for (size_t i = 0; i != tworker.triangle_threads; i++) tworker.done[i] = false;
@@ -6120,58 +6324,99 @@ static void triangle_worker_shutdown(triangle_worker& tworker)
 	delete [] tworker.sembegin;
 }
 
-static void triangle_worker_run(triangle_worker& tworker)
+/*-------------------------------------------------
+    triangle_worker_flush - rasterize all queued
+    triangles, needs to be called before anything
+    reads or modifies state used by the rasterizer
+-------------------------------------------------*/
+static void triangle_worker_flush(triangle_worker& tworker)
 {
-	if (!(v_perf & V_PERFFLAG_MULTITHREAD))
+	if (!tworker.numtris)
+		return;
+
+	// Don't wake up threads for just a few pixels
+	if (!(v_perf & V_PERFFLAG_MULTITHREAD) || !tworker.triangle_threads || tworker.batchpix <= 350)
 	{
-		// do not use threaded calculation
-		tworker.totalpix = 0xFFFFFFF;
 		triangle_worker_work(tworker, 0, 1);
-		return;
 	}
-
-	/* compute the slopes for each portion of the triangle */
-	poly_vertex v1 = tworker.v1, v2 = tworker.v2, v3 = tworker.v3;
-	float dxdy_v1v2 = (v2.y == v1.y) ? 0.0f : (v2.x - v1.x) / (v2.y - v1.y);
-	float dxdy_v1v3 = (v3.y == v1.y) ? 0.0f : (v3.x - v1.x) / (v3.y - v1.y);
-	float dxdy_v2v3 = (v3.y == v2.y) ? 0.0f : (v3.x - v2.x) / (v3.y - v2.y);
-
-	INT32 pixsum = 0;
-	for (INT32 curscan = tworker.v1y, scanend = tworker.v3y; curscan != scanend; curscan++)
+	else
 	{
-		float fully = (float)(curscan) + 0.5f;
-		float startx = v1.x + (fully - v1.y) * dxdy_v1v3;
+		if (!tworker.threads_active)
+		{
+			tworker.threads_active = true;
+			tworker.sembegin = new Semaphore[tworker.triangle_threads];
+			for (size_t i = 0; i != tworker.triangle_threads; i++) Thread::StartDetached(triangle_worker_thread_func, (void*)i);
+		}
+
+		for (size_t i = 0; i != tworker.triangle_threads; i++) tworker.done[i] = false;
+		for (size_t i = 0; i != tworker.triangle_threads; i++) tworker.sembegin[i].Post();
+		triangle_worker_work(tworker, tworker.triangle_threads, tworker.triangle_threads + 1);
+		recheckdone:
+		for (size_t i = 0; i != tworker.triangle_threads; i++) if (!tworker.done[i]) goto recheckdone;
+	}
 
-		/* compute the ending X based on which part of the triangle we're in */
-		float stopx = (fully < v2.y ? (v1.x + (fully - v1.y) * dxdy_v1v2) : (v2.x + (fully - v2.y) * dxdy_v2v3));
+	tworker.numtris = tworker.batchpix = 0;
+	memset(tworker.bandnum, 0, sizeof(tworker.bandnum));
+}
 
-		/* clamp to full pixels */
-		INT32 istartx = round_coordinate(startx), istopx = round_coordinate(stopx);
+static void triangle_worker_queue(triangle_worker& tworker, const poly_vertex& v1, const poly_vertex& v2, const poly_vertex& v3, INT32 v1y, INT32 v3y, UINT16 *drawbuf, int texcount)
+{
+	if (tworker.numtris == TRIANGLE_BATCH_SIZE)
+		triangle_worker_flush(tworker);
 
-		/* force start < stop */
-		pixsum += (istartx > istopx ? istartx - istopx : istopx - istartx);
-	}
-	tworker.totalpix = pixsum;
+	triangle_params& tp = tworker.tris[tworker.numtris];
+	tp.drawbuf = drawbuf;
+	tp.v1 = v1, tp.v2 = v2, tp.v3 = v3;
+	tp.v1y = v1y, tp.v3y = v3y;
 
-	// Don't wake up threads for just a few pixels
-	if (tworker.totalpix <= 350)
+	/* compute the slopes for each portion of the triangle */
+	tp.dxdy_v1v2 = (v2.y == v1.y) ? 0.0f : (v2.x - v1.x) / (v2.y - v1.y);
+	tp.dxdy_v1v3 = (v3.y == v1.y) ? 0.0f : (v3.x - v1.x) / (v3.y - v1.y);
+	tp.dxdy_v2v3 = (v3.y == v2.y) ? 0.0f : (v3.x - v2.x) / (v3.y - v2.y);
+
+	/* determine the texture modes of the TMUs involved */
+	tp.tmus = (UINT32)texcount;
+	tp.texmode0 = (texcount >= 1 ? v->tmu[0].reg[textureMode].u : 0);
+	tp.texmode1 = (texcount >= 2 ? v->tmu[1].reg[textureMode].u : 0);
+	if (v_perf & V_PERFFLAG_LOWQUALITY) //force disable bilinear filter
 	{
-		triangle_worker_work(tworker, 0, tworker.triangle_threads + 1);
-		return;
+		tp.texmode0 &= ~6;
+		tp.texmode1 &= ~6;
 	}
+	tp.raster = raster_select(tworker, tp.tmus, tp.texmode0, tp.texmode1);
 
-	if (!tworker.threads_active)
+	/* copy the iterated values */
+	const fbi_state& fbi = v->fbi;
+	tp.ax = fbi.ax; tp.ay = fbi.ay;
+	tp.startr = fbi.startr; tp.startg = fbi.startg; tp.startb = fbi.startb; tp.starta = fbi.starta; tp.startz = fbi.startz; tp.startw = fbi.startw;
+	tp.drdx = fbi.drdx; tp.dgdx = fbi.dgdx; tp.dbdx = fbi.dbdx; tp.dadx = fbi.dadx; tp.dzdx = fbi.dzdx; tp.dwdx = fbi.dwdx;
+	tp.drdy = fbi.drdy; tp.dgdy = fbi.dgdy; tp.dbdy = fbi.dbdy; tp.dady = fbi.dady; tp.dzdy = fbi.dzdy; tp.dwdy = fbi.dwdy;
+	for (int i = 0; i < texcount; i++)
 	{
-		tworker.threads_active = true;
-		tworker.sembegin = new Semaphore[tworker.triangle_threads];
-		for (size_t i = 0; i != tworker.triangle_threads; i++) Thread::StartDetached(triangle_worker_thread_func, (void*)i);
+		const tmu_state& tmu = v->tmu[i];
+		triangle_params::tmu_params& tpt = tp.tmu[i];
+		tpt.starts = tmu.starts; tpt.startt = tmu.startt; tpt.startw = tmu.startw;
+		tpt.dsdx = tmu.dsdx; tpt.dtdx = tmu.dtdx; tpt.dwdx = tmu.dwdx;
+		tpt.dsdy = tmu.dsdy; tpt.dtdy = tmu.dtdy; tpt.dwdy = tmu.dwdy;
+		tpt.lodbasetemp = tmu.lodbasetemp;
+	}
+
+	/* bin the triangle into all bands it touches */
+	INT32 band = (v1y >> TRIANGLE_BAND_SHIFT), bandcount = ((v3y - 1) >> TRIANGLE_BAND_SHIFT) - band + 1;
+	if (bandcount > TRIANGLE_BANDS) bandcount = TRIANGLE_BANDS;
+	for (; bandcount--; band++)
+	{
+		UINT16& num = tworker.bandnum[band & (TRIANGLE_BANDS - 1)];
+		tworker.bandtris[band & (TRIANGLE_BANDS - 1)][num++] = (UINT16)tworker.numtris;
 	}
+	tworker.numtris++;
 
-	for (size_t i = 0; i != tworker.triangle_threads; i++) tworker.done[i] = false;
-	for (size_t i = 0; i != tworker.triangle_threads; i++) tworker.sembegin[i].Post();
-	triangle_worker_work(tworker, tworker.triangle_threads, tworker.triangle_threads + 1);
-	recheckdone:
-	for (size_t i = 0; i != tworker.triangle_threads; i++) if (!tworker.done[i]) goto recheckdone;
+	/* estimate the number of pixels in the batch */
+	tworker.batchpix += (INT32)(fabsf((v2.x - v1.x) * (v3.y - v1.y) - (v3.x - v1.x) * (v2.y - v1.y)) * 0.5f) + 1;
+
+	/* without worker threads there is nothing to gain from batching */
+	if (!(v_perf & V_PERFFLAG_MULTITHREAD))
+		triangle_worker_flush(tworker);
 }
 
 /*-------------------------------------------------
@@ -6280,12 +6525,7 @@ static void triangle(voodoo_state *v)
 			prepare_tmu(&v->tmu[1]);
 	}
 
-	triangle_worker& tworker = v->tworker;
-	tworker.v1 = *v1, tworker.v2 = *v2, tworker.v3 = *v3;
-	tworker.drawbuf = drawbuf;
-	tworker.v1y = v1y;
-	tworker.v3y = v3y;
-	triangle_worker_run(tworker);
+	triangle_worker_queue(v->tworker, *v1, *v2, *v3, v1y, v3y, drawbuf, texcount);
 
 	/* update stats */
 	v->reg[fbiTrianglesOut].u++;
@@ -6673,6 +6913,10 @@ static void register_w(UINT32 offset, UINT32 data) {
 		return;
 	}
 
+	/* anything but triangle setup and commands may change the state used by queued triangles */
+	if ((regnum < vertexAx || regnum > ftriangleCMD) && (regnum < sSetupMode || regnum > sBeginTriCMD))
+		triangle_worker_flush(v->tworker);
+
 	/* switch off the register */
 	switch (regnum)
 	{
@@ -8115,6 +8359,7 @@ static UINT32 register_r(UINT32 offset)
 		case fbiZfuncFail:
 		case fbiAfuncFail:
 		case fbiPixelsOut:
+			triangle_worker_flush(v->tworker);
 			update_statistics(v, true);
 		case fbiTrianglesOut:
 			result = v->reg[regnum].u & 0xffffff;
@@ -8201,20 +8446,106 @@ static UINT32 lfb_r(UINT32 offset)
 	return data;
 }
 
+//#define DBP_VOODOO_REPLAY_BENCH
+#ifdef DBP_VOODOO_REPLAY_BENCH
+// Records the command stream of a number of frames and then replays it with the software renderer with and without worker threads
+#ifdef _MSC_VER
+#include <intrin.h>
+#elif defined(__SSE2__) || defined(_M_AMD64) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP == 2)
+static Bit64s __rdtsc() { unsigned long lo, hi; asm( "rdtsc" : "=a" (lo), "=d" (hi) );  return( lo | (hi << 32) ); }
+#else
+#include <sys/time.h>
+static Bit64s __rdtsc() { struct timeval tv; gettimeofday(&tv, NULL); return ((Bit64u)tv.tv_sec * 1000000 + tv.tv_usec)<<8; }
+#endif
+#include <dbp_serialize.h>
+#include <vector>
+void DBPSerialize_Voodoo(DBPArchive& ar);
+static void voodoo_w(UINT32 offset, UINT32 data, UINT32 mask);
+static struct voodoo_replay_bench
+{
+	enum { SKIP_SWAPS = 300, RECORD_SWAPS = 120, REPLAY_PASSES = 3 };
+	struct command { UINT32 offset, data, mask; };
+	std::vector<command> commands;
+	std::vector<Bit8u> startstate;
+	UINT32 swaps;
+	bool replaying;
+
+	void Process(UINT32 offset, UINT32 data, UINT32 mask)
+	{
+		if (replaying) return;
+		#ifdef C_DBP_ENABLE_VOODOO_OPENGL
+		if (vogl_active) return;
+		#endif
+		if (swaps > SKIP_SWAPS) commands.push_back({ offset, data, mask });
+		if ((offset & (0xc00000/4)) != 0 || (offset & 0xff) != swapbufferCMD) return;
+		if (++swaps == SKIP_SWAPS + 1)
+		{
+			DBPArchiveCounter arsize;
+			arsize.version = 8;
+			DBPSerialize_Voodoo(arsize);
+			startstate.resize(arsize.count);
+			DBPArchiveWriter ar(&startstate[0], startstate.size());
+			ar.version = 8;
+			DBPSerialize_Voodoo(ar);
+		}
+		else if (swaps == SKIP_SWAPS + 1 + RECORD_SWAPS)
+			Replay();
+	}
+
+	void Replay()
+	{
+		replaying = true;
+		UINT8 org_perf = v_perf;
+		for (int pass = 0; pass != REPLAY_PASSES * 2; pass++)
+		{
+			v_perf = (UINT8)((org_perf & V_PERFFLAG_LOWQUALITY) | ((pass & 1) ? V_PERFFLAG_MULTITHREAD : 0));
+			DBPArchiveReader ar(&startstate[0], startstate.size());
+			ar.version = 8;
+			DBPSerialize_Voodoo(ar);
+
+			Bit64s from = __rdtsc();
+			for (const command& c : commands)
+				voodoo_w(c.offset, c.data, c.mask);
+			triangle_worker_flush(v->tworker);
+			Bit64s to = __rdtsc();
+
+			UINT32 hash = 2166136261U;
+			for (const UINT8 *p = v->fbi.ram, *pEnd = p + v->fbi.mask + 1; p != pEnd; p++) hash = (hash ^ *p) * 16777619U;
+			printf("[VOODOO] Replayed %u commands of %u frames %s worker threads in %u (frame buffer hash: %08x)\n",
+				(unsigned)commands.size(), (unsigned)RECORD_SWAPS, ((pass & 1) ? "with" : "without"), (unsigned)((to - from) >> 14), hash);
+		}
+		v_perf = org_perf;
+		replaying = false;
+	}
+} voodoo_bench;
+#endif
+
 static void voodoo_w(UINT32 offset, UINT32 data, UINT32 mask) {
 	if ((offset & (0xc00000/4)) == 0)
 		register_w(offset, data);
-	else if ((offset & (0x800000/4)) == 0)
-		lfb_w(offset, data, mask);
 	else
-		texture_w(offset, data);
+	{
+		/* frame buffer and texture memory accesses need all queued triangles to be rasterized */
+		triangle_worker_flush(v->tworker);
+		if ((offset & (0x800000/4)) == 0)
+			lfb_w(offset, data, mask);
+		else
+			texture_w(offset, data);
+	}
+
+	#ifdef DBP_VOODOO_REPLAY_BENCH
+	voodoo_bench.Process(offset, data, mask);
+	#endif
 }
 
 static UINT32 voodoo_r(UINT32 offset) {
 	if ((offset & (0xc00000/4)) == 0)
 		return register_r(offset);
 	else if ((offset & (0x800000/4)) == 0)
+	{
+		triangle_worker_flush(v->tworker);
 		return lfb_r(offset);
+	}
 
 	return 0xffffffff;
 }
@@ -8421,6 +8752,7 @@ static void voodoo_shutdown() {
 		}
 		v->active = false;
 		triangle_worker_shutdown(v->tworker);
+		if (v_lograsterizers) raster_log_misses(v->tworker);
 		delete v;
 		v = NULL;
 	}
@@ -8450,6 +8782,7 @@ static void voodoo_activate(void) {
 }
 
 static void Voodoo_VerticalTimer(Bitu /*val*/) {
+	triangle_worker_flush(v->tworker);
 	v->draw.frame_start = PIC_FullIndex();
 	PIC_AddEvent( Voodoo_VerticalTimer, v->draw.vfreq );
 
@@ -8865,6 +9198,7 @@ void VOODOO_Init(Section* sec) {
 
 	Section_prop * section = static_cast<Section_prop *>(sec);
 	v_perf = (UINT8)section->Get_int("voodoo_perf");
+	v_lograsterizers = section->Get_bool("voodoo_lograsterizers");
 	voodoo_pci_sstdevice.gammafix = section->Get_int("voodoo_gamma")*.1f;
 	if (vogl_unavailable && (v_perf & V_PERFFLAG_OPENGL)) v_perf = V_PERFFLAG_MULTITHREAD;
 	voodoo_ogl_scale = ((v_perf & V_PERFFLAG_OPENGL) ? section->Get_int("voodoo_scale") : 1);
@@ -8940,6 +9274,9 @@ void DBPSerialize_Voodoo(DBPArchive& ar)
 
 	if (v)
 	{
+		// Rasterize queued triangles before accessing the frame buffer
+		triangle_worker_flush(v->tworker);
+
 		// Serialize simple data types in voodoo_state
 		UINT8 vflags = v->chipmask | 0x8; // 0x8 is "have clutRaw", not part of old save states
 		ar.Serialize(v->type).Serialize(vflags).SerializeArray(v->reg).Serialize(v->alt_regmap).Serialize(v->pci).Serialize(v->dac)
@@ -30,8 +30,82 @@
 
 //DBP: for mem_readb_inline and mem_writeb_inline
 #include "paging.h"
+#include <map>
+#include <algorithm>
 
 #ifdef C_DBP_SUPPORT_DISK_MOUNT_DOSFILE
+#if defined(WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#elif C_HAVE_MPROTECT
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+//DBP: Read-only view of a disk image on the host file system to copy sectors without going through stdio
+//   Only used as long as the image file itself is not written to (writes to a differencing or discard disk are fine)
+//   If the platform doesn't support mapping files or mapping fails, reads go through the DOS_File as before
+struct mappedDisk
+{
+	const Bit8u* view;
+	Bit64u size;
+	#if defined(WIN32)
+	HANDLE hmap;
+	#endif
+
+	static mappedDisk* TryMap(DOS_File* df)
+	{
+		FILE* f = df->GetHostFile();
+		if (!f) return NULL;
+		fflush(f);
+		#if defined(WIN32)
+		HANDLE hfile = (HANDLE)_get_osfhandle(_fileno(f));
+		LARGE_INTEGER filesize;
+		if (hfile == INVALID_HANDLE_VALUE || !GetFileSizeEx(hfile, &filesize) || !filesize.QuadPart || (Bit64u)filesize.QuadPart > (Bit64u)(size_t)-1) return NULL;
+		HANDLE hmap = CreateFileMappingA(hfile, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (!hmap) return NULL;
+		const Bit8u* view = (const Bit8u*)MapViewOfFile(hmap, FILE_MAP_READ, 0, 0, 0);
+		if (!view) { CloseHandle(hmap); return NULL; }
+		mappedDisk* res = new mappedDisk;
+		res->view = view;
+		res->size = (Bit64u)filesize.QuadPart;
+		res->hmap = hmap;
+		return res;
+		#elif C_HAVE_MPROTECT
+		struct stat st;
+		int fd = fileno(f);
+		if (fd < 0 || fstat(fd, &st) || st.st_size <= 0 || (Bit64u)st.st_size > (Bit64u)(size_t)-1) return NULL;
+		void* view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (view == MAP_FAILED) return NULL;
+		mappedDisk* res = new mappedDisk;
+		res->view = (const Bit8u*)view;
+		res->size = (Bit64u)st.st_size;
+		return res;
+		#else
+		return NULL;
+		#endif
+	}
+
+	~mappedDisk()
+	{
+		#if defined(WIN32)
+		UnmapViewOfFile(view);
+		CloseHandle(hmap);
+		#elif C_HAVE_MPROTECT
+		munmap((void*)view, (size_t)size);
+		#endif
+	}
+
+	Bit64u Read(Bit64u ofs, void* data, Bit64u len)
+	{
+		if (ofs >= size) return 0;
+		if (len > size - ofs) len = size - ofs;
+		memcpy(data, view + ofs, (size_t)len);
+		return len;
+	}
+};
+
 struct discardDisk
 {
 	std::vector<Bit8u*> tempwrites;
@@ -62,58 +136,187 @@ struct discardDisk
 	}
 };
 
+//DBP: Differencing disk save file format v2 (FFDD2)
+//   The file is split into 512 byte units. Unit 0 holds the header which references the L1 index table.
+//   Each L1 entry points to a 4K L2 table with 512 entries of 8 bytes, one entry per block of 8 sectors.
+//   An L2 entry stores the location of a block (4K aligned cluster if uncompressed or a run of units if
+//   compressed with LZ4) and a mask of which sectors of the block differ from the underlying disk.
+//   Updates only rewrite the affected entry so the index stays valid without scanning the file on load.
+//   Freed space gets reused by new blocks and the file gets compacted in place when it is closed.
+//   Files in the v1 format (a list of [sector number][sector data] records) get converted on load.
+//   New files (and converted v1 files) use LZ4 when dbp_diskdiff_compress is set, existing files keep the mode from their header.
+//#define DBP_FFDD_SELF_TEST
+bool dbp_diskdiff_compress;
 struct differencingDisk
 {
 	enum ddDefs : Bit32u
 	{
 		BYTESPERSECTOR    = 512,
 		NULL_CURSOR       = (Bit32u)-1,
+		V1_END_MARKER     = (Bit32u)-2, // sector number of the v1 record appended before converting
+		BLOCKSHIFT        = 3,
+		SECTORSPERBLOCK   = (1 << BLOCKSHIFT),
+		BYTESPERBLOCK     = (BYTESPERSECTOR << BLOCKSHIFT),
+		UNITSPERBLOCK     = SECTORSPERBLOCK, // file units are the size of a sector
+		ENTRYSIZE         = 8,
+		ENTRIESPERL2      = (BYTESPERBLOCK / ENTRYSIZE),
+		HEADERSIZE        = 32,
+		FLAG_LZ4          = 0x01,
+		ALLOC_SCAN_LIMIT  = 256,
+		COMPACT_MIN_UNITS = 256,
 	};
 
-	struct ffddBuf { Bit8u data[BYTESPERSECTOR]; };
-	struct ffddSec { Bit32u cursor = NULL_CURSOR; };
-	std::vector<ffddBuf>  diffSectorBufs;
-	std::vector<ffddSec>  diffSectors;
-	std::vector<Bit32u>   diffFreeCursors;
-	std::string           savePath;
-	FILE*                 saveFile = NULL;
-	Bit32u                saveEndCursor = 0;
+	struct ffddBlock { Bit32u ofs = 0; Bit16u len = 0; Bit8u mask = 0, flags = 0; }; // ofs is in units (or index into memBlocks), len in bytes
+	struct ffddBuf { Bit8u data[BYTESPERBLOCK]; };
+	std::vector<ffddBlock> blocks;
+	std::vector<Bit32u>    l1;
+	std::map<Bit32u, Bit32u> freeExtents; // unit offset -> unit count
+	std::vector<ffddBuf>   memBlocks;
+	std::vector<Bit32u>    memFreeBlocks;
+	std::string            savePath;
+	FILE*                  saveFile = NULL;
+	Bit32u                 sectDiskEnd = 0, l1Ofs = 0, endUnits = 0;
+	Bit8u                  fileFlags = 0;
+	Bit32u                 curBlock = NULL_CURSOR; // block buffered for compressed files
+	Bit8u                  curMask = 0;
+	bool                   curDirty = false;
+	Bit8u                  curData[BYTESPERBLOCK];
 
 	~differencingDisk()
 	{
-		if (saveFile)
-			fclose(saveFile);
+		if (!saveFile) return;
+		FlushCur();
+		Compact();
+		fclose(saveFile);
+	}
+
+	static INLINE Bit32u UnitsFor(Bit32u bytes) { return (bytes + BYTESPERSECTOR - 1) / BYTESPERSECTOR; }
+	static INLINE Bit32u L1Count(Bit32u sect_disk_end) { Bit32u n = ((sect_disk_end + SECTORSPERBLOCK - 1) >> BLOCKSHIFT); return (n ? (n + ENTRIESPERL2 - 1) / ENTRIESPERL2 : 1); }
+
+	bool FileRead(Bit32u unit, Bit32u byteofs, void* p, Bit32u n)
+	{
+		fseek_wrap(saveFile, (Bit64u)unit * BYTESPERSECTOR + byteofs, SEEK_SET);
+		return (fread(p, n, 1, saveFile) == 1);
+	}
+
+	void FileWrite(Bit32u unit, Bit32u byteofs, const void* p, Bit32u n)
+	{
+		fseek_wrap(saveFile, (Bit64u)unit * BYTESPERSECTOR + byteofs, SEEK_SET);
+		fwrite(p, n, 1, saveFile);
+	}
+
+	void WriteHeader()
+	{
+		Bit8u hdr[HEADERSIZE] = { 'F', 'F', 'D', 'D', 2, fileFlags };
+		var_write((Bit32u*)&hdr[8], sectDiskEnd);
+		var_write((Bit32u*)&hdr[12], l1Ofs);
+		var_write((Bit32u*)&hdr[16], (Bit32u)l1.size());
+		FileWrite(0, 0, hdr, sizeof(hdr));
+	}
+
+	void WriteL1(Bit32u idx)
+	{
+		Bit32u val;
+		var_write(&val, l1[idx]);
+		FileWrite(l1Ofs, idx * 4, &val, 4);
+	}
+
+	void WriteEntry(Bit32u block)
+	{
+		Bit32u idx = block / ENTRIESPERL2;
+		if (!l1[idx])
+		{
+			static const Bit8u zeroes[BYTESPERBLOCK] = {0};
+			l1[idx] = Alloc(UNITSPERBLOCK, true);
+			FileWrite(l1[idx], 0, zeroes, BYTESPERBLOCK);
+			WriteL1(idx);
+		}
+		const ffddBlock& e = blocks[block];
+		Bit8u entry[ENTRYSIZE];
+		var_write((Bit32u*)&entry[0], e.ofs);
+		var_write((Bit16u*)&entry[4], e.len);
+		entry[6] = e.mask;
+		entry[7] = e.flags;
+		FileWrite(l1[idx], (block % ENTRIESPERL2) * ENTRYSIZE, entry, ENTRYSIZE);
+	}
+
+	Bit32u AllocHole(Bit32u units, bool align, Bit32u below)
+	{
+		Bit32u scanned = 0;
+		for (std::map<Bit32u, Bit32u>::iterator it = freeExtents.begin(); it != freeExtents.end() && it->first < below && scanned++ != ALLOC_SCAN_LIMIT; ++it)
+		{
+			Bit32u hole = it->first, holeEnd = hole + it->second, ofs = (align ? ((hole + UNITSPERBLOCK - 1) & ~(UNITSPERBLOCK - 1)) : hole);
+			if (ofs + units > holeEnd || ofs + units > below) continue;
+			freeExtents.erase(it);
+			if (ofs != hole) freeExtents[hole] = ofs - hole;
+			if (ofs + units != holeEnd) freeExtents[ofs + units] = holeEnd - (ofs + units);
+			return ofs;
+		}
+		return NULL_CURSOR;
+	}
+
+	Bit32u Alloc(Bit32u units, bool align)
+	{
+		Bit32u ofs = AllocHole(units, align, NULL_CURSOR);
+		if (ofs != NULL_CURSOR) return ofs;
+		ofs = (align ? ((endUnits + UNITSPERBLOCK - 1) & ~(UNITSPERBLOCK - 1)) : endUnits);
+		if (ofs != endUnits) Free(endUnits, ofs - endUnits);
+		endUnits = ofs + units;
+		return ofs;
+	}
+
+	void Free(Bit32u ofs, Bit32u units)
+	{
+		std::map<Bit32u, Bit32u>::iterator next = freeExtents.lower_bound(ofs);
+		if (next != freeExtents.begin())
+		{
+			std::map<Bit32u, Bit32u>::iterator prev = next; --prev;
+			DBP_ASSERT(prev->first + prev->second <= ofs);
+			if (prev->first + prev->second == ofs) { ofs = prev->first; units += prev->second; freeExtents.erase(prev); }
+		}
+		if (next != freeExtents.end() && ofs + units == next->first) { units += next->second; freeExtents.erase(next); }
+		if (ofs + units == endUnits) endUnits = ofs; // shrink instead of tracking free space at the end
+		else freeExtents[ofs] = units;
+	}
+
+	bool CreateFile(const char* path)
+	{
+		if (!(saveFile = fopen_wrap(path, "wb+"))) return false;
+		fileFlags = (dbp_diskdiff_compress ? FLAG_LZ4 : 0);
+		l1.assign(L1Count(sectDiskEnd), 0);
+		l1Ofs = 1;
+		endUnits = l1Ofs + UnitsFor((Bit32u)l1.size() * 4);
+		std::vector<Bit8u> zeroes(l1.size() * 4);
+		FileWrite(l1Ofs, 0, &zeroes[0], (Bit32u)zeroes.size());
+		WriteHeader();
+		return true;
 	}
 
 	void SetupSave(const char* inSavePath, Bit32u sect_disk_end)
 	{
 		DBP_ASSERT(inSavePath && *inSavePath);
+		#ifdef DBP_FFDD_SELF_TEST
+		static bool self_tested;
+		if (!self_tested) { self_tested = true; SelfTest(inSavePath); }
+		#endif
+		sectDiskEnd = sect_disk_end;
 		if (FILE* f = fopen_wrap(inSavePath, "rb+"))
 		{
 			saveFile = f;
-			char fhead[5];
-			if (!fread(fhead, sizeof(fhead), 1, f) || memcmp(fhead, "FFDD\x1", sizeof(fhead))) goto invalid_file;
-			Bit32u cursor = sizeof(fhead);
-			for (Bit32u sectnumval; fread(&sectnumval, sizeof(sectnumval), 1, f); cursor += (Bit32u)(sizeof(sectnumval) + BYTESPERSECTOR))
-			{
-				fseek(f, BYTESPERSECTOR, SEEK_CUR);
-				if (sectnumval != 0xFFFFFFFF)
-				{
-					Bit32u sectnum = var_read(&sectnumval);
-					if (sectnum >= sect_disk_end) goto invalid_file;
-					if (sectnum >= diffSectors.size()) diffSectors.resize(sectnum + 1);
-					diffSectors[sectnum].cursor = cursor;
-				}
-				else diffFreeCursors.push_back(cursor);
-			}
-			saveEndCursor = cursor;
+			Bit8u hdr[HEADERSIZE];
+			if (!fread(hdr, 5, 1, f) || memcmp(hdr, "FFDD", 4)) goto invalid_file;
+			if (hdr[4] == 1) { if (!ConvertV1()) goto invalid_file; }
+			else if (hdr[4] != 2 || !LoadV2()) goto invalid_file;
 		}
 		else if (0)
 		{
 			invalid_file:
 			LOG_MSG("[DOSBOX] Invalid disk save file %s", inSavePath);
-			fclose(f);
+			fclose(saveFile);
 			saveFile = NULL;
+			blocks.clear();
+			l1.clear();
+			freeExtents.clear();
 		}
 		else
 		{
@@ -121,11 +324,254 @@ struct differencingDisk
 		}
 	}
 
-	bool WriteDiff(Bit32u sectnum, const void* data, const void* unmodified)
+	bool LoadV2()
+	{
+		Bit8u hdr[HEADERSIZE];
+		fseek_wrap(saveFile, 0, SEEK_END);
+		Bit64u fileSize = (Bit64u)ftell_wrap(saveFile);
+		if (!FileRead(0, 0, hdr, HEADERSIZE)) return false;
+		fileFlags = hdr[5];
+		l1Ofs = var_read((Bit32u*)&hdr[12]);
+		Bit32u fileUnits = (Bit32u)((fileSize + BYTESPERSECTOR - 1) / BYTESPERSECTOR), fileL1Count = var_read((Bit32u*)&hdr[16]);
+		Bit32u l1Units = UnitsFor(fileL1Count * 4);
+		if (!l1Ofs || !fileL1Count || l1Ofs + l1Units > fileUnits) return false;
+
+		struct Extent { Bit32u ofs, units; bool operator<(const Extent& o) const { return ofs < o.ofs; } };
+		std::vector<Extent> used;
+		used.push_back({ 0, 1 });
+		used.push_back({ l1Ofs, l1Units });
+		l1.resize(fileL1Count);
+		if (!FileRead(l1Ofs, 0, &l1[0], fileL1Count * 4)) return false;
+		Bit8u table[BYTESPERBLOCK];
+		for (Bit32u idx = 0; idx != fileL1Count; idx++)
+		{
+			if (!(l1[idx] = var_read(&l1[idx]))) continue;
+			if (l1[idx] + UNITSPERBLOCK > fileUnits || !FileRead(l1[idx], 0, table, BYTESPERBLOCK)) return false;
+			used.push_back({ l1[idx], UNITSPERBLOCK });
+			for (Bit32u i = 0; i != ENTRIESPERL2; i++)
+			{
+				const Bit8u* entry = &table[i * ENTRYSIZE];
+				if (!entry[6]) continue;
+				Bit32u block = idx * ENTRIESPERL2 + i;
+				ffddBlock e;
+				e.ofs = var_read((Bit32u*)&entry[0]);
+				e.len = var_read((Bit16u*)&entry[4]);
+				e.mask = entry[6];
+				e.flags = entry[7];
+				Bit32u lastSect = (block << BLOCKSHIFT) + 7; while (!(e.mask & (1 << (lastSect & 7)))) lastSect--;
+				if (lastSect >= sectDiskEnd || !e.len || e.len > BYTESPERBLOCK || (!(e.flags & FLAG_LZ4) && e.len != BYTESPERBLOCK) || e.ofs + UnitsFor(e.len) > fileUnits) return false;
+				if (block >= blocks.size()) blocks.resize(block + 1);
+				blocks[block] = e;
+				used.push_back({ e.ofs, UnitsFor(e.len) });
+			}
+		}
+
+		// Everything not referenced by the index is free space
+		std::sort(used.begin(), used.end());
+		for (size_t i = 1; i != used.size(); i++)
+		{
+			Bit32u prevEnd = used[i - 1].ofs + used[i - 1].units;
+			if (prevEnd > used[i].ofs) return false; // overlapping
+			if (prevEnd != used[i].ofs) freeExtents[prevEnd] = used[i].ofs - prevEnd;
+		}
+		endUnits = used.back().ofs + used.back().units;
+
+		// Grow the L1 table in case the disk got larger
+		Bit32u needL1Count = L1Count(sectDiskEnd);
+		if (needL1Count > fileL1Count)
+		{
+			Free(l1Ofs, l1Units);
+			l1.resize(needL1Count, 0);
+			l1Ofs = Alloc(UnitsFor(needL1Count * 4), false);
+			std::vector<Bit32u> vals(needL1Count);
+			for (Bit32u idx = 0; idx != needL1Count; idx++) var_write(&vals[idx], l1[idx]);
+			FileWrite(l1Ofs, 0, &vals[0], needL1Count * 4);
+			WriteHeader();
+		}
+		return true;
+	}
+
+	bool ConvertV1()
+	{
+		// Read the list of sectors stored in the v1 file up to its end marker (left by an interrupted conversion) or the last complete record
+		std::vector<std::pair<Bit32u, Bit32u> > sects;
+		fseek_wrap(saveFile, 0, SEEK_END);
+		Bit64u fileSize = (Bit64u)ftell_wrap(saveFile);
+		Bit32u cursor = 5;
+		fseek_wrap(saveFile, cursor, SEEK_SET);
+		for (Bit32u sectnumval; cursor + sizeof(sectnumval) + BYTESPERSECTOR <= fileSize && fread(&sectnumval, sizeof(sectnumval), 1, saveFile); cursor += (Bit32u)(sizeof(sectnumval) + BYTESPERSECTOR))
+		{
+			fseek(saveFile, BYTESPERSECTOR, SEEK_CUR);
+			if (sectnumval == 0xFFFFFFFF) continue;
+			Bit32u sectnum = var_read(&sectnumval);
+			if (sectnum == V1_END_MARKER) break;
+			if (sectnum >= sectDiskEnd) return false;
+			sects.push_back(std::make_pair(sectnum, cursor + (Bit32u)sizeof(sectnumval)));
+		}
+		std::sort(sects.begin(), sects.end());
+
+		// Build the v2 index and blocks after the end of the v1 data, then switch over by writing the header.
+		// Until then the file keeps the v1 magic, so the marker makes a conversion interrupted by a crash start over from the same records.
+		Bit32u endval;
+		var_write(&endval, (Bit32u)V1_END_MARKER);
+		FileWrite(0, cursor, &endval, sizeof(endval));
+		fflush(saveFile);
+		Bit32u v1Units = UnitsFor(cursor + (Bit32u)sizeof(endval));
+		fileFlags = (dbp_diskdiff_compress ? FLAG_LZ4 : 0);
+		endUnits = v1Units;
+		l1.assign(L1Count(sectDiskEnd), 0);
+		l1Ofs = Alloc(UnitsFor((Bit32u)l1.size() * 4), false);
+		std::vector<Bit8u> zeroes(l1.size() * 4);
+		FileWrite(l1Ofs, 0, &zeroes[0], (Bit32u)zeroes.size());
+		Bit8u data[BYTESPERSECTOR];
+		bool failed = false;
+		for (const std::pair<Bit32u, Bit32u>& it : sects)
+		{
+			fseek_wrap(saveFile, it.second, SEEK_SET);
+			if (!fread(data, BYTESPERSECTOR, 1, saveFile)) { failed = true; break; }
+			StoreSector(it.first, data, true);
+		}
+		FlushCur();
+		fflush(saveFile);
+		if (failed)
+		{
+			// Cut off the marker and the partially built v2 data to leave the v1 records as they were
+			if (ftruncate(fileno(saveFile), cursor)) { DBP_ASSERT(false); }
+			return false;
+		}
+		WriteHeader();
+		fflush(saveFile);
+		if (v1Units > 1) Free(1, v1Units - 1); // the old data gets reused and compacted away
+		LOG_MSG("[DOSBOX] Converted disk save file with %u sectors to new format", (unsigned)sects.size());
+		return true;
+	}
+
+	void StoreSector(Bit32u sectnum, const void* data, bool is_different)
 	{
-		if (sectnum >= diffSectors.size()) diffSectors.resize(sectnum + 128);
-		Bit32u *cursor_ptr = &diffSectors[sectnum].cursor, cursor_val = *cursor_ptr;
+		Bit32u block = (sectnum >> BLOCKSHIFT), sub = (sectnum & (SECTORSPERBLOCK - 1)), bit = (1 << sub);
+		if (block >= blocks.size()) blocks.resize(block + 16);
+		ffddBlock& e = blocks[block];
+		if (!saveFile)
+		{
+			if (is_different)
+			{
+				if (!e.mask)
+				{
+					if (memFreeBlocks.size()) { e.ofs = memFreeBlocks.back(); memFreeBlocks.pop_back(); }
+					else { e.ofs = (Bit32u)memBlocks.size(); memBlocks.resize(e.ofs + 1); }
+				}
+				memcpy(memBlocks[e.ofs].data + sub * BYTESPERSECTOR, data, BYTESPERSECTOR);
+				e.mask |= bit;
+			}
+			else if (!(e.mask &= ~bit)) memFreeBlocks.push_back(e.ofs);
+		}
+		else if (fileFlags & FLAG_LZ4)
+		{
+			// Compressed blocks are modified in a buffer and written when another block gets accessed
+			if (block != curBlock) { FlushCur(); LoadCur(block); }
+			if (is_different) { memcpy(curData + sub * BYTESPERSECTOR, data, BYTESPERSECTOR); curMask |= bit; }
+			else curMask &= ~bit;
+			curDirty = true;
+		}
+		else if (is_different)
+		{
+			if (!e.mask)
+			{
+				// Write the entire cluster of a new block so the file always covers all allocated space
+				Bit8u cluster[BYTESPERBLOCK] = {0};
+				memcpy(cluster + sub * BYTESPERSECTOR, data, BYTESPERSECTOR);
+				e.ofs = Alloc(UNITSPERBLOCK, true); e.len = BYTESPERBLOCK; e.flags = 0;
+				FileWrite(e.ofs, 0, cluster, BYTESPERBLOCK);
+			}
+			else FileWrite(e.ofs, sub * BYTESPERSECTOR, data, BYTESPERSECTOR);
+			if (!(e.mask & bit)) { e.mask |= bit; WriteEntry(block); }
+		}
+		else
+		{
+			Bit32u ofs = e.ofs;
+			if (!(e.mask &= ~bit)) { e = ffddBlock(); Free(ofs, UNITSPERBLOCK); }
+			WriteEntry(block);
+		}
+	}
+
+	void LoadCur(Bit32u block)
+	{
+		const ffddBlock& e = blocks[block];
+		curBlock = block;
+		curMask = e.mask;
+		curDirty = false;
+		if (!e.mask) { memset(curData, 0, BYTESPERBLOCK); return; }
+		Bit8u comp[BYTESPERBLOCK];
+		bool valid = ((e.flags & FLAG_LZ4) ? (FileRead(e.ofs, 0, comp, e.len) && LZ4Decompress(comp, e.len, curData, BYTESPERBLOCK)) : FileRead(e.ofs, 0, curData, BYTESPERBLOCK));
+		if (!valid) { DBP_ASSERT(false); LOG_MSG("[DOSBOX] Corrupt block %u in disk save file", (unsigned)block); memset(curData, 0, BYTESPERBLOCK); }
+	}
+
+	void FlushCur()
+	{
+		if (curBlock == NULL_CURSOR || !curDirty) return;
+		curDirty = false;
+		ffddBlock& e = blocks[curBlock];
+		Bit32u oldOfs = e.ofs, oldUnits = (e.mask ? UnitsFor(e.len) : 0);
+		if (curMask)
+		{
+			// Write to a new location before updating the index so the file stays valid at all times
+			for (Bit32u sub = 0; sub != SECTORSPERBLOCK; sub++)
+				if (!(curMask & (1 << sub))) memset(curData + sub * BYTESPERSECTOR, 0, BYTESPERSECTOR);
+			Bit8u comp[BYTESPERBLOCK - BYTESPERSECTOR];
+			Bit32u complen = LZ4Compress(curData, BYTESPERBLOCK, comp, (Bit32u)sizeof(comp));
+			e.len = (Bit16u)(complen ? complen : BYTESPERBLOCK);
+			e.flags = (Bit8u)(complen ? FLAG_LZ4 : 0);
+			e.ofs = Alloc(UnitsFor(e.len), !complen);
+			FileWrite(e.ofs, 0, (complen ? comp : curData), e.len);
+			e.mask = curMask;
+		}
+		else e = ffddBlock();
+		WriteEntry(curBlock);
+		if (oldUnits) Free(oldOfs, oldUnits);
+	}
+
+	void Compact()
+	{
+		// Move the data at the end of the file into free space closer to the start and then truncate the file
+		Bit32u freeUnits = 0;
+		for (const std::pair<const Bit32u, Bit32u>& it : freeExtents) freeUnits += it.second;
+		if (freeUnits >= COMPACT_MIN_UNITS && freeUnits * 4 >= endUnits)
+		{
+			struct Extent { Bit32u ofs, units, idx; Bit8u kind; bool operator<(const Extent& o) const { return ofs > o.ofs; } };
+			enum { KIND_BLOCK, KIND_L2, KIND_L1 };
+			std::vector<Extent> used;
+			for (Bit32u block = 0; block != (Bit32u)blocks.size(); block++)
+				if (blocks[block].mask) used.push_back({ blocks[block].ofs, UnitsFor(blocks[block].len), block, KIND_BLOCK });
+			for (Bit32u idx = 0; idx != (Bit32u)l1.size(); idx++)
+				if (l1[idx]) used.push_back({ l1[idx], UNITSPERBLOCK, idx, KIND_L2 });
+			used.push_back({ l1Ofs, UnitsFor((Bit32u)l1.size() * 4), 0, KIND_L1 });
+			std::sort(used.begin(), used.end());
+
+			std::vector<Bit8u> buf;
+			for (const Extent& x : used)
+			{
+				if (freeExtents.empty() || freeExtents.begin()->first > x.ofs) break;
+				bool align = (x.kind == KIND_L2 || (x.kind == KIND_BLOCK && !(blocks[x.idx].flags & FLAG_LZ4)));
+				Bit32u ofs = AllocHole(x.units, align, x.ofs);
+				if (ofs == NULL_CURSOR) continue;
+				buf.resize(x.units * BYTESPERSECTOR);
+				if (!FileRead(x.ofs, 0, &buf[0], (Bit32u)buf.size())) { Free(ofs, x.units); break; }
+				FileWrite(ofs, 0, &buf[0], (Bit32u)buf.size());
+				fflush(saveFile);
+				if (x.kind == KIND_BLOCK) { blocks[x.idx].ofs = ofs; WriteEntry(x.idx); }
+				else if (x.kind == KIND_L2) { l1[x.idx] = ofs; WriteL1(x.idx); }
+				else { l1Ofs = ofs; WriteHeader(); }
+				Free(x.ofs, x.units);
+			}
+		}
+		fflush(saveFile);
+		fseek_wrap(saveFile, 0, SEEK_END);
+		if ((Bit64u)ftell_wrap(saveFile) > (Bit64u)endUnits * BYTESPERSECTOR)
+			if (ftruncate(fileno(saveFile), (Bit64u)endUnits * BYTESPERSECTOR)) { DBP_ASSERT(false); }
+	}
 
+	bool WriteDiff(Bit32u sectnum, const void* data, const void* unmodified)
+	{
 		int is_different;
 		if (!unmodified)
 		{
@@ -135,77 +581,197 @@ struct differencingDisk
 		}
 		else is_different = memcmp(unmodified, data, BYTESPERSECTOR);
 
-		if (is_different)
+		if (sectDiskEnd && sectnum >= sectDiskEnd) { DBP_ASSERT(false); return false; }
+		Bit32u block = (sectnum >> BLOCKSHIFT), bit = (1 << (sectnum & (SECTORSPERBLOCK - 1)));
+		Bit8u mask = (block == curBlock ? curMask : (block < blocks.size() ? blocks[block].mask : 0));
+		if (!is_different && !(mask & bit)) return false;
+
+		if (!saveFile && !savePath.empty())
+		{
+			CreateFile(savePath.c_str());
+			savePath.clear();
+		}
+		StoreSector(sectnum, data, !!is_different);
+		return true;
+	}
+
+	bool GetDiff(Bit32u sectnum, void* data)
+	{
+		Bit32u block = (sectnum >> BLOCKSHIFT), sub = (sectnum & (SECTORSPERBLOCK - 1)), bit = (1 << sub);
+		if (block == curBlock)
+		{
+			if (!(curMask & bit)) return false;
+			memcpy(data, curData + sub * BYTESPERSECTOR, BYTESPERSECTOR);
+			return true;
+		}
+		if (block >= blocks.size() || !(blocks[block].mask & bit)) return false;
+		const ffddBlock& e = blocks[block];
+		if (!saveFile)
+		{
+			memcpy(data, memBlocks[e.ofs].data + sub * BYTESPERSECTOR, BYTESPERSECTOR);
+			return true;
+		}
+		if (!(e.flags & FLAG_LZ4))
+			return FileRead(e.ofs, sub * BYTESPERSECTOR, data, BYTESPERSECTOR);
+		FlushCur();
+		LoadCur(block);
+		memcpy(data, curData + sub * BYTESPERSECTOR, BYTESPERSECTOR);
+		return true;
+	}
+
+	// Minimal implementation of the LZ4 block format for 4K blocks
+	static Bit32u LZ4Compress(const Bit8u* src, Bit32u srcLen, Bit8u* dst, Bit32u dstCap)
+	{
+		enum { HASHLOG = 12, MINMATCH = 4, LASTLITERALS = 5, MFLIMIT = 12 };
+		Bit16u table[1 << HASHLOG];
+		memset(table, 0xFF, sizeof(table));
+		const Bit8u *ip = src, *anchor = src, *iend = src + srcLen, *mflimit = iend - MFLIMIT, *matchlimit = iend - LASTLITERALS;
+		Bit8u *op = dst, *oend = dst + dstCap;
+		while (srcLen > MFLIMIT && ip < mflimit)
+		{
+			Bit32u seq; memcpy(&seq, ip, 4);
+			Bit32u h = ((seq * 2654435761U) >> (32 - HASHLOG)), ref = table[h];
+			table[h] = (Bit16u)(ip - src);
+			if (ref == 0xFFFF || memcmp(src + ref, ip, 4)) { ip++; continue; }
+			const Bit8u* match = src + ref;
+			while (ip > anchor && match > src && ip[-1] == match[-1]) { ip--; match--; }
+			const Bit8u *mp = ip + MINMATCH, *mm = match + MINMATCH;
+			while (mp < matchlimit && *mp == *mm) { mp++; mm++; }
+			Bit32u litLen = (Bit32u)(ip - anchor), matchLen = (Bit32u)(mp - ip) - MINMATCH, offset = (Bit32u)(ip - match);
+			if ((Bit32u)(oend - op) < 1 + litLen / 255 + 1 + litLen + 2 + matchLen / 255 + 1) return 0;
+			Bit8u* token = op++;
+			*token = (Bit8u)((litLen >= 15 ? 15 : litLen) << 4);
+			if (litLen >= 15) { Bit32u n = litLen - 15; for (; n >= 255; n -= 255) *op++ = 255; *op++ = (Bit8u)n; }
+			memcpy(op, anchor, litLen); op += litLen;
+			*op++ = (Bit8u)(offset & 0xFF); *op++ = (Bit8u)(offset >> 8);
+			*token |= (Bit8u)(matchLen >= 15 ? 15 : matchLen);
+			if (matchLen >= 15) { Bit32u n = matchLen - 15; for (; n >= 255; n -= 255) *op++ = 255; *op++ = (Bit8u)n; }
+			ip = anchor = mp;
+		}
+		Bit32u litLen = (Bit32u)(iend - anchor);
+		if ((Bit32u)(oend - op) < 1 + litLen / 255 + 1 + litLen) return 0;
+		*op++ = (Bit8u)((litLen >= 15 ? 15 : litLen) << 4);
+		if (litLen >= 15) { Bit32u n = litLen - 15; for (; n >= 255; n -= 255) *op++ = 255; *op++ = (Bit8u)n; }
+		memcpy(op, anchor, litLen); op += litLen;
+		return (Bit32u)(op - dst);
+	}
+
+	static bool LZ4Decompress(const Bit8u* src, Bit32u srcLen, Bit8u* dst, Bit32u dstLen)
+	{
+		const Bit8u *ip = src, *iend = src + srcLen;
+		Bit8u *op = dst, *oend = dst + dstLen;
+		for (;;)
 		{
-			if (!saveFile && !savePath.empty())
+			if (ip >= iend) return false;
+			Bit32u token = *ip++, len = (token >> 4);
+			if (len == 15) for (Bit8u s = 255; s == 255; len += s) { if (ip >= iend) return false; s = *ip++; }
+			if ((Bit32u)(iend - ip) < len || (Bit32u)(oend - op) < len) return false;
+			memcpy(op, ip, len); op += len; ip += len;
+			if (ip == iend) return (op == oend); // last sequence has only literals
+			if (iend - ip < 2) return false;
+			Bit32u offset = (ip[0] | (ip[1] << 8));
+			ip += 2;
+			if (!offset || offset > (Bit32u)(op - dst)) return false;
+			len = (token & 15);
+			if (len == 15) for (Bit8u s = 255; s == 255; len += s) { if (ip >= iend) return false; s = *ip++; }
+			len += 4;
+			if ((Bit32u)(oend - op) < len) return false;
+			for (const Bit8u* m = op - offset; len--;) *op++ = *m++; // can overlap
+		}
+	}
+
+	#ifdef DBP_FFDD_SELF_TEST
+	// Round-trips LZ4 on synthetic blocks, then writes, reverts, reopens and compacts uncompressed and compressed files next to the save file
+	static void SelfTest(const char* inSavePath)
+	{
+		enum { SECTS = 2048, OPS = 12000 };
+		Bit32u seed = 1234, errors = 0;
+		#define FFDD_RAND() (seed = seed * 1103515245 + 12345, (seed >> 16))
+		Bit8u src[BYTESPERBLOCK], comp[BYTESPERBLOCK + 64], dec[BYTESPERBLOCK];
+		for (Bit32u pattern = 0; pattern != 6 * 16; pattern++)
+		{
+			for (Bit32u i = 0; i != BYTESPERBLOCK; i++)
 			{
-				saveFile = fopen(savePath.c_str(), "wb+");
-				if (saveFile) { fwrite("FFDD\x1", 5, 1, saveFile); saveEndCursor = 5; };
-				savePath.clear();
+				switch (pattern % 6)
+				{
+					case 0: src[i] = 0; break; // long match
+					case 1: src[i] = (Bit8u)FFDD_RAND(); break; // incompressible
+					case 2: src[i] = (Bit8u)("MOV AX,BX\r\nINT 21h\r\n"[(i + pattern) % 20]); break; // short repeats
+					case 3: src[i] = (Bit8u)((i / (1 + pattern)) & 0xFF); break; // runs
+					case 4: src[i] = (i < 300 + pattern * 20 ? (Bit8u)FFDD_RAND() : 0); break; // long literals before a long match
+					case 5: src[i] = ((FFDD_RAND() & 7) ? src[i ? i - 1 : 0] : (Bit8u)FFDD_RAND()); break; // mixed
+				}
 			}
-			const bool reuseFree = (cursor_val == NULL_CURSOR && diffFreeCursors.size());
-			if (reuseFree)
+			for (Bit32u len = BYTESPERBLOCK - (pattern / 6) * 97; len; len = (len > 64 ? len / 3 : 0))
 			{
-				*cursor_ptr = cursor_val = diffFreeCursors.back();
-				diffFreeCursors.pop_back();
+				Bit32u complen = LZ4Compress(src, len, comp, (Bit32u)sizeof(comp));
+				memset(dec, 0xCC, len);
+				if (!complen || !LZ4Decompress(comp, complen, dec, len) || memcmp(src, dec, len)) errors++;
+				if (complen > 1 && LZ4Decompress(comp, complen - 1, dec, len)) errors++; // truncated input must fail
+				Bit32u smallcap = (complen > 1 ? complen - 1 : 0); // output that doesn't fit must fail
+				if (LZ4Compress(src, len, comp, smallcap)) errors++;
 			}
-			if (saveFile)
+		}
+		LOG_MSG("[DOSBOX] Self test of disk save LZ4: %s", (errors ? "FAILED" : "OK"));
+		DBP_ASSERT(!errors);
+
+		std::string path = inSavePath;
+		path += ".selftest";
+		std::vector<Bit8u> model((size_t)SECTS * BYTESPERSECTOR), present(SECTS);
+		bool oldCompress = dbp_diskdiff_compress;
+		for (int lz4 = 0; lz4 != 2; lz4++)
+		{
+			errors = 0;
+			dbp_diskdiff_compress = !!lz4;
+			remove(path.c_str());
+			std::fill(model.begin(), model.end(), (Bit8u)0);
+			std::fill(present.begin(), present.end(), (Bit8u)0);
+			Bit8u buf[BYTESPERSECTOR];
+			for (int round = 0; round != 4; round++)
 			{
-				if (cursor_val == NULL_CURSOR)
+				differencingDisk dd;
+				dd.SetupSave(path.c_str(), SECTS);
+				if ((round == 0) != !dd.saveFile || (round && !!(dd.fileFlags & FLAG_LZ4) != !!lz4)) errors++;
+				for (Bit32u s = 0; s != SECTS; s++)
 				{
-					*cursor_ptr = cursor_val = saveEndCursor;
-					saveEndCursor += sizeof(sectnum) + BYTESPERSECTOR;
-					writeSectNum:
-					Bit32u sectnumval;
-					var_write(&sectnumval, sectnum);
-					fseek_wrap(saveFile, cursor_val, SEEK_SET);
-					fwrite(&sectnumval, sizeof(sectnumval), 1, saveFile);
+					memset(buf, 0xCC, sizeof(buf));
+					if (dd.GetDiff(s, buf) != !!present[s] || (present[s] && memcmp(buf, &model[s * BYTESPERSECTOR], BYTESPERSECTOR))) errors++;
 				}
-				else if (reuseFree)
-					goto writeSectNum;
-				else
-					fseek_wrap(saveFile, cursor_val + sizeof(sectnum), SEEK_SET);
-				fwrite(data, BYTESPERSECTOR, 1, saveFile);
-			}
-			else
-			{
-				if (cursor_val == NULL_CURSOR)
+				for (Bit32u op = 0; op != (round == 3 ? 0u : (Bit32u)OPS); op++)
 				{
-					*cursor_ptr = cursor_val = (Bit32u)diffSectorBufs.size();
-					diffSectorBufs.resize(cursor_val + 1);
+					// Round 2 reverts most sectors to get the file compacted when closed
+					Bit32u s = (FFDD_RAND() % SECTS), kind = (round == 2 ? ((FFDD_RAND() % 8) ? 0 : 2) : (FFDD_RAND() % 4));
+					for (Bit32u i = 0; i != BYTESPERSECTOR; i++)
+						buf[i] = (kind == 0 ? 0 : kind == 1 ? (Bit8u)FFDD_RAND() : (Bit8u)(s + i / 16 + op));
+					if (kind == 3) buf[FFDD_RAND() % BYTESPERSECTOR] ^= 0xFF;
+					bool different = (kind != 0);
+					if (dd.WriteDiff(s, buf, NULL) != (different || present[s])) errors++;
+					memcpy(&model[s * BYTESPERSECTOR], buf, BYTESPERSECTOR);
+					present[s] = different;
+					if ((op & 1023) == 0)
+					{
+						Bit32u t = (FFDD_RAND() % SECTS);
+						memset(buf, 0xCC, sizeof(buf));
+						if (dd.GetDiff(t, buf) != !!present[t] || (present[t] && memcmp(buf, &model[t * BYTESPERSECTOR], BYTESPERSECTOR))) errors++;
+					}
 				}
-				memcpy(diffSectorBufs[cursor_val].data, data, BYTESPERSECTOR);
 			}
-			return true;
-		}
-		else if (cursor_val != NULL_CURSOR)
-		{
-			if (saveFile)
+			Bit32u remaining = 0;
+			for (Bit32u s = 0; s != SECTS; s++) remaining += present[s];
+			if (FILE* f = fopen_wrap(path.c_str(), "rb"))
 			{
-				// mark sector in diff file as free
-				Bit32u sectnumval = 0xFFFFFFFF;
-				fseek_wrap(saveFile, cursor_val, SEEK_SET);
-				fwrite(&sectnumval, sizeof(sectnumval), 1, saveFile);
+				fseek_wrap(f, 0, SEEK_END);
+				LOG_MSG("[DOSBOX] Self test of %s disk save file: %s (%u sectors in %u bytes)", (lz4 ? "LZ4" : "uncompressed"), (errors ? "FAILED" : "OK"), remaining, (Bit32u)ftell_wrap(f));
+				fclose(f);
 			}
-			diffFreeCursors.push_back(cursor_val);
-			*cursor_ptr = NULL_CURSOR;
-			return true;
+			else LOG_MSG("[DOSBOX] Self test of %s disk save file: FAILED (missing file)", (lz4 ? "LZ4" : "uncompressed"));
+			DBP_ASSERT(!errors);
+			remove(path.c_str());
 		}
-		return false;
-	}
-
-	bool GetDiff(Bit32u sectnum, void* data)
-	{
-		Bit32u cursor = (sectnum >= diffSectors.size() ? NULL_CURSOR : diffSectors[sectnum].cursor);
-		if (cursor == NULL_CURSOR) return false;
-		if (saveFile)
-		{
-			fseek_wrap(saveFile, cursor + sizeof(sectnum), SEEK_SET);
-			return !!fread(data, BYTESPERSECTOR, 1, saveFile);
-		}
-		memcpy(data, diffSectorBufs[cursor].data, BYTESPERSECTOR);
-		return true;
+		dbp_diskdiff_compress = oldCompress;
+		#undef FFDD_RAND
 	}
+	#endif
 };
 
 #ifdef _MSC_VER
@@ -718,10 +1284,7 @@ struct fatFromDOSDrive
 			}
 			if (df)
 			{
-				Bit32u pos = (sectnum - f.firstSect) * BYTESPERSECTOR;
-				Bit16u read = (Bit16u)BYTESPERSECTOR;
-				df->Seek(&pos, DOS_SEEK_SET);
-				if (!df->Read((Bit8u*)filebuf, &read)) { read = 0; DBP_ASSERT(0); }
+				Bit32u read = (Bit32u)df->ReadBulk((Bit8u*)filebuf, BYTESPERSECTOR, (Bit64u)(sectnum - f.firstSect) * BYTESPERSECTOR);
 				if (read != BYTESPERSECTOR)
 					memset((Bit8u*)filebuf + read, 0, BYTESPERSECTOR - read);
 				return filebuf;
@@ -918,6 +1481,11 @@ Bit8u imageDisk::Read_AbsoluteSector(Bit32u sectnum, void * data) {
 		return 0x00;
 
 	Bit64u bytenum = (Bit64u)sectnum * sector_size;
+	if (mapped)
+	{
+		mapped->Read(bytenum, data, sector_size);
+		return 0x00;
+	}
 	if (last_action==WRITE || bytenum!=current_fpos) dos_file->Seek64(&bytenum, DOS_SEEK_SET);
 	DBP_ASSERT(sector_size <= 0xFFFF);
 	Bit16u read_size = (Bit16u)sector_size;
@@ -936,6 +1504,38 @@ Bit8u imageDisk::Read_AbsoluteSector(Bit32u sectnum, void * data) {
 	return 0x00;
 }
 
+Bit8u imageDisk::Read_AbsoluteSectors(Bit32u start, Bit32u count, void * data) {
+	#ifdef C_DBP_SUPPORT_DISK_MOUNT_DOSFILE
+	#ifdef C_DBP_SUPPORT_DISK_FAT_EMULATOR
+	if (ffdd)
+	{
+		for (Bit32u i = 0; i != count; i++)
+			if (Bit8u res = ffdd->ReadSector(start + i, (Bit8u*)data + i * sector_size))
+				return res;
+		return 0x00;
+	}
+	#endif
+
+	// Read the whole range from the image then apply the sectors that have been modified on top of it
+	Bit8u* p = (Bit8u*)data;
+	Bit64u bytenum = (Bit64u)start * sector_size, len = (Bit64u)count * sector_size;
+	if (mapped) mapped->Read(bytenum, p, len);
+	else dos_file->ReadBulk(p, len, bytenum);
+
+	if (discard)
+		for (Bit32u i = 0; i != count; i++, p += sector_size)
+			discard->Read_AbsoluteSector(start + i, p, sector_size);
+	else if (differencing)
+		for (Bit32u i = 0; i != count; i++, p += sector_size)
+			differencing->GetDiff(start + i, p);
+	#else
+	for (Bit32u i = 0; i != count; i++)
+		if (Bit8u res = Read_AbsoluteSector(start + i, (Bit8u*)data + i * sector_size))
+			return res;
+	#endif
+	return 0x00;
+}
+
 Bit8u imageDisk::Write_Sector(Bit32u head,Bit32u cylinder,Bit32u sector,void * data) {
 	Bit32u sectnum;
 
@@ -959,15 +1559,24 @@ Bit8u imageDisk::Write_AbsoluteSector(Bit32u sectnum, void *data) {
 	if (differencing)
 	{
 		Bit64u unmodified_fpos = (Bit64u)sectnum * differencingDisk::BYTESPERSECTOR;
-		if (unmodified_fpos != current_fpos) dos_file->Seek64(&unmodified_fpos, DOS_SEEK_SET);
-		current_fpos = unmodified_fpos + differencingDisk::BYTESPERSECTOR;
 		Bit8u buf[differencingDisk::BYTESPERSECTOR];
-		Bit16u read_size = (Bit16u)differencingDisk::BYTESPERSECTOR;
-		const void* unmodified = (dos_file->Read(buf, &read_size) ? buf : NULL);
+		const void* unmodified;
+		if (mapped)
+			unmodified = (mapped->Read(unmodified_fpos, buf, differencingDisk::BYTESPERSECTOR) ? buf : NULL);
+		else
+		{
+			if (unmodified_fpos != current_fpos) dos_file->Seek64(&unmodified_fpos, DOS_SEEK_SET);
+			current_fpos = unmodified_fpos + differencingDisk::BYTESPERSECTOR;
+			Bit16u read_size = (Bit16u)differencingDisk::BYTESPERSECTOR;
+			unmodified = (dos_file->Read(buf, &read_size) ? buf : NULL);
+		}
 		differencing->WriteDiff(sectnum, data, unmodified);
 		return 0x00;
 	}
 
+	// The mapped view is read-only, once the image file itself gets modified go back to reading through the file
+	if (mapped) { delete mapped; mapped = NULL; }
+
 	Bit64u bytenum = (Bit64u)sectnum * sector_size;
 	if (last_action==READ || bytenum!=current_fpos) dos_file->Seek64(&bytenum, DOS_SEEK_SET);
 	DBP_ASSERT(sector_size <= 0xFFFF);
@@ -993,20 +1602,7 @@ Bit8u imageDisk::Write_AbsoluteSector(Bit32u sectnum, void *data) {
 #ifdef C_DBP_SUPPORT_DISK_MOUNT_DOSFILE
 Bit32u imageDisk::Read_Raw(Bit8u *buffer, Bit32u seek, Bit32u len)
 {
-	if (seek != current_fpos)
-	{
-		current_fpos = seek;
-		dos_file->Seek64(&current_fpos, DOS_SEEK_SET);
-	}
-	for (Bit32u remain = (Bit32u)len; remain;)
-	{
-		Bit16u sz = (remain > 0xFFFF ? 0xFFFF : (Bit16u)remain);
-		if (!dos_file->Read(buffer, &sz) || !sz) { len -= remain; break; }
-		remain -= sz;
-		buffer += sz;
-	}
-	current_fpos += (Bit32u)len;
-	return len;
+	return (Bit32u)dos_file->ReadBulk(buffer, len, seek);
 }
 
 void imageDisk::SetDifferencingDisk(const char* savePath)
@@ -1026,6 +1622,7 @@ imageDisk::~imageDisk()
 		if (!fat_drive || fat_drive->loadedDisk != this) continue;
 		fat_drive->loadedDisk = NULL;
 	}
+	if (mapped) delete mapped;
 	if (dos_file)
 	{
 		if (dos_file->IsOpen()) dos_file->Close();
@@ -1063,6 +1660,7 @@ imageDisk::imageDisk(FILE *imgFile, const char *imgName, Bit32u imgSizeK, bool i
 	dos_file->Seek64(&current_fpos, DOS_SEEK_SET);
 	if (!OPEN_IS_WRITING(dos_file->flags))
 		discard = new discardDisk();
+	mapped = mappedDisk::TryMap(dos_file);
 	#else
 	diskimg = imgFile;
 	fseek(diskimg,0,SEEK_SET);
@@ -1223,6 +1821,26 @@ static bool driveInactive(Bit8u driveNum) {
 }
 
 #ifdef C_DBP_LIBRETRO // added implementation of INT13 extensions from Taewoong's Daum branch
+//DBP: Read sectors into guest memory in larger chunks instead of one sector at a time
+//   The destination offset wraps around within the segment like the previous byte by byte loop did
+//   Returns as soon as a chunk fails to read or killRead is set without writing that chunk to memory
+static Bit8u INT13_ReadSectorsToMem(imageDisk* disk, Bit32u sectnum, Bitu count, Bit16u seg, Bit16u off) {
+	enum { CHUNK_SECTORS = 64 };
+	static Bit8u buf[CHUNK_SECTORS * 512];
+	DBP_ASSERT(disk->getSectSize() == 512);
+	for (Bitu n; count; count -= n, sectnum += (Bit32u)n) {
+		n = (count < CHUNK_SECTORS ? count : CHUNK_SECTORS);
+		Bit8u res = disk->Read_AbsoluteSectors(sectnum, (Bit32u)n, buf);
+		if (res || killRead) return res;
+		for (Bitu done = 0, len; done != n * 512; done += len, off += (Bit16u)len) {
+			len = n * 512 - done;
+			if (len > 0x10000 - (Bitu)off) len = 0x10000 - (Bitu)off;
+			MEM_BlockWrite(((PhysPt)seg << 4) + off, buf + done, len);
+		}
+	}
+	return 0x00;
+}
+
 struct DAP {
 	Bit8u sz;
 	Bit8u res;
@@ -1331,23 +1949,18 @@ static Bitu INT13_DiskHandler(void) {
 			return CBRET_NONE;
 		}
 
-		segat = SegValue(es);
-		bufptr = reg_bx;
-		for(i=0;i<reg_al;i++) {
-			last_status = imageDiskList[drivenum]->Read_Sector((Bit32u)reg_dh, (Bit32u)(reg_ch | ((reg_cl & 0xc0)<< 2)), (Bit32u)((reg_cl & 63)+i), sectbuf);
-			if((last_status != 0x00) || (killRead)) {
-				LOG_MSG("Error in disk read");
-				killRead = false;
-				reg_ah = 0x04;
-				CALLBACK_SCF(true);
-				return CBRET_NONE;
-			}
-			//DBP: Changed loop to use mem_writeb_inline
-			for(t=0;t<512;t++) {
-				//real_writeb(segat,bufptr,sectbuf[t]);
-				mem_writeb_inline((segat<<4)+bufptr,sectbuf[t]);
-				bufptr++;
-			}
+		//DBP: Changed to read all sectors in one go (sectors past the end of the track continue on the next one like before)
+		{
+			imageDisk* disk = imageDiskList[drivenum];
+			Bit32u sectnum = ((Bit32u)(reg_ch | ((reg_cl & 0xc0)<< 2)) * disk->heads + (Bit32u)reg_dh) * disk->sectors + (Bit32u)(reg_cl & 63) - 1;
+			last_status = INT13_ReadSectorsToMem(disk, sectnum, reg_al, SegValue(es), reg_bx);
+		}
+		if((last_status != 0x00) || (killRead)) {
+			LOG_MSG("Error in disk read");
+			killRead = false;
+			reg_ah = 0x04;
+			CALLBACK_SCF(true);
+			return CBRET_NONE;
 		}
 		reg_ah = 0x00;
 		CALLBACK_SCF(false);
@@ -1542,27 +2155,18 @@ static Bitu INT13_DiskHandler(void) {
 			return CBRET_NONE;
 		}
 
-		segat = dap.seg;
-		bufptr = dap.off;
-		for(i=0;i<dap.num;i++) {
-			last_status = imageDiskList[drivenum]->Read_AbsoluteSector(dap.sector+i, sectbuf);
+		//DBP: Changed to read all sectors in one go
+		last_status = INT13_ReadSectorsToMem(imageDiskList[drivenum], dap.sector, dap.num, dap.seg, dap.off);
 
-			////DBP: Omitted for now
-			//IDE_EmuINT13DiskReadByBIOS_LBA(reg_dl,dap.sector+i);
+		////DBP: Omitted for now
+		//IDE_EmuINT13DiskReadByBIOS_LBA(reg_dl,dap.sector+i);
 
-			if((last_status != 0x00) || (killRead)) {
-				LOG_MSG("Error in disk read");
-				killRead = false;
-				reg_ah = 0x04;
-				CALLBACK_SCF(true);
-				return CBRET_NONE;
-			}
-			//DBP: Changed loop to use mem_writeb_inline
-			for(t=0;t<512;t++) {
-				//real_writeb(segat,bufptr,sectbuf[t]);
-				mem_writeb_inline((segat<<4)+bufptr,sectbuf[t]);
-				bufptr++;
-			}
+		if((last_status != 0x00) || (killRead)) {
+			LOG_MSG("Error in disk read");
+			killRead = false;
+			reg_ah = 0x04;
+			CALLBACK_SCF(true);
+			return CBRET_NONE;
 		}
 		reg_ah = 0x00;
 		CALLBACK_SCF(false);